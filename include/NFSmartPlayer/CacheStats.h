@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace nativeformat {
+namespace smartplayer {
+
+// How well the decoded audio shared between files is being reused
+typedef struct CacheStats {
+  long _hits;              // Chunks that were already cached
+  long _shared;            // Chunks that joined a decode already under way
+  long _misses;            // Chunks that had to be decoded
+  double _hit_rate;        // Chunks that didn't need decoding, from 0 to 1
+  size_t _resident_bytes;  // Bytes of decoded audio the cache holds
+  size_t _budget_bytes;    // Bytes the cache holds at most
+} CacheStats;
+
+}  // namespace smartplayer
+}  // namespace nativeformat
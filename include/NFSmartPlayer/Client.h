@@ -21,6 +21,10 @@
 #pragma once
 
 #include <NFLogger/LogInfo.h>
+#include <NFSmartPlayer/CacheStats.h>
+#include <NFSmartPlayer/DecodeStats.h>
+#include <NFSmartPlayer/DiskCacheStats.h>
+#include <NFSmartPlayer/PrefetchStats.h>
 #include <NFSmartPlayer/CallbackTypes.h>
 #include <NFSmartPlayer/ErrorCode.h>
 #include <NFSmartPlayer/Graph.h>
@@ -57,16 +61,38 @@ typedef std::function<bool(const std::shared_ptr<Graph> &)>
 typedef std::function<bool(const std::shared_ptr<Script> &)>
     NF_SMART_PLAYER_SCRIPT_CALLBACK;
 
+// The outcome of rendering the loaded graphs to a wave file as fast as possible
+typedef struct OfflineRender {
+  bool _rendered;
+  std::string _error;
+  double _render_time;      // Seconds of audio written
+  double _elapsed_time;     // Seconds it took to render them
+  double _realtime_factor;  // How many times faster than realtime it ran
+  float _maximum_deviation;  // Largest sample difference from a serial render
+} OfflineRender;
+
+// How an offline render is split into segments rendered in parallel
+typedef struct OfflineRenderOptions {
+  int _segments;      // The most segments to render at once
+  double _preroll;    // Seconds rendered and thrown away before each segment
+  double _crossfade;  // Seconds each segment crossfades into the last over
+  bool _verify;       // Also render serially to measure _maximum_deviation
+} OfflineRenderOptions;
+
 extern const std::string PlayerErrorDomain;
 
 extern const char *NFSmartPlayerOscAddress;
 extern const char *PlayerMessageIdentifierEnd;
+extern const char *PlayerMessageIdentifierXrun;
 extern const char *PlayerSenderIdentifier;
 extern const char *Version;
 
 extern const int NFSmartPlayerOscReadPort;
 extern const int NFSmartPlayerOscWritePort;
 extern const int NFSmartPlayerLocalhostPort;
+extern const int NFSmartPlayerRenderThreads;
+extern const double NFSmartPlayerSampleRate;
+extern const int NFSmartPlayerBlockSize;
 
 class Client {
  public:
@@ -101,6 +127,61 @@ class Client {
   virtual void setLoadingPolicy(nfgrapher::LoadingPolicy loading_policy) = 0;
   virtual nfgrapher::LoadingPolicy loadingPolicy() const = 0;
   virtual bool isLoaded() = 0;
+  virtual OfflineRender renderOffline(const std::string &output_path,
+                                      double duration = 0.0) = 0;
+  virtual OfflineRender renderOfflineParallel(
+      const std::string &output_path, double duration,
+      const OfflineRenderOptions &options) = 0;
+  /**
+   * Times how long the player, its graphs and their nodes take to render
+   * blocks. Switching it on starts the stats over.
+   */
+  virtual void setProfiling(bool profiling) = 0;
+  virtual bool profiling() const = 0;
+  /**
+   * How long the player has taken to render each block while profiling, with
+   * the load being the DSP load of all the graphs together
+   */
+  virtual RenderStats renderStats() const = 0;
+  /**
+   * How many blocks a graph fades over when a changed score replaces the one
+   * it is playing. The new score gets ready off the render thread and catches
+   * up with the old one first. With none the new score takes over at once.
+   */
+  virtual void setCrossfadeBlocks(int crossfade_blocks) = 0;
+  virtual int crossfadeBlocks() const = 0;
+  /**
+   * How often files found their decoded audio already in the cache they all
+   * share, and how much memory it holds
+   */
+  virtual CacheStats fileCacheStats() const = 0;
+  /**
+   * How many decodes of files are waiting and running, and how many finished
+   * after playback needed their audio
+   */
+  virtual DecodeStats fileDecodeStats() const = 0;
+  /**
+   * How many bytes of decoded audio files may keep ahead of playback. Files
+   * needed soonest decode ahead first, the rest only open their decoders.
+   */
+  virtual void setFilePrefetchBudget(size_t budget_bytes) = 0;
+  /**
+   * How much of the budget files are using, and how often they were told to
+   * let go of their audio or were kept from decoding ahead
+   */
+  virtual PrefetchStats filePrefetchStats() const = 0;
+  /**
+   * Keeps the audio files decode in a directory, so later runs read it back
+   * rather than decoding it again. An empty directory stops using the disk,
+   * and a budget of 0 keeps the default.
+   */
+  virtual bool setFileDiskCache(const std::string &directory,
+                                size_t budget_bytes = 0) = 0;
+  /**
+   * How often files read their audio back from disk, and how much of it the
+   * directory holds
+   */
+  virtual DiskCacheStats fileDiskCacheStats() const = 0;
 };
 
 extern std::shared_ptr<Client> createClient(
@@ -110,7 +191,10 @@ extern std::shared_ptr<Client> createClient(
     int osc_read_port = NFSmartPlayerOscReadPort,
     int osc_write_port = NFSmartPlayerOscWritePort,
     const std::string osc_address = NFSmartPlayerOscAddress,
-    int localhost_write_port = NFSmartPlayerLocalhostPort);
+    int localhost_write_port = NFSmartPlayerLocalhostPort,
+    int render_threads = NFSmartPlayerRenderThreads,
+    double sample_rate = NFSmartPlayerSampleRate,
+    int block_size = NFSmartPlayerBlockSize);
 
 }  // namespace smartplayer
 }  // namespace nativeformat
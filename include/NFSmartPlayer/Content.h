@@ -49,7 +49,9 @@ class Content {
         _sample_rate(0.0),
         _channels(0),
         _required_items(0),
-        _payload_type(ContentPayloadTypeNone) {}
+        _payload_type(ContentPayloadTypeNone),
+        _silent(true),
+        _zeroed(true) {}
   Content(size_t payload_size, size_t items, double sample_rate,
           size_t channels, size_t required_items,
           ContentPayloadType payload_type)
@@ -58,20 +60,51 @@ class Content {
         _sample_rate(sample_rate),
         _channels(channels),
         _required_items(required_items),
-        _payload_type(payload_type) {}
+        _payload_type(payload_type),
+        _silent(true),
+        _zeroed(true) {}
 
-  float *payload() const { return const_cast<float *>(_payload.data()); }
+  // Handing out the payload means it may be written to, so it is no longer
+  // known to be silent
+  float *payload() const {
+    _silent = false;
+    _zeroed = false;
+    return const_cast<float *>(_payload.data());
+  }
+  // Reads the payload without giving up its silence
+  const float *constPayload() const { return _payload.data(); }
   size_t channels() const { return _channels; }
   size_t requiredItems() const { return _required_items; }
   double sampleRate() const { return _sample_rate; }
-  void setItems(size_t items) { _items = std::min(items, _required_items); }
+  void setItems(size_t items) {
+    items = std::min(items, _required_items);
+    // Only content that is all zeros stays silent as it grows
+    if (items > _items && !_zeroed) {
+      _silent = false;
+    }
+    _items = items;
+  }
   size_t items() const { return _items; }
   ContentPayloadType type() const { return _payload_type; }
   size_t payloadSize() const { return _payload.size(); }
+  // Whether every item is known to be zero, in which case consumers can skip
+  // processing it. Producers that leave their items as zeros can declare so.
+  bool silent() const { return _silent; }
+  void setSilent() {
+    if (!_silent) {
+      std::fill_n(_payload.begin(), _items, 0.0f);
+      _silent = true;
+    }
+  }
 
   void erase() {
     _items = 0;
-    std::fill(_payload.begin(), _payload.end(), 0);
+    // Content nobody wrote to since the last erase is still all zeros
+    if (!_zeroed) {
+      std::fill(_payload.begin(), _payload.end(), 0);
+      _zeroed = true;
+    }
+    _silent = true;
   }
 
   Content &operator=(const Content &rhs) {
@@ -84,6 +117,8 @@ class Content {
     _channels = rhs._channels;
     _required_items = rhs._required_items;
     _payload_type = rhs._payload_type;
+    _silent = rhs._silent;
+    _zeroed = rhs._zeroed;
     return *this;
   }
 
@@ -93,12 +128,31 @@ class Content {
       return 0;
     }
     size_t items_to_mix = std::min(_items, content.items());
+    if (content._silent) {
+      return items_to_mix;
+    }
     for (size_t i = 0; i < items_to_mix; ++i) {
       _payload[i] += content._payload[i];
     }
+    _silent = false;
+    _zeroed = false;
     return items_to_mix;
   }
 
+  // Replaces the items with those of another content, staying silent if the
+  // other content was
+  size_t copy(const Content &content) {
+    setItems(content.items());
+    if (content._silent) {
+      setSilent();
+      return _items;
+    }
+    std::copy_n(content._payload.data(), _items, _payload.data());
+    _silent = false;
+    _zeroed = false;
+    return _items;
+  }
+
   size_t append(const Content &content) {
     if (_payload_type != content.type() ||
         _payload_type != ContentPayloadTypeBuffer) {
@@ -106,8 +160,16 @@ class Content {
     }
     size_t items_to_append =
         std::min(_items + content.items(), _required_items) - _items;
-    _payload.resize(_payload.size() + items_to_append);
-    std::copy_n(&content._payload[0], items_to_append, &_payload[_items]);
+    resize(_items + items_to_append);
+    // Zeros appended to content that is all zeros already change nothing
+    if (!content._silent || !_zeroed) {
+      std::copy_n(content._payload.data(), items_to_append,
+                  _payload.data() + _items);
+    }
+    if (!content._silent) {
+      _silent = false;
+      _zeroed = false;
+    }
     _items += items_to_append;
     return items_to_append;
   }
@@ -119,6 +181,22 @@ class Content {
     }
   }
 
+  // make room for a payload of this size without allocating later
+  void reserve(size_t payload_size) { _payload.reserve(payload_size); }
+
+  // give the content a new shape, reusing the payload it already has room for
+  void reshape(size_t payload_size, double sample_rate, size_t channels,
+               size_t required_items, ContentPayloadType payload_type) {
+    _payload.resize(payload_size);
+    _items = 0;
+    _silent = false;
+    _zeroed = false;
+    _sample_rate = sample_rate;
+    _channels = channels;
+    _required_items = required_items;
+    _payload_type = payload_type;
+  }
+
  protected:
   std::vector<float> _payload;
   size_t _items;
@@ -126,6 +204,8 @@ class Content {
   size_t _channels;
   size_t _required_items;
   ContentPayloadType _payload_type;
+  mutable bool _silent;
+  mutable bool _zeroed;
 };
 
 }  // namespace plugin
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace nativeformat {
+namespace smartplayer {
+
+// How the decoding of files is keeping up with playback
+typedef struct DecodeStats {
+  size_t _queued;   // Decodes waiting for a thread
+  size_t _active;   // Decodes running
+  long _completed;  // Decodes that have finished
+  long _cancelled;  // Decodes dropped because playback moved away
+  long _missed;     // Decodes that finished after their audio was needed
+} DecodeStats;
+
+}  // namespace smartplayer
+}  // namespace nativeformat
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace nativeformat {
+namespace smartplayer {
+
+// How often files read their decoded audio back from disk instead of decoding
+typedef struct DiskCacheStats {
+  long _hits;              // Chunks read back from disk
+  long _misses;            // Chunks that had to be decoded
+  long _writes;            // Chunks written to disk after decoding
+  long _evictions;         // Chunks deleted to keep within the budget
+  long _corrupt;           // Chunks deleted because they failed their checks
+  size_t _resident_bytes;  // Bytes of decoded audio on disk
+  size_t _budget_bytes;    // Bytes kept on disk at most
+} DiskCacheStats;
+
+}  // namespace smartplayer
+}  // namespace nativeformat
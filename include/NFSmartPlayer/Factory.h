@@ -57,6 +57,33 @@ class Factory {
       const NF_PLUGIN_RESOLVE_CALLBACK &resolve_callback, int channels,
       double samplerate, const std::shared_ptr<plugin::Plugin> &child_plugin,
       const std::string &session_id) = 0;
+  /**
+   * The number of channels a plugin created for a node renders at
+   * @param grapher_node The grapher object describing the behaviour of the
+   * plugin
+   * @param input_channels The widest of the inputs to the node, or the graph
+   * channels if it has no inputs
+   * @param channels The number of channels the graph renders
+   * @discussion Branches that don't need the full width of the graph, such as
+   * a mono voice, can stay narrower until something widens them. The graph
+   * repeats the channels of narrower inputs for the plugins consuming them.
+   */
+  virtual int channels(const nfgrapher::Node &grapher_node, int input_channels,
+                       int channels) const {
+    return channels;
+  }
+  /**
+   * Whether a plugin created for a node feeds its inputs at the sample index
+   * it is fed itself, as Plugin::timeAligned reports once it exists
+   * @param grapher_node The grapher object describing the behaviour of the
+   * plugin
+   * @discussion The graph only shares a node between several consumers when
+   * every node between them and the output is time aligned. Anything below a
+   * loop, delay or stretch gets a subtree of its own.
+   */
+  virtual bool timeAligned(const nfgrapher::Node &grapher_node) const {
+    return false;
+  }
   /**
    * The identifiers represented by this factory
    * @warning This should not change.
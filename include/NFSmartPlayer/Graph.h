@@ -25,6 +25,7 @@
 #include <NFSmartPlayer/Edge.h>
 #include <NFSmartPlayer/ErrorCode.h>
 #include <NFSmartPlayer/Node.h>
+#include <NFSmartPlayer/RenderStats.h>
 #include <NFSmartPlayer/Script.h>
 
 #include <functional>
@@ -67,6 +68,17 @@ class Graph {
   virtual bool finished() = 0;
   virtual void forEachScript(
       NF_SMART_PLAYER_GRAPH_SCRIPT_CALLBACK script_callback) = 0;
+  /**
+   * Times how long the graph and each of its nodes take to render blocks.
+   * Switching it on starts the stats over, while it is off rendering pays
+   * next to nothing for it.
+   */
+  virtual void setProfiling(bool profiling) = 0;
+  virtual bool profiling() const = 0;
+  /**
+   * How long the graph has taken to render each block while profiling
+   */
+  virtual RenderStats renderStats() const = 0;
 
  protected:
   virtual void run() = 0;
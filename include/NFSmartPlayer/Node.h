@@ -21,6 +21,7 @@
 #pragma once
 
 #include <NFSmartPlayer/Plugin.h>
+#include <NFSmartPlayer/RenderStats.h>
 
 #include <functional>
 #include <memory>
@@ -33,6 +34,8 @@ namespace smartplayer {
 typedef std::function<bool(const std::shared_ptr<param::Param> &)>
     NF_SMART_PLAYER_NODE_PARAM_CALLBACK;
 
+class RenderProfile;
+
 class Node {
   friend class GraphImplementation;
 
@@ -50,6 +53,15 @@ class Node {
   virtual nfgrapher::LoadingPolicy loadingPolicy() const = 0;
   virtual std::vector<std::string> dependencies() const = 0;
   virtual void setPlugin(std::shared_ptr<plugin::Plugin> &plugin) = 0;
+  /**
+   * How long the plugin of the node has taken to feed each block while its
+   * graph was profiling, leaving out the time its inputs took
+   */
+  virtual RenderStats renderStats() const = 0;
+  /**
+   * What the graph records the render times of the node into
+   */
+  virtual std::shared_ptr<RenderProfile> renderProfile() const = 0;
 
  protected:
   virtual void run(double time, const plugin::NodeTimes &node_times,
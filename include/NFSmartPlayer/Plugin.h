@@ -24,6 +24,7 @@
 #include <NFGrapher/param/ParamUtil.h>
 #include <NFSmartPlayer/CallbackTypes.h>
 #include <NFSmartPlayer/Content.h>
+#include <NFSmartPlayer/Port.h>
 
 #include <functional>
 #include <map>
@@ -123,6 +124,23 @@ class Plugin {
   virtual void feed(std::map<std::string, std::shared_ptr<Content>> &content,
                     long sample_index, long graph_sample_index,
                     nfgrapher::LoadingPolicy loading_policy) = 0;
+  /**
+   * The same routine with the content keyed by interned port. Plugins that
+   * don't override this are fed through a content map built from the ports.
+   */
+  virtual void feedPorts(PortContent &content, long sample_index,
+                         long graph_sample_index,
+                         nfgrapher::LoadingPolicy loading_policy) {
+    std::map<std::string, std::shared_ptr<Content>> content_map;
+    content.copyTo(content_map);
+    feed(content_map, sample_index, graph_sample_index, loading_policy);
+    content.assign(content_map);
+  }
+  /**
+   * Whether the plugin implements feedPorts itself, and so would rather be fed
+   * that way
+   */
+  virtual bool feedsPorts() const { return false; }
   /**
    * This is called before the player begins rendering, the plugin must call the
    * callback to let the player know it is ready to load
@@ -177,6 +195,12 @@ class Plugin {
    * Allows time dilation for the nodes below the current node
    */
   virtual long timeDilation(long sample_index) { return sample_index; }
+  /**
+   * Whether the plugin always feeds its child first, with the same sample
+   * indices it was fed with. The player can then render the child ahead of the
+   * plugin rather than recursively from within its feed.
+   */
+  virtual bool timeAligned() const { return false; }
   /**
    * Whether the plugin has finished processing at a given time.
    */
@@ -201,5 +225,24 @@ class Plugin {
                              long sample_index_end) = 0;
 };
 
+/**
+ * A plugin that works on interned ports, which keeps working for hosts that
+ * feed it content maps
+ */
+class PortPlugin : public Plugin {
+ public:
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    PortContent port_content(content);
+    feedPorts(port_content, sample_index, graph_sample_index, loading_policy);
+    port_content.copyTo(content);
+  }
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override = 0;
+  bool feedsPorts() const override { return true; }
+};
+
 }  // namespace plugin
 }  // namespace nativeformat
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/Content.h>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace nativeformat {
+namespace plugin {
+
+typedef unsigned int PortId;
+
+extern const PortId AudioPortId;      // "audio"
+extern const PortId SidechainPortId;  // "sidechain"
+
+/**
+ * Returns the ID for a port name, creating one if the name hasn't been seen
+ * before. Intended to be called when loading graphs rather than when rendering.
+ */
+PortId internPort(const std::string &name);
+/**
+ * Returns the name a port ID was interned from
+ */
+std::string portName(PortId port);
+
+/**
+ * Content keyed by interned port ID. It holds at most a handful of ports, so a
+ * lookup is a short scan over integers rather than a string keyed map lookup.
+ */
+class PortContent {
+ public:
+  typedef std::pair<PortId, std::shared_ptr<Content>> Port;
+  static const size_t Capacity = 8;
+
+  PortContent() : _size(0) {}
+  explicit PortContent(
+      const std::map<std::string, std::shared_ptr<Content>> &content)
+      : _size(0) {
+    assign(content);
+  }
+
+  /**
+   * The content for a port, added empty if the port isn't present
+   */
+  std::shared_ptr<Content> &operator[](PortId port) {
+    for (size_t i = 0; i < _size; ++i) {
+      if (_ports[i].first == port) {
+        return _ports[i].second;
+      }
+    }
+    if (_size == Capacity) {
+      throw std::length_error("Too many ports for PortContent");
+    }
+    _ports[_size] = Port(port, nullptr);
+    return _ports[_size++].second;
+  }
+  /**
+   * The content for a port, or null if the port isn't present
+   */
+  Content *find(PortId port) const {
+    for (size_t i = 0; i < _size; ++i) {
+      if (_ports[i].first == port) {
+        return _ports[i].second.get();
+      }
+    }
+    return nullptr;
+  }
+  bool has(PortId port) const { return find(port) != nullptr; }
+  size_t size() const { return _size; }
+  Port *begin() { return _ports.data(); }
+  Port *end() { return _ports.data() + _size; }
+  const Port *begin() const { return _ports.data(); }
+  const Port *end() const { return _ports.data() + _size; }
+  void clear() {
+    for (size_t i = 0; i < _size; ++i) {
+      _ports[i].second = nullptr;
+    }
+    _size = 0;
+  }
+
+  /**
+   * Bridges to plugins that use content maps
+   */
+  void assign(const std::map<std::string, std::shared_ptr<Content>> &content) {
+    clear();
+    for (const auto &content_pair : content) {
+      (*this)[internPort(content_pair.first)] = content_pair.second;
+    }
+  }
+  void copyTo(std::map<std::string, std::shared_ptr<Content>> &content) const {
+    for (size_t i = 0; i < _size; ++i) {
+      content[portName(_ports[i].first)] = _ports[i].second;
+    }
+  }
+
+ private:
+  std::array<Port, Capacity> _ports;
+  size_t _size;
+};
+
+}  // namespace plugin
+}  // namespace nativeformat
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace nativeformat {
+namespace smartplayer {
+
+// How the memory files may hold ahead of playback is being spent
+typedef struct PrefetchStats {
+  size_t _budget_bytes;   // Bytes files may keep decoded at most
+  size_t _planned_bytes;  // Bytes the files kept decoded need
+  size_t _decoded_files;  // Files keeping their audio decoded
+  size_t _open_files;     // Files only keeping their decoder open
+  long _evictions;        // Times a file was told to let go of what it held
+  long _deferrals;        // Times the budget kept a file from decoding ahead
+} PrefetchStats;
+
+}  // namespace smartplayer
+}  // namespace nativeformat
@@ -68,6 +68,19 @@ class Registry {
       int channels, double samplerate,
       const std::shared_ptr<plugin::Plugin> &child_plugin,
       const std::string &session_id) const;
+  /**
+   * The number of channels the plugin for a node renders at, between 1 and the
+   * graph channels
+   * @see Factory::channels
+   */
+  int channels(const nfgrapher::Node &grapher_node, int input_channels,
+               int channels) const;
+  /**
+   * Whether the plugin for a node feeds its inputs at the sample index it is
+   * fed itself
+   * @see Factory::timeAligned
+   */
+  bool timeAligned(const nfgrapher::Node &grapher_node) const;
   /**
    * Whether the plugin registry contains a plugin
    * @param plugin_identifier The plugin identifier to check for
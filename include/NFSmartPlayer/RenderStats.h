@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+namespace nativeformat {
+namespace smartplayer {
+
+// How long something took to render its blocks since profiling was enabled
+typedef struct RenderStats {
+  long _blocks;       // Blocks rendered
+  double _mean_time;  // Seconds an average block took
+  double _p99_time;   // Seconds 99% of the blocks rendered within
+  double _max_time;   // Seconds the slowest block took
+  double _load;       // Render time as a percentage of the blocks' duration
+} RenderStats;
+
+}  // namespace smartplayer
+}  // namespace nativeformat
@@ -81,17 +81,71 @@ typedef struct NF_SMART_PLAYER_SETTINGS {
   const char *_osc_address;
   int _localhost_port;
   int _pump_manually;
+  int _render_threads;
+  double _sample_rate;  // 0 for NF_SMART_PLAYER_SAMPLE_RATE, the only rate
+                        // that plays, others render offline
+  int _block_size;      // Frames rendered at a time, 0 for the default
 } NF_SMART_PLAYER_SETTINGS;
+typedef struct NF_SMART_PLAYER_OFFLINE_RENDER {
+  int _rendered;
+  double _render_time;
+  double _elapsed_time;
+  double _realtime_factor;
+  float _maximum_deviation;
+} NF_SMART_PLAYER_OFFLINE_RENDER;
+typedef struct NF_SMART_PLAYER_RENDER_STATS {
+  long _blocks;       // Blocks rendered while profiling
+  double _mean_time;  // Seconds an average block took
+  double _p99_time;   // Seconds 99% of the blocks rendered within
+  double _max_time;   // Seconds the slowest block took
+  double _load;       // Render time as a percentage of the blocks' duration
+} NF_SMART_PLAYER_RENDER_STATS;
+typedef struct NF_SMART_PLAYER_CACHE_STATS {
+  long _hits;            // Chunks of decoded audio that were already cached
+  long _shared;          // Chunks that joined a decode already under way
+  long _misses;          // Chunks that had to be decoded
+  double _hit_rate;      // Chunks that didn't need decoding, from 0 to 1
+  long _resident_bytes;  // Bytes of decoded audio the cache holds
+  long _budget_bytes;    // Bytes the cache holds at most
+} NF_SMART_PLAYER_CACHE_STATS;
+typedef struct NF_SMART_PLAYER_DECODE_STATS {
+  long _queued;     // Decodes of files waiting for a thread
+  long _active;     // Decodes running
+  long _completed;  // Decodes that have finished
+  long _cancelled;  // Decodes dropped because playback moved away
+  long _missed;     // Decodes that finished after their audio was needed
+} NF_SMART_PLAYER_DECODE_STATS;
+typedef struct NF_SMART_PLAYER_PREFETCH_STATS {
+  long _budget_bytes;   // Bytes files may keep decoded at most
+  long _planned_bytes;  // Bytes the files kept decoded need
+  long _decoded_files;  // Files keeping their audio decoded
+  long _open_files;     // Files only keeping their decoder open
+  long _evictions;      // Times a file was told to let go of what it held
+  long _deferrals;      // Times the budget kept a file from decoding ahead
+} NF_SMART_PLAYER_PREFETCH_STATS;
+typedef struct NF_SMART_PLAYER_DISK_CACHE_STATS {
+  long _hits;            // Chunks of audio read back from disk
+  long _misses;          // Chunks that had to be decoded
+  long _writes;          // Chunks written to disk after decoding
+  long _evictions;       // Chunks deleted to keep within the budget
+  long _corrupt;         // Chunks deleted because they failed their checks
+  long _resident_bytes;  // Bytes of decoded audio on disk
+  long _budget_bytes;    // Bytes kept on disk at most
+} NF_SMART_PLAYER_DISK_CACHE_STATS;
 
 extern const char *NF_SMART_PLAYER_OSC_ADDRESS;
 extern const char *NF_SMART_PLAYER_DRIVER_TYPE_FILE_STRING;
 extern const char *NF_SMART_PLAYER_DRIVER_TYPE_SOUNDCARD_STRING;
 extern const char *NF_SMART_PLAYER_SENDER_IDENTIFIER;
 extern const char *NF_SMART_PLAYER_MESSAGE_IDENTIFIER_END;
+extern const char *NF_SMART_PLAYER_MESSAGE_IDENTIFIER_XRUN;
 extern const char *NF_SMART_PLAYER_VERSION;
 extern const int NF_SMART_PLAYER_OSC_READ_PORT;
 extern const int NF_SMART_PLAYER_OSC_WRITE_PORT;
 extern const int NF_SMART_PLAYER_LOCALHOST_PORT;
+extern const int NF_SMART_PLAYER_RENDER_THREADS;
+extern const double NF_SMART_PLAYER_SAMPLE_RATE;
+extern const int NF_SMART_PLAYER_BLOCK_SIZE;
 extern const NF_SMART_PLAYER_SETTINGS NF_SMART_PLAYER_DEFAULT_SETTINGS;
 
 // Player
@@ -141,7 +195,34 @@ extern void smartplayer_set_values_for_path(NF_SMART_PLAYER_HANDLE handle,
                                             const char *path, float *values,
                                             size_t values_length);
 extern int smartplayer_is_loaded(NF_SMART_PLAYER_HANDLE handle);
+extern NF_SMART_PLAYER_OFFLINE_RENDER smartplayer_render_offline(
+    NF_SMART_PLAYER_HANDLE handle, const char *output_path, double duration);
+extern NF_SMART_PLAYER_OFFLINE_RENDER smartplayer_render_offline_parallel(
+    NF_SMART_PLAYER_HANDLE handle, const char *output_path, double duration,
+    int segments, double preroll, double crossfade, int verify);
 extern void *smartplayer_get_context(NF_SMART_PLAYER_HANDLE handle);
+extern void smartplayer_set_profiling(NF_SMART_PLAYER_HANDLE handle,
+                                      int profiling);
+extern int smartplayer_is_profiling(NF_SMART_PLAYER_HANDLE handle);
+extern void smartplayer_set_crossfade_blocks(NF_SMART_PLAYER_HANDLE handle,
+                                             int crossfade_blocks);
+extern int smartplayer_get_crossfade_blocks(NF_SMART_PLAYER_HANDLE handle);
+extern NF_SMART_PLAYER_RENDER_STATS smartplayer_render_stats(
+    NF_SMART_PLAYER_HANDLE handle);
+extern NF_SMART_PLAYER_CACHE_STATS smartplayer_file_cache_stats(
+    NF_SMART_PLAYER_HANDLE handle);
+extern NF_SMART_PLAYER_DECODE_STATS smartplayer_file_decode_stats(
+    NF_SMART_PLAYER_HANDLE handle);
+extern void smartplayer_set_file_prefetch_budget(NF_SMART_PLAYER_HANDLE handle,
+                                                 long budget_bytes);
+extern NF_SMART_PLAYER_PREFETCH_STATS smartplayer_file_prefetch_stats(
+    NF_SMART_PLAYER_HANDLE handle);
+// Budgets of 0 or less keep the default
+extern int smartplayer_set_file_disk_cache(NF_SMART_PLAYER_HANDLE handle,
+                                           const char *directory,
+                                           long budget_bytes);
+extern NF_SMART_PLAYER_DISK_CACHE_STATS smartplayer_file_disk_cache_stats(
+    NF_SMART_PLAYER_HANDLE handle);
 
 // Graph
 extern NF_SMART_PLAYER_GRAPH_HANDLE smartplayer_create_graph(
@@ -167,6 +248,8 @@ extern NF_SMART_PLAYER_PARAM_HANDLE smartplayer_graph_get_parameter(
     NF_SMART_PLAYER_GRAPH_HANDLE graph, const char *path);
 extern void smartplayer_graph_close(NF_SMART_PLAYER_GRAPH_HANDLE graph);
 extern int smartplayer_graph_loaded(NF_SMART_PLAYER_GRAPH_HANDLE graph);
+extern NF_SMART_PLAYER_RENDER_STATS smartplayer_graph_render_stats(
+    NF_SMART_PLAYER_GRAPH_HANDLE graph);
 
 // Edge
 extern NF_SMART_PLAYER_EDGE_HANDLE smartplayer_create_edge(const char *source,
@@ -197,6 +280,8 @@ extern NF_SMART_PLAYER_PARAM_HANDLE smartplayer_node_get_param(
     NF_SMART_PLAYER_NODE_HANDLE node_handle, const char *param_identifier);
 extern NF_SMART_PLAYER_PARAM_HANDLE smartplayer_node_get_param_at_index(
     NF_SMART_PLAYER_NODE_HANDLE node_handle, int param_index);
+extern NF_SMART_PLAYER_RENDER_STATS smartplayer_node_render_stats(
+    NF_SMART_PLAYER_NODE_HANDLE node_handle);
 extern void smartplayer_node_close(NF_SMART_PLAYER_NODE_HANDLE node_handle);
 
 // Script
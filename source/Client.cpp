@@ -29,6 +29,7 @@ namespace smartplayer {
 const std::string PlayerErrorDomain("com.nativeformat.smartplayer");
 
 const char *PlayerMessageIdentifierEnd = "com.nativeformat.player.end";
+const char *PlayerMessageIdentifierXrun = "com.nativeformat.player.xrun";
 const char *PlayerSenderIdentifier = "com.nativeformat.client";
 const char *Version = SMARTPLAYER_VERSION;
 
@@ -36,10 +37,12 @@ std::shared_ptr<Client> createClient(
     NF_SMART_PLAYER_RESOLVE_CALLBACK resolve_callback,
     NF_SMART_PLAYER_ERROR_CALLBACK error_callback, DriverType driver_type,
     std::string output_destination, int osc_read_port, int osc_write_port,
-    const std::string osc_address, int localhost_write_port) {
+    const std::string osc_address, int localhost_write_port,
+    int render_threads, double sample_rate, int block_size) {
   return std::make_shared<ClientImplementation>(
       resolve_callback, error_callback, driver_type, output_destination,
-      osc_read_port, osc_write_port, osc_address, localhost_write_port);
+      osc_read_port, osc_write_port, osc_address, localhost_write_port,
+      render_threads, sample_rate, block_size);
 }
 
 }  // namespace smartplayer
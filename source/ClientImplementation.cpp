@@ -27,7 +27,11 @@
 #include "plugins/channel/PluginFactory.h"
 #include "plugins/compressor/CompressorPluginFactory.h"
 #include "plugins/eq/EQPluginFactory.h"
+#include "plugins/file/DecodeScheduler.h"
+#include "plugins/file/DiskPCMCache.h"
 #include "plugins/file/FilePluginFactory.h"
+#include "plugins/file/PCMCache.h"
+#include "plugins/file/PrefetchPlanner.h"
 #include "plugins/noise/NoisePluginFactory.h"
 #include "plugins/time/TimePluginFactory.h"
 #include "plugins/waa/WAAPluginFactory.h"
@@ -43,12 +47,17 @@ const char *NFSmartPlayerOscAddress = "127.0.0.1";
 const int NFSmartPlayerOscReadPort = 7003;
 const int NFSmartPlayerOscWritePort = 7000;
 const int NFSmartPlayerLocalhostPort = 64855;
+const int NFSmartPlayerRenderThreads = 1;
+const double NFSmartPlayerSampleRate = NF_DRIVER_SAMPLERATE;
+const int NFSmartPlayerBlockSize =
+    NF_DRIVER_SAMPLE_BLOCK_SIZE / NF_DRIVER_CHANNELS;
 
 ClientImplementation::ClientImplementation(
     NF_SMART_PLAYER_RESOLVE_CALLBACK resolve_callback,
     NF_SMART_PLAYER_ERROR_CALLBACK error_callback, DriverType driver_type,
     std::string output_destination, int osc_read_port, int osc_write_port,
-    const std::string osc_address, int localhost_write_port)
+    const std::string osc_address, int localhost_write_port,
+    int render_threads, double sample_rate, int block_size)
     : _authorisers(),
       _client(http::createClient(
           http::standardCacheLocation(), "Native Format Player 0.1",
@@ -70,7 +79,7 @@ ClientImplementation::ClientImplementation(
                    std::make_shared<plugin::time::TimePluginFactory>()}),
               resolve_callback),
           error_callback, localhost_write_port, driver_type, output_destination,
-          _io_service)),
+          _io_service, render_threads, sample_rate, block_size)),
       _thread(&ClientImplementation::thread, &_io_service, _smart_player) {
   // TODO: Add this back someday
   /*
@@ -194,6 +203,65 @@ nfgrapher::LoadingPolicy ClientImplementation::loadingPolicy() const {
 
 bool ClientImplementation::isLoaded() { return _smart_player->isLoaded(); }
 
+OfflineRender ClientImplementation::renderOffline(
+    const std::string &output_path, double duration) {
+  return _smart_player->renderOffline(output_path, duration);
+}
+
+OfflineRender ClientImplementation::renderOfflineParallel(
+    const std::string &output_path, double duration,
+    const OfflineRenderOptions &options) {
+  return _smart_player->renderOfflineParallel(output_path, duration, options);
+}
+
+void ClientImplementation::setProfiling(bool profiling) {
+  _smart_player->setProfiling(profiling);
+}
+
+bool ClientImplementation::profiling() const {
+  return _smart_player->profiling();
+}
+
+RenderStats ClientImplementation::renderStats() const {
+  return _smart_player->renderStats();
+}
+
+void ClientImplementation::setCrossfadeBlocks(int crossfade_blocks) {
+  _smart_player->setCrossfadeBlocks(crossfade_blocks);
+}
+
+int ClientImplementation::crossfadeBlocks() const {
+  return _smart_player->crossfadeBlocks();
+}
+
+CacheStats ClientImplementation::fileCacheStats() const {
+  return plugin::file::PCMCache::sharedCache()->stats();
+}
+
+DecodeStats ClientImplementation::fileDecodeStats() const {
+  return plugin::file::DecodeScheduler::sharedScheduler()->stats();
+}
+
+void ClientImplementation::setFilePrefetchBudget(size_t budget_bytes) {
+  plugin::file::PrefetchPlanner::sharedPlanner()->setBudgetBytes(budget_bytes);
+}
+
+PrefetchStats ClientImplementation::filePrefetchStats() const {
+  return plugin::file::PrefetchPlanner::sharedPlanner()->stats();
+}
+
+bool ClientImplementation::setFileDiskCache(const std::string &directory,
+                                            size_t budget_bytes) {
+  return plugin::file::DiskPCMCache::sharedCache()->setDirectory(
+      directory, budget_bytes > 0
+                     ? budget_bytes
+                     : plugin::file::DiskPCMCacheDefaultBudgetBytes);
+}
+
+DiskCacheStats ClientImplementation::fileDiskCacheStats() const {
+  return plugin::file::DiskPCMCache::sharedCache()->stats();
+}
+
 void ClientImplementation::thread(
     boost::asio::io_service *io_service,
     std::shared_ptr<smartplayer::Player> smart_player) {
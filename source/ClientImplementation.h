@@ -45,7 +45,10 @@ class ClientImplementation : public Client {
                        NF_SMART_PLAYER_ERROR_CALLBACK error_callback,
                        DriverType driver_type, std::string output_destination,
                        int osc_read_port, int osc_write_port,
-                       const std::string osc_address, int localhost_write_port);
+                       const std::string osc_address, int localhost_write_port,
+                       int render_threads = NFSmartPlayerRenderThreads,
+                       double sample_rate = NFSmartPlayerSampleRate,
+                       int block_size = NFSmartPlayerBlockSize);
   virtual ~ClientImplementation();
 
   // Client
@@ -78,6 +81,23 @@ class ClientImplementation : public Client {
   void setLoadingPolicy(nfgrapher::LoadingPolicy loading_policy) override;
   nfgrapher::LoadingPolicy loadingPolicy() const override;
   bool isLoaded() override;
+  OfflineRender renderOffline(const std::string &output_path,
+                              double duration) override;
+  OfflineRender renderOfflineParallel(
+      const std::string &output_path, double duration,
+      const OfflineRenderOptions &options) override;
+  void setProfiling(bool profiling) override;
+  bool profiling() const override;
+  RenderStats renderStats() const override;
+  void setCrossfadeBlocks(int crossfade_blocks) override;
+  int crossfadeBlocks() const override;
+  CacheStats fileCacheStats() const override;
+  DecodeStats fileDecodeStats() const override;
+  void setFilePrefetchBudget(size_t budget_bytes) override;
+  PrefetchStats filePrefetchStats() const override;
+  bool setFileDiskCache(const std::string &directory,
+                        size_t budget_bytes = 0) override;
+  DiskCacheStats fileDiskCacheStats() const override;
 
  private:
   static void thread(boost::asio::io_service *io_service,
@@ -0,0 +1,606 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "ExecutionPlan.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "RenderThreadPool.h"
+
+namespace nativeformat {
+namespace plugin {
+
+const std::string ExecutionPlanIdentifier("com.nativeformat.plugin.plan");
+
+static const double ExecutionPlanFeedCostSmoothing = 0.1;
+
+PlanInputPlugin::PlanInputPlugin(
+    const std::vector<MixerPlugin::Metadata> &metadata, int channels,
+    double samplerate,
+    std::shared_ptr<smartplayer::RenderThreadPool> render_thread_pool)
+    : _mixer(std::make_shared<MixerPlugin>(metadata, channels, samplerate,
+                                           render_thread_pool)),
+      _steps(nullptr),
+      _connected(false),
+      _timing_feeds(false),
+      _feed_nanos(0) {}
+
+PlanInputPlugin::~PlanInputPlugin() {}
+
+void PlanInputPlugin::bind(const std::vector<Input> &inputs,
+                           const std::vector<ExecutionStep> &steps) {
+  _steps = &steps;
+  _connections.clear();
+  for (const auto &input : inputs) {
+    for (const auto &edge : input._edges) {
+      _connections.push_back({&steps[input._step], internPort(edge.first),
+                              nullptr, internPort(edge.second), edge.second,
+                              inputs.size() > 1});
+    }
+  }
+  _mixed_content.reserve(_connections.size());
+  _connected = false;
+}
+
+void PlanInputPlugin::rebind() { _connected = false; }
+
+void PlanInputPlugin::unbind() {
+  _steps = nullptr;
+  _connections.clear();
+  _connected = false;
+}
+
+bool PlanInputPlugin::bound() const { return _steps != nullptr; }
+
+void PlanInputPlugin::startTimingFeeds() {
+  _timing_feeds = true;
+  _feed_nanos = 0;
+}
+
+long PlanInputPlugin::stopTimingFeeds() {
+  _timing_feeds = false;
+  return _feed_nanos;
+}
+
+void PlanInputPlugin::majorTimeChange(long sample_index,
+                                      long graph_sample_index) {
+  _mixer->majorTimeChange(sample_index, graph_sample_index);
+}
+
+void PlanInputPlugin::potentialTimeChange(long sample_index,
+                                          long graph_sample_index) {
+  _mixer->potentialTimeChange(sample_index, graph_sample_index);
+}
+
+std::string PlanInputPlugin::name() { return _mixer->name(); }
+
+bool PlanInputPlugin::finished(long sample_index, long sample_index_end) {
+  return _mixer->finished(sample_index, sample_index_end);
+}
+
+void PlanInputPlugin::notifyFinished(long sample_index,
+                                     long graph_sample_index) {
+  _mixer->notifyFinished(sample_index, graph_sample_index);
+}
+
+Plugin::PluginType PlanInputPlugin::type() const { return _mixer->type(); }
+
+void PlanInputPlugin::feed(
+    std::map<std::string, std::shared_ptr<Content>> &content,
+    long sample_index, long graph_sample_index,
+    nfgrapher::LoadingPolicy loading_policy) {
+  if (!_timing_feeds) {
+    feedInputs(content, sample_index, graph_sample_index, loading_policy);
+    return;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  feedInputs(content, sample_index, graph_sample_index, loading_policy);
+  _feed_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+}
+
+void PlanInputPlugin::feedPorts(PortContent &content, long sample_index,
+                                long graph_sample_index,
+                                nfgrapher::LoadingPolicy loading_policy) {
+  if (!_timing_feeds) {
+    feedInputPorts(content, sample_index, graph_sample_index, loading_policy);
+    return;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  feedInputPorts(content, sample_index, graph_sample_index, loading_policy);
+  _feed_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+}
+
+void PlanInputPlugin::feedInputs(
+    std::map<std::string, std::shared_ptr<Content>> &content,
+    long sample_index, long graph_sample_index,
+    nfgrapher::LoadingPolicy loading_policy) {
+  if (!bound()) {
+    _mixer->feed(content, sample_index, graph_sample_index, loading_policy);
+    return;
+  }
+
+  // The plan has already rendered our inputs, so all that is left is to mix
+  // them in the same order the MixerPlugin would have
+  if (!_connected) {
+    connect();
+  }
+  _mixed_content.clear();
+  for (const auto &connection : _connections) {
+    if (!mixes(connection)) {
+      continue;
+    }
+    // The plan creates the ports its steps are fed, so only content a
+    // plugin hands over itself can lack one. It takes its shape from the
+    // audio content, just as the MixerPlugin does.
+    auto destination_it = content.find(connection._destination);
+    if (destination_it == content.end()) {
+      const Content &audio = *content[AudioContentTypeKey];
+      destination_it =
+          content
+              .emplace(connection._destination,
+                       std::make_shared<Content>(
+                           audio.payloadSize(), 0, audio.sampleRate(),
+                           audio.channels(), audio.requiredItems(),
+                           audio.type()))
+              .first;
+    }
+    mix(*connection._source, *destination_it->second, loading_policy);
+  }
+}
+
+void PlanInputPlugin::feedInputPorts(PortContent &content, long sample_index,
+                                     long graph_sample_index,
+                                     nfgrapher::LoadingPolicy loading_policy) {
+  if (!bound()) {
+    content.copyTo(_content_map);
+    _mixer->feed(_content_map, sample_index, graph_sample_index,
+                 loading_policy);
+    content.assign(_content_map);
+    return;
+  }
+
+  if (!_connected) {
+    connect();
+  }
+  _mixed_content.clear();
+  for (const auto &connection : _connections) {
+    if (!mixes(connection)) {
+      continue;
+    }
+    Content *destination = content.find(connection._destination_port);
+    if (!destination) {
+      const Content &audio = *content[AudioPortId];
+      auto &port = content[connection._destination_port];
+      port = std::make_shared<Content>(audio.payloadSize(), 0,
+                                       audio.sampleRate(), audio.channels(),
+                                       audio.requiredItems(), audio.type());
+      destination = port.get();
+    }
+    mix(*connection._source, *destination, loading_policy);
+  }
+}
+
+bool PlanInputPlugin::feedsPorts() const { return true; }
+
+void PlanInputPlugin::connect() {
+  for (auto &connection : _connections) {
+    connection._source = connection._step->_ports.find(connection._source_port);
+  }
+  _connected = true;
+}
+
+bool PlanInputPlugin::mixes(const Connection &connection) const {
+  // A step shared with an ungated consumer runs even when it has nothing to
+  // say, so the consumers that asked still leave it out, as a mixer would
+  return connection._step->_active &&
+         (!connection._gated || connection._step->_processing);
+}
+
+void PlanInputPlugin::mix(const Content &source, Content &destination,
+                          nfgrapher::LoadingPolicy loading_policy) {
+  if (std::find(_mixed_content.begin(), _mixed_content.end(), &destination) ==
+      _mixed_content.end()) {
+    // Copy instead of mixing since there's nothing in destination yet
+    destination.copy(source);
+    _mixed_content.push_back(&destination);
+    return;
+  }
+  switch (loading_policy) {
+    case nfgrapher::LoadingPolicy::SOME_CONTENT_PLAYTHROUGH:
+      destination.setItems(std::max(source.items(), destination.items()));
+      break;
+    case nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH:
+      destination.setItems(std::min(source.items(), destination.items()));
+      break;
+  }
+  destination.mix(source);
+}
+
+void PlanInputPlugin::load(LOAD_CALLBACK callback) { _mixer->load(callback); }
+
+bool PlanInputPlugin::loaded() const { return _mixer->loaded(); }
+
+void PlanInputPlugin::run(long sample_index, const NodeTimes &node_times,
+                          long node_sample_index) {
+  _mixer->run(sample_index, node_times, node_sample_index);
+}
+
+long PlanInputPlugin::startSampleIndex() { return _mixer->startSampleIndex(); }
+
+bool PlanInputPlugin::shouldProcess(long sample_index_start,
+                                    long sample_index_end) {
+  return _mixer->shouldProcess(sample_index_start, sample_index_end);
+}
+
+ExecutionPlan::ExecutionPlan(
+    const std::shared_ptr<Node> &output,
+    std::shared_ptr<smartplayer::RenderThreadPool> render_thread_pool,
+    bool feeds_ports, bool bind_inputs)
+    : _output(output->_input),
+      _render_thread_pool(render_thread_pool),
+      _payload_size(-1),
+      _required_items(-1),
+      _channels(-1),
+      _samplerate(0.0) {
+  CompileContext compile_context;
+  compile_context._feeds_ports = feeds_ports;
+  std::set<const Node *> visited_nodes;
+  findRecursiveNodes(output, false, visited_nodes,
+                     compile_context._recursive_nodes);
+  // Nodes kept from an earlier plan may still be bound to its steps, those
+  // this plan renders recursively have to forget them
+  for (const auto *nodes :
+       {&visited_nodes, &compile_context._recursive_nodes}) {
+    for (const Node *node : *nodes) {
+      if (node->_input) {
+        _unbound_inputs.push_back(node->_input);
+      }
+    }
+  }
+  compile(output, -1, compile_context);
+  _bindings.swap(compile_context._bindings);
+  _inputs.reserve(_bindings.size());
+
+  // Order the steps so each level only depends on the levels before it
+  for (size_t i = 0; i < _steps.size(); ++i) {
+    _order.push_back(i);
+  }
+  std::stable_sort(_order.begin(), _order.end(), [this](size_t a, size_t b) {
+    return _steps[a]._level < _steps[b]._level;
+  });
+  for (size_t i = 0; i < _order.size(); ++i) {
+    if (i == 0 || _steps[_order[i]]._level != _steps[_order[i - 1]]._level) {
+      _level_offsets.push_back(i);
+    }
+  }
+  _level_offsets.push_back(_order.size());
+  _level_feed_nanos.resize(_level_offsets.size() - 1, 0.0);
+  if (bind_inputs) {
+    bind();
+  }
+}
+
+ExecutionPlan::~ExecutionPlan() {}
+
+size_t ExecutionPlan::steps() const { return _steps.size(); }
+
+void ExecutionPlan::bind() {
+  for (const auto &input : _unbound_inputs) {
+    input->unbind();
+  }
+  _inputs.clear();
+  for (const auto &binding : _bindings) {
+    binding.first->bind(binding.second, _steps);
+    _inputs.push_back(binding.first);
+  }
+}
+
+void ExecutionPlan::findRecursiveNodes(
+    const std::shared_ptr<Node> &node, bool recursive,
+    std::set<const Node *> &visited_nodes,
+    std::set<const Node *> &recursive_nodes) {
+  if (recursive) {
+    if (!recursive_nodes.insert(node.get()).second) {
+      return;
+    }
+  } else if (!visited_nodes.insert(node.get()).second) {
+    return;
+  }
+  const bool inputs_recursive =
+      recursive || (node->_plugin && !node->_plugin->timeAligned());
+  for (const auto &input : node->_inputs) {
+    findRecursiveNodes(input.first, inputs_recursive, visited_nodes,
+                       recursive_nodes);
+  }
+}
+
+int ExecutionPlan::compile(const std::shared_ptr<Node> &node, long step,
+                           CompileContext &compile_context) {
+  // Plugins that move time around for their children keep feeding them
+  // recursively
+  if (step >= 0 &&
+      (!node->_plugin || !node->_plugin->timeAligned() ||
+       compile_context._recursive_nodes.count(node.get()) > 0)) {
+    return 0;
+  }
+
+  int level = 0;
+  const bool gated = node->_inputs.size() > 1;
+  std::vector<PlanInputPlugin::Input> inputs;
+  for (const auto &input : node->_inputs) {
+    // A node feeding several consumers is only compiled the first time
+    auto &node_steps = compile_context._node_steps;
+    auto node_step_it = node_steps.find(input.first.get());
+    if (node_step_it == node_steps.end()) {
+      ExecutionStep input_step;
+      input_step._plugin = input.first->_plugin;
+      input_step._feeds_ports = compile_context._feeds_ports &&
+                                input_step._plugin &&
+                                input_step._plugin->feedsPorts();
+      input_step._level = 0;
+      input_step._active = false;
+      input_step._processing = false;
+      input_step._feed_nanos = 0;
+      const size_t input_index = _steps.size();
+      _steps.push_back(input_step);
+      node_step_it = node_steps.emplace(input.first.get(), input_index).first;
+      const int input_level =
+          compile(input.first, input_index, compile_context);
+      _steps[input_index]._level = input_level;
+    }
+
+    ExecutionStep &input_step = _steps[node_step_it->second];
+    input_step._consumers.emplace_back(step, gated);
+    for (const auto &edge : input.second) {
+      std::pair<std::string, PortId> source(edge.first,
+                                            internPort(edge.first));
+      if (std::find(input_step._sources.begin(), input_step._sources.end(),
+                    source) == input_step._sources.end()) {
+        input_step._sources.push_back(source);
+      }
+      if (step < 0) {
+        continue;
+      }
+      // The plan hands the plugin the buffers its inputs mix into as well,
+      // so none of them have to be created while rendering
+      std::vector<std::pair<std::string, PortId>> &sources =
+          _steps[step]._sources;
+      std::pair<std::string, PortId> destination(edge.second,
+                                                 internPort(edge.second));
+      if (std::find(sources.begin(), sources.end(), destination) ==
+          sources.end()) {
+        sources.push_back(destination);
+      }
+    }
+    level = std::max(level, input_step._level + 1);
+    inputs.push_back({node_step_it->second, input.second});
+  }
+  compile_context._bindings.emplace_back(node->_input, inputs);
+  return level;
+}
+
+void ExecutionPlan::reserve(const Content &content) {
+  for (auto &step : _steps) {
+    for (const auto &source : step._sources) {
+      auto &source_content = step._content[source.first];
+      if (!source_content) {
+        source_content = std::make_shared<Content>();
+        step._ports[source.second] = source_content;
+      }
+      source_content->reserve(content.payloadSize());
+    }
+  }
+  allocate(content);
+}
+
+void ExecutionPlan::allocate(const Content &content) {
+  if (_payload_size == static_cast<long>(content.payloadSize()) &&
+      _required_items == static_cast<long>(content.requiredItems()) &&
+      _channels == static_cast<long>(content.channels()) &&
+      _samplerate == content.sampleRate()) {
+    return;
+  }
+  _payload_size = content.payloadSize();
+  _required_items = content.requiredItems();
+  _channels = content.channels();
+  _samplerate = content.sampleRate();
+  for (auto &step : _steps) {
+    for (const auto &source : step._sources) {
+      auto &source_content = step._content[source.first];
+      if (!source_content) {
+        source_content = std::make_shared<Content>();
+        step._ports[source.second] = source_content;
+      }
+    }
+    // Reshape in place, along with any ports the consumer added, so a block
+    // no larger than the one reserved for doesn't allocate
+    for (auto &content_pair : step._content) {
+      content_pair.second->reshape(content.payloadSize(), content.sampleRate(),
+                                   content.channels(), content.requiredItems(),
+                                   content.type());
+    }
+    for (auto &port : step._ports) {
+      port.second->reshape(content.payloadSize(), content.sampleRate(),
+                           content.channels(), content.requiredItems(),
+                           content.type());
+    }
+  }
+  for (const auto &input : _inputs) {
+    input->rebind();
+  }
+}
+
+void ExecutionPlan::majorTimeChange(long sample_index,
+                                    long graph_sample_index) {
+  _output->majorTimeChange(sample_index, graph_sample_index);
+}
+
+void ExecutionPlan::potentialTimeChange(long sample_index,
+                                        long graph_sample_index) {
+  _output->potentialTimeChange(sample_index, graph_sample_index);
+}
+
+std::string ExecutionPlan::name() { return ExecutionPlanIdentifier; }
+
+bool ExecutionPlan::finished(long sample_index, long sample_index_end) {
+  return _output->finished(sample_index, sample_index_end);
+}
+
+void ExecutionPlan::notifyFinished(long sample_index,
+                                   long graph_sample_index) {
+  _output->notifyFinished(sample_index, graph_sample_index);
+}
+
+Plugin::PluginType ExecutionPlan::type() const { return _output->type(); }
+
+void ExecutionPlan::feed(
+    std::map<std::string, std::shared_ptr<Content>> &content,
+    long sample_index, long graph_sample_index,
+    nfgrapher::LoadingPolicy loading_policy) {
+  if (!_steps.empty() && !content.empty()) {
+    auto audio_it = content.find(AudioContentTypeKey);
+    if (audio_it == content.end()) {
+      audio_it = content.begin();
+    }
+    allocate(*audio_it->second);
+
+    // Work out which steps run this block, consumers before their inputs
+    for (auto it = _order.rbegin(); it != _order.rend(); ++it) {
+      ExecutionStep &step = _steps[*it];
+      bool consumed = false;
+      bool ungated = false;
+      bool gated = false;
+      for (const auto &consumer : step._consumers) {
+        if (consumer.first < 0 || _steps[consumer.first]._active) {
+          consumed = true;
+          ungated = ungated || !consumer.second;
+          gated = gated || consumer.second;
+        }
+      }
+      step._processing =
+          consumed && (!gated || step._plugin->shouldProcess(
+                                     sample_index,
+                                     sample_index + _required_items));
+      step._active = ungated || step._processing;
+    }
+
+    const bool parallel =
+        _render_thread_pool && _render_thread_pool->threads() > 1;
+    for (size_t level = 0; level < _level_feed_nanos.size(); ++level) {
+      const size_t offset = _level_offsets[level];
+      const size_t count = _level_offsets[level + 1] - offset;
+      FeedContext feed_context{this, &_order[offset], sample_index,
+                               graph_sample_index, loading_policy};
+      if (!parallel) {
+        for (size_t i = 0; i < count; ++i) {
+          feedStep(&feed_context, i);
+        }
+        continue;
+      }
+
+      size_t active_steps = 0;
+      for (size_t i = 0; i < count; ++i) {
+        active_steps += _steps[_order[offset + i]]._active ? 1 : 0;
+      }
+      if (active_steps > 1 &&
+          _level_feed_nanos[level] >
+              smartplayer::RenderThreadPoolMinimumParallelNanos) {
+        _render_thread_pool->parallelFor(count, &ExecutionPlan::feedStep,
+                                         &feed_context);
+      } else {
+        for (size_t i = 0; i < count; ++i) {
+          feedStep(&feed_context, i);
+        }
+      }
+      long feed_nanos = 0;
+      for (size_t i = 0; i < count; ++i) {
+        feed_nanos += _steps[_order[offset + i]]._feed_nanos;
+      }
+      _level_feed_nanos[level] += (feed_nanos - _level_feed_nanos[level]) *
+                                  ExecutionPlanFeedCostSmoothing;
+    }
+  }
+
+  // The graph content can be swapped between blocks so always reconnect
+  _output->rebind();
+  _output->feed(content, sample_index, graph_sample_index, loading_policy);
+}
+
+void ExecutionPlan::feedStep(void *context, size_t index) {
+  FeedContext *feed_context = static_cast<FeedContext *>(context);
+  ExecutionPlan *plan = feed_context->_plan;
+  ExecutionStep &step = plan->_steps[feed_context->_steps[index]];
+  if (!step._active) {
+    step._feed_nanos = 0;
+    return;
+  }
+  if (!plan->_render_thread_pool) {
+    feedStep(step, *feed_context);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  feedStep(step, *feed_context);
+  step._feed_nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+}
+
+void ExecutionPlan::feedStep(ExecutionStep &step,
+                             const FeedContext &feed_context) {
+  if (step._feeds_ports) {
+    for (auto &port : step._ports) {
+      port.second->erase();
+    }
+    step._plugin->feedPorts(step._ports, feed_context._sample_index,
+                            feed_context._graph_sample_index,
+                            feed_context._loading_policy);
+    return;
+  }
+  for (auto &content_pair : step._content) {
+    content_pair.second->erase();
+  }
+  step._plugin->feed(step._content, feed_context._sample_index,
+                     feed_context._graph_sample_index,
+                     feed_context._loading_policy);
+}
+
+void ExecutionPlan::load(LOAD_CALLBACK callback) { _output->load(callback); }
+
+bool ExecutionPlan::loaded() const { return _output->loaded(); }
+
+void ExecutionPlan::run(long sample_index, const NodeTimes &node_times,
+                        long node_sample_index) {
+  _output->run(sample_index, node_times, node_sample_index);
+}
+
+long ExecutionPlan::startSampleIndex() { return _output->startSampleIndex(); }
+
+bool ExecutionPlan::shouldProcess(long sample_index_start,
+                                  long sample_index_end) {
+  return _output->shouldProcess(sample_index_start, sample_index_end);
+}
+
+}  // namespace plugin
+}  // namespace nativeformat
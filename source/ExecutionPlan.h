@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/Plugin.h>
+
+#include <memory>
+#include <set>
+
+#include "MixerPlugin.h"
+
+namespace nativeformat {
+namespace smartplayer {
+class RenderThreadPool;
+}  // namespace smartplayer
+namespace plugin {
+
+extern const std::string ExecutionPlanIdentifier;
+
+/**
+ * A single processing step of an execution plan: a plugin along with the
+ * buffers it renders into.
+ */
+struct ExecutionStep {
+  std::shared_ptr<Plugin> _plugin;
+  bool _feeds_ports;
+  // The ports the consumers read and the ones the inputs are mixed into
+  std::vector<std::pair<std::string, PortId>> _sources;
+  // The same buffers keyed both ways, depending on how the plugin is fed
+  std::map<std::string, std::shared_ptr<Content>> _content;
+  PortContent _ports;
+  // The steps consuming this one (-1 for the graph output), along with
+  // whether each asks shouldProcess before mixing it
+  std::vector<std::pair<long, bool>> _consumers;
+  int _level;  // Steps of the same level don't depend on one another
+  bool _active;
+  bool _processing;  // What shouldProcess said, for the consumers that asked
+  long _feed_nanos;
+};
+
+/**
+ * The child the graph hands to every plugin it creates. Until an execution
+ * plan binds it, it simply feeds the plugin inputs recursively through a
+ * MixerPlugin. Once bound, the inputs have already been rendered by the plan
+ * and it only has to copy or mix their buffers.
+ */
+class PlanInputPlugin : public Plugin {
+ public:
+  struct Input {
+    size_t _step;
+    MixerPlugin::src_dst_t _edges;
+  };
+
+  PlanInputPlugin(const std::vector<MixerPlugin::Metadata> &metadata,
+                  int channels, double samplerate,
+                  std::shared_ptr<smartplayer::RenderThreadPool>
+                      render_thread_pool = nullptr);
+  virtual ~PlanInputPlugin();
+
+  void bind(const std::vector<Input> &inputs,
+            const std::vector<ExecutionStep> &steps);
+  void rebind();
+  // Goes back to feeding the inputs recursively
+  void unbind();
+  bool bound() const;
+  // Adds up how long feeding takes until stopped, so a profiled plugin can
+  // leave the time its inputs took out of its own
+  void startTimingFeeds();
+  // Returns how long the feeds since starting took, in nanoseconds
+  long stopTimingFeeds();
+
+  // Plugin
+  void majorTimeChange(long sample_index, long graph_sample_index) override;
+  void potentialTimeChange(long sample_index, long graph_sample_index) override;
+  std::string name() override;
+  bool finished(long sample_index, long sample_index_end) override;
+  void notifyFinished(long sample_index, long graph_sample_index) override;
+  PluginType type() const override;
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
+  bool feedsPorts() const override;
+  void load(LOAD_CALLBACK callback) override;
+  bool loaded() const override;
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override;
+  long startSampleIndex() override;
+  bool shouldProcess(long sample_index_start, long sample_index_end) override;
+
+ private:
+  struct Connection {
+    const ExecutionStep *_step;
+    PortId _source_port;
+    Content *_source;
+    PortId _destination_port;
+    std::string _destination;
+    bool _gated;
+  };
+
+  bool mixes(const Connection &connection) const;
+
+  void feedInputs(std::map<std::string, std::shared_ptr<Content>> &content,
+                  long sample_index, long graph_sample_index,
+                  nfgrapher::LoadingPolicy loading_policy);
+  void feedInputPorts(PortContent &content, long sample_index,
+                      long graph_sample_index,
+                      nfgrapher::LoadingPolicy loading_policy);
+  void connect();
+  void mix(const Content &source, Content &destination,
+           nfgrapher::LoadingPolicy loading_policy);
+
+  const std::shared_ptr<MixerPlugin> _mixer;
+  const std::vector<ExecutionStep> *_steps;
+  bool _connected;
+  std::vector<Connection> _connections;
+  std::vector<Content *> _mixed_content;
+  std::map<std::string, std::shared_ptr<Content>> _content_map;
+  bool _timing_feeds;
+  long _feed_nanos;
+};
+
+/**
+ * A graph compiled into a flat list of steps ordered so that every step runs
+ * after the steps it reads from. Plugins which declare themselves time aligned
+ * have their inputs rendered by the plan, anything else (such as plugins that
+ * dilate time) keeps rendering its subtree recursively within a single step.
+ * Nodes feeding several consumers are rendered by a single step.
+ */
+class ExecutionPlan : public Plugin {
+ public:
+  struct Node {
+    std::shared_ptr<Plugin> _plugin;  // Null for the graph output
+    std::shared_ptr<PlanInputPlugin> _input;
+    std::vector<std::pair<std::shared_ptr<Node>, MixerPlugin::src_dst_t>>
+        _inputs;
+    int _channels;  // The width the plugin renders at
+  };
+
+  /**
+   * Compiles the graph feeding the output node into steps
+   * @param bind_inputs Whether the plugins feeding the steps are bound to the
+   * plan straight away, otherwise it can't render until bind is called
+   */
+  ExecutionPlan(const std::shared_ptr<Node> &output,
+                std::shared_ptr<smartplayer::RenderThreadPool>
+                    render_thread_pool = nullptr,
+                bool feeds_ports = true, bool bind_inputs = true);
+  virtual ~ExecutionPlan();
+
+  size_t steps() const;
+  /**
+   * Binds the plugins feeding the steps to the plan. Plugins kept from an
+   * earlier plan stay bound to it until then, so a plan compiled while that
+   * one renders is only bound once it takes over.
+   */
+  void bind();
+  /**
+   * Creates the step buffers up front with room for blocks shaped like
+   * content, so rendering reshapes them in place rather than allocating
+   */
+  void reserve(const Content &content);
+
+  // Plugin
+  void majorTimeChange(long sample_index, long graph_sample_index) override;
+  void potentialTimeChange(long sample_index, long graph_sample_index) override;
+  std::string name() override;
+  bool finished(long sample_index, long sample_index_end) override;
+  void notifyFinished(long sample_index, long graph_sample_index) override;
+  PluginType type() const override;
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override;
+  void load(LOAD_CALLBACK callback) override;
+  bool loaded() const override;
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override;
+  long startSampleIndex() override;
+  bool shouldProcess(long sample_index_start, long sample_index_end) override;
+
+ private:
+  struct FeedContext {
+    ExecutionPlan *_plan;
+    const size_t *_steps;
+    long _sample_index;
+    long _graph_sample_index;
+    nfgrapher::LoadingPolicy _loading_policy;
+  };
+
+  struct CompileContext {
+    bool _feeds_ports;
+    std::vector<std::pair<std::shared_ptr<PlanInputPlugin>,
+                          std::vector<PlanInputPlugin::Input>>>
+        _bindings;
+    std::map<const Node *, size_t> _node_steps;
+    // Nodes some plugin renders recursively, their inputs have to stay that
+    // way even when the node is shared with a time aligned consumer
+    std::set<const Node *> _recursive_nodes;
+  };
+
+  static void findRecursiveNodes(const std::shared_ptr<Node> &node,
+                                 bool recursive,
+                                 std::set<const Node *> &visited_nodes,
+                                 std::set<const Node *> &recursive_nodes);
+  int compile(const std::shared_ptr<Node> &node, long step,
+              CompileContext &compile_context);
+  void allocate(const Content &content);
+  static void feedStep(void *context, size_t index);
+  static void feedStep(ExecutionStep &step, const FeedContext &feed_context);
+
+  const std::shared_ptr<PlanInputPlugin> _output;
+  const std::shared_ptr<smartplayer::RenderThreadPool> _render_thread_pool;
+  std::vector<ExecutionStep> _steps;
+  std::vector<std::shared_ptr<PlanInputPlugin>> _inputs;
+  // What bind does, worked out when the plan is compiled
+  std::vector<std::shared_ptr<PlanInputPlugin>> _unbound_inputs;
+  std::vector<std::pair<std::shared_ptr<PlanInputPlugin>,
+                        std::vector<PlanInputPlugin::Input>>>
+      _bindings;
+  std::vector<size_t> _order;  // Step indices sorted by level
+  std::vector<size_t> _level_offsets;
+  std::vector<double> _level_feed_nanos;
+  long _payload_size;
+  long _required_items;
+  long _channels;
+  double _samplerate;
+};
+
+}  // namespace plugin
+}  // namespace nativeformat
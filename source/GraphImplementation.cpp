@@ -21,12 +21,17 @@
 #include "GraphImplementation.h"
 
 #include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <cmath>
 #include <queue>
 #include <string>
 
 #include "EdgeImplementation.h"
+#include "ExecutionPlan.h"
 #include "MixerPlugin.h"
 #include "NodeImplementation.h"
+#include "ProfiledPlugin.h"
+#include "UpmixPlugin.h"
 
 namespace nativeformat {
 namespace smartplayer {
@@ -50,27 +55,75 @@ const std::string GraphImplementationErrorDomain =
     "com.nativeformat.graph.error";
 static const std::string GraphImplementationOutputDriverTarget =
     "output_driver";
+// How far back from the render position a score being swapped in starts
+// rendering, so filters and the like have settled by the time it is heard
+static const long GraphImplementationPrerollBlocks = 2;
+// How long a score being swapped in may wait on its content before it fades
+// in regardless
+static const std::chrono::milliseconds GraphImplementationPrerollTimeout(2000);
 
 static long PlayerContentExpectedRenderSamples(
     const std::map<std::string, std::shared_ptr<plugin::Content>> &content);
+static long PrerollSampleIndex(long sample_index, size_t block_samples,
+                               int channels);
 static void PrioritiseNodes(
     std::map<std::string, std::shared_ptr<PrioritisedNode>> &nodes,
     std::shared_ptr<PrioritisedNode> &output_node);
+static void UnlinkNodes(
+    std::map<std::string, std::shared_ptr<PrioritisedNode>> &nodes);
 static int NodePriorityTraversal(std::shared_ptr<PrioritisedNode> &node);
-static std::shared_ptr<plugin::Plugin> CreatePluginTraverse(
+static std::string NodeDescriptor(const PrioritisedNode &node,
+                                  const EdgeMap &edge_map, bool duplicated);
+static std::set<std::string> DuplicatedNodes(
+    const std::map<std::string, std::shared_ptr<PrioritisedNode>> &nodes,
+    const std::shared_ptr<PrioritisedNode> &output_node,
+    const plugin::Registry &plugin_registry);
+static bool NodeTimeAligned(const std::shared_ptr<PrioritisedNode> &node,
+                            const std::shared_ptr<PrioritisedNode> &output_node,
+                            const plugin::Registry &plugin_registry,
+                            std::map<std::string, bool> &aligned_nodes);
+static long NodePaths(const std::shared_ptr<PrioritisedNode> &node,
+                      const std::shared_ptr<PrioritisedNode> &output_node,
+                      std::map<std::string, long> &node_paths);
+static bool NodeUnchanged(
+    const std::shared_ptr<PrioritisedNode> &node,
+    const std::map<std::string, std::string> &descriptors,
+    const std::map<std::string, std::string> &loaded_descriptors,
+    std::map<std::string, bool> &unchanged_nodes);
+static std::shared_ptr<plugin::ExecutionPlan::Node> CreatePluginTraverse(
     std::shared_ptr<PrioritisedNode> &node, const EdgeMap &edge_map,
     const std::string &graph_id, int channels, double samplerate,
     std::shared_ptr<plugin::Registry> &plugin_registry,
     std::shared_ptr<PrioritisedNode> &output_node,
-    const std::string &session_id);
+    const std::string &session_id,
+    const std::shared_ptr<RenderThreadPool> &render_thread_pool,
+    const std::shared_ptr<plugin::RenderPass> &render_pass,
+    const std::shared_ptr<const RenderProfiling> &profiling,
+    const std::set<std::string> &duplicated_nodes,
+    const std::map<std::string, std::shared_ptr<plugin::ExecutionPlan::Node>>
+        &reused_plan_nodes,
+    std::map<std::string, std::shared_ptr<plugin::ExecutionPlan::Node>>
+        &plan_nodes);
 
 GraphImplementation::GraphImplementation(int channels, double samplerate,
                                          const std::string &session_id)
-    : _channels(channels),
+    : _uses_execution_plan(true),
+      _uses_port_content(true),
+      _block_samples(NF_DRIVER_SAMPLE_BLOCK_SIZE),
+      _crossfade_blocks(0),
+      _profiling(std::make_shared<RenderProfiling>(false)),
+      _channels(channels),
       _samplerate(samplerate),
       _session_id(session_id),
       _sample_index(0),
-      _finished(false) {}
+      _finished(false),
+      _render_pass(std::make_shared<plugin::RenderPass>(0)),
+      _crossfade_frames(0),
+      _crossfade_frame(0),
+      _cut_content(
+          {{AudioContentTypeKey, std::make_shared<plugin::Content>()}}) {
+  _cut_content[AudioContentTypeKey]->reserve(_block_samples);
+}
 
 GraphImplementation::~GraphImplementation() {}
 
@@ -97,7 +150,22 @@ void GraphImplementation::setRenderTime(double render_time) {
   long sample_index = (render_time * _channels) * _samplerate;
   sample_index -= sample_index % 2;
   _sample_index = sample_index;
+  std::lock_guard<std::mutex> incoming_score_lock(_incoming_score_mutex);
+  // A score catching up starts over from the new position
+  if (_incoming_score) {
+    long preroll_sample_index =
+        PrerollSampleIndex(sample_index, _block_samples, _channels);
+    _incoming_score->_sample_index = preroll_sample_index;
+    _incoming_score->_root_plugin->majorTimeChange(preroll_sample_index,
+                                                   preroll_sample_index);
+  }
+  std::lock_guard<std::mutex> root_plugin_lock(_root_plugin_mutex);
   _root_plugin->majorTimeChange(sample_index, sample_index);
+  // A score fading out has nothing to fade from once the position jumps
+  if (_outgoing_plugin) {
+    _released_plugin = std::move(_outgoing_plugin);
+    _outgoing_render_pass = nullptr;
+  }
 }
 
 float GraphImplementation::valueForPath(const std::string &path) {
@@ -250,6 +318,15 @@ void GraphImplementation::traverse(
   }
 
   std::lock_guard<std::mutex> lock(_root_plugin_mutex);
+  const bool profiling = _profiling->load(std::memory_order_relaxed);
+  RenderTimer render_timer(
+      profiling ? &_render_profile : nullptr,
+      profiling ? RenderProfile::deadlineNanos(content) : 0);
+  // Shared nodes only hand out blocks they cached during this pass
+  ++(*_render_pass);
+  if (_outgoing_plugin) {
+    ++(*_outgoing_render_pass);
+  }
   long sample_index = _sample_index;
   long maximum_expected_render_samples_step =
       PlayerContentExpectedRenderSamples(content);
@@ -270,65 +347,47 @@ void GraphImplementation::traverse(
     }
   } else {
     if (sample_index < 0) {
-      // Cut the fed in content buffer
+      // Cut the fed in content buffer, reusing the cut buffers made up front
+      // or for the blocks before
       for (const auto &content_pair : content) {
-        auto it = _cut_content.find(content_pair.first);
-        if (it == _cut_content.end()) {
-          const auto &content_instance = content_pair.second;
-          auto new_content = std::make_shared<plugin::Content>(
-              content_instance->payloadSize(), 0,
-              content_instance->sampleRate(), content_instance->channels(),
-              content_instance->requiredItems(), content_instance->type());
-          auto result = _cut_content.emplace(content_pair.first, new_content);
-          if (result.second) {
-            it = result.first;
-          }
+        const plugin::Content &content_instance = *content_pair.second;
+        auto &cut_content = _cut_content[content_pair.first];
+        if (!cut_content) {
+          cut_content = std::make_shared<plugin::Content>();
+          cut_content->reserve(content_instance.payloadSize());
         }
-        (*it).second->setItems(0);
-      }
-      for (auto &content_type : _cut_content) {
-        switch (content_type.second->type()) {
-          case plugin::ContentPayloadTypeNone:
-          case plugin::ContentPayloadTypeHandle:
-            break;
-          case plugin::ContentPayloadTypeBuffer: {
-            _cut_content[content_type.first] =
-                std::make_shared<plugin::Content>(
-                    end_sample_index, 0, content_type.second->sampleRate(),
-                    content_type.second->channels(), end_sample_index,
-                    content_type.second->type());
-            break;
-          }
-        }
-      }
-      {
-        std::lock_guard<std::mutex> node_times_lock(_node_times_mutex);
-        _root_plugin->feed(_cut_content, sample_index, sample_index,
-                           loading_policy);
+        const bool is_buffer =
+            content_instance.type() == plugin::ContentPayloadTypeBuffer;
+        cut_content->reshape(
+            is_buffer ? end_sample_index : content_instance.payloadSize(),
+            content_instance.sampleRate(), content_instance.channels(),
+            is_buffer ? end_sample_index : content_instance.requiredItems(),
+            content_instance.type());
       }
+      feedRoot(_cut_content, sample_index, loading_policy);
       // Merge the cut buffer back into the original
       for (auto &content_type : _cut_content) {
+        auto content_it = content.find(content_type.first);
+        if (content_it == content.end()) {
+          continue;
+        }
+        plugin::Content &content_instance = *content_it->second;
         switch (content_type.second->type()) {
           case plugin::ContentPayloadTypeNone:
           case plugin::ContentPayloadTypeHandle:
             break;
           case plugin::ContentPayloadTypeBuffer: {
             size_t silence_samples =
-                content[content_type.first]->requiredItems() -
-                content_type.second->items();
-            content[content_type.first]->setItems(silence_samples);
-            std::fill_n(content[content_type.first]->payload(), silence_samples,
-                        0);
-            content[content_type.first]->append(*content_type.second);
+                content_instance.requiredItems() - content_type.second->items();
+            content_instance.setItems(silence_samples);
+            std::fill_n(content_instance.payload(), silence_samples, 0);
+            content_instance.append(*content_type.second);
             break;
           }
         }
       }
     } else {
-      {
-        std::lock_guard<std::mutex> node_times_lock(_node_times_mutex);
-        _root_plugin->feed(content, sample_index, sample_index, loading_policy);
-      }
+      feedRoot(content, sample_index, loading_policy);
     }
   }
 
@@ -357,6 +416,165 @@ void GraphImplementation::traverse(
   _buffer_size = maximum_expected_render_samples_step;
 }
 
+void GraphImplementation::setIncomingScore(
+    std::shared_ptr<IncomingScore> incoming_score) {
+  std::shared_ptr<IncomingScore> superseded_score;
+  {
+    std::lock_guard<std::mutex> lock(_incoming_score_mutex);
+    superseded_score.swap(_incoming_score);
+    _incoming_score = incoming_score;
+  }
+  // A score replaced before it caught up still loaded, it just never plays
+  if (superseded_score) {
+    superseded_score->_load_callback();
+  }
+  preroll();
+}
+
+void GraphImplementation::preroll() {
+  std::unique_lock<std::mutex> lock(_incoming_score_mutex);
+  std::shared_ptr<IncomingScore> incoming_score = _incoming_score;
+  if (!incoming_score) {
+    return;
+  }
+  plugin::NodeTimes node_times;
+  {
+    std::lock_guard<std::mutex> node_times_lock(_node_times_mutex);
+    node_times = _node_times;
+  }
+  plugin::Plugin &plugin = *incoming_score->_root_plugin;
+  plugin::Content &audio = *incoming_score->_content[AudioContentTypeKey];
+  long &sample_index = incoming_score->_sample_index;
+  // Renders up to wherever the graph has played on to by now. Content that
+  // hasn't loaded yet is left for the next run rather than waited on.
+  bool caught_up = true;
+  while (sample_index < _sample_index &&
+         !plugin.finished(sample_index, sample_index)) {
+    plugin.run(sample_index, node_times, 0);
+    ++(*incoming_score->_render_pass);
+    audio.erase();
+    plugin.feed(incoming_score->_content, sample_index, sample_index,
+                incoming_score->_loading_policy);
+    if (audio.items() == 0) {
+      caught_up = false;
+      break;
+    }
+    sample_index += audio.items();
+  }
+  if (!caught_up &&
+      std::chrono::steady_clock::now() < incoming_score->_timeout) {
+    return;
+  }
+  _incoming_score = nullptr;
+  crossfadeTo(incoming_score->_root_plugin, incoming_score->_render_pass,
+              incoming_score->_loaded_nodes,
+              incoming_score->_crossfade_samples);
+  lock.unlock();
+  incoming_score->_load_callback();
+}
+
+void GraphImplementation::crossfadeTo(
+    std::shared_ptr<plugin::Plugin> root_plugin,
+    std::shared_ptr<plugin::RenderPass> render_pass,
+    const std::map<std::string, LoadedNode> &loaded_nodes,
+    size_t crossfade_samples) {
+  std::shared_ptr<plugin::Plugin> released_plugin;
+  std::shared_ptr<plugin::Plugin> interrupted_plugin;
+  std::lock_guard<std::mutex> lock(_root_plugin_mutex);
+  // A score still fading out from an earlier swap is cut off
+  released_plugin.swap(_released_plugin);
+  interrupted_plugin.swap(_outgoing_plugin);
+  // Sized like the player's content so rendering the fade doesn't allocate
+  auto &outgoing_audio = _outgoing_content[AudioContentTypeKey];
+  if (!outgoing_audio) {
+    outgoing_audio = std::make_shared<plugin::Content>();
+    outgoing_audio->reserve(_block_samples * _channels);
+  }
+  _outgoing_plugin = _root_plugin;
+  _outgoing_render_pass = _render_pass;
+  _crossfade_frames = std::max(crossfade_samples / _channels, size_t(1));
+  _crossfade_frame = 0;
+  _root_plugin = root_plugin;
+  _render_pass = render_pass;
+  _loaded_nodes = loaded_nodes;
+}
+
+void GraphImplementation::feedRoot(
+    std::map<std::string, std::shared_ptr<plugin::Content>> &content,
+    long sample_index, nfgrapher::LoadingPolicy loading_policy) {
+  std::lock_guard<std::mutex> node_times_lock(_node_times_mutex);
+  _root_plugin->feed(content, sample_index, sample_index, loading_policy);
+  if (!_outgoing_plugin) {
+    return;
+  }
+  // The score fading out renders the same block into content shaped like it
+  for (const auto &content_pair : content) {
+    const plugin::Content &content_instance = *content_pair.second;
+    auto &outgoing_content = _outgoing_content[content_pair.first];
+    if (!outgoing_content) {
+      outgoing_content = std::make_shared<plugin::Content>();
+      outgoing_content->reserve(content_instance.payloadSize());
+    }
+    outgoing_content->reshape(
+        content_instance.payloadSize(), content_instance.sampleRate(),
+        content_instance.channels(), content_instance.requiredItems(),
+        content_instance.type());
+    outgoing_content->erase();
+  }
+  _outgoing_plugin->feed(_outgoing_content, sample_index, sample_index,
+                         loading_policy);
+  crossfade(content);
+}
+
+void GraphImplementation::crossfade(
+    std::map<std::string, std::shared_ptr<plugin::Content>> &content) {
+  long faded_frames = 0;
+  for (const auto &content_pair : content) {
+    plugin::Content &incoming = *content_pair.second;
+    auto outgoing_it = _outgoing_content.find(content_pair.first);
+    if (incoming.type() != plugin::ContentPayloadTypeBuffer ||
+        outgoing_it == _outgoing_content.end()) {
+      continue;
+    }
+    const plugin::Content &outgoing = *outgoing_it->second;
+    const size_t channels = std::max(incoming.channels(), size_t(1));
+    const size_t incoming_items = incoming.items();
+    const size_t outgoing_items = outgoing.items();
+    const size_t items = std::max(incoming_items, outgoing_items);
+    const long frames = items / channels;
+    faded_frames = std::max(frames, faded_frames);
+    if (incoming.silent() && outgoing.silent()) {
+      incoming.setItems(items);
+      continue;
+    }
+    // Equal power, so the loudness holds steady through the fade
+    float *incoming_payload = incoming.payload();
+    const float *outgoing_payload = outgoing.constPayload();
+    for (long frame = 0; frame < frames; ++frame) {
+      const double position =
+          std::min(static_cast<double>(_crossfade_frame + frame) /
+                       static_cast<double>(_crossfade_frames),
+                   1.0);
+      const float incoming_gain = std::sin(position * M_PI_2);
+      const float outgoing_gain = std::cos(position * M_PI_2);
+      for (size_t i = frame * channels; i < (frame + 1) * channels; ++i) {
+        const float incoming_sample =
+            i < incoming_items ? incoming_payload[i] : 0.0f;
+        const float outgoing_sample =
+            i < outgoing_items ? outgoing_payload[i] : 0.0f;
+        incoming_payload[i] =
+            incoming_sample * incoming_gain + outgoing_sample * outgoing_gain;
+      }
+    }
+    incoming.setItems(items);
+  }
+  _crossfade_frame += faded_frames;
+  if (_crossfade_frame >= _crossfade_frames) {
+    // Freeing the score could take a while, so that's left to run()
+    _released_plugin = std::move(_outgoing_plugin);
+  }
+}
+
 void GraphImplementation::forEachNode(
     NF_SMART_PLAYER_GRAPH_NODE_CALLBACK node_callback) {
   std::lock_guard<std::mutex> lock(_nodes_mutex);
@@ -367,6 +585,23 @@ void GraphImplementation::forEachNode(
   }
 }
 
+void GraphImplementation::setProfiling(bool profiling) {
+  if (profiling && !_profiling->load()) {
+    _render_profile.reset();
+    std::lock_guard<std::mutex> lock(_nodes_mutex);
+    for (const auto &node : _nodes) {
+      node.second->renderProfile()->reset();
+    }
+  }
+  _profiling->store(profiling);
+}
+
+bool GraphImplementation::profiling() const { return _profiling->load(); }
+
+RenderStats GraphImplementation::renderStats() const {
+  return _render_profile.stats();
+}
+
 void GraphImplementation::forEachScript(
     NF_SMART_PLAYER_GRAPH_SCRIPT_CALLBACK script_callback) {
   std::lock_guard<std::mutex> lock(_scripts_mutex);
@@ -383,6 +618,13 @@ void GraphImplementation::setPluginRegistry(
 }
 
 void GraphImplementation::run() {
+  // Scores that have faded out are freed here rather than on the render thread
+  std::shared_ptr<plugin::Plugin> released_plugin;
+  {
+    std::lock_guard<std::mutex> lock(_root_plugin_mutex);
+    released_plugin.swap(_released_plugin);
+  }
+  preroll();
   bool graph_finished = finished();
   std::lock_guard<std::mutex> node_times_lock(_node_times_mutex);
   long sample_index = _sample_index;
@@ -403,6 +645,31 @@ void GraphImplementation::setDelegate(std::weak_ptr<GraphDelegate> delegate) {
   _delegate = delegate;
 }
 
+void GraphImplementation::setRenderThreadPool(
+    std::shared_ptr<RenderThreadPool> render_thread_pool) {
+  _render_thread_pool = render_thread_pool;
+}
+
+void GraphImplementation::setUsesExecutionPlan(bool uses_execution_plan) {
+  _uses_execution_plan = uses_execution_plan;
+}
+
+void GraphImplementation::setUsesPortContent(bool uses_port_content) {
+  _uses_port_content = uses_port_content;
+}
+
+void GraphImplementation::setBlockSize(size_t block_samples) {
+  std::lock_guard<std::mutex> lock(_root_plugin_mutex);
+  _block_samples = block_samples;
+  // Blocks cut short where the graph starts render into it, so it has room
+  // for a whole one before the render thread needs it
+  _cut_content[AudioContentTypeKey]->reserve(block_samples);
+}
+
+void GraphImplementation::setCrossfadeBlocks(size_t crossfade_blocks) {
+  _crossfade_blocks = crossfade_blocks;
+}
+
 void GraphImplementation::setJson(const nlohmann::json &json,
                                   LOAD_CALLBACK load_callback) {
   nfgrapher::Score score;
@@ -414,7 +681,11 @@ void GraphImplementation::setJson(const nlohmann::json &json,
     load_callback({false, GraphImplementationErrorDomain, msg});
     return;
   }
+  setScore(score, load_callback);
+}
 
+void GraphImplementation::setScore(const nfgrapher::Score &score,
+                                   LOAD_CALLBACK load_callback) {
   const nfgrapher::Graph &graph = score.graph;
   if (!_plugin_registry && graph.nodes && graph.nodes->size() > 0) {
     load_callback(Load{false, GraphImplementationErrorDomain,
@@ -491,6 +762,7 @@ void GraphImplementation::loadScore(const nfgrapher::Score &score,
         std::string error_msg = "Invalid edge could not find source with id: ";
         error_msg += e.source;
 
+        UnlinkNodes(nodes);
         load_callback_message(
             {false, GraphImplementationErrorDomain, error_msg});
         return;
@@ -502,6 +774,7 @@ void GraphImplementation::loadScore(const nfgrapher::Score &score,
         std::string error_msg = "Invalid edge could not find target with id: ";
         error_msg += e.target;
 
+        UnlinkNodes(nodes);
         load_callback_message(
             {false, GraphImplementationErrorDomain, error_msg});
         return;
@@ -535,7 +808,59 @@ void GraphImplementation::loadScore(const nfgrapher::Score &score,
     }
   }
 
+  // Subtrees that haven't changed since the last score was loaded keep their
+  // nodes and plugins, along with everything those have decoded and buffered
+  std::map<std::string, LoadedNode> loaded_nodes;
+  std::shared_ptr<plugin::RenderPass> render_pass;
+  {
+    std::lock_guard<std::mutex> lock(_root_plugin_mutex);
+    loaded_nodes = _loaded_nodes;
+    render_pass = _render_pass;
+  }
+  const std::set<std::string> duplicated_nodes =
+      DuplicatedNodes(nodes, output_node, *_plugin_registry);
+  std::map<std::string, std::string> descriptors;
+  std::map<std::string, std::string> loaded_descriptors;
+  for (const auto &node : nodes) {
+    descriptors[node.first] =
+        NodeDescriptor(*node.second, edge_map,
+                       duplicated_nodes.count(node.first) > 0);
+  }
+  for (const auto &loaded_node : loaded_nodes) {
+    loaded_descriptors[loaded_node.first] = loaded_node.second._descriptor;
+  }
+  std::map<std::string, bool> unchanged_nodes;
+  std::vector<std::string> unchanged_identifiers;
+  for (auto &node : nodes) {
+    if (NodeUnchanged(node.second, descriptors, loaded_descriptors,
+                      unchanged_nodes)) {
+      unchanged_identifiers.push_back(node.first);
+    }
+  }
+  // A score fading in renders alongside the one it replaces, so the two
+  // can't share plugins. Only a score that changed at all fades in.
+  const size_t crossfade_blocks = _crossfade_blocks;
+  const bool crossfade = crossfade_blocks > 0 && !loaded_nodes.empty() &&
+                         (unchanged_identifiers.size() != nodes.size() ||
+                          nodes.size() != loaded_nodes.size());
+  std::map<std::string, std::shared_ptr<plugin::ExecutionPlan::Node>>
+      reused_plan_nodes;
+  if (crossfade) {
+    render_pass = std::make_shared<plugin::RenderPass>(0);
+  } else {
+    for (const auto &identifier : unchanged_identifiers) {
+      // Each path to a duplicated node creates its own
+      if (duplicated_nodes.count(identifier) > 0) {
+        continue;
+      }
+      const LoadedNode &loaded_node = loaded_nodes[identifier];
+      nodes[identifier]->node = loaded_node._node;
+      reused_plan_nodes[identifier] = loaded_node._plan_node;
+    }
+  }
+
   // Update the graph
+  std::shared_ptr<plugin::ExecutionPlan::Node> root_node;
   {
     std::lock_guard<std::mutex> nodes_lock(_nodes_mutex);
     std::lock_guard<std::mutex> node_times_lock(_node_times_mutex);
@@ -553,27 +878,108 @@ void GraphImplementation::loadScore(const nfgrapher::Score &score,
     PrioritiseNodes(nodes, output_node);
 
     // Try to intialize plugins from node descriptions
-    std::shared_ptr<plugin::Plugin> root_plugin;
+    std::map<std::string, std::shared_ptr<plugin::ExecutionPlan::Node>>
+        plan_nodes;
     try {
-      root_plugin = CreatePluginTraverse(
+      root_node = CreatePluginTraverse(
           output_node, edge_map, _identifier, _channels, _samplerate,
-          _plugin_registry, output_node, _session_id);
+          _plugin_registry, output_node, _session_id, _render_thread_pool,
+          render_pass, _profiling, duplicated_nodes, reused_plan_nodes,
+          plan_nodes);
     } catch (std::logic_error e) {  // out_of_range or invalid_argument
       std::string error_msg = "Failed to parse command values. Exception: ";
       error_msg += std::string(e.what());
+      UnlinkNodes(nodes);
       load_callback_message({false, GraphImplementationErrorDomain, error_msg});
       return;
     }
-    auto strong_this = shared_from_this();
-    root_plugin->load(
-        [load_callback_message, strong_this, root_plugin](Load load) {
-          {
-            std::lock_guard<std::mutex> lock(strong_this->_root_plugin_mutex);
-            strong_this->_root_plugin = root_plugin;
-          }
-          load_callback_message(load);
-        });
+    // Reused subtrees are returned whole, so only their roots are planned
+    plan_nodes.insert(reused_plan_nodes.begin(), reused_plan_nodes.end());
+    loaded_nodes.clear();
+    for (const auto &node : nodes) {
+      auto plan_node_it = plan_nodes.find(node.first);
+      if (plan_node_it != plan_nodes.end()) {
+        loaded_nodes[node.first] = {descriptors[node.first], node.second->node,
+                                    plan_node_it->second};
+      }
+    }
   }
+  UnlinkNodes(nodes);
+
+  // Loading may call back straight away, and a score fading in takes its time
+  // getting ready, so none of the graph's locks are held
+  auto strong_this = shared_from_this();
+  const bool uses_execution_plan = _uses_execution_plan;
+  const bool uses_port_content = _uses_port_content;
+  const size_t block_samples = _block_samples;
+  auto create_root_plugin = [strong_this, root_node, uses_execution_plan,
+                             uses_port_content, block_samples](bool bind) {
+    std::shared_ptr<plugin::Plugin> root_plugin = root_node->_input;
+    if (uses_execution_plan) {
+      auto execution_plan = std::make_shared<plugin::ExecutionPlan>(
+          root_node, strong_this->_render_thread_pool, uses_port_content,
+          bind);
+      // Sized for the player's blocks so rendering them doesn't allocate
+      execution_plan->reserve(plugin::Content(
+          block_samples, 0, strong_this->_samplerate, strong_this->_channels,
+          block_samples, plugin::ContentPayloadTypeBuffer));
+      root_plugin = execution_plan;
+    }
+    return root_plugin;
+  };
+  root_node->_input->load([load_callback_message, strong_this,
+                           create_root_plugin, render_pass, loaded_nodes,
+                           crossfade, crossfade_blocks, block_samples,
+                           loading_policy](Load load) {
+    if (crossfade && load._loaded) {
+      // Nothing is shared with the score playing, so the new one is
+      // prepared away from it and brought up to the render position over
+      // the graph's next runs before it fades in
+      auto incoming_score = std::make_shared<IncomingScore>();
+      incoming_score->_root_plugin = create_root_plugin(true);
+      incoming_score->_render_pass = render_pass;
+      incoming_score->_loaded_nodes = loaded_nodes;
+      incoming_score->_content = {
+          {AudioContentTypeKey,
+           std::make_shared<plugin::Content>(
+               block_samples, 0, strong_this->_samplerate,
+               strong_this->_channels, block_samples,
+               plugin::ContentPayloadTypeBuffer)}};
+      incoming_score->_loading_policy = loading_policy;
+      incoming_score->_crossfade_samples = crossfade_blocks * block_samples;
+      incoming_score->_sample_index = PrerollSampleIndex(
+          strong_this->_sample_index, block_samples, strong_this->_channels);
+      incoming_score->_root_plugin->majorTimeChange(
+          incoming_score->_sample_index, incoming_score->_sample_index);
+      incoming_score->_timeout =
+          std::chrono::steady_clock::now() + GraphImplementationPrerollTimeout;
+      incoming_score->_load_callback = [load_callback_message, load]() {
+        load_callback_message(load);
+      };
+      strong_this->setIncomingScore(incoming_score);
+      return;
+    }
+    // A score still catching up would otherwise take over from this one
+    strong_this->setIncomingScore(nullptr);
+    // Plugins kept from the last score are still rendering through its
+    // plan, so the new one is compiled and sized here and only bound to them
+    // as it takes over. The score it replaces is freed once the swap is done.
+    std::shared_ptr<plugin::Plugin> root_plugin = create_root_plugin(false);
+    auto execution_plan =
+        std::dynamic_pointer_cast<plugin::ExecutionPlan>(root_plugin);
+    std::shared_ptr<plugin::RenderPass> root_render_pass = render_pass;
+    std::map<std::string, LoadedNode> root_loaded_nodes = loaded_nodes;
+    {
+      std::lock_guard<std::mutex> lock(strong_this->_root_plugin_mutex);
+      if (execution_plan) {
+        execution_plan->bind();
+      }
+      root_plugin.swap(strong_this->_root_plugin);
+      root_render_pass.swap(strong_this->_render_pass);
+      root_loaded_nodes.swap(strong_this->_loaded_nodes);
+    }
+    load_callback_message(load);
+  });
 }
 
 std::map<std::string, std::shared_ptr<Script>> GraphImplementation::loadScripts(
@@ -588,8 +994,10 @@ std::map<std::string, std::shared_ptr<Script>> GraphImplementation::loadScripts(
     for (const auto &script : *graph.scripts.get()) {
       const std::string name = script.name;
       const std::string code = script.code;
-      if (_scripts.find(name) != _scripts.end() &&
-          _scripts[name]->code() == code) {
+      // Unchanged scripts carry on running as they are
+      auto script_it = _scripts.find(name);
+      if (script_it != _scripts.end() && script_it->second->code() == code) {
+        scripts[name] = script_it->second;
         continue;
       }
       if (auto delegate = _delegate.lock()) {
@@ -628,6 +1036,24 @@ static long PlayerContentExpectedRenderSamples(
   return maximum_expected_render_samples_step;
 }
 
+static long PrerollSampleIndex(long sample_index, size_t block_samples,
+                               int channels) {
+  sample_index = std::max(sample_index - static_cast<long>(block_samples) *
+                                             GraphImplementationPrerollBlocks,
+                          0l);
+  return sample_index - sample_index % channels;
+}
+
+static void UnlinkNodes(
+    std::map<std::string, std::shared_ptr<PrioritisedNode>> &nodes) {
+  // Nodes hold on to both their inputs and their outputs, so they would keep
+  // each other and the plugins set on them alive long after the score is gone
+  for (auto &node : nodes) {
+    node.second->input.clear();
+    node.second->output.clear();
+  }
+}
+
 static void PrioritiseNodes(
     std::map<std::string, std::shared_ptr<PrioritisedNode>> &nodes,
     std::shared_ptr<PrioritisedNode> &output_node) {
@@ -686,12 +1112,153 @@ static int NodePriorityTraversal(std::shared_ptr<PrioritisedNode> &node) {
   return node->priority;
 }
 
-static std::shared_ptr<plugin::Plugin> CreatePluginTraverse(
+static std::string NodeDescriptor(const PrioritisedNode &node,
+                                  const EdgeMap &edge_map, bool duplicated) {
+  // Everything the plugin for the node is created from: its description, its
+  // sources and how they connect, and whether it is shared between targets or
+  // duplicated for them
+  std::set<std::string> source_ids;
+  for (const auto &source : node.input) {
+    source_ids.insert(source->node->identifier());
+  }
+  nlohmann::json sources = nlohmann::json::array();
+  for (const auto &source_id : source_ids) {
+    nlohmann::json edges = nlohmann::json::array();
+    for (const auto &edge :
+         edge_map.at({source_id, node.node->identifier()})) {
+      edges.push_back({edge.first, edge.second});
+    }
+    sources.push_back({source_id, edges});
+  }
+  std::set<std::shared_ptr<PrioritisedNode>> targets(node.output.begin(),
+                                                     node.output.end());
+  nlohmann::json descriptor = {{"node", node.node->grapherNode()},
+                               {"sources", sources},
+                               {"shared", targets.size() > 1 && !duplicated},
+                               {"duplicated", duplicated}};
+  return descriptor.dump();
+}
+
+static std::set<std::string> DuplicatedNodes(
+    const std::map<std::string, std::shared_ptr<PrioritisedNode>> &nodes,
+    const std::shared_ptr<PrioritisedNode> &output_node,
+    const plugin::Registry &plugin_registry) {
+  // A node renders at a single sample index each block, so it can only be
+  // shared by consumers that all ask for the same one. One reached along
+  // several paths, some of which move time around, is created for each.
+  std::map<std::string, bool> aligned_nodes;
+  std::map<std::string, long> node_paths;
+  std::set<std::string> duplicated_nodes;
+  for (const auto &node : nodes) {
+    if (!NodeTimeAligned(node.second, output_node, plugin_registry,
+                         aligned_nodes) &&
+        NodePaths(node.second, output_node, node_paths) > 1) {
+      duplicated_nodes.insert(node.first);
+    }
+  }
+  return duplicated_nodes;
+}
+
+static bool NodeTimeAligned(const std::shared_ptr<PrioritisedNode> &node,
+                            const std::shared_ptr<PrioritisedNode> &output_node,
+                            const plugin::Registry &plugin_registry,
+                            std::map<std::string, bool> &aligned_nodes) {
+  const std::string &identifier = node->node->identifier();
+  auto aligned_node_it = aligned_nodes.find(identifier);
+  if (aligned_node_it != aligned_nodes.end()) {
+    return aligned_node_it->second;
+  }
+  bool aligned = true;
+  for (const auto &target : node->output) {
+    if (target == output_node) {
+      continue;
+    }
+    aligned = plugin_registry.timeAligned(target->node->grapherNode()) &&
+              NodeTimeAligned(target, output_node, plugin_registry,
+                              aligned_nodes);
+    if (!aligned) {
+      break;
+    }
+  }
+  aligned_nodes[identifier] = aligned;
+  return aligned;
+}
+
+static long NodePaths(const std::shared_ptr<PrioritisedNode> &node,
+                      const std::shared_ptr<PrioritisedNode> &output_node,
+                      std::map<std::string, long> &node_paths) {
+  if (node == output_node) {
+    return 1;
+  }
+  const std::string &identifier = node->node->identifier();
+  auto node_paths_it = node_paths.find(identifier);
+  if (node_paths_it != node_paths.end()) {
+    return node_paths_it->second;
+  }
+  // Only whether there is more than one matters, so the count stops at two
+  std::set<std::shared_ptr<PrioritisedNode>> targets(node->output.begin(),
+                                                     node->output.end());
+  long paths = 0;
+  for (const auto &target : targets) {
+    paths = std::min(paths + NodePaths(target, output_node, node_paths), 2l);
+  }
+  node_paths[identifier] = paths;
+  return paths;
+}
+
+static bool NodeUnchanged(
+    const std::shared_ptr<PrioritisedNode> &node,
+    const std::map<std::string, std::string> &descriptors,
+    const std::map<std::string, std::string> &loaded_descriptors,
+    std::map<std::string, bool> &unchanged_nodes) {
+  const std::string &identifier = node->node->identifier();
+  auto unchanged_node_it = unchanged_nodes.find(identifier);
+  if (unchanged_node_it != unchanged_nodes.end()) {
+    return unchanged_node_it->second;
+  }
+  auto loaded_descriptor_it = loaded_descriptors.find(identifier);
+  bool unchanged = loaded_descriptor_it != loaded_descriptors.end() &&
+                   loaded_descriptor_it->second == descriptors.at(identifier);
+  for (const auto &source : node->input) {
+    if (!unchanged) {
+      break;
+    }
+    unchanged = NodeUnchanged(source, descriptors, loaded_descriptors,
+                              unchanged_nodes);
+  }
+  unchanged_nodes[identifier] = unchanged;
+  return unchanged;
+}
+
+static std::shared_ptr<plugin::ExecutionPlan::Node> CreatePluginTraverse(
     std::shared_ptr<PrioritisedNode> &node, const EdgeMap &edge_map,
     const std::string &graph_id, int channels, double samplerate,
     std::shared_ptr<plugin::Registry> &plugin_registry,
     std::shared_ptr<PrioritisedNode> &output_node,
-    const std::string &session_id) {
+    const std::string &session_id,
+    const std::shared_ptr<RenderThreadPool> &render_thread_pool,
+    const std::shared_ptr<plugin::RenderPass> &render_pass,
+    const std::shared_ptr<const RenderProfiling> &profiling,
+    const std::set<std::string> &duplicated_nodes,
+    const std::map<std::string, std::shared_ptr<plugin::ExecutionPlan::Node>>
+        &reused_plan_nodes,
+    std::map<std::string, std::shared_ptr<plugin::ExecutionPlan::Node>>
+        &plan_nodes) {
+  // Nodes with several outputs are only created once and shared between them,
+  // unless some of them move time around
+  const bool duplicated =
+      duplicated_nodes.count(node->node->identifier()) > 0;
+  auto plan_node_it = plan_nodes.find(node->node->identifier());
+  if (plan_node_it != plan_nodes.end() && !duplicated) {
+    return plan_node_it->second;
+  }
+  // As are subtrees that haven't changed since the last score was loaded
+  auto reused_plan_node_it = reused_plan_nodes.find(node->node->identifier());
+  if (reused_plan_node_it != reused_plan_nodes.end()) {
+    plan_nodes[node->node->identifier()] = reused_plan_node_it->second;
+    return reused_plan_node_it->second;
+  }
+
   // Traverse the leaves in order
   std::sort(node->input.begin(), node->input.end(),
             [](const std::shared_ptr<PrioritisedNode> &node1,
@@ -699,30 +1266,83 @@ static std::shared_ptr<plugin::Plugin> CreatePluginTraverse(
               return node1->priority > node2->priority;
             });
 
-  std::vector<plugin::MixerPlugin::Metadata> mixer_metadata;
+  auto plan_node = std::make_shared<plugin::ExecutionPlan::Node>();
+  std::vector<std::pair<std::shared_ptr<PrioritisedNode>,
+                        std::shared_ptr<plugin::ExecutionPlan::Node>>>
+      source_plan_nodes;
+  std::set<std::shared_ptr<PrioritisedNode>> source_nodes;
+  int input_channels = 0;
   for (auto &source_node : node->input) {
-    plugin::MixerPlugin::Metadata metadata;
-    metadata._plugin = CreatePluginTraverse(
+    // Several edges between the same nodes are all carried by one input
+    if (!source_nodes.insert(source_node).second) {
+      continue;
+    }
+    auto source_plan_node = CreatePluginTraverse(
         source_node, edge_map, graph_id, channels, samplerate, plugin_registry,
-        output_node, session_id);
-    EdgeMap::key_type edge_key{std::string(source_node->node->identifier()),
+        output_node, session_id, render_thread_pool, render_pass, profiling,
+        duplicated_nodes, reused_plan_nodes, plan_nodes);
+    input_channels = std::max(input_channels, source_plan_node->_channels);
+    source_plan_nodes.emplace_back(source_node, source_plan_node);
+  }
+
+  // Negotiate the width of the node now that its inputs have theirs
+  if (output_node == node) {
+    plan_node->_channels = channels;
+  } else {
+    plan_node->_channels = plugin_registry->channels(
+        node->node->grapherNode(),
+        source_plan_nodes.empty() ? channels : input_channels, channels);
+  }
+
+  std::vector<plugin::MixerPlugin::Metadata> mixer_metadata;
+  for (auto &source : source_plan_nodes) {
+    auto source_plan_node = source.second;
+    EdgeMap::key_type edge_key{std::string(source.first->node->identifier()),
                                std::string(node->node->identifier())};
-    metadata._edges = edge_map.at(edge_key);
+    const auto &edges = edge_map.at(edge_key);
+    // Narrower inputs are widened for this node alone, the input itself might
+    // be shared with consumers of other widths
+    if (source_plan_node->_plugin &&
+        source_plan_node->_channels < plan_node->_channels) {
+      auto upmix_node = std::make_shared<plugin::ExecutionPlan::Node>();
+      upmix_node->_plugin = std::make_shared<plugin::UpmixPlugin>(
+          source_plan_node->_plugin, source_plan_node->_channels,
+          plan_node->_channels);
+      upmix_node->_inputs.emplace_back(source_plan_node, edges);
+      upmix_node->_channels = plan_node->_channels;
+      source_plan_node = upmix_node;
+    }
+    plugin::MixerPlugin::Metadata metadata;
+    metadata._plugin = source_plan_node->_plugin;
+    metadata._edges = edges;
     mixer_metadata.push_back(metadata);
+    plan_node->_inputs.emplace_back(source_plan_node, metadata._edges);
   }
 
-  std::shared_ptr<plugin::Plugin> mixer_plugin =
-      std::make_shared<plugin::MixerPlugin>(mixer_metadata, channels,
-                                            samplerate);
+  plan_node->_input = std::make_shared<plugin::PlanInputPlugin>(
+      mixer_metadata, plan_node->_channels, samplerate, render_thread_pool);
   if (output_node == node) {
-    node->node->setPlugin(mixer_plugin);
-    return mixer_plugin;
-  }
-  auto plugin = plugin_registry->createPlugin(node->node->grapherNode(),
-                                              graph_id, channels, samplerate,
-                                              mixer_plugin, session_id);
-  node->node->setPlugin(plugin);
-  return plugin;
+    std::shared_ptr<plugin::Plugin> input_plugin = plan_node->_input;
+    node->node->setPlugin(input_plugin);
+    return plan_node;
+  }
+  plan_node->_plugin = plugin_registry->createPlugin(
+      node->node->grapherNode(), graph_id, plan_node->_channels, samplerate,
+      plan_node->_input, session_id);
+  node->node->setPlugin(plan_node->_plugin);
+  if (plan_node->_plugin) {
+    plan_node->_plugin = std::make_shared<plugin::ProfiledPlugin>(
+        plan_node->_plugin, node->node->renderProfile(), profiling,
+        plan_node->_input);
+  }
+  std::set<std::shared_ptr<PrioritisedNode>> target_nodes(node->output.begin(),
+                                                          node->output.end());
+  if (plan_node->_plugin && target_nodes.size() > 1 && !duplicated) {
+    plan_node->_plugin = std::make_shared<plugin::SharedNodePlugin>(
+        plan_node->_plugin, render_pass);
+  }
+  plan_nodes[node->node->identifier()] = plan_node;
+  return plan_node;
 }
 
 }  // namespace smartplayer
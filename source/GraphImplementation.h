@@ -27,11 +27,16 @@
 #include <NFSmartPlayer/Registry.h>
 
 #include <atomic>
+#include <chrono>
 #include <mutex>
 
+#include "ExecutionPlan.h"
 #include "GraphDelegate.h"
 #include "NodeImplementation.h"
 #include "Player.h"
+#include "RenderProfile.h"
+#include "RenderThreadPool.h"
+#include "SharedNodePlugin.h"
 
 namespace nativeformat {
 namespace smartplayer {
@@ -79,9 +84,34 @@ class GraphImplementation
   bool finished() override;
   void forEachScript(
       NF_SMART_PLAYER_GRAPH_SCRIPT_CALLBACK script_callback) override;
+  void setProfiling(bool profiling) override;
+  bool profiling() const override;
+  RenderStats renderStats() const override;
 
   void setPluginRegistry(std::shared_ptr<plugin::Registry> plugin_registry);
   void setDelegate(std::weak_ptr<GraphDelegate> delegate);
+  void setRenderThreadPool(
+      std::shared_ptr<RenderThreadPool> render_thread_pool);
+  /**
+   * Whether the next score loaded is compiled into an execution plan, or fed
+   * recursively from the output node
+   */
+  void setUsesExecutionPlan(bool uses_execution_plan);
+  /**
+   * Whether the execution plan feeds plugins that support it content keyed by
+   * interned port rather than by name
+   */
+  void setUsesPortContent(bool uses_port_content);
+  /**
+   * The number of samples the graph is expected to render each block, so the
+   * next score loaded can size its buffers up front
+   */
+  void setBlockSize(size_t block_samples);
+  /**
+   * How many blocks a changed score fades in over once it loads, while the
+   * score it replaces fades out. With none the new score takes over at once.
+   */
+  void setCrossfadeBlocks(size_t crossfade_blocks);
 
  protected:
   void run() override;
@@ -92,6 +122,33 @@ class GraphImplementation
                LOAD_CALLBACK load_callback) override;
 
  private:
+  /**
+   * A node of the score currently rendering, along with how it was wired up
+   * so the next score loaded can tell whether its subtree changed
+   */
+  struct LoadedNode {
+    std::string _descriptor;
+    std::shared_ptr<Node> _node;
+    std::shared_ptr<plugin::ExecutionPlan::Node> _plan_node;
+  };
+  /**
+   * A changed score that has loaded and is catching up with the render
+   * position before it fades in
+   */
+  struct IncomingScore {
+    std::shared_ptr<plugin::Plugin> _root_plugin;
+    std::shared_ptr<plugin::RenderPass> _render_pass;
+    std::map<std::string, LoadedNode> _loaded_nodes;
+    std::map<std::string, std::shared_ptr<plugin::Content>> _content;
+    nfgrapher::LoadingPolicy _loading_policy;
+    size_t _crossfade_samples;
+    long _sample_index;
+    std::chrono::steady_clock::time_point _timeout;
+    // Reports the load once the score takes over, or is superseded
+    std::function<void()> _load_callback;
+  };
+
+  void setScore(const nfgrapher::Score &score, LOAD_CALLBACK load_callback);
   void loadScore(const nfgrapher::Score &score, LOAD_CALLBACK load_callback);
   std::map<std::string, std::shared_ptr<Script>> loadScripts(
       const nfgrapher::Score &score);
@@ -99,8 +156,26 @@ class GraphImplementation
                                                LOAD_CALLBACK load_callback,
                                                bool &failed);
   std::shared_ptr<Node> nodeForIdentifier(const std::string &identifier);
+  void setIncomingScore(std::shared_ptr<IncomingScore> incoming_score);
+  void preroll();
+  void crossfadeTo(std::shared_ptr<plugin::Plugin> root_plugin,
+                   std::shared_ptr<plugin::RenderPass> render_pass,
+                   const std::map<std::string, LoadedNode> &loaded_nodes,
+                   size_t crossfade_samples);
+  void feedRoot(
+      std::map<std::string, std::shared_ptr<plugin::Content>> &content,
+      long sample_index, nfgrapher::LoadingPolicy loading_policy);
+  void crossfade(
+      std::map<std::string, std::shared_ptr<plugin::Content>> &content);
 
   std::shared_ptr<plugin::Registry> _plugin_registry;
+  std::shared_ptr<RenderThreadPool> _render_thread_pool;
+  bool _uses_execution_plan;
+  bool _uses_port_content;
+  size_t _block_samples;
+  std::atomic<size_t> _crossfade_blocks;
+  const std::shared_ptr<RenderProfiling> _profiling;
+  RenderProfile _render_profile;
   const int _channels;
   const double _samplerate;
   const std::string _session_id;
@@ -120,7 +195,21 @@ class GraphImplementation
   std::atomic<long> _buffer_size;
   std::mutex _root_plugin_mutex;
   std::shared_ptr<plugin::Plugin> _root_plugin;
+  std::shared_ptr<plugin::RenderPass> _render_pass;
+  // The score fading out, along with where it is in its fade
+  std::shared_ptr<plugin::Plugin> _outgoing_plugin;
+  std::shared_ptr<plugin::RenderPass> _outgoing_render_pass;
+  std::map<std::string, std::shared_ptr<plugin::Content>> _outgoing_content;
+  long _crossfade_frames;
+  long _crossfade_frame;
+  // Faded out scores wait here to be freed off the render thread
+  std::shared_ptr<plugin::Plugin> _released_plugin;
+  // Guarded by the root plugin mutex, it always describes the root plugin
+  std::map<std::string, LoadedNode> _loaded_nodes;
   std::map<std::string, std::shared_ptr<plugin::Content>> _cut_content;
+  // Taken before the root plugin mutex whenever both are held
+  std::mutex _incoming_score_mutex;
+  std::shared_ptr<IncomingScore> _incoming_score;
   std::map<std::string, std::shared_ptr<Node>> _nodes;
 };
 
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "HealthMonitor.h"
+
+#include <algorithm>
+
+namespace nativeformat {
+namespace smartplayer {
+
+const double HealthMonitorNearMissRatio = 0.8;
+const double HealthMonitorReportInterval = 1.0;
+
+const size_t HealthMonitor::ReportEvents;
+
+HealthMonitor::HealthMonitor(double near_miss_ratio, double report_interval)
+    : _near_miss_ratio(near_miss_ratio),
+      _report_interval(static_cast<long>(report_interval * 1.0e9)),
+      _rendering(false),
+      _xruns(0),
+      _near_misses(0),
+      _stutters(0),
+      _event_render_time(0.0),
+      _events(0),
+      _reported_events(0),
+      _reported_time(std::chrono::steady_clock::now() - _report_interval) {
+  for (auto &event_slot : _event_slots) {
+    event_slot._sequence = 0;
+    event_slot._type = EventTypeXrun;
+    event_slot._render_time = 0.0;
+  }
+}
+
+HealthMonitor::~HealthMonitor() {}
+
+void HealthMonitor::willRender() {
+  _render_start = std::chrono::steady_clock::now();
+  _rendering = true;
+}
+
+void HealthMonitor::didRender(long frames, double samplerate,
+                              double render_time) {
+  if (!_rendering || samplerate <= 0.0) {
+    return;
+  }
+  _rendering = false;
+  const long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - _render_start)
+                         .count();
+  const long deadline_nanos = static_cast<long>(frames * 1.0e9 / samplerate);
+  _callbacks.record(nanos, deadline_nanos);
+  if (nanos > deadline_nanos) {
+    _xruns.fetch_add(1, std::memory_order_relaxed);
+    record(EventTypeXrun, render_time);
+  } else if (nanos > deadline_nanos * _near_miss_ratio) {
+    _near_misses.fetch_add(1, std::memory_order_relaxed);
+    record(EventTypeNearMiss, render_time);
+  }
+}
+
+void HealthMonitor::didStutter(double render_time) {
+  _stutters.fetch_add(1, std::memory_order_relaxed);
+  record(EventTypeStutter, render_time);
+}
+
+void HealthMonitor::record(EventType type, double render_time) {
+  _event_render_time = render_time;
+  const long event = _events.fetch_add(1);
+  EventSlot &event_slot = _event_slots[event % ReportEvents];
+  // Marked as being written, so a report reading it meanwhile skips it
+  event_slot._sequence = -1;
+  event_slot._type = type;
+  event_slot._render_time = render_time;
+  event_slot._sequence = event + 1;
+}
+
+bool HealthMonitor::report(Report &report) {
+  const long events = _events;
+  const auto now = std::chrono::steady_clock::now();
+  if (events == _reported_events || now - _reported_time < _report_interval) {
+    return false;
+  }
+  report._events.clear();
+  for (long event = std::max(_reported_events,
+                             events - static_cast<long>(ReportEvents));
+       event < events; ++event) {
+    // Left out if it is still being written, or a later event has taken its
+    // slot since, although the counts still include it
+    const EventSlot &event_slot = _event_slots[event % ReportEvents];
+    if (event_slot._sequence != event + 1) {
+      continue;
+    }
+    const Event reported_event{static_cast<EventType>(event_slot._type.load()),
+                               event_slot._render_time};
+    if (event_slot._sequence == event + 1) {
+      report._events.push_back(reported_event);
+    }
+  }
+  _reported_events = events;
+  _reported_time = now;
+  report._xruns = _xruns;
+  report._near_misses = _near_misses;
+  report._stutters = _stutters;
+  report._render_time = _event_render_time;
+  report._callbacks = _callbacks.stats();
+  return true;
+}
+
+RenderStats HealthMonitor::callbackStats() const { return _callbacks.stats(); }
+
+}  // namespace smartplayer
+}  // namespace nativeformat
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "RenderProfile.h"
+
+namespace nativeformat {
+namespace smartplayer {
+
+extern const double HealthMonitorNearMissRatio;
+extern const double HealthMonitorReportInterval;
+
+/**
+ * Watches the driver callbacks for blocks that missed their deadline (xruns),
+ * blocks that came close (near misses) and stutters the driver reports. The
+ * render thread side is lock free and doesn't allocate, the control thread
+ * collects reports at most once per interval and only when something
+ * happened.
+ */
+class HealthMonitor {
+ public:
+  // The most events a report lists
+  static const size_t ReportEvents = 32;
+
+  enum EventType { EventTypeXrun, EventTypeNearMiss, EventTypeStutter };
+  struct Event {
+    EventType _type;
+    double _render_time;  // Where the player was rendering
+  };
+  struct Report {
+    long _xruns;
+    long _near_misses;
+    long _stutters;
+    double _render_time;  // Where the player was rendering at the last event
+    // The events since the last report, only the most recent ReportEvents
+    // of them if there were more
+    std::vector<Event> _events;
+    RenderStats _callbacks;
+  };
+
+  HealthMonitor(double near_miss_ratio = HealthMonitorNearMissRatio,
+                double report_interval = HealthMonitorReportInterval);
+  virtual ~HealthMonitor();
+
+  // Render thread
+  void willRender();
+  void didRender(long frames, double samplerate, double render_time);
+  void didStutter(double render_time);
+
+  // Control thread
+  /**
+   * Fills in a report if there has been an event since the last one and the
+   * report interval has passed
+   */
+  bool report(Report &report);
+  RenderStats callbackStats() const;
+
+ private:
+  // Written by whichever thread had the event, the sequence is that of the
+  // event plus one once the slot holds it
+  struct EventSlot {
+    std::atomic<long> _sequence;
+    std::atomic<int> _type;
+    std::atomic<double> _render_time;
+  };
+
+  void record(EventType type, double render_time);
+
+  const double _near_miss_ratio;
+  const std::chrono::nanoseconds _report_interval;
+
+  std::chrono::steady_clock::time_point _render_start;
+  bool _rendering;
+  RenderProfile _callbacks;
+  std::atomic<long> _xruns;
+  std::atomic<long> _near_misses;
+  std::atomic<long> _stutters;
+  std::atomic<double> _event_render_time;
+  std::atomic<long> _events;
+  std::array<EventSlot, ReportEvents> _event_slots;
+
+  long _reported_events;
+  std::chrono::steady_clock::time_point _reported_time;
+};
+
+}  // namespace smartplayer
+}  // namespace nativeformat
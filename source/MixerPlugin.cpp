@@ -23,16 +23,27 @@
 #define BOOST_THREAD_PROVIDES_FUTURE
 #define BOOST_THREAD_PROVIDES_FUTURE_CONTINUATION
 #define BOOST_THREAD_PROVIDES_FUTURE_WHEN_ALL_WHEN_ANY
+#include <algorithm>
 #include <boost/thread.hpp>
+#include <chrono>
+
+#include "RenderThreadPool.h"
 
 namespace nativeformat {
 namespace plugin {
 
 const std::string MixerPluginIdentifier("com.nativeformat.plugin.mixer");
 
-MixerPlugin::MixerPlugin(const std::vector<Metadata> &metadata, int channels,
-                         double samplerate)
-    : _child_metadata(metadata) {}
+static const double MixerPluginFeedCostSmoothing = 0.1;
+
+MixerPlugin::MixerPlugin(
+    const std::vector<Metadata> &metadata, int channels, double samplerate,
+    std::shared_ptr<smartplayer::RenderThreadPool> render_thread_pool)
+    : _child_metadata(metadata),
+      _render_thread_pool(render_thread_pool),
+      _child_process(metadata.size(), false),
+      _child_feed_nanos(metadata.size(), 0),
+      _average_feed_nanos(0.0) {}
 
 MixerPlugin::~MixerPlugin() {}
 
@@ -93,8 +104,11 @@ void MixerPlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
   for (auto &content_item_pair : _maximum_content_items) {
     content_item_pair.second = 0;
   }
-  std::map<std::string, bool> first_processed;
-  for (auto &metadata : _child_metadata) {
+  for (auto &first_processed_pair : _first_processed) {
+    first_processed_pair.second = false;
+  }
+  for (size_t i = 0; i < _child_metadata.size(); ++i) {
+    auto &metadata = _child_metadata[i];
     auto &plugin = metadata._plugin;
     auto &edges = metadata._edges;
     auto &tmp_content = metadata._content;
@@ -105,8 +119,8 @@ void MixerPlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
     // TODO: Do we consider this auto-abuse?
     // edge is std::pair<std::string, std::string>
     for (const auto &edge : edges) {
-      auto source = edge.first;
-      auto dest = edge.second;
+      const auto &source = edge.first;
+      const auto &dest = edge.second;
 
       /* THIS IS A HACK until we support not-audio
        or until we have a plugin that doesnt take
@@ -145,24 +159,47 @@ void MixerPlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
       max_items = std::max(source_it->second->requiredItems(), max_items);
     }
 
-    // Process the plugin
-    if (!plugin->shouldProcess(sample_index, sample_index + max_items)) {
-      continue;
+    _child_process[i] =
+        plugin->shouldProcess(sample_index, sample_index + max_items);
+  }
+
+  // Process the plugins, each writes into its own content so they can run
+  // concurrently
+  FeedContext feed_context{this, sample_index, graph_sample_index,
+                           loading_policy};
+  if (shouldFeedInParallel()) {
+    _render_thread_pool->parallelFor(_child_metadata.size(),
+                                     &MixerPlugin::feedChild, &feed_context);
+  } else {
+    for (size_t i = 0; i < _child_metadata.size(); ++i) {
+      feedChild(&feed_context, i);
     }
-    plugin->feed(tmp_content, sample_index, graph_sample_index, loading_policy);
+  }
+  long feed_nanos = 0;
+  for (const auto child_feed_nanos : _child_feed_nanos) {
+    feed_nanos += child_feed_nanos;
+  }
+  _average_feed_nanos +=
+      (feed_nanos - _average_feed_nanos) * MixerPluginFeedCostSmoothing;
 
-    // Now mix!
-    for (const auto &edge : edges) {
-      auto dest = edge.second;
-      auto source = edge.first;
-      if (!first_processed.count(dest)) first_processed[dest] = false;
-      if (!first_processed[dest]) {
+  // Now mix! Always in child order so the result doesn't depend on how the
+  // children were processed
+  for (size_t i = 0; i < _child_metadata.size(); ++i) {
+    if (!_child_process[i]) {
+      continue;
+    }
+    auto &metadata = _child_metadata[i];
+    auto &tmp_content = metadata._content;
+    for (const auto &edge : metadata._edges) {
+      const auto &dest = edge.second;
+      const auto &source = edge.first;
+      bool &first_processed = _first_processed[dest];
+      if (!first_processed) {
         _maximum_content_items[dest] = tmp_content[source]->items();
-        content[dest]->setItems(_maximum_content_items[dest]);
-        // Copy instead of mixing since there's nothing in content[dest] yet
-        std::copy_n(tmp_content[source]->payload(), content[dest]->items(),
-                    content[dest]->payload());
-        first_processed[dest] = true;
+        // Copy instead of mixing since there's nothing in content[dest] yet,
+        // a silent child leaves content[dest] silent
+        content[dest]->copy(*(tmp_content[source]));
+        first_processed = true;
       } else {
         switch (loading_policy) {
           case nfgrapher::LoadingPolicy::SOME_CONTENT_PLAYTHROUGH:
@@ -180,6 +217,35 @@ void MixerPlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
   }
 }
 
+void MixerPlugin::feedChild(void *context, size_t index) {
+  FeedContext *feed_context = static_cast<FeedContext *>(context);
+  MixerPlugin *mixer = feed_context->_mixer;
+  if (!mixer->_child_process[index]) {
+    mixer->_child_feed_nanos[index] = 0;
+    return;
+  }
+  auto &metadata = mixer->_child_metadata[index];
+  auto start = std::chrono::steady_clock::now();
+  metadata._plugin->feed(metadata._content, feed_context->_sample_index,
+                         feed_context->_graph_sample_index,
+                         feed_context->_loading_policy);
+  mixer->_child_feed_nanos[index] =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count();
+}
+
+bool MixerPlugin::shouldFeedInParallel() const {
+  if (!_render_thread_pool || _render_thread_pool->threads() < 2) {
+    return false;
+  }
+  size_t processing_children =
+      std::count(_child_process.begin(), _child_process.end(), true);
+  return processing_children > 1 &&
+         _average_feed_nanos >
+             smartplayer::RenderThreadPoolMinimumParallelNanos;
+}
+
 void MixerPlugin::load(LOAD_CALLBACK callback) {
   if (_child_metadata.empty()) {
     callback(Load{true});
@@ -25,6 +25,9 @@
 #include <memory>
 
 namespace nativeformat {
+namespace smartplayer {
+class RenderThreadPool;
+}  // namespace smartplayer
 namespace plugin {
 
 extern const std::string MixerPluginIdentifier;
@@ -41,7 +44,9 @@ class MixerPlugin : public Plugin,
   };
 
   MixerPlugin(const std::vector<Metadata> &metadata, int channels,
-              double samplerate);
+              double samplerate,
+              std::shared_ptr<smartplayer::RenderThreadPool> render_thread_pool =
+                  nullptr);
   virtual ~MixerPlugin();
 
   // Plugin
@@ -64,6 +69,15 @@ class MixerPlugin : public Plugin,
   bool shouldProcess(long sample_index_start, long sample_index_end) override;
 
  private:
+  struct FeedContext {
+    MixerPlugin *_mixer;
+    long _sample_index;
+    long _graph_sample_index;
+    nfgrapher::LoadingPolicy _loading_policy;
+  };
+  static void feedChild(void *context, size_t index);
+  bool shouldFeedInParallel() const;
+
   std::vector<Metadata>
       _child_metadata;  // vector that defines metadata of plugins to source
                         // content from. Remember the graph is traversed from
@@ -73,6 +87,16 @@ class MixerPlugin : public Plugin,
       _maximum_content_items;  // Tracks the amount of items in the content that
                                // will be returned/output to the destination
                                // plugin
+  std::map<std::string, bool>
+      _first_processed;  // Whether a destination has been written to yet
+                         // this block, kept between blocks so mixing doesn't
+                         // allocate
+
+  // Parallel feeding of the children, decided per block from what they cost
+  const std::shared_ptr<smartplayer::RenderThreadPool> _render_thread_pool;
+  std::vector<bool> _child_process;
+  std::vector<long> _child_feed_nanos;
+  double _average_feed_nanos;
 };
 
 }  // namespace plugin
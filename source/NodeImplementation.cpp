@@ -44,7 +44,8 @@ NodeImplementation::NodeImplementation(nfgrapher::Node &grapher_node,
       _loading_policy(LoadingPolicy::ALL_CONTENT_PLAYTHROUGH),
       _identifier(grapher_node.id),
       _type(grapher_node.kind),
-      _grapher_node(std::move(grapher_node)) {
+      _grapher_node(std::move(grapher_node)),
+      _render_profile(std::make_shared<RenderProfile>()) {
   /*
   if (json.find(NodeImplementationLoadingPolicyKey) != json.end()) {
     _loading_policy =
@@ -61,7 +62,8 @@ NodeImplementation::NodeImplementation(bool output_node,
       _loading_policy(loading_policy),
       _identifier(identifier),
       _type(type),
-      _grapher_node(makeCustomNode(identifier, type)) {}
+      _grapher_node(makeCustomNode(identifier, type)),
+      _render_profile(std::make_shared<RenderProfile>()) {}
 
 NodeImplementation::NodeImplementation(bool output_node,
                                        LoadingPolicy loading_policy,
@@ -72,7 +74,8 @@ NodeImplementation::NodeImplementation(bool output_node,
       _loading_policy(loading_policy),
       _identifier(identifier),
       _type(type),
-      _grapher_node(std::move(grapher_node)) {}
+      _grapher_node(std::move(grapher_node)),
+      _render_profile(std::make_shared<RenderProfile>()) {}
 
 NodeImplementation::~NodeImplementation() {}
 
@@ -89,6 +92,14 @@ std::shared_ptr<plugin::Plugin> NodeImplementation::plugin() const {
   return _plugin;
 }
 
+RenderStats NodeImplementation::renderStats() const {
+  return _render_profile->stats();
+}
+
+std::shared_ptr<RenderProfile> NodeImplementation::renderProfile() const {
+  return _render_profile;
+}
+
 const nfgrapher::Node &NodeImplementation::grapherNode() const {
   return _grapher_node;
 }
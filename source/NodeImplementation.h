@@ -24,6 +24,8 @@
 
 #include <memory>
 
+#include "RenderProfile.h"
+
 namespace nativeformat {
 namespace smartplayer {
 
@@ -54,6 +56,8 @@ class NodeImplementation : public Node {
   std::shared_ptr<plugin::Plugin> plugin() const override;
   nfgrapher::LoadingPolicy loadingPolicy() const override;
   std::vector<std::string> dependencies() const override;
+  RenderStats renderStats() const override;
+  std::shared_ptr<RenderProfile> renderProfile() const override;
 
  protected:
   void run(double time, const plugin::NodeTimes &node_times,
@@ -68,6 +72,7 @@ class NodeImplementation : public Node {
 
   const nfgrapher::Node _grapher_node;
   std::shared_ptr<plugin::Plugin> _plugin;
+  const std::shared_ptr<RenderProfile> _render_profile;
 };
 
 }  // namespace smartplayer
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "OfflineSegments.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nativeformat {
+namespace smartplayer {
+
+std::vector<OfflineSegment> planOfflineSegments(long frames, int segment_count,
+                                                long preroll_frames,
+                                                long crossfade_frames,
+                                                long block_frames) {
+  std::vector<OfflineSegment> segments;
+  if (frames <= 0) {
+    return segments;
+  }
+  block_frames = std::max(block_frames, 1L);
+  // Every segment after the first has to be long enough to hold its crossfade
+  const long minimum_frames = crossfade_frames + block_frames;
+  segment_count = static_cast<int>(std::max(
+      1L, std::min(static_cast<long>(segment_count), frames / minimum_frames)));
+  long start_boundary = 0;
+  for (int i = 0; i < segment_count; ++i) {
+    long end_boundary = frames;
+    if (i < segment_count - 1) {
+      end_boundary = (frames * (i + 1)) / segment_count;
+      end_boundary -= end_boundary % block_frames;
+    }
+    if (end_boundary - start_boundary < minimum_frames &&
+        end_boundary != frames) {
+      continue;
+    }
+    OfflineSegment segment;
+    segment._fade_frames =
+        std::min(start_boundary, start_boundary > 0 ? crossfade_frames : 0);
+    segment._start_frame = start_boundary - segment._fade_frames;
+    segment._render_frame = 0;
+    if (start_boundary > 0) {
+      segment._render_frame =
+          std::max(0L, segment._start_frame - preroll_frames);
+      segment._render_frame -= segment._render_frame % block_frames;
+    }
+    segment._end_frame = end_boundary;
+    segments.push_back(segment);
+    start_boundary = end_boundary;
+  }
+  return segments;
+}
+
+void crossfadeOfflineSegment(float *output, const float *fade_in,
+                             long fade_frames, int channels) {
+  // Both sides render the same signal once pre-rolled, so a linear fade keeps
+  // the level constant where an equal power one would bump it
+  for (long frame = 0; frame < fade_frames; ++frame) {
+    const float gain =
+        static_cast<float>(frame + 1) / static_cast<float>(fade_frames + 1);
+    for (int channel = 0; channel < channels; ++channel) {
+      const long i = frame * channels + channel;
+      output[i] = output[i] * (1.0f - gain) + fade_in[i] * gain;
+    }
+  }
+}
+
+float maximumSampleDeviation(const float *samples, const float *reference,
+                             size_t sample_count) {
+  float deviation = 0.0f;
+  for (size_t i = 0; i < sample_count; ++i) {
+    deviation = std::max(deviation, std::fabs(samples[i] - reference[i]));
+  }
+  return deviation;
+}
+
+}  // namespace smartplayer
+}  // namespace nativeformat
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace nativeformat {
+namespace smartplayer {
+
+/**
+ * A slice of an offline render that can be rendered independently of the
+ * others. Rendering starts at the pre-roll frame so stateful DSP settles, the
+ * first fade frames are crossfaded into the end of the previous segment and
+ * everything up to the end frame is kept.
+ */
+typedef struct OfflineSegment {
+  long _render_frame;  // Where rendering starts, including the pre-roll
+  long _start_frame;   // The first frame kept
+  long _fade_frames;   // Frames from the start crossfaded into the last segment
+  long _end_frame;     // One past the last frame kept
+} OfflineSegment;
+
+/**
+ * Splits frames into at most segment_count segments. Boundaries and render
+ * starts land on whole blocks so parameters are evaluated on the same blocks a
+ * serial render would use, and segments too short to hold their crossfade are
+ * merged away.
+ */
+std::vector<OfflineSegment> planOfflineSegments(long frames, int segment_count,
+                                                long preroll_frames,
+                                                long crossfade_frames,
+                                                long block_frames);
+/**
+ * Crossfades the head of a segment into the tail of the one before it, which
+ * output already holds
+ */
+void crossfadeOfflineSegment(float *output, const float *fade_in,
+                             long fade_frames, int channels);
+/**
+ * The largest absolute difference between two renders
+ */
+float maximumSampleDeviation(const float *samples, const float *reference,
+                             size_t sample_count);
+
+}  // namespace smartplayer
+}  // namespace nativeformat
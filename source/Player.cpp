@@ -20,9 +20,14 @@
  */
 #include "Player.h"
 
+#include <NFSmartPlayer/GlobalLogger.h>
+
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
+#include <chrono>
 #include <ctime>
 #include <functional>
+#include <future>
 #include <map>
 #include <sstream>
 #include <string>
@@ -35,6 +40,7 @@
 #include "NFOSCHandler.h"
 #include "Notification.h"
 #include "ScriptImplementation.h"
+#include "WaveFileWriter.h"
 
 namespace nativeformat {
 namespace smartplayer {
@@ -45,13 +51,19 @@ const int NFSmartPlayerNodeComponentIndex = 1;
 const int NFSmartPlayerParamComponentIndex = 2;
 const int NFSmartPlayerCommandComponentIndex = 3;
 
+static const std::chrono::milliseconds PlayerOfflineWaitInterval(1);
+static const std::chrono::seconds PlayerOfflineStallTimeout(30);
+
 Player::Player(std::shared_ptr<plugin::Registry> plugin_registry,
                NF_SMART_PLAYER_ERROR_CALLBACK error_callback,
                int localhost_write_port, DriverType driver_type,
                std::string output_destination,
-               boost::asio::io_service &io_service)
+               boost::asio::io_service &io_service, int render_threads,
+               double samplerate, int block_frames)
     : _channels(2),
-      _samplerate(44100.0),
+      _samplerate(samplerate > 0.0 ? samplerate : NFSmartPlayerSampleRate),
+      _block_frames(block_frames > 0 ? block_frames : NFSmartPlayerBlockSize),
+      _block_samples(_block_frames * _channels),
       _plugin_registry(plugin_registry),
       _error_callback(error_callback),
       _io_service(io_service),
@@ -66,16 +78,40 @@ Player::Player(std::shared_ptr<plugin::Registry> plugin_registry,
       _limiter(std::make_shared<Limiter>(_channels, kDelay)),
       _loading_policy(nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH),
       _finished(false),
+      _profiling(false),
+      _crossfade_blocks(0),
+      _callback_frames(0),
+      _render_snapshot(new RenderSnapshot()),
+      _render_snapshot_hazard(nullptr),
       _final_content(std::make_shared<plugin::Content>(
-          NF_DRIVER_SAMPLE_BLOCK_SIZE, 0, _samplerate, _channels,
-          NF_DRIVER_SAMPLE_BLOCK_SIZE, plugin::ContentPayloadTypeBuffer)) {}
-
-Player::~Player() { _driver->setPlaying(false); }
+          _block_samples, 0, _samplerate, _channels, _block_samples,
+          plugin::ContentPayloadTypeBuffer)),
+      _render_thread_pool(
+          render_threads > 1
+              ? std::make_shared<RenderThreadPool>(render_threads)
+              : nullptr),
+      _block(_block_samples),
+      _block_offset(0),
+      _block_rendered(0) {}
+
+Player::~Player() {
+  _driver->setPlaying(false);
+  std::lock_guard<std::mutex> render_lock(_render_mutex);
+  std::lock_guard<std::mutex> lock(_graphs_mutex);
+  for (RenderSnapshot *snapshot : _retired_render_snapshots) {
+    delete snapshot;
+  }
+  delete _render_snapshot.exchange(nullptr);
+}
 
 std::shared_ptr<plugin::Registry> Player::pluginRegistry() const {
   return _plugin_registry;
 }
 
+double Player::sampleRate() const { return _samplerate; }
+
+size_t Player::blockFrames() const { return _block_frames; }
+
 void Player::scriptDidClose(std::shared_ptr<Script> script) {
   _scripts.erase(script->name());
 }
@@ -127,17 +163,28 @@ boost::future<Load> Player::setJson(const std::string &json) {
     std::shared_ptr<GraphImplementation> player_graph_implementation =
         std::make_shared<GraphImplementation>(_channels, _samplerate,
                                               createGraphSessionId());
+    player_graph_implementation->setBlockSize(_block_samples);
     player_graph_implementation->setPluginRegistry(_plugin_registry);
     player_graph_implementation->setDelegate(shared_from_this());
+    player_graph_implementation->setRenderThreadPool(_render_thread_pool);
+    player_graph_implementation->setProfiling(_profiling);
+    player_graph_implementation->setCrossfadeBlocks(_crossfade_blocks);
     player_graph = player_graph_implementation;
   }
 
-  nlohmann::json graph_json = graph;
-  player_graph->setJson(
-      j, [promise](const Load &load) { promise->set_value(load); });
+  // Hand over the score we already have rather than converting it again
+  auto load_callback = [promise](const Load &load) {
+    promise->set_value(load);
+  };
+  if (auto player_graph_implementation =
+          std::dynamic_pointer_cast<GraphImplementation>(player_graph)) {
+    player_graph_implementation->setScore(score, load_callback);
+  } else {
+    player_graph->setJson(j, load_callback);
+  }
 
-  graph_future.then([this, load_promise, graph_id,
-                     player_graph](boost::future<Load> future) {
+  graph_future.then([this, load_promise, graph_id, player_graph,
+                     json](boost::future<Load> future) {
     Load load = future.get();
     if (load._loaded == false) {
       load_promise->set_value(load);
@@ -147,6 +194,7 @@ boost::future<Load> Player::setJson(const std::string &json) {
       // Assign the finished graph
       std::lock_guard<std::mutex> lock(_graphs_mutex);
       _graphs[graph_id] = player_graph;
+      _graph_scores[graph_id] = json;
       recalculateRenderVariables();
       _render_time = 0.0;
     }
@@ -173,7 +221,22 @@ boost::future<Load> Player::setJson(const std::string &json) {
 
 bool Player::isPlaying() const { return _driver->isPlaying(); }
 
-void Player::setPlaying(bool playing) { _driver->setPlaying(playing); }
+void Player::setPlaying(bool playing) {
+  // The driver always runs at its own rate, so a player at any other rate
+  // can only render offline
+  if (playing && _samplerate != NF_DRIVER_SAMPLERATE) {
+    std::stringstream ss;
+    ss << "Cannot play at " << _samplerate << "Hz, the driver runs at "
+       << NF_DRIVER_SAMPLERATE << "Hz";
+    NF_ERROR(ss.str());
+    if (_error_callback) {
+      Load load(false, PlayerErrorDomain, ss.str());
+      _error_callback(load._info);
+    }
+    return;
+  }
+  _driver->setPlaying(playing);
+}
 
 bool Player::canPlayThrough() const { return _play_through; }
 
@@ -195,12 +258,19 @@ void Player::setRenderTime(double time) {
     return true;
   });
   _render_time = time;
+  // Whatever is left of the last block belongs to the old time
+  _block_offset = 0;
+  _block_rendered = 0;
 }
 
 void Player::run() {
   if (_osc_handler) {
     _osc_handler->broadcast();
   }
+  {
+    std::lock_guard<std::mutex> lock(_graphs_mutex);
+    reclaimRenderSnapshots();
+  }
   forEachGraph([](const std::shared_ptr<Graph> &graph) {
     graph->run();
     return true;
@@ -211,6 +281,31 @@ void Player::run() {
                 NFSmartPlayerMessageTypeNone, nullptr);
     _finished = true;
   }
+
+  // Glitches are reported from here rather than the driver thread, and at
+  // most once per report interval
+  HealthMonitor::Report health_report;
+  if (_health_monitor.report(health_report)) {
+    nlohmann::json events = nlohmann::json::array();
+    for (const auto &event : health_report._events) {
+      static const char *event_types[] = {"xrun", "near_miss", "stutter"};
+      events.push_back({{"type", event_types[event._type]},
+                        {"render_time", event._render_time}});
+    }
+    nlohmann::json health_json = {
+        {"xruns", health_report._xruns},
+        {"near_misses", health_report._near_misses},
+        {"stutters", health_report._stutters},
+        {"render_time", health_report._render_time},
+        {"events", events},
+        {"callback_mean_time", health_report._callbacks._mean_time},
+        {"callback_p99_time", health_report._callbacks._p99_time},
+        {"callback_max_time", health_report._callbacks._max_time},
+        {"load", health_report._callbacks._load}};
+    const std::string health_payload = health_json.dump();
+    sendMessage(PlayerMessageIdentifierXrun, PlayerSenderIdentifier,
+                NFSmartPlayerMessageTypeGeneric, health_payload.c_str());
+  }
 }
 
 void Player::forEachGraph(NF_SMART_PLAYER_GRAPH_CALLBACK graph_callback) {
@@ -356,6 +451,11 @@ std::shared_ptr<Script> Player::scriptForIdentifier(
 
 void Player::addGraph(std::shared_ptr<Graph> graph) {
   std::lock_guard<std::mutex> lock(_graphs_mutex);
+  graph->setProfiling(_profiling);
+  if (auto graph_implementation =
+          std::dynamic_pointer_cast<GraphImplementation>(graph)) {
+    graph_implementation->setCrossfadeBlocks(_crossfade_blocks);
+  }
   _graphs[graph->identifier()] = graph;
   recalculateRenderVariables();
 }
@@ -363,6 +463,7 @@ void Player::addGraph(std::shared_ptr<Graph> graph) {
 void Player::removeGraph(const std::string &identifier) {
   std::lock_guard<std::mutex> lock(_graphs_mutex);
   _graphs.erase(identifier);
+  _graph_scores.erase(identifier);
   recalculateRenderVariables();
   sendMessage("com.nativeformat.graph.remove", "com.nativeformat.host",
               NFSmartPlayerMessageTypeGeneric, identifier.c_str());
@@ -406,62 +507,449 @@ bool Player::isLoaded() {
   return loaded && graphs > 0;
 }
 
-void Player::driverDidStutter(void *clientdata) {}
+OfflineRender Player::renderOffline(const std::string &output_path,
+                                    double duration) {
+  OfflineRender offline_render{false, "", 0.0, 0.0, 0.0, 0.0f};
+  setPlaying(false);
+
+  // Pump the graphs ourselves rather than waiting on the client's timer
+  auto wait_start = std::chrono::steady_clock::now();
+  while (!isLoaded()) {
+    run();
+    if (std::chrono::steady_clock::now() - wait_start >
+        PlayerOfflineStallTimeout) {
+      offline_render._error = "Timed out waiting for the graphs to load";
+      return offline_render;
+    }
+    std::this_thread::sleep_for(PlayerOfflineWaitInterval);
+  }
+
+  WaveFileWriter writer(output_path, _channels, _samplerate);
+  if (!writer.open()) {
+    offline_render._error = "Could not open " + output_path;
+    return offline_render;
+  }
+
+  // Content that isn't ready has to hold the render up rather than play
+  // through as silence
+  const nfgrapher::LoadingPolicy loading_policy = _loading_policy;
+  _loading_policy = nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH;
+  const long duration_frames = duration * _samplerate;
+  std::vector<float> samples(_block_samples);
+  auto render_start = std::chrono::steady_clock::now();
+  auto last_render = render_start;
+  long rendered_frames = 0;
+  bool rendered = true;
+  while (duration_frames <= 0 || rendered_frames < duration_frames) {
+    run();
+    if (finished()) {
+      break;
+    }
+    long frames = render(samples.data(), _block_frames, true);
+    auto now = std::chrono::steady_clock::now();
+    if (frames == 0) {
+      // A decoder is still catching up, give it time before trying again
+      if (now - last_render > PlayerOfflineStallTimeout) {
+        offline_render._error = "Timed out waiting for content to render";
+        rendered = false;
+        break;
+      }
+      std::this_thread::sleep_for(PlayerOfflineWaitInterval);
+      continue;
+    }
+    last_render = now;
+    if (duration_frames > 0) {
+      frames = std::min(frames, duration_frames - rendered_frames);
+    }
+    if (!writer.write(samples.data(), frames)) {
+      offline_render._error = "Could not write to " + output_path;
+      rendered = false;
+      break;
+    }
+    rendered_frames += frames;
+  }
+  _loading_policy = loading_policy;
+  rendered = writer.close() && rendered;
+
+  offline_render._rendered = rendered;
+  offline_render._render_time = rendered_frames / _samplerate;
+  offline_render._elapsed_time =
+      std::chrono::duration_cast<std::chrono::duration<double>>(
+          std::chrono::steady_clock::now() - render_start)
+          .count();
+  if (offline_render._elapsed_time > 0.0) {
+    offline_render._realtime_factor =
+        offline_render._render_time / offline_render._elapsed_time;
+  }
+  return offline_render;
+}
+
+OfflineRender Player::renderOfflineParallel(
+    const std::string &output_path, double duration,
+    const OfflineRenderOptions &options) {
+  OfflineRender offline_render{false, "", 0.0, 0.0, 0.0, 0.0f};
+  if (duration <= 0.0) {
+    offline_render._error = "Rendering in parallel needs a duration";
+    return offline_render;
+  }
+  OfflineSegmentsContext context;
+  context._player = this;
+  {
+    std::lock_guard<std::mutex> lock(_graphs_mutex);
+    for (const auto &graph : _graphs) {
+      auto score_iterator = _graph_scores.find(graph.first);
+      if (score_iterator == _graph_scores.end()) {
+        offline_render._error =
+            "Graph " + graph.first + " was not loaded from a score";
+        return offline_render;
+      }
+      context._scores.push_back((*score_iterator).second);
+    }
+  }
+  if (context._scores.empty()) {
+    offline_render._error = "There are no graphs to render";
+    return offline_render;
+  }
+
+  const long frames = duration * _samplerate;
+  const long block_frames = _block_frames;
+  context._segments = planOfflineSegments(
+      frames, std::max(options._segments, 1), options._preroll * _samplerate,
+      options._crossfade * _samplerate, block_frames);
+  std::vector<float> output(frames * _channels);
+  context._output = output.data();
+  auto render_start = std::chrono::steady_clock::now();
+  bool rendered = renderOfflineSegments(context, context._segments.size());
+  if (rendered) {
+    for (size_t i = 1; i < context._segments.size(); ++i) {
+      const OfflineSegment &segment = context._segments[i];
+      crossfadeOfflineSegment(output.data() + segment._start_frame * _channels,
+                              context._fades[i].data(), segment._fade_frames,
+                              _channels);
+    }
+    WaveFileWriter writer(output_path, _channels, _samplerate);
+    rendered = writer.open() && writer.write(output.data(), frames);
+    rendered = writer.close() && rendered;
+    if (!rendered) {
+      offline_render._error = "Could not write to " + output_path;
+    }
+  }
+  offline_render._elapsed_time =
+      std::chrono::duration_cast<std::chrono::duration<double>>(
+          std::chrono::steady_clock::now() - render_start)
+          .count();
+  if (!rendered) {
+    for (const auto &error : context._errors) {
+      if (offline_render._error.empty()) {
+        offline_render._error = error;
+      }
+    }
+    return offline_render;
+  }
+
+  if (options._verify) {
+    // The reference is the same score rendered as one segment from the start
+    OfflineSegmentsContext serial_context;
+    serial_context._player = this;
+    serial_context._scores = context._scores;
+    serial_context._segments =
+        planOfflineSegments(frames, 1, 0, 0, block_frames);
+    std::vector<float> serial_output(output.size());
+    serial_context._output = serial_output.data();
+    if (!renderOfflineSegments(serial_context, 1)) {
+      offline_render._error = serial_context._errors.front();
+      return offline_render;
+    }
+    offline_render._maximum_deviation = maximumSampleDeviation(
+        output.data(), serial_output.data(), output.size());
+  }
+
+  offline_render._rendered = true;
+  offline_render._render_time = frames / _samplerate;
+  if (offline_render._elapsed_time > 0.0) {
+    offline_render._realtime_factor =
+        offline_render._render_time / offline_render._elapsed_time;
+  }
+  return offline_render;
+}
+
+void Player::driverDidStutter(void *clientdata) {
+  Player *player = (Player *)clientdata;
+  player->_health_monitor.didStutter(player->_render_time);
+}
 
 int Player::driverRender(void *clientdata, float *samples, int frame_count) {
-  int sample_count = frame_count * NF_DRIVER_CHANNELS;
   Player *player = (Player *)clientdata;
-  std::lock_guard<std::mutex> render_lock(player->_render_mutex);
-  size_t channels = NF_DRIVER_CHANNELS;
-  double sample_rate = static_cast<double>(NF_DRIVER_SAMPLERATE);
-  double render_time = player->_render_time;
+  player->_callback_frames = frame_count;
+  // Never wait on a seek from the control thread, just emit silence
+  return player->render(samples, frame_count, false);
+}
+
+int Player::render(float *samples, int frame_count, bool wait_for_lock) {
+  size_t sample_count = frame_count * _channels;
   std::fill_n(samples, sample_count, 0);
-  nfgrapher::LoadingPolicy loading_policy = player->_loading_policy;
+  std::unique_lock<std::mutex> render_lock(_render_mutex, std::defer_lock);
+  if (wait_for_lock) {
+    render_lock.lock();
+  } else if (!render_lock.try_lock()) {
+    return frame_count;
+  }
 
-  // Render the graphs
-  std::lock_guard<std::mutex> lock(player->_graphs_mutex);
-  for (const auto &graph : player->_graphs) {
-    for (auto &content_pair : player->_graph_content_maps[graph.first]) {
-      content_pair.second->erase();
+  // The graphs always render whole blocks, whatever the driver asks for
+  size_t rendered_samples = 0;
+  while (rendered_samples < sample_count) {
+    if (_block_offset == _block_rendered) {
+      _block_offset = 0;
+      _block_rendered = renderBlock(_block.data());
+      if (_block_rendered == 0) {
+        break;
+      }
     }
-    graph.second->traverse(player->_graph_content_maps[graph.first],
-                           loading_policy);
+    size_t copy_samples = std::min(sample_count - rendered_samples,
+                                   _block_rendered - _block_offset);
+    std::copy_n(_block.data() + _block_offset, copy_samples,
+                samples + rendered_samples);
+    _block_offset += copy_samples;
+    rendered_samples += copy_samples;
   }
+  return rendered_samples / _channels;
+}
 
-  // Mix them together
-  player->_final_content->setItems(sample_count);
-  std::fill_n(player->_final_content->payload(),
-              player->_final_content->payloadSize(), 0);
-  size_t maximum_samples = 0;
-  for (const auto &graph : player->_graphs) {
-    maximum_samples = std::max(
-        player->_final_content->mix(
-            *player->_graph_content_maps[graph.first][AudioContentTypeKey]),
-        maximum_samples);
+size_t Player::renderBlock(float *samples) {
+  RenderTimer render_timer(
+      _profiling.load(std::memory_order_relaxed) ? &_render_profile : nullptr,
+      static_cast<long>(_block_frames * 1.0e9 / _samplerate));
+  double render_time = _render_time;
+  nfgrapher::LoadingPolicy loading_policy = _loading_policy;
+
+  // Render the graphs, each into its own content so they can run in parallel
+  RenderSnapshot *snapshot = acquireRenderSnapshot();
+  RenderContext render_context{snapshot, loading_policy};
+  if (_render_thread_pool) {
+    _render_thread_pool->parallelFor(snapshot->_graphs.size(),
+                                     &Player::renderGraph, &render_context);
+  } else {
+    for (size_t i = 0; i < snapshot->_graphs.size(); ++i) {
+      renderGraph(&render_context, i);
+    }
   }
-  std::copy_n(player->_final_content->payload(), maximum_samples, samples);
+
+  // Mix them together
+  _final_content->setItems(_block_samples);
+  size_t maximum_samples = mixRenderGraphs(snapshot->_graphs, *_final_content);
+  releaseRenderSnapshot();
+  std::copy_n(_final_content->constPayload(), maximum_samples, samples);
   double maximum_time_step =
-      static_cast<double>(maximum_samples / channels) / sample_rate;
+      static_cast<double>(maximum_samples / _channels) / _samplerate;
 
   // Limit the signal so no clipping occurs
-  player->_limiter->limit(samples, samples, maximum_samples);
+  _limiter->limit(samples, samples, maximum_samples);
 
   // TODO: Delete this eventually, its just for my sanity while debugging
-  for (size_t i = 0; i < sample_count; ++i) {
+  for (size_t i = 0; i < maximum_samples; ++i) {
     samples[i] = std::max(std::min(1.0f, samples[i]), -1.0f);
   }
 
   // Calculate the next render time
-  player->_render_time = render_time + maximum_time_step;
+  _render_time = render_time + maximum_time_step;
+
+  return maximum_samples;
+}
+
+void Player::setProfiling(bool profiling) {
+  std::lock_guard<std::mutex> lock(_graphs_mutex);
+  if (profiling && !_profiling) {
+    _render_profile.reset();
+  }
+  _profiling = profiling;
+  for (const auto &graph : _graphs) {
+    graph.second->setProfiling(profiling);
+  }
+}
 
-  return maximum_samples / NF_DRIVER_CHANNELS;
+bool Player::profiling() const { return _profiling; }
+
+RenderStats Player::renderStats() const { return _render_profile.stats(); }
+
+void Player::setCrossfadeBlocks(int crossfade_blocks) {
+  std::lock_guard<std::mutex> lock(_graphs_mutex);
+  _crossfade_blocks = std::max(crossfade_blocks, 0);
+  for (const auto &graph : _graphs) {
+    if (auto graph_implementation =
+            std::dynamic_pointer_cast<GraphImplementation>(graph.second)) {
+      graph_implementation->setCrossfadeBlocks(_crossfade_blocks);
+    }
+  }
+}
+
+int Player::crossfadeBlocks() const { return _crossfade_blocks; }
+
+void Player::renderGraph(void *context, size_t index) {
+  RenderContext *render_context = static_cast<RenderContext *>(context);
+  RenderGraph &render_graph = render_context->_snapshot->_graphs[index];
+  for (auto &content_pair : render_graph._content) {
+    content_pair.second->erase();
+  }
+  render_graph._graph->traverse(render_graph._content,
+                                render_context->_loading_policy);
+}
+
+size_t Player::mixRenderGraphs(const std::vector<RenderGraph> &graphs,
+                               plugin::Content &final_content) {
+  std::fill_n(final_content.payload(), final_content.payloadSize(), 0);
+  size_t maximum_samples = 0;
+  for (const auto &render_graph : graphs) {
+    maximum_samples = std::max(
+        final_content.mix(*render_graph._content.at(AudioContentTypeKey)),
+        maximum_samples);
+  }
+  return maximum_samples;
+}
+
+void Player::renderOfflineSegment(void *context, size_t index) {
+  OfflineSegmentsContext *segments_context =
+      static_cast<OfflineSegmentsContext *>(context);
+  segments_context->_player->renderSegment(
+      segments_context->_scores, segments_context->_segments[index],
+      segments_context->_output, segments_context->_fades[index].data(),
+      segments_context->_errors[index]);
+}
+
+bool Player::renderOfflineSegments(OfflineSegmentsContext &context,
+                                   size_t threads) {
+  const size_t segment_count = context._segments.size();
+  context._fades.assign(segment_count, std::vector<float>());
+  context._errors.assign(segment_count, std::string());
+  for (size_t i = 0; i < segment_count; ++i) {
+    context._fades[i].resize(context._segments[i]._fade_frames * _channels);
+  }
+  threads = std::min(threads, static_cast<size_t>(std::max(
+                                  std::thread::hardware_concurrency(), 1u)));
+  RenderThreadPool thread_pool(std::max(threads, static_cast<size_t>(1)));
+  thread_pool.parallelFor(segment_count, &Player::renderOfflineSegment,
+                          &context);
+  for (const auto &error : context._errors) {
+    if (!error.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Player::renderSegment(const std::vector<std::string> &scores,
+                           const OfflineSegment &segment, float *output,
+                           float *fade, std::string &error) {
+  RenderSnapshot snapshot;
+  for (const auto &score : scores) {
+    std::shared_ptr<GraphImplementation> graph =
+        std::make_shared<GraphImplementation>(_channels, _samplerate,
+                                              createGraphSessionId());
+    graph->setBlockSize(_block_samples);
+    graph->setPluginRegistry(_plugin_registry);
+    std::shared_ptr<std::promise<Load>> load_promise =
+        std::make_shared<std::promise<Load>>();
+    graph->setJson(score, [load_promise](const Load &load) {
+      load_promise->set_value(load);
+    });
+    std::future<Load> load_future = load_promise->get_future();
+    if (load_future.wait_for(PlayerOfflineStallTimeout) !=
+        std::future_status::ready) {
+      error = "Timed out waiting for a segment to load";
+      return false;
+    }
+    const Load load = load_future.get();
+    if (!load._loaded) {
+      error = errorMessageFromLoad(load);
+      return false;
+    }
+    RenderGraph render_graph;
+    render_graph._identifier = graph->identifier();
+    render_graph._graph = graph;
+    render_graph._content[AudioContentTypeKey] =
+        std::make_shared<plugin::Content>(
+            _block_samples * _channels, 0, _samplerate, _channels,
+            _block_samples, plugin::ContentPayloadTypeBuffer);
+    snapshot._graphs.push_back(render_graph);
+  }
+  if (segment._render_frame > 0) {
+    // Half a frame in so rounding can't land the graphs on the frame before
+    const double render_time = (segment._render_frame + 0.5) / _samplerate;
+    for (const auto &render_graph : snapshot._graphs) {
+      render_graph._graph->setRenderTime(render_time);
+    }
+  }
+
+  RenderContext render_context{
+      &snapshot, nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH};
+  Limiter limiter(_channels, kDelay);
+  plugin::Content final_content(_block_samples, 0, _samplerate, _channels,
+                                _block_samples,
+                                plugin::ContentPayloadTypeBuffer);
+  std::vector<float> samples(_block_samples);
+  auto last_render = std::chrono::steady_clock::now();
+  long frame = segment._render_frame;
+  while (frame < segment._end_frame) {
+    bool graphs_finished = true;
+    for (size_t i = 0; i < snapshot._graphs.size(); ++i) {
+      snapshot._graphs[i]._graph->run();
+      graphs_finished = snapshot._graphs[i]._graph->finished() &&
+                        graphs_finished;
+      renderGraph(&render_context, i);
+    }
+    final_content.setItems(samples.size());
+    size_t sample_count = mixRenderGraphs(snapshot._graphs, final_content);
+    auto now = std::chrono::steady_clock::now();
+    if (sample_count == 0) {
+      if (graphs_finished) {
+        // Past the end of the score, keep going with silence
+        sample_count = samples.size();
+      } else if (now - last_render > PlayerOfflineStallTimeout) {
+        error = "Timed out waiting for content to render";
+        return false;
+      } else {
+        std::this_thread::sleep_for(PlayerOfflineWaitInterval);
+        continue;
+      }
+    }
+    last_render = now;
+    std::copy_n(final_content.payload(), sample_count, samples.data());
+    limiter.limit(samples.data(), samples.data(), sample_count);
+    for (size_t i = 0; i < sample_count; ++i) {
+      samples[i] = std::max(std::min(1.0f, samples[i]), -1.0f);
+    }
+
+    // Keep what lands in the segment, the pre-roll is thrown away
+    const long frames = sample_count / _channels;
+    for (long block_frame = 0; block_frame < frames; ++block_frame) {
+      const long output_frame = frame + block_frame;
+      if (output_frame < segment._start_frame ||
+          output_frame >= segment._end_frame) {
+        continue;
+      }
+      const long fade_frame = output_frame - segment._start_frame;
+      float *destination = fade_frame < segment._fade_frames
+                               ? fade + fade_frame * _channels
+                               : output + output_frame * _channels;
+      std::copy_n(samples.data() + block_frame * _channels, _channels,
+                  destination);
+    }
+    frame += frames;
+  }
+  return true;
 }
 
 void Player::driverDidError(void *clientdata, const char *domain, int error) {}
 
-void Player::driverWillRender(void *clientdata) {}
+void Player::driverWillRender(void *clientdata) {
+  Player *player = (Player *)clientdata;
+  player->_health_monitor.willRender();
+}
 
-void Player::driverDidRender(void *clientdata) {}
+void Player::driverDidRender(void *clientdata) {
+  Player *player = (Player *)clientdata;
+  player->_health_monitor.didRender(player->_callback_frames,
+                                    player->_samplerate, player->_render_time);
+}
 
 void Player::receivedNotification(const Notification &notification) {
   for (auto &script : _scripts) {
@@ -477,14 +965,53 @@ void Player::receivedNotification(const Notification &notification) {
 }
 
 void Player::recalculateRenderVariables() {
-  _graph_content_maps.clear();
+  // Called with _graphs_mutex held
+  RenderSnapshot *snapshot = new RenderSnapshot();
+  snapshot->_graphs.reserve(_graphs.size());
   for (const auto &graph : _graphs) {
-    const size_t payload_size = NF_DRIVER_SAMPLE_BLOCK_SIZE * _channels;
-    _graph_content_maps[graph.first][AudioContentTypeKey] =
-        std::make_shared<plugin::Content>(
-            payload_size, 0, _samplerate, _channels,
-            NF_DRIVER_SAMPLE_BLOCK_SIZE, plugin::ContentPayloadTypeBuffer);
+    const size_t payload_size = _block_samples * _channels;
+    RenderGraph render_graph;
+    render_graph._identifier = graph.first;
+    render_graph._graph = graph.second;
+    render_graph._content[AudioContentTypeKey] =
+        std::make_shared<plugin::Content>(payload_size, 0, _samplerate,
+                                          _channels, _block_samples,
+                                          plugin::ContentPayloadTypeBuffer);
+    snapshot->_graphs.push_back(render_graph);
   }
+  _retired_render_snapshots.push_back(_render_snapshot.exchange(snapshot));
+  reclaimRenderSnapshots();
+}
+
+Player::RenderSnapshot *Player::acquireRenderSnapshot() {
+  // Only the render thread (holding _render_mutex) acquires snapshots, so a
+  // single hazard slot is enough to keep the current one alive
+  RenderSnapshot *snapshot = _render_snapshot.load();
+  while (true) {
+    _render_snapshot_hazard.store(snapshot);
+    RenderSnapshot *current_snapshot = _render_snapshot.load();
+    if (current_snapshot == snapshot) {
+      return snapshot;
+    }
+    snapshot = current_snapshot;
+  }
+}
+
+void Player::releaseRenderSnapshot() { _render_snapshot_hazard.store(nullptr); }
+
+void Player::reclaimRenderSnapshots() {
+  // Called with _graphs_mutex held
+  RenderSnapshot *hazard = _render_snapshot_hazard.load();
+  auto it = std::remove_if(
+      _retired_render_snapshots.begin(), _retired_render_snapshots.end(),
+      [hazard](RenderSnapshot *snapshot) {
+        if (snapshot == hazard) {
+          return false;
+        }
+        delete snapshot;
+        return true;
+      });
+  _retired_render_snapshots.erase(it, _retired_render_snapshots.end());
 }
 
 static_assert(DriverTypeFile == driver::OutputTypeFile,
@@ -41,6 +41,10 @@
 #include <boost/thread.hpp>
 
 #include "GraphDelegate.h"
+#include "HealthMonitor.h"
+#include "OfflineSegments.h"
+#include "RenderProfile.h"
+#include "RenderThreadPool.h"
 #include "ScriptDelegate.h"
 #include "ScriptImplementation.h"
 
@@ -68,7 +72,9 @@ class Player : public std::enable_shared_from_this<Player>,
   Player(std::shared_ptr<plugin::Registry> plugin_registry,
          NF_SMART_PLAYER_ERROR_CALLBACK error_callback,
          int localhost_write_port, DriverType driver_type,
-         std::string output_destination, boost::asio::io_service &io_service);
+         std::string output_destination, boost::asio::io_service &io_service,
+         int render_threads = 1, double samplerate = NFSmartPlayerSampleRate,
+         int block_frames = NFSmartPlayerBlockSize);
   virtual ~Player();
 
   // ScriptDelegate
@@ -88,6 +94,8 @@ class Player : public std::enable_shared_from_this<Player>,
                         const void *payload) override;
 
   std::shared_ptr<plugin::Registry> pluginRegistry() const;
+  double sampleRate() const;
+  size_t blockFrames() const;
   bool isPlaying() const;
   void setPlaying(bool playing) override;
   bool canPlayThrough() const;
@@ -119,6 +127,15 @@ class Player : public std::enable_shared_from_this<Player>,
   nfgrapher::LoadingPolicy loadingPolicy() const;
   bool finished();
   bool isLoaded();
+  OfflineRender renderOffline(const std::string &output_path, double duration);
+  OfflineRender renderOfflineParallel(const std::string &output_path,
+                                      double duration,
+                                      const OfflineRenderOptions &options);
+  void setProfiling(bool profiling);
+  bool profiling() const;
+  RenderStats renderStats() const;
+  void setCrossfadeBlocks(int crossfade_blocks);
+  int crossfadeBlocks() const;
 
  private:
   static void driverDidStutter(void *clientdata);
@@ -126,11 +143,54 @@ class Player : public std::enable_shared_from_this<Player>,
   static void driverDidError(void *clientdata, const char *domain, int error);
   static void driverWillRender(void *clientdata);
   static void driverDidRender(void *clientdata);
+  int render(float *samples, int frame_count, bool wait_for_lock);
+  size_t renderBlock(float *samples);
   void receivedNotification(const Notification &notification);
   void recalculateRenderVariables();
 
+  // Render snapshots are immutable views of the graphs (and the content
+  // buffers they render into) that the driver thread reads without taking
+  // _graphs_mutex. They are published under _graphs_mutex and reclaimed on the
+  // control threads once the render thread no longer holds them.
+  struct RenderGraph {
+    std::string _identifier;
+    std::shared_ptr<Graph> _graph;
+    std::map<std::string, std::shared_ptr<plugin::Content>> _content;
+  };
+  struct RenderSnapshot {
+    std::vector<RenderGraph> _graphs;
+  };
+  struct RenderContext {
+    RenderSnapshot *_snapshot;
+    nfgrapher::LoadingPolicy _loading_policy;
+  };
+  // Offline segments render on fresh graphs loaded from the same scores, so
+  // they share no DSP state with each other or with the driver's graphs
+  struct OfflineSegmentsContext {
+    Player *_player;
+    std::vector<std::string> _scores;
+    std::vector<OfflineSegment> _segments;
+    float *_output;
+    std::vector<std::vector<float>> _fades;
+    std::vector<std::string> _errors;
+  };
+  static void renderGraph(void *context, size_t index);
+  static size_t mixRenderGraphs(const std::vector<RenderGraph> &graphs,
+                                plugin::Content &final_content);
+  static void renderOfflineSegment(void *context, size_t index);
+  bool renderOfflineSegments(OfflineSegmentsContext &context,
+                             size_t threads);
+  bool renderSegment(const std::vector<std::string> &scores,
+                     const OfflineSegment &segment, float *output, float *fade,
+                     std::string &error);
+  RenderSnapshot *acquireRenderSnapshot();
+  void releaseRenderSnapshot();
+  void reclaimRenderSnapshots();
+
   const int _channels;
   const double _samplerate;
+  const size_t _block_frames;
+  const size_t _block_samples;
   std::shared_ptr<plugin::Registry> _plugin_registry;
   NF_SMART_PLAYER_ERROR_CALLBACK _error_callback;
   boost::asio::io_service &_io_service;
@@ -143,17 +203,29 @@ class Player : public std::enable_shared_from_this<Player>,
   std::shared_ptr<Limiter> _limiter;
   std::shared_ptr<NFOSCHandler> _osc_handler;
   std::map<std::string, std::shared_ptr<Graph>> _graphs;
+  std::map<std::string, std::string> _graph_scores;
   std::mutex _graphs_mutex;
   std::mutex _render_mutex;
   NF_SMART_PLAYER_MESSAGE_CALLBACK _message_callback;
   std::map<std::string, std::shared_ptr<ScriptImplementation>> _scripts;
   std::atomic<nfgrapher::LoadingPolicy> _loading_policy;
   bool _finished;
+  std::atomic<bool> _profiling;
+  RenderProfile _render_profile;
+  std::atomic<int> _crossfade_blocks;
+  HealthMonitor _health_monitor;
+  int _callback_frames;  // Only touched by the driver callbacks
 
   // Render variables
-  std::map<std::string, std::map<std::string, std::shared_ptr<plugin::Content>>>
-      _graph_content_maps;
+  std::atomic<RenderSnapshot *> _render_snapshot;
+  std::atomic<RenderSnapshot *> _render_snapshot_hazard;
+  std::vector<RenderSnapshot *> _retired_render_snapshots;
   std::shared_ptr<plugin::Content> _final_content;
+  std::shared_ptr<RenderThreadPool> _render_thread_pool;
+  // The last block rendered, handed out in whatever sizes the driver asks for
+  std::vector<float> _block;
+  size_t _block_offset;
+  size_t _block_rendered;
 };
 
 }  // namespace smartplayer
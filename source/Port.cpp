@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <NFSmartPlayer/Port.h>
+
+#include <mutex>
+#include <vector>
+
+namespace nativeformat {
+namespace plugin {
+
+const PortId AudioPortId = 0;
+const PortId SidechainPortId = 1;
+
+static const char *PortAudioName = "audio";
+static const char *PortSidechainName = "sidechain";
+
+static std::mutex &PortsMutex() {
+  static std::mutex ports_mutex;
+  return ports_mutex;
+}
+
+static std::vector<std::string> &PortNames() {
+  static std::vector<std::string> port_names = {PortAudioName,
+                                                PortSidechainName};
+  return port_names;
+}
+
+PortId internPort(const std::string &name) {
+  // The ports every built in plugin uses don't need the lock
+  if (name == PortAudioName) {
+    return AudioPortId;
+  }
+  if (name == PortSidechainName) {
+    return SidechainPortId;
+  }
+  std::lock_guard<std::mutex> lock(PortsMutex());
+  auto &port_names = PortNames();
+  for (size_t i = 0; i < port_names.size(); ++i) {
+    if (port_names[i] == name) {
+      return static_cast<PortId>(i);
+    }
+  }
+  port_names.push_back(name);
+  return static_cast<PortId>(port_names.size() - 1);
+}
+
+std::string portName(PortId port) {
+  if (port == AudioPortId) {
+    return PortAudioName;
+  }
+  if (port == SidechainPortId) {
+    return PortSidechainName;
+  }
+  std::lock_guard<std::mutex> lock(PortsMutex());
+  const auto &port_names = PortNames();
+  return port < port_names.size() ? port_names[port] : std::string();
+}
+
+}  // namespace plugin
+}  // namespace nativeformat
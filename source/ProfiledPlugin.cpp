@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "ProfiledPlugin.h"
+
+namespace nativeformat {
+namespace plugin {
+
+ProfiledPlugin::ProfiledPlugin(
+    const std::shared_ptr<Plugin> &plugin,
+    const std::shared_ptr<smartplayer::RenderProfile> &render_profile,
+    const std::shared_ptr<const smartplayer::RenderProfiling> &profiling,
+    const std::shared_ptr<PlanInputPlugin> &input)
+    : _plugin(plugin),
+      _render_profile(render_profile),
+      _profiling(profiling),
+      _input(input) {}
+
+ProfiledPlugin::~ProfiledPlugin() {}
+
+std::shared_ptr<Plugin> ProfiledPlugin::plugin() const { return _plugin; }
+
+smartplayer::RenderProfile *ProfiledPlugin::activeProfile() const {
+  // All it costs while profiling is off is this load
+  return _profiling->load(std::memory_order_relaxed) ? _render_profile.get()
+                                                     : nullptr;
+}
+
+void ProfiledPlugin::feed(
+    std::map<std::string, std::shared_ptr<Content>> &content,
+    long sample_index, long graph_sample_index,
+    nfgrapher::LoadingPolicy loading_policy) {
+  smartplayer::RenderProfile *render_profile = activeProfile();
+  smartplayer::RenderTimer render_timer(
+      render_profile,
+      render_profile ? smartplayer::RenderProfile::deadlineNanos(content) : 0);
+  const bool time_input = render_profile && _input;
+  if (time_input) {
+    _input->startTimingFeeds();
+  }
+  _plugin->feed(content, sample_index, graph_sample_index, loading_policy);
+  if (time_input) {
+    render_timer.exclude(_input->stopTimingFeeds());
+  }
+}
+
+void ProfiledPlugin::feedPorts(PortContent &content, long sample_index,
+                               long graph_sample_index,
+                               nfgrapher::LoadingPolicy loading_policy) {
+  smartplayer::RenderProfile *render_profile = activeProfile();
+  const Content *audio_content =
+      render_profile ? content.find(AudioPortId) : nullptr;
+  smartplayer::RenderTimer render_timer(
+      render_profile,
+      audio_content ? smartplayer::RenderProfile::deadlineNanos(*audio_content)
+                    : 0);
+  const bool time_input = render_profile && _input;
+  if (time_input) {
+    _input->startTimingFeeds();
+  }
+  _plugin->feedPorts(content, sample_index, graph_sample_index,
+                     loading_policy);
+  if (time_input) {
+    render_timer.exclude(_input->stopTimingFeeds());
+  }
+}
+
+bool ProfiledPlugin::feedsPorts() const { return _plugin->feedsPorts(); }
+
+void ProfiledPlugin::load(LOAD_CALLBACK callback) { _plugin->load(callback); }
+
+bool ProfiledPlugin::loaded() const { return _plugin->loaded(); }
+
+void ProfiledPlugin::potentialTimeChange(long sample_index,
+                                         long graph_sample_index) {
+  _plugin->potentialTimeChange(sample_index, graph_sample_index);
+}
+
+void ProfiledPlugin::majorTimeChange(long sample_index,
+                                     long graph_sample_index) {
+  _plugin->majorTimeChange(sample_index, graph_sample_index);
+}
+
+std::string ProfiledPlugin::name() { return _plugin->name(); }
+
+void ProfiledPlugin::run(long sample_index, const NodeTimes &node_times,
+                         long node_sample_index) {
+  _plugin->run(sample_index, node_times, node_sample_index);
+}
+
+std::vector<std::string> ProfiledPlugin::paramNames() {
+  return _plugin->paramNames();
+}
+
+std::shared_ptr<param::Param> ProfiledPlugin::paramForName(
+    const std::string &name) {
+  return _plugin->paramForName(name);
+}
+
+bool ProfiledPlugin::shouldProcessChildren(long sample_index,
+                                           long sample_index_end,
+                                           const NodeTimes &node_times) {
+  return _plugin->shouldProcessChildren(sample_index, sample_index_end,
+                                        node_times);
+}
+
+long ProfiledPlugin::timeDilation(long sample_index) {
+  return _plugin->timeDilation(sample_index);
+}
+
+bool ProfiledPlugin::timeAligned() const { return _plugin->timeAligned(); }
+
+bool ProfiledPlugin::finished(long sample_index, long sample_index_end) {
+  return _plugin->finished(sample_index, sample_index_end);
+}
+
+void ProfiledPlugin::notifyFinished(long sample_index,
+                                    long graph_sample_index) {
+  _plugin->notifyFinished(sample_index, graph_sample_index);
+}
+
+Plugin::PluginType ProfiledPlugin::type() const { return _plugin->type(); }
+
+long ProfiledPlugin::localRenderSampleIndex(long sample_index) {
+  return _plugin->localRenderSampleIndex(sample_index);
+}
+
+long ProfiledPlugin::startSampleIndex() { return _plugin->startSampleIndex(); }
+
+bool ProfiledPlugin::shouldProcess(long sample_index_start,
+                                   long sample_index_end) {
+  return _plugin->shouldProcess(sample_index_start, sample_index_end);
+}
+
+}  // namespace plugin
+}  // namespace nativeformat
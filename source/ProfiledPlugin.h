@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/Plugin.h>
+
+#include <memory>
+
+#include "ExecutionPlan.h"
+#include "RenderProfile.h"
+
+namespace nativeformat {
+namespace plugin {
+
+/**
+ * Wraps the plugin of a node to time how long it takes to feed, while the
+ * graph has profiling switched on. The time spent feeding from its input is
+ * left out, so a node's time is its own work alone whether its inputs are
+ * rendered by the plan or from within its feed.
+ */
+class ProfiledPlugin : public Plugin {
+ public:
+  ProfiledPlugin(
+      const std::shared_ptr<Plugin> &plugin,
+      const std::shared_ptr<smartplayer::RenderProfile> &render_profile,
+      const std::shared_ptr<const smartplayer::RenderProfiling> &profiling,
+      const std::shared_ptr<PlanInputPlugin> &input = nullptr);
+  virtual ~ProfiledPlugin();
+
+  std::shared_ptr<Plugin> plugin() const;
+
+  // Plugin
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
+  bool feedsPorts() const override;
+  void load(LOAD_CALLBACK callback) override;
+  bool loaded() const override;
+  void potentialTimeChange(long sample_index, long graph_sample_index) override;
+  void majorTimeChange(long sample_index, long graph_sample_index) override;
+  std::string name() override;
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override;
+  std::vector<std::string> paramNames() override;
+  std::shared_ptr<param::Param> paramForName(const std::string &name) override;
+  bool shouldProcessChildren(long sample_index, long sample_index_end,
+                             const NodeTimes &node_times) override;
+  long timeDilation(long sample_index) override;
+  bool timeAligned() const override;
+  bool finished(long sample_index, long sample_index_end) override;
+  void notifyFinished(long sample_index, long graph_sample_index) override;
+  PluginType type() const override;
+  long localRenderSampleIndex(long sample_index) override;
+  long startSampleIndex() override;
+  bool shouldProcess(long sample_index_start, long sample_index_end) override;
+
+ private:
+  smartplayer::RenderProfile *activeProfile() const;
+
+  const std::shared_ptr<Plugin> _plugin;
+  const std::shared_ptr<smartplayer::RenderProfile> _render_profile;
+  const std::shared_ptr<const smartplayer::RenderProfiling> _profiling;
+  // What the plugin feeds its inputs from, if the graph created it with one
+  const std::shared_ptr<PlanInputPlugin> _input;
+};
+
+}  // namespace plugin
+}  // namespace nativeformat
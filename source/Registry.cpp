@@ -20,6 +20,8 @@
  */
 #include <NFSmartPlayer/Registry.h>
 
+#include <algorithm>
+
 namespace nativeformat {
 namespace plugin {
 
@@ -68,6 +70,26 @@ std::shared_ptr<Plugin> Registry::createPlugin(
   return nullptr;
 }
 
+int Registry::channels(const nfgrapher::Node &grapher_node,
+                       int input_channels, int channels) const {
+  auto factory_it = _plugin_factories.find(grapher_node.kind);
+  if (factory_it == _plugin_factories.end()) {
+    return channels;
+  }
+  int plugin_channels =
+      factory_it->second->channels(grapher_node, input_channels, channels);
+  return std::min(std::max(plugin_channels, 1), channels);
+}
+
+bool Registry::timeAligned(const nfgrapher::Node &grapher_node) const {
+  // Nodes without a plugin don't feed their inputs at all
+  auto factory_it = _plugin_factories.find(grapher_node.kind);
+  if (factory_it == _plugin_factories.end()) {
+    return true;
+  }
+  return factory_it->second->timeAligned(grapher_node);
+}
+
 bool Registry::containsPluginIdentifier(
     const std::string &plugin_identifier) const {
   return _plugin_factories.find(plugin_identifier) != _plugin_factories.end();
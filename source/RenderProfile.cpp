@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RenderProfile.h"
+
+#include <algorithm>
+
+namespace nativeformat {
+namespace smartplayer {
+
+static const double RenderProfilePercentile = 0.99;
+
+RenderProfile::RenderProfile() { reset(); }
+
+RenderProfile::~RenderProfile() {}
+
+void RenderProfile::record(long nanos, long deadline_nanos) {
+  nanos = std::max(nanos, 0l);
+  _nanos.fetch_add(nanos, std::memory_order_relaxed);
+  _deadline_nanos.fetch_add(deadline_nanos, std::memory_order_relaxed);
+  _histogram[bucket(nanos)].fetch_add(1, std::memory_order_relaxed);
+  long max_nanos = _max_nanos.load(std::memory_order_relaxed);
+  while (nanos > max_nanos &&
+         !_max_nanos.compare_exchange_weak(max_nanos, nanos,
+                                           std::memory_order_relaxed)) {
+  }
+}
+
+RenderStats RenderProfile::stats() const {
+  RenderStats stats = {0, 0.0, 0.0, 0.0, 0.0};
+  long blocks = 0;
+  for (const auto &count : _histogram) {
+    blocks += count.load(std::memory_order_relaxed);
+  }
+  if (blocks == 0) {
+    return stats;
+  }
+  const long nanos = _nanos.load(std::memory_order_relaxed);
+  const long deadline_nanos = _deadline_nanos.load(std::memory_order_relaxed);
+  const long max_nanos = _max_nanos.load(std::memory_order_relaxed);
+
+  // The upper edge of the bucket the percentile falls in, which the slowest
+  // block can tighten
+  const long percentile_blocks =
+      static_cast<long>(blocks * RenderProfilePercentile + 0.5);
+  long counted_blocks = 0;
+  long percentile_nanos = max_nanos;
+  for (size_t i = 0; i < Buckets; ++i) {
+    counted_blocks += _histogram[i].load(std::memory_order_relaxed);
+    if (counted_blocks >= percentile_blocks) {
+      percentile_nanos = std::min(bucketNanos(i), max_nanos);
+      break;
+    }
+  }
+
+  stats._blocks = blocks;
+  stats._mean_time = (nanos * 1.0e-9) / blocks;
+  stats._p99_time = percentile_nanos * 1.0e-9;
+  stats._max_time = max_nanos * 1.0e-9;
+  stats._load = deadline_nanos > 0 ? (100.0 * nanos) / deadline_nanos : 0.0;
+  return stats;
+}
+
+void RenderProfile::reset() {
+  _nanos = 0;
+  _deadline_nanos = 0;
+  _max_nanos = 0;
+  for (auto &count : _histogram) {
+    count = 0;
+  }
+}
+
+long RenderProfile::deadlineNanos(const plugin::Content &content) {
+  if (content.channels() == 0 || content.sampleRate() <= 0.0) {
+    return 0;
+  }
+  return static_cast<long>((content.requiredItems() / content.channels()) *
+                           1.0e9 / content.sampleRate());
+}
+
+long RenderProfile::deadlineNanos(
+    const std::map<std::string, std::shared_ptr<plugin::Content>> &content) {
+  auto audio_it = content.find(AudioContentTypeKey);
+  return audio_it == content.end() ? 0 : deadlineNanos(*audio_it->second);
+}
+
+size_t RenderProfile::bucket(long nanos) {
+  if (nanos < 4) {
+    return nanos;
+  }
+  size_t octave = 0;
+  for (unsigned long value = nanos; value > 1; value >>= 1) {
+    ++octave;
+  }
+  const size_t quarter = (nanos >> (octave - 2)) & 3;
+  return std::min(octave * 4 + quarter, Buckets - 1);
+}
+
+long RenderProfile::bucketNanos(size_t bucket) {
+  if (bucket < 4) {
+    return bucket;
+  }
+  const size_t octave = bucket / 4;
+  const size_t quarter = bucket % 4;
+  return ((5l + quarter) << (octave - 2)) - 1;
+}
+
+}  // namespace smartplayer
+}  // namespace nativeformat
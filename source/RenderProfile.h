@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/Plugin.h>
+#include <NFSmartPlayer/RenderStats.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace nativeformat {
+namespace smartplayer {
+
+/**
+ * Switches profiling on and off for everything sharing it, so a graph can
+ * enable all of its nodes at once.
+ */
+typedef std::atomic<bool> RenderProfiling;
+
+/**
+ * Accumulates how long blocks take to render. Recording is lock free and
+ * doesn't allocate so it can happen on the render threads, while stats can be
+ * read from any thread. Block times land in a histogram with four buckets per
+ * octave (up to days), which is what the 99th percentile is estimated from.
+ */
+class RenderProfile {
+ public:
+  static const size_t Buckets = 4 * 48;
+
+  RenderProfile();
+  virtual ~RenderProfile();
+
+  void record(long nanos, long deadline_nanos);
+  RenderStats stats() const;
+  void reset();
+
+  /**
+   * The time the blocks in content have to be rendered within
+   */
+  static long deadlineNanos(const plugin::Content &content);
+  static long deadlineNanos(
+      const std::map<std::string, std::shared_ptr<plugin::Content>> &content);
+
+ private:
+  static size_t bucket(long nanos);
+  static long bucketNanos(size_t bucket);
+
+  std::atomic<long> _nanos;
+  std::atomic<long> _deadline_nanos;
+  std::atomic<long> _max_nanos;
+  std::array<std::atomic<long>, Buckets> _histogram;
+};
+
+/**
+ * Records the time from its construction to its destruction, less any time
+ * excluded, if it was handed a profile
+ */
+class RenderTimer {
+ public:
+  RenderTimer(RenderProfile *profile, long deadline_nanos)
+      : _profile(profile), _deadline_nanos(deadline_nanos), _excluded_nanos(0) {
+    if (_profile) {
+      _start = std::chrono::steady_clock::now();
+    }
+  }
+  ~RenderTimer() {
+    if (_profile) {
+      const long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - _start)
+                             .count();
+      _profile->record(nanos - _excluded_nanos, _deadline_nanos);
+    }
+  }
+
+  // Leaves time spent on something else out, such as rendering inputs
+  void exclude(long nanos) { _excluded_nanos += nanos; }
+
+ private:
+  RenderProfile *const _profile;
+  const long _deadline_nanos;
+  long _excluded_nanos;
+  std::chrono::steady_clock::time_point _start;
+};
+
+}  // namespace smartplayer
+}  // namespace nativeformat
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "RenderThreadPool.h"
+
+namespace nativeformat {
+namespace smartplayer {
+
+const double RenderThreadPoolMinimumParallelNanos = 100000.0;
+
+// How many times a parked worker polls for new work before sleeping
+static const int RenderThreadPoolSpinCount = 1000;
+
+RenderThreadPool::RenderThreadPool(size_t threads)
+    : _stop(false),
+      _busy(false),
+      _generation(0),
+      _next_index(0),
+      _completed(0),
+      _count(0),
+      _task(nullptr),
+      _context(nullptr) {
+  for (size_t i = 1; i < threads; ++i) {
+    _workers.emplace_back(&RenderThreadPool::work, this);
+  }
+}
+
+RenderThreadPool::~RenderThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _condition.notify_all();
+  for (auto &worker : _workers) {
+    worker.join();
+  }
+}
+
+size_t RenderThreadPool::threads() const { return _workers.size() + 1; }
+
+void RenderThreadPool::parallelFor(size_t count, RENDER_TASK task,
+                                   void *context) {
+  if (_workers.empty() || count < 2 || _busy.exchange(true)) {
+    for (size_t i = 0; i < count; ++i) {
+      task(context, i);
+    }
+    return;
+  }
+
+  uint32_t generation;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    generation = _generation + 1;
+    _count = count;
+    _task = task;
+    _context = context;
+    _completed = 0;
+    _next_index = static_cast<uint64_t>(generation) << 32;
+    _generation = generation;
+  }
+  _condition.notify_all();
+
+  while (runIndex(generation, count, task, context)) {
+  }
+  while (_completed.load() < count) {
+    std::this_thread::yield();
+  }
+  _busy = false;
+}
+
+void RenderThreadPool::work() {
+  uint32_t seen_generation = 0;
+  while (true) {
+    // Poll briefly so back to back blocks don't pay for a wake up
+    for (int i = 0;
+         i < RenderThreadPoolSpinCount && _generation.load() == seen_generation;
+         ++i) {
+      std::this_thread::yield();
+    }
+    size_t count;
+    RENDER_TASK task;
+    void *context;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _condition.wait(lock, [this, seen_generation] {
+        return _stop || _generation.load() != seen_generation;
+      });
+      if (_stop) {
+        return;
+      }
+      seen_generation = _generation;
+      count = _count;
+      task = _task;
+      context = _context;
+    }
+    while (runIndex(seen_generation, count, task, context)) {
+    }
+  }
+}
+
+bool RenderThreadPool::runIndex(uint32_t generation, size_t count,
+                                RENDER_TASK task, void *context) {
+  uint64_t next_index = _next_index.load();
+  while (true) {
+    if (static_cast<uint32_t>(next_index >> 32) != generation) {
+      return false;
+    }
+    size_t index = static_cast<size_t>(next_index & 0xFFFFFFFF);
+    if (index >= count) {
+      return false;
+    }
+    if (_next_index.compare_exchange_weak(next_index, next_index + 1)) {
+      task(context, index);
+      _completed++;
+      return true;
+    }
+  }
+}
+
+}  // namespace smartplayer
+}  // namespace nativeformat
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nativeformat {
+namespace smartplayer {
+
+// Below this much work per block the cost of waking the render threads
+// outweighs what running in parallel saves
+extern const double RenderThreadPoolMinimumParallelNanos;
+
+/**
+ * A fixed pool of worker threads used to split up the work of a render
+ * callback. Dispatching a task does not allocate, and the calling thread takes
+ * part in the work so a pool of N threads only spawns N - 1 workers.
+ */
+class RenderThreadPool {
+ public:
+  typedef void (*RENDER_TASK)(void *context, size_t index);
+
+  /**
+   * Constructor
+   * @param threads The total number of threads to render with, including the
+   * thread calling parallelFor
+   */
+  explicit RenderThreadPool(size_t threads);
+  /**
+   * Destructor
+   */
+  virtual ~RenderThreadPool();
+
+  /**
+   * The total number of threads rendering, including the caller
+   */
+  size_t threads() const;
+  /**
+   * Runs the task for every index in [0, count) and returns once they have
+   * all completed. If the pool is already busy (for example when called from
+   * within another task) the indices are run serially on the calling thread.
+   * @param count The number of indices to run
+   * @param task The function to call for each index
+   * @param context The context to hand to the task
+   */
+  void parallelFor(size_t count, RENDER_TASK task, void *context);
+
+ private:
+  void work();
+  bool runIndex(uint32_t generation, size_t count, RENDER_TASK task,
+                void *context);
+
+  std::vector<std::thread> _workers;
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  bool _stop;
+  std::atomic<bool> _busy;
+  std::atomic<uint32_t> _generation;
+  // The upper 32 bits hold the generation, the lower 32 the next index
+  std::atomic<uint64_t> _next_index;
+  std::atomic<size_t> _completed;
+  size_t _count;
+  RENDER_TASK _task;
+  void *_context;
+};
+
+}  // namespace smartplayer
+}  // namespace nativeformat
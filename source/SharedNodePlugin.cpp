@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "SharedNodePlugin.h"
+
+namespace nativeformat {
+namespace plugin {
+
+SharedNodePlugin::SharedNodePlugin(
+    const std::shared_ptr<Plugin> &plugin,
+    const std::shared_ptr<const RenderPass> &render_pass)
+    : _plugin(plugin),
+      _render_pass(render_pass),
+      _cached_sample_index(0),
+      _cached_render_pass(-1),
+      _cached_loading_policy(nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH),
+      _loading(false),
+      _load_finished(false),
+      _load(false) {}
+
+SharedNodePlugin::~SharedNodePlugin() {}
+
+std::shared_ptr<Plugin> SharedNodePlugin::plugin() const { return _plugin; }
+
+void SharedNodePlugin::feed(
+    std::map<std::string, std::shared_ptr<Content>> &content,
+    long sample_index, long graph_sample_index,
+    nfgrapher::LoadingPolicy loading_policy) {
+  std::lock_guard<std::mutex> lock(_feed_mutex);
+  const long render_pass = *_render_pass;
+  if (cached(content, sample_index, render_pass, loading_policy)) {
+    for (auto &content_pair : content) {
+      *content_pair.second = *_cached_content[content_pair.first];
+    }
+    return;
+  }
+
+  _plugin->feed(content, sample_index, graph_sample_index, loading_policy);
+
+  // Keep a copy of everything the plugin rendered for the other consumers
+  for (const auto &content_pair : content) {
+    auto &cached_content = _cached_content[content_pair.first];
+    if (!cached_content) {
+      cached_content = std::make_shared<Content>();
+    }
+    *cached_content = *content_pair.second;
+  }
+  _cached_sample_index = sample_index;
+  _cached_render_pass = render_pass;
+  _cached_loading_policy = loading_policy;
+}
+
+bool SharedNodePlugin::cached(
+    const std::map<std::string, std::shared_ptr<Content>> &content,
+    long sample_index, long render_pass,
+    nfgrapher::LoadingPolicy loading_policy) const {
+  if (_cached_render_pass != render_pass ||
+      _cached_sample_index != sample_index ||
+      _cached_loading_policy != loading_policy) {
+    return false;
+  }
+  for (const auto &content_pair : content) {
+    auto cached_it = _cached_content.find(content_pair.first);
+    if (cached_it == _cached_content.end() ||
+        cached_it->second->requiredItems() !=
+            content_pair.second->requiredItems() ||
+        cached_it->second->channels() != content_pair.second->channels() ||
+        cached_it->second->type() != content_pair.second->type()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SharedNodePlugin::load(LOAD_CALLBACK callback) {
+  bool load_finished = false;
+  bool start_loading = false;
+  Load load(false);
+  {
+    std::lock_guard<std::mutex> lock(_load_mutex);
+    if (_load_finished) {
+      load_finished = true;
+      load = _load;
+    } else {
+      _load_callbacks.push_back(callback);
+      start_loading = !_loading;
+      _loading = true;
+    }
+  }
+  if (load_finished) {
+    callback(load);
+    return;
+  }
+  if (!start_loading) {
+    return;
+  }
+  auto strong_this = shared_from_this();
+  _plugin->load([strong_this](Load load) {
+    std::vector<LOAD_CALLBACK> callbacks;
+    {
+      std::lock_guard<std::mutex> lock(strong_this->_load_mutex);
+      // Only a load that worked is kept, so a score reloaded around this node
+      // tries a failed one again rather than inheriting the failure
+      strong_this->_load = load;
+      strong_this->_load_finished = load._loaded;
+      strong_this->_loading = false;
+      callbacks.swap(strong_this->_load_callbacks);
+    }
+    for (const auto &callback : callbacks) {
+      callback(load);
+    }
+  });
+}
+
+bool SharedNodePlugin::loaded() const { return _plugin->loaded(); }
+
+void SharedNodePlugin::potentialTimeChange(long sample_index,
+                                           long graph_sample_index) {
+  _plugin->potentialTimeChange(sample_index, graph_sample_index);
+}
+
+void SharedNodePlugin::majorTimeChange(long sample_index,
+                                       long graph_sample_index) {
+  {
+    std::lock_guard<std::mutex> lock(_feed_mutex);
+    _cached_render_pass = -1;
+  }
+  _plugin->majorTimeChange(sample_index, graph_sample_index);
+}
+
+std::string SharedNodePlugin::name() { return _plugin->name(); }
+
+void SharedNodePlugin::run(long sample_index, const NodeTimes &node_times,
+                           long node_sample_index) {
+  _plugin->run(sample_index, node_times, node_sample_index);
+}
+
+std::vector<std::string> SharedNodePlugin::paramNames() {
+  return _plugin->paramNames();
+}
+
+std::shared_ptr<param::Param> SharedNodePlugin::paramForName(
+    const std::string &name) {
+  return _plugin->paramForName(name);
+}
+
+bool SharedNodePlugin::shouldProcessChildren(long sample_index,
+                                             long sample_index_end,
+                                             const NodeTimes &node_times) {
+  return _plugin->shouldProcessChildren(sample_index, sample_index_end,
+                                        node_times);
+}
+
+long SharedNodePlugin::timeDilation(long sample_index) {
+  return _plugin->timeDilation(sample_index);
+}
+
+bool SharedNodePlugin::timeAligned() const { return _plugin->timeAligned(); }
+
+bool SharedNodePlugin::finished(long sample_index, long sample_index_end) {
+  return _plugin->finished(sample_index, sample_index_end);
+}
+
+void SharedNodePlugin::notifyFinished(long sample_index,
+                                      long graph_sample_index) {
+  _plugin->notifyFinished(sample_index, graph_sample_index);
+}
+
+Plugin::PluginType SharedNodePlugin::type() const { return _plugin->type(); }
+
+long SharedNodePlugin::localRenderSampleIndex(long sample_index) {
+  return _plugin->localRenderSampleIndex(sample_index);
+}
+
+long SharedNodePlugin::startSampleIndex() {
+  return _plugin->startSampleIndex();
+}
+
+bool SharedNodePlugin::shouldProcess(long sample_index_start,
+                                     long sample_index_end) {
+  return _plugin->shouldProcess(sample_index_start, sample_index_end);
+}
+
+}  // namespace plugin
+}  // namespace nativeformat
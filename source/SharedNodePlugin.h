@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2016 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/Plugin.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace nativeformat {
+namespace plugin {
+
+/**
+ * Counts the blocks a graph has rendered so that shared nodes can tell a block
+ * they cached during this render from one cached during an earlier one.
+ */
+typedef std::atomic<long> RenderPass;
+
+/**
+ * Wraps the plugin of a node that feeds several consumers, so the node is only
+ * instantiated and rendered once. The first consumer to feed it in a render
+ * pass renders the block, later consumers asking for the same sample index are
+ * handed a copy. Consumers that dilate time may ask for a different sample
+ * index, in which case the block is rendered again.
+ */
+class SharedNodePlugin : public Plugin,
+                         public std::enable_shared_from_this<SharedNodePlugin> {
+ public:
+  SharedNodePlugin(const std::shared_ptr<Plugin> &plugin,
+                   const std::shared_ptr<const RenderPass> &render_pass);
+  virtual ~SharedNodePlugin();
+
+  std::shared_ptr<Plugin> plugin() const;
+
+  // Plugin
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override;
+  void load(LOAD_CALLBACK callback) override;
+  bool loaded() const override;
+  void potentialTimeChange(long sample_index, long graph_sample_index) override;
+  void majorTimeChange(long sample_index, long graph_sample_index) override;
+  std::string name() override;
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override;
+  std::vector<std::string> paramNames() override;
+  std::shared_ptr<param::Param> paramForName(const std::string &name) override;
+  bool shouldProcessChildren(long sample_index, long sample_index_end,
+                             const NodeTimes &node_times) override;
+  long timeDilation(long sample_index) override;
+  bool timeAligned() const override;
+  bool finished(long sample_index, long sample_index_end) override;
+  void notifyFinished(long sample_index, long graph_sample_index) override;
+  PluginType type() const override;
+  long localRenderSampleIndex(long sample_index) override;
+  long startSampleIndex() override;
+  bool shouldProcess(long sample_index_start, long sample_index_end) override;
+
+ private:
+  bool cached(const std::map<std::string, std::shared_ptr<Content>> &content,
+              long sample_index, long render_pass,
+              nfgrapher::LoadingPolicy loading_policy) const;
+
+  const std::shared_ptr<Plugin> _plugin;
+  const std::shared_ptr<const RenderPass> _render_pass;
+
+  std::mutex _feed_mutex;
+  std::map<std::string, std::shared_ptr<Content>> _cached_content;
+  long _cached_sample_index;
+  long _cached_render_pass;
+  nfgrapher::LoadingPolicy _cached_loading_policy;
+
+  // Every consumer loads its inputs, the plugin itself is only loaded once
+  // unless loading it failed
+  std::mutex _load_mutex;
+  bool _loading;
+  bool _load_finished;
+  Load _load;
+  std::vector<LOAD_CALLBACK> _load_callbacks;
+};
+
+}  // namespace plugin
+}  // namespace nativeformat
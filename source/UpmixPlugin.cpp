@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "UpmixPlugin.h"
+
+namespace nativeformat {
+namespace plugin {
+
+UpmixPlugin::UpmixPlugin(const std::shared_ptr<Plugin> &plugin, int channels,
+                         int output_channels)
+    : _plugin(plugin), _channels(channels), _output_channels(output_channels) {}
+
+UpmixPlugin::~UpmixPlugin() {}
+
+std::shared_ptr<Plugin> UpmixPlugin::plugin() const { return _plugin; }
+
+void UpmixPlugin::feedPorts(PortContent &content, long sample_index,
+                            long graph_sample_index,
+                            nfgrapher::LoadingPolicy loading_policy) {
+  // Keep a narrow buffer for each of the consumer ports, only reshaping it
+  // when the blocks change shape so steady state rendering doesn't allocate
+  bool same_ports = _content.size() == content.size();
+  for (const auto &port : content) {
+    same_ports = same_ports && _content.has(port.first);
+  }
+  if (!same_ports) {
+    _content.clear();
+  }
+  for (const auto &port : content) {
+    const Content &output_content = *port.second;
+    auto &narrow_content = _content[port.first];
+    if (!narrow_content) {
+      narrow_content = std::make_shared<Content>();
+    }
+    const size_t payload_size =
+        output_content.payloadSize() / _output_channels * _channels;
+    const size_t required_items =
+        output_content.requiredItems() / _output_channels * _channels;
+    if (narrow_content->payloadSize() != payload_size ||
+        narrow_content->requiredItems() != required_items ||
+        narrow_content->sampleRate() != output_content.sampleRate() ||
+        narrow_content->type() != output_content.type()) {
+      narrow_content->reshape(payload_size, output_content.sampleRate(),
+                              _channels, required_items,
+                              output_content.type());
+    }
+    narrow_content->erase();
+  }
+
+  _plugin->feedPorts(_content, narrow(sample_index), narrow(graph_sample_index),
+                     loading_policy);
+
+  for (auto &port : content) {
+    const Content *narrow_content = _content.find(port.first);
+    if (narrow_content) {
+      upmix(*narrow_content, *port.second);
+    }
+  }
+}
+
+void UpmixPlugin::upmix(const Content &source, Content &destination) const {
+  if (source.type() != ContentPayloadTypeBuffer ||
+      destination.type() != ContentPayloadTypeBuffer) {
+    return;
+  }
+  const size_t frames = source.items() / _channels;
+  destination.setItems(frames * _output_channels);
+  if (source.silent()) {
+    destination.setSilent();
+    return;
+  }
+  // Each output channel repeats the source channel it lines up with, so a
+  // mono branch lands in every channel at the same level it was rendered at
+  const float *source_samples = source.constPayload();
+  float *destination_samples = destination.payload();
+  for (size_t frame = 0; frame < frames; ++frame) {
+    const float *source_frame = source_samples + frame * _channels;
+    float *destination_frame = destination_samples + frame * _output_channels;
+    for (long channel = 0; channel < _output_channels; ++channel) {
+      destination_frame[channel] = source_frame[channel % _channels];
+    }
+  }
+}
+
+long UpmixPlugin::narrow(long sample_index) const {
+  return (sample_index / _output_channels) * _channels;
+}
+
+long UpmixPlugin::widen(long sample_index) const {
+  return (sample_index / _channels) * _output_channels;
+}
+
+void UpmixPlugin::load(LOAD_CALLBACK callback) { _plugin->load(callback); }
+
+bool UpmixPlugin::loaded() const { return _plugin->loaded(); }
+
+void UpmixPlugin::potentialTimeChange(long sample_index,
+                                      long graph_sample_index) {
+  _plugin->potentialTimeChange(narrow(sample_index),
+                               narrow(graph_sample_index));
+}
+
+void UpmixPlugin::majorTimeChange(long sample_index, long graph_sample_index) {
+  _plugin->majorTimeChange(narrow(sample_index), narrow(graph_sample_index));
+}
+
+std::string UpmixPlugin::name() { return _plugin->name(); }
+
+void UpmixPlugin::run(long sample_index, const NodeTimes &node_times,
+                      long node_sample_index) {
+  _plugin->run(narrow(sample_index), node_times, narrow(node_sample_index));
+}
+
+std::vector<std::string> UpmixPlugin::paramNames() {
+  return _plugin->paramNames();
+}
+
+std::shared_ptr<param::Param> UpmixPlugin::paramForName(
+    const std::string &name) {
+  return _plugin->paramForName(name);
+}
+
+bool UpmixPlugin::shouldProcessChildren(long sample_index,
+                                        long sample_index_end,
+                                        const NodeTimes &node_times) {
+  return _plugin->shouldProcessChildren(narrow(sample_index),
+                                        narrow(sample_index_end), node_times);
+}
+
+long UpmixPlugin::timeDilation(long sample_index) {
+  return widen(_plugin->timeDilation(narrow(sample_index)));
+}
+
+bool UpmixPlugin::finished(long sample_index, long sample_index_end) {
+  return _plugin->finished(narrow(sample_index), narrow(sample_index_end));
+}
+
+void UpmixPlugin::notifyFinished(long sample_index, long graph_sample_index) {
+  _plugin->notifyFinished(narrow(sample_index), narrow(graph_sample_index));
+}
+
+Plugin::PluginType UpmixPlugin::type() const { return _plugin->type(); }
+
+long UpmixPlugin::localRenderSampleIndex(long sample_index) {
+  return widen(_plugin->localRenderSampleIndex(narrow(sample_index)));
+}
+
+long UpmixPlugin::startSampleIndex() {
+  return widen(_plugin->startSampleIndex());
+}
+
+bool UpmixPlugin::shouldProcess(long sample_index_start,
+                                long sample_index_end) {
+  return _plugin->shouldProcess(narrow(sample_index_start),
+                                narrow(sample_index_end));
+}
+
+}  // namespace plugin
+}  // namespace nativeformat
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/Plugin.h>
+
+#include <memory>
+
+namespace nativeformat {
+namespace plugin {
+
+/**
+ * Wraps the plugin of a branch that renders fewer channels than the node
+ * consuming it, such as a mono voice feeding a stereo effect. The branch keeps
+ * its own sample indices, interleaved at its own width, and the rendered
+ * channels are repeated across the wider content of the consumer. The branch
+ * renders recursively beneath it, so it stays at its width all the way down.
+ */
+class UpmixPlugin : public PortPlugin {
+ public:
+  UpmixPlugin(const std::shared_ptr<Plugin> &plugin, int channels,
+              int output_channels);
+  virtual ~UpmixPlugin();
+
+  std::shared_ptr<Plugin> plugin() const;
+
+  // Plugin
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
+  void load(LOAD_CALLBACK callback) override;
+  bool loaded() const override;
+  void potentialTimeChange(long sample_index, long graph_sample_index) override;
+  void majorTimeChange(long sample_index, long graph_sample_index) override;
+  std::string name() override;
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override;
+  std::vector<std::string> paramNames() override;
+  std::shared_ptr<param::Param> paramForName(const std::string &name) override;
+  bool shouldProcessChildren(long sample_index, long sample_index_end,
+                             const NodeTimes &node_times) override;
+  long timeDilation(long sample_index) override;
+  bool finished(long sample_index, long sample_index_end) override;
+  void notifyFinished(long sample_index, long graph_sample_index) override;
+  PluginType type() const override;
+  long localRenderSampleIndex(long sample_index) override;
+  long startSampleIndex() override;
+  bool shouldProcess(long sample_index_start, long sample_index_end) override;
+
+ private:
+  long narrow(long sample_index) const;
+  long widen(long sample_index) const;
+  void upmix(const Content &source, Content &destination) const;
+
+  const std::shared_ptr<Plugin> _plugin;
+  const long _channels;
+  const long _output_channels;
+  PortContent _content;
+};
+
+}  // namespace plugin
+}  // namespace nativeformat
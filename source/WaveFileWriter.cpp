@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2016 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "WaveFileWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace nativeformat {
+namespace smartplayer {
+
+static const int WaveFileWriterBitsPerSample = 16;
+static const size_t WaveFileWriterHeaderSize = 44;
+
+static void WriteLittleEndian(std::vector<uint8_t> &bytes, uint32_t value,
+                              int size) {
+  for (int i = 0; i < size; ++i) {
+    bytes.push_back((value >> (i * 8)) & 0xFF);
+  }
+}
+
+WaveFileWriter::WaveFileWriter(const std::string &path, int channels,
+                               double samplerate)
+    : _path(path),
+      _channels(channels),
+      _samplerate(samplerate),
+      _file(nullptr),
+      _frames(0) {}
+
+WaveFileWriter::~WaveFileWriter() { close(); }
+
+bool WaveFileWriter::open() {
+  _file = fopen(_path.c_str(), "wb");
+  if (!_file) {
+    return false;
+  }
+  _frames = 0;
+  // Written again with the final sizes once we are done
+  return writeHeader();
+}
+
+bool WaveFileWriter::write(const float *samples, size_t frames) {
+  if (!_file) {
+    return false;
+  }
+  const size_t sample_count = frames * _channels;
+  std::vector<int16_t> pcm(sample_count);
+  for (size_t i = 0; i < sample_count; ++i) {
+    const float sample = std::max(std::min(samples[i], 1.0f), -1.0f);
+    pcm[i] = static_cast<int16_t>(sample * INT16_MAX);
+  }
+  if (fwrite(pcm.data(), sizeof(int16_t), sample_count, _file) !=
+      sample_count) {
+    return false;
+  }
+  _frames += frames;
+  return true;
+}
+
+bool WaveFileWriter::close() {
+  if (!_file) {
+    return false;
+  }
+  bool closed = fseek(_file, 0, SEEK_SET) == 0 && writeHeader();
+  closed = fclose(_file) == 0 && closed;
+  _file = nullptr;
+  return closed;
+}
+
+size_t WaveFileWriter::frames() const { return _frames; }
+
+bool WaveFileWriter::writeHeader() {
+  const uint32_t block_align = _channels * (WaveFileWriterBitsPerSample / 8);
+  const uint32_t data_size = _frames * block_align;
+  std::vector<uint8_t> header;
+  header.reserve(WaveFileWriterHeaderSize);
+  header.insert(header.end(), {'R', 'I', 'F', 'F'});
+  WriteLittleEndian(header, WaveFileWriterHeaderSize - 8 + data_size, 4);
+  header.insert(header.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+  WriteLittleEndian(header, 16, 4);  // fmt chunk size
+  WriteLittleEndian(header, 1, 2);   // PCM
+  WriteLittleEndian(header, _channels, 2);
+  WriteLittleEndian(header, static_cast<uint32_t>(_samplerate), 4);
+  WriteLittleEndian(header, static_cast<uint32_t>(_samplerate) * block_align,
+                    4);
+  WriteLittleEndian(header, block_align, 2);
+  WriteLittleEndian(header, WaveFileWriterBitsPerSample, 2);
+  header.insert(header.end(), {'d', 'a', 't', 'a'});
+  WriteLittleEndian(header, data_size, 4);
+  return fwrite(header.data(), 1, header.size(), _file) == header.size();
+}
+
+}  // namespace smartplayer
+}  // namespace nativeformat
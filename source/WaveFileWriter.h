@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2016 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+namespace nativeformat {
+namespace smartplayer {
+
+/**
+ * Writes interleaved float samples to a 16 bit PCM wave file
+ */
+class WaveFileWriter {
+ public:
+  WaveFileWriter(const std::string &path, int channels, double samplerate);
+  virtual ~WaveFileWriter();
+
+  bool open();
+  bool write(const float *samples, size_t frames);
+  bool close();
+  size_t frames() const;
+
+ private:
+  bool writeHeader();
+
+  const std::string _path;
+  const int _channels;
+  const double _samplerate;
+  FILE *_file;
+  size_t _frames;
+};
+
+}  // namespace smartplayer
+}  // namespace nativeformat
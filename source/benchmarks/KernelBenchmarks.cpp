@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "KernelBenchmarks.h"
+
+#include <BandSplitter.h>
+#include <ButterFilter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Limiter.h"
+#include "plugins/compressor/Drc.h"
+
+extern "C" {
+#include <PeqBank/peqbank.h>
+}
+
+namespace nativeformat {
+namespace benchmarks {
+
+using KernelFunction =
+    std::function<void(float *samples, size_t frames, double time)>;
+
+static const std::vector<int> KernelBlockFrames = {64, 512, 4096};
+static const std::vector<int> KernelChannels = {1, 2, 6};
+static const int KernelMaximumBands = 8;
+
+// Feeds the kernel the same block of noise over and over, timing only the
+// kernel itself
+static nlohmann::json benchmarkKernel(const std::string &kernel,
+                                      const std::string &variant,
+                                      int block_frames, int channels,
+                                      double samplerate, double audio_seconds,
+                                      const KernelFunction &function) {
+  const size_t block_samples = block_frames * channels;
+  std::vector<float> noise(block_samples);
+  std::minstd_rand generator(block_samples);
+  std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+  std::generate(noise.begin(), noise.end(),
+                [&]() { return distribution(generator); });
+  std::vector<float> samples(block_samples);
+  const int blocks =
+      std::max(static_cast<int>(audio_seconds * samplerate / block_frames), 1);
+  long total_nanos = 0;
+  for (int block = 0; block < blocks; ++block) {
+    std::copy(noise.begin(), noise.end(), samples.begin());
+    const double time = static_cast<double>(block) * block_frames / samplerate;
+    auto start = std::chrono::steady_clock::now();
+    function(samples.data(), block_frames, time);
+    total_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  }
+  const double rendered_seconds =
+      static_cast<double>(blocks) * block_frames / samplerate;
+  const double render_seconds = std::max(total_nanos, 1L) / 1000000000.0;
+  return {{"kernel", kernel},
+          {"variant", variant},
+          {"block_frames", block_frames},
+          {"channels", channels},
+          {"ns_per_sample",
+           static_cast<double>(total_nanos) / blocks / block_frames},
+          {"realtime_factor", rendered_seconds / render_seconds}};
+}
+
+static void benchmarkButterFilters(nlohmann::json &results, int block_frames,
+                                   int channels, double samplerate,
+                                   double audio_seconds) {
+  static const std::vector<std::pair<std::string, plugin::util::FilterType>>
+      filter_types = {{"low pass", plugin::util::FilterType::LowPassFilter},
+                      {"high pass", plugin::util::FilterType::HighPassFilter},
+                      {"band pass", plugin::util::FilterType::BandPassFilter}};
+  for (unsigned order = 1; order <= 4; ++order) {
+    for (const auto &filter_type : filter_types) {
+      plugin::util::ButterFilter filter(order, filter_type.second, channels);
+      filter.compute(500.0 / samplerate, 2000.0 / samplerate);
+      results.push_back(benchmarkKernel(
+          "ButterFilter::filter",
+          "order " + std::to_string(order) + " " + filter_type.first,
+          block_frames, channels, samplerate, audio_seconds,
+          [&filter](float *samples, size_t frames, double time) {
+            filter.filter(samples, frames);
+          }));
+    }
+  }
+}
+
+static void benchmarkBandSplitters(nlohmann::json &results, int block_frames,
+                                   int channels, double samplerate,
+                                   double audio_seconds) {
+  for (int bands = 2; bands <= KernelMaximumBands; ++bands) {
+    // Crossovers spaced evenly in octaves between 100Hz and 10kHz
+    std::vector<double> crossovers;
+    for (int crossover = 0; crossover < bands - 1; ++crossover) {
+      crossovers.push_back(100.0 *
+                           std::pow(100.0, (crossover + 1.0) / bands));
+    }
+    plugin::util::BandSplitter splitter(crossovers, samplerate, channels);
+    std::vector<std::vector<float>> band_buffers(
+        bands, std::vector<float>(block_frames * channels));
+    std::vector<float *> band_samples(bands);
+    for (int band = 1; band < bands; ++band) {
+      band_samples[band] = band_buffers[band].data();
+    }
+    results.push_back(benchmarkKernel(
+        "BandSplitter::filter", std::to_string(bands) + " bands",
+        block_frames, channels, samplerate, audio_seconds,
+        [&splitter, &band_samples](float *samples, size_t frames,
+                                   double time) {
+          band_samples[0] = samples;
+          splitter.filter(band_samples.data(), frames);
+        }));
+  }
+}
+
+static void benchmarkCompanders(nlohmann::json &results, int block_frames,
+                                int channels, double samplerate,
+                                double audio_seconds) {
+  using NodeInfo = nfgrapher::contract::CompressorNodeInfo;
+  using Compressor = plugin::compressor::Drc<NodeInfo>;
+  for (const bool rms : {false, true}) {
+    for (const bool soft_knee : {false, true}) {
+      Compressor::KneeParams params = {
+          param::createParam(-20.0f, 0, -100, "_threshold_db"),
+          param::createParam(10.0f, 40, 0, "_knee_db"),
+          param::createParam(4.0f, 20, 1, "_ratio_db")};
+      std::unique_ptr<plugin::compressor::Detector> detector;
+      if (rms) {
+        detector.reset(new plugin::compressor::CompressorRmsDetector());
+      } else {
+        detector.reset(new plugin::compressor::CompressorPeakDetector());
+      }
+      plugin::compressor::knee_fun knee;
+      if (soft_knee) {
+        knee = plugin::compressor::SoftKnee<
+            plugin::compressor::CompressorType>();
+      } else {
+        knee = plugin::compressor::HardKnee<
+            plugin::compressor::CompressorType>();
+      }
+      std::vector<Compressor::Metadata> chains;
+      chains.emplace_back(params, knee, std::move(detector));
+      Compressor compressor(
+          rms ? NodeInfo::DetectionMode::rms : NodeInfo::DetectionMode::max,
+          chains, channels, samplerate);
+      results.push_back(benchmarkKernel(
+          "Drc::compand",
+          std::string(rms ? "rms" : "peak") + " detector " +
+              (soft_knee ? "soft" : "hard") + " knee",
+          block_frames, channels, samplerate, audio_seconds,
+          [&compressor, channels, samplerate](float *samples, size_t frames,
+                                              double time) {
+            compressor.compand(0.01f, 0.1f, time, time + frames / samplerate,
+                               samples, frames * channels, samples,
+                               frames * channels);
+          }));
+    }
+  }
+}
+
+static void benchmarkLimiter(nlohmann::json &results, int block_frames,
+                             int channels, double samplerate,
+                             double audio_seconds) {
+  Limiter limiter(channels);
+  results.push_back(benchmarkKernel(
+      "Limiter::limit", "", block_frames, channels, samplerate, audio_seconds,
+      [&limiter, channels](float *samples, size_t frames, double time) {
+        limiter.limit(samples, samples, frames * channels);
+      }));
+}
+
+static void benchmarkContentMix(nlohmann::json &results, int block_frames,
+                                int channels, double samplerate,
+                                double audio_seconds) {
+  const size_t block_samples = block_frames * channels;
+  plugin::Content destination(block_samples, block_samples, samplerate,
+                              channels, block_samples,
+                              plugin::ContentPayloadTypeBuffer);
+  plugin::Content source(block_samples, block_samples, samplerate, channels,
+                         block_samples, plugin::ContentPayloadTypeBuffer);
+  // Silent sources are skipped, so the source is handed out once to make it
+  // audible
+  std::fill_n(source.payload(), block_samples, 0.25f);
+  results.push_back(benchmarkKernel(
+      "Content::mix", "", block_frames, channels, samplerate, audio_seconds,
+      [&destination, &source](float *samples, size_t frames, double time) {
+        destination.mix(source);
+      }));
+}
+
+// The same filter bank and buffer handling the EQPlugin renders with
+static void benchmarkPeqBank(nlohmann::json &results, int block_frames,
+                             int channels, double samplerate,
+                             double audio_seconds) {
+  std::unique_ptr<t_peqbank, void (*)(t_peqbank *)> peqbank(
+      peqbank_new(samplerate, channels, 512), peqbank_freemem);
+  peqbank->b_mode = SMOOTH;
+  t_filter **filters = new_filters(2);
+  filters[0] = new_shelf(3.0f, 0, -3.0f, 264.0f, 3300.0f);
+  filters[1] = new_peq(1000.0f, 0.5, 0, 6.0f, 0);
+  peqbank_setup(peqbank.get(), filters);
+  results.push_back(benchmarkKernel(
+      "peqbank_callback_float", "3 band eq", block_frames, channels,
+      samplerate, audio_seconds,
+      [&peqbank](float *samples, size_t frames, double time) {
+        if (frames > peqbank->s_n) {
+          peqbank_resize_buffer(peqbank.get(), frames);
+        } else if (frames < peqbank->s_n) {
+          peqbank->s_n = frames;
+        }
+        peqbank_callback_float(peqbank.get(), samples, samples);
+      }));
+}
+
+nlohmann::json benchmarkKernels(double samplerate, double audio_seconds) {
+  nlohmann::json results = nlohmann::json::array();
+  for (const int block_frames : KernelBlockFrames) {
+    for (const int channels : KernelChannels) {
+      benchmarkButterFilters(results, block_frames, channels, samplerate,
+                             audio_seconds);
+      benchmarkBandSplitters(results, block_frames, channels, samplerate,
+                             audio_seconds);
+      benchmarkCompanders(results, block_frames, channels, samplerate,
+                          audio_seconds);
+      benchmarkLimiter(results, block_frames, channels, samplerate,
+                       audio_seconds);
+      benchmarkContentMix(results, block_frames, channels, samplerate,
+                          audio_seconds);
+      benchmarkPeqBank(results, block_frames, channels, samplerate,
+                       audio_seconds);
+    }
+  }
+  return results;
+}
+
+}  // namespace benchmarks
+}  // namespace nativeformat
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+namespace nativeformat {
+namespace benchmarks {
+
+/**
+ * Times the DSP kernels the plugins spend most of their time in, in isolation
+ * from the graph, over a range of block sizes and channel counts. Each kernel
+ * processes audio_seconds of noise per configuration, the results are an array
+ * with the nanoseconds spent per sample frame and the realtime factor.
+ */
+nlohmann::json benchmarkKernels(double samplerate, double audio_seconds);
+
+}  // namespace benchmarks
+}  // namespace nativeformat
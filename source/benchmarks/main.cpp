@@ -0,0 +1,868 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <NFHTTP/Client.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Just for benchmarking, traversing a graph is otherwise left to the Player
+#define protected public
+
+#include "../tests/AllocationCounter.h"
+#include "GraphImplementation.h"
+#include "KernelBenchmarks.h"
+#include "plugins/channel/PluginFactory.h"
+#include "plugins/compressor/CompressorPluginFactory.h"
+#include "plugins/eq/EQPluginFactory.h"
+#include "plugins/file/DiskPCMCache.h"
+#include "plugins/file/FilePluginFactory.h"
+#include "plugins/file/PCMCache.h"
+#include "plugins/noise/NoisePluginFactory.h"
+#include "plugins/time/TimePluginFactory.h"
+#include "plugins/waa/WAAPluginFactory.h"
+#include "plugins/wave/WavePluginFactory.h"
+
+using namespace nativeformat;
+
+static const int BenchmarkLoadTimeoutSeconds = 30;
+static const int BenchmarkMinimumBlockFrames = 64;
+static const int BenchmarkMaximumBlockFrames = 8192;
+static const int BenchmarkReportVersion = 2;
+static const int BenchmarkFileCount = 8;
+static const double BenchmarkFileOffsetSeconds = 0.25;
+// How much audio files decoded before they reported they had loaded before
+// they became ready progressively
+static const double BenchmarkUpfrontReadyTime = 10.0;
+static const double BenchmarkFirstAudioMaximumSeconds = 10.0;
+static const std::chrono::milliseconds BenchmarkResidentSampleInterval(1);
+static const char *BenchmarkDiskCacheDirectory =
+    "/tmp/NFSmartPlayerBenchmarksXXXXXX";
+
+static std::shared_ptr<plugin::Registry> createPluginRegistry(
+    double file_ready_time = plugin::file::FilePluginDefaultReadyTime) {
+  std::shared_ptr<http::Client> client = http::createClient(
+      http::standardCacheLocation(), "NFSmartPlayerBenchmarks",
+      [](std::function<void(const std::shared_ptr<http::Request> &request)>
+             callback,
+         const std::shared_ptr<http::Request> &request) { callback(request); },
+      [](std::function<void(const std::shared_ptr<http::Response> &response,
+                            bool retry)>
+             callback,
+         const std::shared_ptr<http::Response> &response) {
+        callback(response, false);
+      });
+  return std::make_shared<plugin::Registry>(
+      std::vector<std::shared_ptr<plugin::Factory>>(
+          {std::make_shared<plugin::waa::WAAPluginFactory>(),
+           std::make_shared<plugin::noise::NoisePluginFactory>(),
+           std::make_shared<plugin::wave::WavePluginFactory>(),
+           std::make_shared<plugin::file::FilePluginFactory>(
+               client, file_ready_time),
+           std::make_shared<plugin::compressor::CompressorPluginFactory>(),
+           std::make_shared<plugin::channel::PluginFactory>(),
+           std::make_shared<plugin::eq::EQPluginFactory>(),
+           std::make_shared<plugin::time::TimePluginFactory>()}),
+      [](const std::string &plugin_namespace,
+         const std::string &variable_name) { return ""; });
+}
+
+// A score of sines each going through their own gain, node_count nodes large
+static std::string syntheticScore(int node_count) {
+  nlohmann::json nodes = nlohmann::json::array();
+  nlohmann::json edges = nlohmann::json::array();
+  for (int i = 0; i < node_count / 2; ++i) {
+    const std::string sine_id = "sine" + std::to_string(i);
+    const std::string gain_id = "gain" + std::to_string(i);
+    nodes.push_back({{"id", sine_id},
+                     {"kind", "com.nativeformat.plugin.wave.sine"},
+                     {"config",
+                      {{"frequency", 110.0 + i},
+                       {"when", 0.0},
+                       {"duration", 60000000000.0}}},
+                     {"params", nlohmann::json::object()}});
+    nlohmann::json set_gain = {
+        {"name", "setValueAtTime"},
+        {"args", {{"value", 1.0 / node_count}, {"startTime", 0.0}}}};
+    nodes.push_back(
+        {{"id", gain_id},
+         {"kind", "com.nativeformat.plugin.waa.gain"},
+         {"config", nlohmann::json::object()},
+         {"params", {{"gain", nlohmann::json::array({set_gain})}}}});
+    edges.push_back({{"id", "edge" + std::to_string(i)},
+                     {"source", sine_id},
+                     {"target", gain_id}});
+  }
+  nlohmann::json score = {{"version", nfgrapher::version()},
+                          {"graph",
+                           {{"id", "com.nativeformat.graph.synthetic"},
+                            {"nodes", nodes},
+                            {"edges", edges},
+                            {"scripts", nlohmann::json::array()}}}};
+  return score.dump();
+}
+
+// Writes seconds of a stereo 16 bit sine to a WAV file
+static bool writeSineWav(const std::string &path, double frequency,
+                         double seconds) {
+  const uint32_t samplerate = NF_DRIVER_SAMPLERATE;
+  const uint16_t channels = 2;
+  const uint16_t bytes_per_sample = 2;
+  const uint32_t frames = static_cast<uint32_t>(seconds * samplerate);
+  const uint32_t data_bytes = frames * channels * bytes_per_sample;
+  std::ofstream wav_stream(path, std::ios::binary);
+  auto write = [&wav_stream](uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+      wav_stream.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+  };
+  wav_stream.write("RIFF", 4);
+  write(36 + data_bytes, 4);
+  wav_stream.write("WAVEfmt ", 8);
+  write(16, 4);
+  write(1, 2);
+  write(channels, 2);
+  write(samplerate, 4);
+  write(samplerate * channels * bytes_per_sample, 4);
+  write(channels * bytes_per_sample, 2);
+  write(bytes_per_sample * 8, 2);
+  wav_stream.write("data", 4);
+  write(data_bytes, 4);
+  for (uint32_t frame = 0; frame < frames; ++frame) {
+    const int16_t sample = static_cast<int16_t>(
+        8192.0 * std::sin(2.0 * M_PI * frequency * frame / samplerate));
+    for (int channel = 0; channel < channels; ++channel) {
+      write(static_cast<uint16_t>(sample), bytes_per_sample);
+    }
+  }
+  return static_cast<bool>(wav_stream);
+}
+
+// A score of node_count file nodes sharing a handful of files, each starting
+// at its own offset into its file so they play different parts of it
+static std::string fileScore(int node_count,
+                             const std::vector<std::string> &paths,
+                             double seconds) {
+  nlohmann::json nodes = nlohmann::json::array();
+  for (int i = 0; i < node_count; ++i) {
+    const int offset_step = i / static_cast<int>(paths.size());
+    nodes.push_back(
+        {{"id", "file" + std::to_string(i)},
+         {"kind", "com.nativeformat.plugin.file.file"},
+         {"config",
+          {{"file", paths[i % paths.size()]},
+           {"when", 0.0},
+           {"duration", seconds * 1000000000.0},
+           {"offset",
+            offset_step * BenchmarkFileOffsetSeconds * 1000000000.0}}},
+         {"params", nlohmann::json::object()}});
+  }
+  nlohmann::json score = {{"version", nfgrapher::version()},
+                          {"graph",
+                           {{"id", "com.nativeformat.graph.files"},
+                            {"nodes", nodes},
+                            {"edges", nlohmann::json::array()},
+                            {"scripts", nlohmann::json::array()}}}};
+  return score.dump();
+}
+
+// Loads a score into the graph, which keeps whatever it can of a score it
+// already has
+static bool setGraphJson(
+    const std::shared_ptr<smartplayer::GraphImplementation> &graph,
+    const std::string &score_json) {
+  auto promise = std::make_shared<std::promise<Load>>();
+  graph->setJson(score_json,
+                 [promise](const Load &load) { promise->set_value(load); });
+  auto future = promise->get_future();
+  return future.wait_for(std::chrono::seconds(BenchmarkLoadTimeoutSeconds)) ==
+             std::future_status::ready &&
+         future.get()._loaded;
+}
+
+static std::shared_ptr<smartplayer::GraphImplementation> loadGraph(
+    const std::string &score_json,
+    const std::shared_ptr<plugin::Registry> &registry,
+    bool uses_execution_plan, bool uses_port_content,
+    size_t block_samples = NF_DRIVER_SAMPLE_BLOCK_SIZE) {
+  auto graph = std::make_shared<smartplayer::GraphImplementation>(
+      NF_DRIVER_CHANNELS, NF_DRIVER_SAMPLERATE,
+      smartplayer::createGraphSessionId());
+  graph->setBlockSize(block_samples);
+  graph->setPluginRegistry(registry);
+  graph->setUsesExecutionPlan(uses_execution_plan);
+  graph->setUsesPortContent(uses_port_content);
+  return setGraphJson(graph, score_json) ? graph : nullptr;
+}
+
+// Returns the mean time spent traversing a block in nanoseconds, along with
+// how often the traversals themselves allocated if asked
+static double benchmarkTraversal(
+    const std::shared_ptr<smartplayer::GraphImplementation> &graph,
+    int blocks, size_t block_samples = NF_DRIVER_SAMPLE_BLOCK_SIZE,
+    size_t *allocations = nullptr) {
+  std::map<std::string, std::shared_ptr<plugin::Content>> content = {
+      {AudioContentTypeKey,
+       std::make_shared<plugin::Content>(
+           block_samples, 0, NF_DRIVER_SAMPLERATE, NF_DRIVER_CHANNELS,
+           block_samples, plugin::ContentPayloadTypeBuffer)}};
+  // The policy the Player renders with unless told otherwise
+  const auto loading_policy =
+      nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH;
+  graph->run();
+  long total_nanos = 0;
+  // Only this thread renders, so loaders and decoders don't count
+  if (allocations) {
+    test::startCountingAllocations();
+  }
+  for (int block = 0; block < blocks; ++block) {
+    content[AudioContentTypeKey]->erase();
+    auto start = std::chrono::steady_clock::now();
+    graph->traverse(content, loading_policy);
+    total_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  }
+  if (allocations) {
+    *allocations = test::stopCountingAllocations();
+  }
+  return static_cast<double>(total_nanos) / blocks;
+}
+
+// Prints the CPU time spent rendering each second of audio as the block size
+// the graph renders at doubles, small blocks trade throughput for latency
+static int benchmarkBlockSizes(
+    const std::vector<std::pair<std::string, std::string>> &scores,
+    const std::shared_ptr<plugin::Registry> &registry, double audio_seconds) {
+  std::cout << std::endl
+            << "CPU time per second of audio (ms) by block size (frames)"
+            << std::endl;
+  std::cout << std::left << std::setw(40) << "score" << std::right;
+  for (int block_frames = BenchmarkMinimumBlockFrames;
+       block_frames <= BenchmarkMaximumBlockFrames; block_frames *= 2) {
+    std::cout << std::setw(9) << block_frames;
+  }
+  std::cout << std::endl;
+  int failures = 0;
+  for (const auto &score : scores) {
+    std::cout << std::left << std::setw(40) << score.first << std::right
+              << std::fixed << std::setprecision(2);
+    for (int block_frames = BenchmarkMinimumBlockFrames;
+         block_frames <= BenchmarkMaximumBlockFrames; block_frames *= 2) {
+      const size_t block_samples = block_frames * NF_DRIVER_CHANNELS;
+      auto graph = loadGraph(score.second, registry, true, true, block_samples);
+      if (!graph) {
+        std::cout << std::setw(9) << "-";
+        failures++;
+        continue;
+      }
+      const int blocks = std::max(
+          static_cast<int>(audio_seconds * NF_DRIVER_SAMPLERATE / block_frames),
+          1);
+      const double block_nanos =
+          benchmarkTraversal(graph, blocks, block_samples);
+      const double audio_seconds_per_block =
+          static_cast<double>(block_frames) / NF_DRIVER_SAMPLERATE;
+      std::cout << std::setw(9)
+                << block_nanos / audio_seconds_per_block / 1000000.0;
+    }
+    std::cout << std::endl;
+  }
+  return failures;
+}
+
+// The process' resident set in bytes, or -1 where it can't be read
+static long residentBytes() {
+  std::ifstream statm_stream("/proc/self/statm");
+  long size_pages = 0;
+  long resident_pages = 0;
+  if (!(statm_stream >> size_pages >> resident_pages)) {
+    return -1;
+  }
+  return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+// Watches the resident set from its own thread while a score loads and
+// renders. The scores share the process, so each is measured by how far it
+// grew the resident set rather than by the process' high water mark.
+class ResidentGrowthSampler {
+ public:
+  ResidentGrowthSampler()
+      : _baseline_bytes(residentBytes()),
+        _peak_bytes(_baseline_bytes),
+        _sampling(_baseline_bytes >= 0),
+        _thread([this]() {
+          while (_sampling) {
+            _peak_bytes = std::max(_peak_bytes.load(), residentBytes());
+            std::this_thread::sleep_for(BenchmarkResidentSampleInterval);
+          }
+        }) {}
+
+  // The most the resident set grew by, or -1 where it can't be read
+  long stop() {
+    _sampling = false;
+    _thread.join();
+    if (_baseline_bytes < 0) {
+      return -1;
+    }
+    _peak_bytes = std::max(_peak_bytes.load(), residentBytes());
+    return std::max(_peak_bytes - _baseline_bytes, 0L);
+  }
+
+ private:
+  const long _baseline_bytes;
+  std::atomic<long> _peak_bytes;
+  std::atomic<bool> _sampling;
+  std::thread _thread;
+};
+
+// Renders audio_seconds of each score offline and reports the numbers we
+// track between versions of the library as JSON, the RSS growth is how far
+// loading, rendering and reloading the score grew the resident set
+static int benchmarkScores(
+    const std::vector<std::pair<std::string, std::string>> &scores,
+    const std::shared_ptr<plugin::Registry> &registry, double audio_seconds,
+    const nlohmann::json &kernels, const std::string &json_path) {
+  const int block_frames = NF_DRIVER_SAMPLE_BLOCK_SIZE / NF_DRIVER_CHANNELS;
+  const int blocks = std::max(
+      static_cast<int>(audio_seconds * NF_DRIVER_SAMPLERATE / block_frames), 1);
+  const double rendered_seconds =
+      static_cast<double>(blocks) * block_frames / NF_DRIVER_SAMPLERATE;
+  nlohmann::json results = nlohmann::json::array();
+  int failures = 0;
+  for (const auto &score : scores) {
+    ResidentGrowthSampler resident_sampler;
+    auto load_start = std::chrono::steady_clock::now();
+    auto graph = loadGraph(score.second, registry, true, true);
+    const double load_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      load_start)
+            .count();
+    if (!graph) {
+      resident_sampler.stop();
+      results.push_back({{"score", score.first}, {"loaded", false}});
+      failures++;
+      continue;
+    }
+    size_t allocations = 0;
+    const double block_nanos = benchmarkTraversal(
+        graph, blocks, NF_DRIVER_SAMPLE_BLOCK_SIZE, &allocations);
+    const double render_seconds = block_nanos * blocks / 1000000000.0;
+    // Pushing the same score again, as an editor does on every tweak, keeps
+    // every plugin so should cost next to nothing
+    auto reload_start = std::chrono::steady_clock::now();
+    const bool reloaded = setGraphJson(graph, score.second);
+    const double reload_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                      reload_start)
+            .count();
+    if (!reloaded) {
+      failures++;
+    }
+    const long rss_growth_bytes = resident_sampler.stop();
+    results.push_back(
+        {{"score", score.first},
+         {"loaded", true},
+         {"blocks", blocks},
+         {"block_frames", block_frames},
+         {"audio_seconds", rendered_seconds},
+         {"render_seconds", render_seconds},
+         {"realtime_factor", rendered_seconds / render_seconds},
+         {"ns_per_sample", block_nanos / block_frames},
+         {"allocations_per_block",
+          static_cast<double>(allocations) / blocks},
+         {"rss_growth_bytes", rss_growth_bytes >= 0
+                                  ? nlohmann::json(rss_growth_bytes)
+                                  : nlohmann::json()},
+         {"load_ms", load_seconds * 1000.0},
+         {"reload_ms", reload_seconds * 1000.0}});
+  }
+  nlohmann::json report = {{"version", BenchmarkReportVersion},
+                           {"samplerate", NF_DRIVER_SAMPLERATE},
+                           {"channels", NF_DRIVER_CHANNELS},
+                           {"scores", results}};
+  if (!kernels.empty()) {
+    report["kernels"] = kernels;
+  }
+  if (json_path == "-") {
+    std::cout << report.dump(2) << std::endl;
+  } else {
+    std::ofstream json_stream(json_path);
+    json_stream << report.dump(2) << std::endl;
+    if (!json_stream) {
+      std::cerr << "Failed to write " << json_path << std::endl;
+      failures++;
+    }
+  }
+  return failures;
+}
+
+// Plays node_count file nodes at the pace of a sound card while their files
+// decode in the background, printing how long the slowest blocks took to
+// render and how many overran their deadline
+static int benchmarkFileNodes(const std::shared_ptr<plugin::Registry> &registry,
+                              int node_count, double audio_seconds) {
+  const char *temporary_directory = std::getenv("TMPDIR");
+  const std::string directory =
+      temporary_directory ? temporary_directory : "/tmp";
+  const double file_seconds =
+      audio_seconds + (node_count / BenchmarkFileCount + 1) *
+                          BenchmarkFileOffsetSeconds;
+  std::vector<std::string> paths;
+  int failures = 0;
+  for (int i = 0; i < BenchmarkFileCount; ++i) {
+    paths.push_back(directory + "/nfsmartplayer-benchmark-" +
+                    std::to_string(i) + ".wav");
+    if (!writeSineWav(paths.back(), 220.0 + 55.0 * i, file_seconds)) {
+      failures++;
+    }
+  }
+  const std::string name = "files (" + std::to_string(node_count) + " nodes)";
+  std::shared_ptr<smartplayer::GraphImplementation> graph;
+  if (failures == 0) {
+    graph = loadGraph(fileScore(node_count, paths, audio_seconds), registry,
+                      true, true);
+  }
+  std::cout << std::endl
+            << "Block render time (us) playing files in realtime"
+            << std::endl;
+  std::cout << std::left << std::setw(40) << "score" << std::right
+            << std::setw(10) << "mean" << std::setw(10) << "p99"
+            << std::setw(10) << "max" << std::setw(8) << "late"
+            << std::setw(10) << "hit rate" << std::endl;
+  if (!graph) {
+    std::cout << std::left << std::setw(40) << name << "failed to load"
+              << std::endl;
+    for (const auto &path : paths) {
+      std::remove(path.c_str());
+    }
+    return failures + 1;
+  }
+
+  const size_t block_samples = NF_DRIVER_SAMPLE_BLOCK_SIZE;
+  const int block_frames = block_samples / NF_DRIVER_CHANNELS;
+  const int blocks = std::max(
+      static_cast<int>(audio_seconds * NF_DRIVER_SAMPLERATE / block_frames), 1);
+  const auto block_duration = std::chrono::nanoseconds(static_cast<long>(
+      1000000000.0 * block_frames / NF_DRIVER_SAMPLERATE));
+  std::map<std::string, std::shared_ptr<plugin::Content>> content = {
+      {AudioContentTypeKey,
+       std::make_shared<plugin::Content>(
+           block_samples, 0, NF_DRIVER_SAMPLERATE, NF_DRIVER_CHANNELS,
+           block_samples, plugin::ContentPayloadTypeBuffer)}};
+  const auto loading_policy =
+      nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH;
+  std::vector<long> block_nanos(blocks);
+  int late_blocks = 0;
+  graph->run();
+  auto deadline = std::chrono::steady_clock::now();
+  for (int block = 0; block < blocks; ++block) {
+    deadline += block_duration;
+    content[AudioContentTypeKey]->erase();
+    auto start = std::chrono::steady_clock::now();
+    graph->traverse(content, loading_policy);
+    auto end = std::chrono::steady_clock::now();
+    block_nanos[block] =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count();
+    if (end > deadline) {
+      late_blocks++;
+    }
+    std::this_thread::sleep_until(deadline);
+  }
+  std::vector<long> sorted_nanos(block_nanos);
+  std::sort(sorted_nanos.begin(), sorted_nanos.end());
+  long total_nanos = 0;
+  for (const auto nanos : block_nanos) {
+    total_nanos += nanos;
+  }
+  const auto cache_stats = plugin::file::PCMCache::sharedCache()->stats();
+  std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10)
+            << total_nanos / 1000.0 / blocks << std::setw(10)
+            << sorted_nanos[(blocks - 1) * 99 / 100] / 1000.0
+            << std::setw(10) << sorted_nanos.back() / 1000.0 << std::setw(8)
+            << late_blocks << std::setw(10) << cache_stats._hit_rate
+            << std::endl;
+  graph = nullptr;
+  for (const auto &path : paths) {
+    std::remove(path.c_str());
+  }
+  return failures;
+}
+
+// Prints how long it takes from loading a score of each file on its own to
+// rendering its first audible sample, with files ready once their first
+// seconds have decoded as they used to be and with the default ready time
+static int benchmarkFirstAudio(const std::vector<std::string> &paths) {
+  std::cout << std::endl
+            << "Load to first sample (ms) by seconds decoded before loading"
+            << std::endl;
+  std::cout << std::left << std::setw(56) << "file" << std::right
+            << std::setw(8) << "ready" << std::setw(10) << "load"
+            << std::setw(14) << "first sample" << std::endl;
+  const size_t block_samples = NF_DRIVER_SAMPLE_BLOCK_SIZE;
+  const int maximum_blocks =
+      BenchmarkFirstAudioMaximumSeconds * NF_DRIVER_SAMPLERATE /
+      (block_samples / NF_DRIVER_CHANNELS);
+  const auto loading_policy =
+      nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH;
+  auto pcm_cache = plugin::file::PCMCache::sharedCache();
+  int failures = 0;
+  for (const auto &path : paths) {
+    for (const double ready_time : {BenchmarkUpfrontReadyTime,
+                                    plugin::file::FilePluginDefaultReadyTime}) {
+      // Nothing may be left decoded from the last run
+      pcm_cache->setBudgetBytes(0);
+      pcm_cache->setBudgetBytes(plugin::file::PCMCacheDefaultBudgetBytes);
+      auto registry = createPluginRegistry(ready_time);
+      nlohmann::json node = {
+          {"id", "file"},
+          {"kind", "com.nativeformat.plugin.file.file"},
+          {"config",
+           {{"file", path},
+            {"when", 0.0},
+            {"duration", BenchmarkFirstAudioMaximumSeconds * 1000000000.0},
+            {"offset", 0.0}}},
+          {"params", nlohmann::json::object()}};
+      nlohmann::json score = {
+          {"version", nfgrapher::version()},
+          {"graph",
+           {{"id", "com.nativeformat.graph.first-audio"},
+            {"nodes", nlohmann::json::array({node})},
+            {"edges", nlohmann::json::array()},
+            {"scripts", nlohmann::json::array()}}}};
+      std::cout << std::left << std::setw(56) << path << std::right
+                << std::fixed << std::setprecision(2) << std::setw(8)
+                << ready_time;
+      auto start = std::chrono::steady_clock::now();
+      auto graph = loadGraph(score.dump(), registry, true, true);
+      const double load_ms =
+          std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - start)
+              .count();
+      if (!graph) {
+        std::cout << std::setw(10) << "-" << std::setw(14) << "-"
+                  << std::endl;
+        failures++;
+        continue;
+      }
+      std::map<std::string, std::shared_ptr<plugin::Content>> content = {
+          {AudioContentTypeKey,
+           std::make_shared<plugin::Content>(
+               block_samples, 0, NF_DRIVER_SAMPLERATE, NF_DRIVER_CHANNELS,
+               block_samples, plugin::ContentPayloadTypeBuffer)}};
+      graph->run();
+      double first_sample_ms = -1.0;
+      for (int block = 0; block < maximum_blocks && first_sample_ms < 0.0;
+           ++block) {
+        auto &audio_content = *content[AudioContentTypeKey];
+        audio_content.erase();
+        graph->traverse(content, loading_policy);
+        const float *samples = audio_content.constPayload();
+        for (size_t i = 0; i < audio_content.items(); ++i) {
+          if (samples[i] != 0.0f) {
+            first_sample_ms = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+            break;
+          }
+        }
+      }
+      std::cout << std::setw(10) << load_ms << std::setw(14);
+      if (first_sample_ms < 0.0) {
+        std::cout << "-";
+        failures++;
+      } else {
+        std::cout << first_sample_ms;
+      }
+      std::cout << std::endl;
+    }
+  }
+  return failures;
+}
+
+// Prints how long it takes to load a score of each file on its own with its
+// first 10 seconds decoded, from an empty disk cache and then from the chunks
+// the first load left there
+static int benchmarkDiskCache(const std::vector<std::string> &paths) {
+  std::cout << std::endl
+            << "Load with 10 s decoded (ms) by disk cache" << std::endl;
+  std::cout << std::left << std::setw(56) << "file" << std::right
+            << std::setw(10) << "cold" << std::setw(10) << "warm"
+            << std::setw(10) << "speedup" << std::setw(10) << "hits"
+            << std::endl;
+  std::vector<char> directory(
+      BenchmarkDiskCacheDirectory,
+      BenchmarkDiskCacheDirectory + std::strlen(BenchmarkDiskCacheDirectory) +
+          1);
+  if (!mkdtemp(directory.data())) {
+    std::cout << "Can't create a directory for the disk cache" << std::endl;
+    return 1;
+  }
+  auto pcm_cache = plugin::file::PCMCache::sharedCache();
+  auto disk_pcm_cache = plugin::file::DiskPCMCache::sharedCache();
+  auto registry = createPluginRegistry(BenchmarkUpfrontReadyTime);
+  int failures = 0;
+  for (const auto &path : paths) {
+    // Starts cold with nothing on disk
+    disk_pcm_cache->setDirectory(directory.data(), 0);
+    disk_pcm_cache->setDirectory(directory.data());
+    const long hits = disk_pcm_cache->stats()._hits;
+    nlohmann::json node = {
+        {"id", "file"},
+        {"kind", "com.nativeformat.plugin.file.file"},
+        {"config",
+         {{"file", path},
+          {"when", 0.0},
+          {"duration", BenchmarkUpfrontReadyTime * 1000000000.0},
+          {"offset", 0.0}}},
+        {"params", nlohmann::json::object()}};
+    nlohmann::json score = {
+        {"version", nfgrapher::version()},
+        {"graph",
+         {{"id", "com.nativeformat.graph.disk-cache"},
+          {"nodes", nlohmann::json::array({node})},
+          {"edges", nlohmann::json::array()},
+          {"scripts", nlohmann::json::array()}}}};
+    std::cout << std::left << std::setw(56) << path << std::right << std::fixed
+              << std::setprecision(2);
+    double load_ms[2] = {-1.0, -1.0};
+    for (auto &run_load_ms : load_ms) {
+      // Only what is on disk may be left from the last load
+      pcm_cache->setBudgetBytes(0);
+      pcm_cache->setBudgetBytes(plugin::file::PCMCacheDefaultBudgetBytes);
+      auto start = std::chrono::steady_clock::now();
+      auto graph = loadGraph(score.dump(), registry, true, true);
+      if (graph) {
+        run_load_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+      }
+    }
+    if (load_ms[0] < 0.0 || load_ms[1] < 0.0) {
+      std::cout << std::setw(10) << "-" << std::setw(10) << "-" << std::endl;
+      failures++;
+      continue;
+    }
+    std::cout << std::setw(10) << load_ms[0] << std::setw(10) << load_ms[1]
+              << std::setw(9) << load_ms[0] / load_ms[1] << "x"
+              << std::setw(10) << disk_pcm_cache->stats()._hits - hits
+              << std::endl;
+  }
+  disk_pcm_cache->setDirectory(directory.data(), 0);
+  disk_pcm_cache->setDirectory("");
+  rmdir(directory.data());
+  return failures;
+}
+
+// Prints the cost of each DSP kernel per sample frame at every block size and
+// channel count it was timed at
+static void printKernels(const nlohmann::json &kernels) {
+  std::cout << std::endl
+            << "DSP kernel time per sample frame (ns)" << std::endl;
+  std::cout << std::left << std::setw(56) << "kernel" << std::right
+            << std::setw(8) << "frames" << std::setw(10) << "channels"
+            << std::setw(10) << "ns" << std::setw(12) << "realtime"
+            << std::endl;
+  for (const auto &kernel : kernels) {
+    std::string name = kernel["kernel"].get<std::string>();
+    const std::string variant = kernel["variant"].get<std::string>();
+    if (!variant.empty()) {
+      name += " (" + variant + ")";
+    }
+    std::cout << std::left << std::setw(56) << name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(8)
+              << kernel["block_frames"].get<int>() << std::setw(10)
+              << kernel["channels"].get<int>() << std::setw(10)
+              << kernel["ns_per_sample"].get<double>() << std::setw(11)
+              << kernel["realtime_factor"].get<double>() << "x" << std::endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  static const char *help_option = "help";
+  static const char *scores_option = "scores";
+  static const char *blocks_option = "blocks";
+  static const char *synthetic_nodes_option = "synthetic-nodes";
+  static const char *block_sizes_seconds_option = "block-sizes-seconds";
+  static const char *json_option = "json";
+  static const char *json_seconds_option = "json-seconds";
+  static const char *kernels_seconds_option = "kernels-seconds";
+  static const char *file_nodes_option = "file-nodes";
+  static const char *file_seconds_option = "file-seconds";
+  static const char *first_audio_option = "first-audio";
+  static const char *disk_cache_option = "disk-cache";
+
+  boost::program_options::options_description desc("Allowed options");
+  desc.add_options()(help_option, "produce help message")(
+      scores_option,
+      boost::program_options::value<std::vector<std::string>>(),
+      "the score files to benchmark")(
+      blocks_option, boost::program_options::value<int>()->default_value(2000),
+      "the number of blocks to render for each score")(
+      synthetic_nodes_option,
+      boost::program_options::value<int>()->default_value(200),
+      "the size of the generated sine and gain score, 0 to skip it")(
+      block_sizes_seconds_option,
+      boost::program_options::value<double>()->default_value(10.0),
+      "the seconds of audio to render at each block size, 0 to skip it")(
+      json_option, boost::program_options::value<std::string>(),
+      "render each score offline and write a JSON report of realtime factor, "
+      "ns per sample, allocations per block and RSS growth to this file, - "
+      "for stdout")(json_seconds_option,
+                boost::program_options::value<double>()->default_value(30.0),
+                "the seconds of audio to render for the JSON report")(
+      kernels_seconds_option,
+      boost::program_options::value<double>()->default_value(0.0),
+      "the seconds of audio each DSP kernel processes at every block size "
+      "and channel count, 0 to skip them")(
+      file_nodes_option,
+      boost::program_options::value<int>()->default_value(64),
+      "the number of file nodes to play at once")(
+      file_seconds_option,
+      boost::program_options::value<double>()->default_value(0.0),
+      "the seconds of audio to play the file nodes for in realtime, 0 to "
+      "skip them")(
+      first_audio_option,
+      boost::program_options::value<std::vector<std::string>>()->multitoken(),
+      "the audio files to time from loading to their first sample")(
+      disk_cache_option,
+      boost::program_options::value<std::vector<std::string>>()->multitoken(),
+      "the audio files to time loading from a cold and a warm disk cache");
+  boost::program_options::positional_options_description positional;
+  positional.add(scores_option, -1);
+  boost::program_options::variables_map options_map;
+  boost::program_options::store(
+      boost::program_options::command_line_parser(argc, argv)
+          .options(desc)
+          .positional(positional)
+          .run(),
+      options_map);
+
+  if (options_map.count(help_option) > 0) {
+    std::cout << "Usage: NFSmartPlayerBenchmarks [options] score.json..."
+              << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  std::vector<std::pair<std::string, std::string>> scores;
+  const int synthetic_nodes = options_map[synthetic_nodes_option].as<int>();
+  if (synthetic_nodes > 0) {
+    scores.emplace_back("synthetic (" + std::to_string(synthetic_nodes) +
+                            " nodes)",
+                        syntheticScore(synthetic_nodes));
+  }
+  if (options_map.count(scores_option) > 0) {
+    for (const auto &score_file :
+         options_map[scores_option].as<std::vector<std::string>>()) {
+      std::ifstream file_stream(score_file);
+      scores.emplace_back(
+          score_file, std::string((std::istreambuf_iterator<char>(file_stream)),
+                                  std::istreambuf_iterator<char>()));
+    }
+  }
+
+  const double kernels_seconds =
+      options_map[kernels_seconds_option].as<double>();
+  const nlohmann::json kernels =
+      kernels_seconds > 0.0
+          ? benchmarks::benchmarkKernels(NF_DRIVER_SAMPLERATE, kernels_seconds)
+          : nlohmann::json::array();
+
+  auto registry = createPluginRegistry();
+  if (options_map.count(json_option) > 0) {
+    return benchmarkScores(scores, registry,
+                           options_map[json_seconds_option].as<double>(),
+                           kernels,
+                           options_map[json_option].as<std::string>()) == 0
+               ? 0
+               : 1;
+  }
+
+  const int blocks = options_map[blocks_option].as<int>();
+  std::cout << std::left << std::setw(40) << "score" << std::right
+            << std::setw(16) << "recursive (us)" << std::setw(16)
+            << "plan maps (us)" << std::setw(16) << "plan ports (us)"
+            << std::setw(10) << "speedup" << std::endl;
+  int failures = 0;
+  for (const auto &score : scores) {
+    auto recursive_graph = loadGraph(score.second, registry, false, false);
+    auto map_graph = loadGraph(score.second, registry, true, false);
+    auto port_graph = loadGraph(score.second, registry, true, true);
+    if (!recursive_graph || !map_graph || !port_graph) {
+      std::cout << std::left << std::setw(40) << score.first
+                << "failed to load" << std::endl;
+      failures++;
+      continue;
+    }
+    const double recursive_nanos = benchmarkTraversal(recursive_graph, blocks);
+    const double map_nanos = benchmarkTraversal(map_graph, blocks);
+    const double port_nanos = benchmarkTraversal(port_graph, blocks);
+    std::cout << std::left << std::setw(40) << score.first << std::right
+              << std::fixed << std::setprecision(2) << std::setw(16)
+              << recursive_nanos / 1000.0 << std::setw(16)
+              << map_nanos / 1000.0 << std::setw(16) << port_nanos / 1000.0
+              << std::setw(9) << recursive_nanos / port_nanos << "x"
+              << std::endl;
+  }
+
+  const double block_sizes_seconds =
+      options_map[block_sizes_seconds_option].as<double>();
+  if (block_sizes_seconds > 0.0) {
+    failures += benchmarkBlockSizes(scores, registry, block_sizes_seconds);
+  }
+  if (!kernels.empty()) {
+    printKernels(kernels);
+  }
+  const double file_seconds = options_map[file_seconds_option].as<double>();
+  if (file_seconds > 0.0) {
+    failures += benchmarkFileNodes(
+        registry, options_map[file_nodes_option].as<int>(), file_seconds);
+  }
+  if (options_map.count(first_audio_option) > 0) {
+    failures += benchmarkFirstAudio(
+        options_map[first_audio_option].as<std::vector<std::string>>());
+  }
+  if (options_map.count(disk_cache_option) > 0) {
+    failures += benchmarkDiskCache(
+        options_map[disk_cache_option].as<std::vector<std::string>>());
+  }
+  return failures == 0 ? 0 : 1;
+}
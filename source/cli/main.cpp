@@ -22,6 +22,7 @@
 #include <NFSmartPlayer/GlobalLogger.h>
 #include <NFSmartPlayer/nf_smart_player.h>
 
+#include <atomic>
 #include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
 #include <chrono>
@@ -40,6 +41,7 @@
 #endif
 
 static std::atomic<bool> alive;
+static std::atomic<bool> loaded;
 static std::mutex m;
 static std::condition_variable alive_condition;
 static NF_SMART_PLAYER_HANDLE handle = nullptr;
@@ -102,6 +104,16 @@ int main(int argc, char *argv[]) {
   static const char *driver_file_option = "driver-file";
   static const char *render_time_option = "render-time";
   static const char *interactive_option = "interactive";
+  static const char *render_threads_option = "render-threads";
+  static const char *sample_rate_option = "sample-rate";
+  static const char *block_size_option = "block-size";
+  static const char *offline_option = "offline";
+  static const char *duration_option = "duration";
+  static const char *segments_option = "segments";
+  static const char *preroll_option = "preroll";
+  static const char *crossfade_option = "crossfade";
+  static const char *verify_option = "verify";
+  static const char *disk_cache_option = "disk-cache";
   static const char *smartplayer_wave = "/nfsmartplayer.wav";
 
   {
@@ -129,7 +141,38 @@ int main(int argc, char *argv[]) {
         "driver file to render to")(
         render_time_option,
         boost::program_options::value<double>()->default_value(0.0),
-        "The time to start rendering at");
+        "The time to start rendering at")(
+        render_threads_option,
+        boost::program_options::value<int>()->default_value(
+            NF_SMART_PLAYER_RENDER_THREADS),
+        "The number of threads to render graphs with")(
+        sample_rate_option,
+        boost::program_options::value<double>()->default_value(
+            NF_SMART_PLAYER_SAMPLE_RATE),
+        "The sample rate to render at, the sound card plays at its own")(
+        block_size_option,
+        boost::program_options::value<int>()->default_value(
+            NF_SMART_PLAYER_BLOCK_SIZE),
+        "The number of frames the graphs render at a time")(
+        offline_option,
+        "render to the driver file as fast as possible instead of in realtime")(
+        duration_option,
+        boost::program_options::value<double>()->default_value(0.0),
+        "The seconds to render offline, 0 to render until the score ends")(
+        segments_option, boost::program_options::value<int>()->default_value(1),
+        "The number of segments to render offline in parallel, which needs a "
+        "duration")(
+        preroll_option,
+        boost::program_options::value<double>()->default_value(1.0),
+        "The seconds rendered before each segment to let effects settle")(
+        crossfade_option,
+        boost::program_options::value<double>()->default_value(0.01),
+        "The seconds each segment crossfades into the last over")(
+        verify_option,
+        "also render serially and report the largest sample deviation")(
+        disk_cache_option, boost::program_options::value<std::string>(),
+        "A directory to keep decoded audio in, so files played again aren't "
+        "decoded again");
     boost::program_options::store(
         boost::program_options::parse_command_line(argc, argv, desc),
         options_map);
@@ -178,6 +221,19 @@ int main(int argc, char *argv[]) {
           options_map[driver_type_option].as<std::string>().c_str());
     }
 
+    // Offline renders write the driver file themselves, so keep the driver
+    // away from it
+    const bool offline = options_map.count(offline_option) > 0;
+    std::string driver_file = options_map[driver_file_option].as<std::string>();
+    if (offline) {
+      driver_type = NF_SMART_PLAYER_DRIVER_TYPE_FILE;
+      driver_file = "/dev/null";
+    }
+
+    NF_SMART_PLAYER_SETTINGS settings = NF_SMART_PLAYER_DEFAULT_SETTINGS;
+    settings._render_threads = options_map[render_threads_option].as<int>();
+    settings._sample_rate = options_map[sample_rate_option].as<double>();
+    settings._block_size = options_map[block_size_option].as<int>();
     handle = smartplayer_open(
         [](void *context, const char *plugin_namespace,
            const char *variable_identifier) -> const char * {
@@ -185,10 +241,18 @@ int main(int argc, char *argv[]) {
               (std::map<std::string, std::string> *)context;
           return (*resolved_variable_map)[variable_identifier].c_str();
         },
-        &resolved_variable_map, NF_SMART_PLAYER_DEFAULT_SETTINGS, driver_type,
-        options_map[driver_file_option].as<std::string>().c_str());
+        &resolved_variable_map, settings, driver_type, driver_file.c_str());
+    if (options_map.count(disk_cache_option) > 0 &&
+        !smartplayer_set_file_disk_cache(
+            handle, options_map[disk_cache_option].as<std::string>().c_str(),
+            0)) {
+      std::cerr << "Can't keep decoded audio in "
+                << options_map[disk_cache_option].as<std::string>()
+                << std::endl;
+    }
 
     alive = true;
+    loaded = false;
     smartplayer_set_message_callback(
         handle,
         [](void *context, const char *message_identifier,
@@ -203,6 +267,10 @@ int main(int argc, char *argv[]) {
               alive = false;
             }
             alive_condition.notify_one();
+          } else if (strcmp(message_identifier,
+                            NF_SMART_PLAYER_MESSAGE_IDENTIFIER_XRUN) == 0) {
+            std::cerr << "Render glitch: " << (const char *)payload
+                      << std::endl;
           }
         });
     std::cout << "Loading JSON" << std::endl;
@@ -218,11 +286,48 @@ int main(int argc, char *argv[]) {
             NF_INFO("Initialised playback");
             smartplayer_set_render_time(
                 handle, options_map[render_time_option].as<double>());
-            smartplayer_set_playing(handle, true);
+            if (options_map.count(offline_option) == 0) {
+              smartplayer_set_playing(handle, true);
+            }
+            {
+              std::lock_guard<std::mutex> lg(m);
+              loaded = true;
+            }
+            alive_condition.notify_one();
           }
         });
 
-    if (options_map.count(interactive_option) > 0) {
+    if (offline) {
+      {
+        std::unique_lock<std::mutex> ul(m);
+        alive_condition.wait(ul, []() { return loaded.load(); });
+      }
+      const std::string output_file =
+          options_map[driver_file_option].as<std::string>();
+      const double duration = options_map[duration_option].as<double>();
+      const bool verify = options_map.count(verify_option) > 0;
+      const int segments = options_map[segments_option].as<int>();
+      NF_SMART_PLAYER_OFFLINE_RENDER offline_render =
+          segments > 1 || verify
+              ? smartplayer_render_offline_parallel(
+                    handle, output_file.c_str(), duration, segments,
+                    options_map[preroll_option].as<double>(),
+                    options_map[crossfade_option].as<double>(), verify)
+              : smartplayer_render_offline(handle, output_file.c_str(),
+                                           duration);
+      if (!offline_render._rendered) {
+        smartplayer_close(handle);
+        return 1;
+      }
+      std::cout << "Rendered " << offline_render._render_time << "s in "
+                << offline_render._elapsed_time << "s ("
+                << offline_render._realtime_factor << "x realtime)"
+                << std::endl;
+      if (verify) {
+        std::cout << "Maximum deviation from a serial render: "
+                  << offline_render._maximum_deviation << std::endl;
+      }
+    } else if (options_map.count(interactive_option) > 0) {
       std::thread t1 = std::thread(interactive_thread);
       while (alive) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -23,11 +23,18 @@
 #include <NFSmartPlayer/GlobalLogger.h>
 #include <NFSmartPlayer/nf_smart_player.h>
 
+#include <algorithm>
 #include <mutex>
 
 using nativeformat::logger::Logger;
 using nativeformat::logger::LogInfo;
 
+static NF_SMART_PLAYER_RENDER_STATS renderStatsStruct(
+    const nativeformat::smartplayer::RenderStats &render_stats) {
+  return {render_stats._blocks, render_stats._mean_time,
+          render_stats._p99_time, render_stats._max_time, render_stats._load};
+}
+
 typedef struct NF_SMART_PLAYER_HANDLE_STRUCT {
   std::shared_ptr<nativeformat::smartplayer::Client> _smart_player_client;
   void *_context;
@@ -57,7 +64,8 @@ typedef struct NF_SMART_PLAYER_HANDLE_STRUCT {
             (nativeformat::smartplayer::DriverType)driver_type,
             output_destination, settings._osc_read_port,
             settings._osc_write_port, settings._osc_address,
-            settings._pump_manually)),
+            settings._localhost_port, settings._render_threads,
+            settings._sample_rate, settings._block_size)),
         _context(context) {}
 } NF_SMART_PLAYER_HANDLE_STRUCT;
 
@@ -89,15 +97,25 @@ const char *NF_SMART_PLAYER_SENDER_IDENTIFIER =
     nativeformat::smartplayer::PlayerSenderIdentifier;
 const char *NF_SMART_PLAYER_MESSAGE_IDENTIFIER_END =
     nativeformat::smartplayer::PlayerMessageIdentifierEnd;
+const char *NF_SMART_PLAYER_MESSAGE_IDENTIFIER_XRUN =
+    nativeformat::smartplayer::PlayerMessageIdentifierXrun;
 const int NF_SMART_PLAYER_OSC_READ_PORT =
     nativeformat::smartplayer::NFSmartPlayerOscReadPort;
 const int NF_SMART_PLAYER_OSC_WRITE_PORT =
     nativeformat::smartplayer::NFSmartPlayerOscWritePort;
 const int NF_SMART_PLAYER_LOCALHOST_PORT =
     nativeformat::smartplayer::NFSmartPlayerLocalhostPort;
+const int NF_SMART_PLAYER_RENDER_THREADS =
+    nativeformat::smartplayer::NFSmartPlayerRenderThreads;
+const double NF_SMART_PLAYER_SAMPLE_RATE =
+    nativeformat::smartplayer::NFSmartPlayerSampleRate;
+const int NF_SMART_PLAYER_BLOCK_SIZE =
+    nativeformat::smartplayer::NFSmartPlayerBlockSize;
 const NF_SMART_PLAYER_SETTINGS NF_SMART_PLAYER_DEFAULT_SETTINGS = {
     NF_SMART_PLAYER_OSC_READ_PORT, NF_SMART_PLAYER_OSC_WRITE_PORT,
-    NF_SMART_PLAYER_OSC_ADDRESS, NF_SMART_PLAYER_LOCALHOST_PORT, false};
+    NF_SMART_PLAYER_OSC_ADDRESS,   NF_SMART_PLAYER_LOCALHOST_PORT,
+    false,                         NF_SMART_PLAYER_RENDER_THREADS,
+    NF_SMART_PLAYER_SAMPLE_RATE,   NF_SMART_PLAYER_BLOCK_SIZE};
 
 NF_SMART_PLAYER_HANDLE smartplayer_open(
     NF_SMART_PLAYER_RESOLVE_CALLBACK resolve_callback, void *context,
@@ -329,12 +347,142 @@ int smartplayer_is_loaded(NF_SMART_PLAYER_HANDLE handle) {
   return player_handle->_smart_player_client->isLoaded();
 }
 
+NF_SMART_PLAYER_OFFLINE_RENDER smartplayer_render_offline(
+    NF_SMART_PLAYER_HANDLE handle, const char *output_path, double duration) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  nativeformat::smartplayer::OfflineRender offline_render =
+      player_handle->_smart_player_client->renderOffline(output_path,
+                                                         duration);
+  if (!offline_render._rendered) {
+    NF_ERROR("Offline render failed: " + offline_render._error);
+  }
+  return {offline_render._rendered, offline_render._render_time,
+          offline_render._elapsed_time, offline_render._realtime_factor,
+          offline_render._maximum_deviation};
+}
+
+NF_SMART_PLAYER_OFFLINE_RENDER smartplayer_render_offline_parallel(
+    NF_SMART_PLAYER_HANDLE handle, const char *output_path, double duration,
+    int segments, double preroll, double crossfade, int verify) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  nativeformat::smartplayer::OfflineRender offline_render =
+      player_handle->_smart_player_client->renderOfflineParallel(
+          output_path, duration, {segments, preroll, crossfade, verify != 0});
+  if (!offline_render._rendered) {
+    NF_ERROR("Offline render failed: " + offline_render._error);
+  }
+  return {offline_render._rendered, offline_render._render_time,
+          offline_render._elapsed_time, offline_render._realtime_factor,
+          offline_render._maximum_deviation};
+}
+
 void *smartplayer_get_context(NF_SMART_PLAYER_HANDLE handle) {
   NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
       (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
   return player_handle->_context;
 }
 
+void smartplayer_set_profiling(NF_SMART_PLAYER_HANDLE handle, int profiling) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  player_handle->_smart_player_client->setProfiling(profiling != 0);
+}
+
+int smartplayer_is_profiling(NF_SMART_PLAYER_HANDLE handle) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  return player_handle->_smart_player_client->profiling();
+}
+
+void smartplayer_set_crossfade_blocks(NF_SMART_PLAYER_HANDLE handle,
+                                      int crossfade_blocks) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  player_handle->_smart_player_client->setCrossfadeBlocks(crossfade_blocks);
+}
+
+int smartplayer_get_crossfade_blocks(NF_SMART_PLAYER_HANDLE handle) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  return player_handle->_smart_player_client->crossfadeBlocks();
+}
+
+NF_SMART_PLAYER_RENDER_STATS smartplayer_render_stats(
+    NF_SMART_PLAYER_HANDLE handle) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  return renderStatsStruct(player_handle->_smart_player_client->renderStats());
+}
+
+NF_SMART_PLAYER_CACHE_STATS smartplayer_file_cache_stats(
+    NF_SMART_PLAYER_HANDLE handle) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  auto cache_stats = player_handle->_smart_player_client->fileCacheStats();
+  return {cache_stats._hits,
+          cache_stats._shared,
+          cache_stats._misses,
+          cache_stats._hit_rate,
+          static_cast<long>(cache_stats._resident_bytes),
+          static_cast<long>(cache_stats._budget_bytes)};
+}
+
+NF_SMART_PLAYER_DECODE_STATS smartplayer_file_decode_stats(
+    NF_SMART_PLAYER_HANDLE handle) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  auto decode_stats = player_handle->_smart_player_client->fileDecodeStats();
+  return {static_cast<long>(decode_stats._queued),
+          static_cast<long>(decode_stats._active), decode_stats._completed,
+          decode_stats._cancelled, decode_stats._missed};
+}
+
+void smartplayer_set_file_prefetch_budget(NF_SMART_PLAYER_HANDLE handle,
+                                          long budget_bytes) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  player_handle->_smart_player_client->setFilePrefetchBudget(
+      std::max(budget_bytes, 0l));
+}
+
+NF_SMART_PLAYER_PREFETCH_STATS smartplayer_file_prefetch_stats(
+    NF_SMART_PLAYER_HANDLE handle) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  auto prefetch_stats =
+      player_handle->_smart_player_client->filePrefetchStats();
+  return {static_cast<long>(prefetch_stats._budget_bytes),
+          static_cast<long>(prefetch_stats._planned_bytes),
+          static_cast<long>(prefetch_stats._decoded_files),
+          static_cast<long>(prefetch_stats._open_files),
+          prefetch_stats._evictions, prefetch_stats._deferrals};
+}
+
+int smartplayer_set_file_disk_cache(NF_SMART_PLAYER_HANDLE handle,
+                                    const char *directory, long budget_bytes) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  return player_handle->_smart_player_client->setFileDiskCache(
+      directory ? directory : "", std::max(budget_bytes, 0l));
+}
+
+NF_SMART_PLAYER_DISK_CACHE_STATS smartplayer_file_disk_cache_stats(
+    NF_SMART_PLAYER_HANDLE handle) {
+  NF_SMART_PLAYER_HANDLE_STRUCT *player_handle =
+      (NF_SMART_PLAYER_HANDLE_STRUCT *)handle;
+  auto disk_cache_stats =
+      player_handle->_smart_player_client->fileDiskCacheStats();
+  return {disk_cache_stats._hits,
+          disk_cache_stats._misses,
+          disk_cache_stats._writes,
+          disk_cache_stats._evictions,
+          disk_cache_stats._corrupt,
+          static_cast<long>(disk_cache_stats._resident_bytes),
+          static_cast<long>(disk_cache_stats._budget_bytes)};
+}
+
 NF_SMART_PLAYER_GRAPH_HANDLE smartplayer_create_graph(
     const char *json, void *context,
     NF_SMART_PLAYER_LOAD_CALLBACK load_callback) {
@@ -449,6 +597,13 @@ int smartplayer_graph_loaded(NF_SMART_PLAYER_GRAPH_HANDLE graph) {
   return handle->_graph->loaded();
 }
 
+NF_SMART_PLAYER_RENDER_STATS smartplayer_graph_render_stats(
+    NF_SMART_PLAYER_GRAPH_HANDLE graph) {
+  NF_SMART_PLAYER_GRAPH_HANDLE_STRUCT *handle =
+      (NF_SMART_PLAYER_GRAPH_HANDLE_STRUCT *)graph;
+  return renderStatsStruct(handle->_graph->renderStats());
+}
+
 NF_SMART_PLAYER_EDGE_HANDLE smartplayer_create_edge(const char *source,
                                                     const char *target) {
   nfgrapher::Edge ge;
@@ -577,6 +732,13 @@ NF_SMART_PLAYER_PARAM_HANDLE smartplayer_node_get_param_at_index(
       nativeformat::param::Param>(player_param);
 }
 
+NF_SMART_PLAYER_RENDER_STATS smartplayer_node_render_stats(
+    NF_SMART_PLAYER_NODE_HANDLE node_handle) {
+  std::shared_ptr<nativeformat::smartplayer::Node> *player_node =
+      (std::shared_ptr<nativeformat::smartplayer::Node> *)node_handle;
+  return renderStatsStruct((*player_node)->renderStats());
+}
+
 void smartplayer_node_close(NF_SMART_PLAYER_NODE_HANDLE node_handle) {
   std::shared_ptr<nativeformat::smartplayer::Node> *player_node =
       (std::shared_ptr<nativeformat::smartplayer::Node> *)node_handle;
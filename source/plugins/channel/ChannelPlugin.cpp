@@ -34,12 +34,15 @@ ChannelPlugin::ChannelPlugin(
 
 ChannelPlugin::~ChannelPlugin() {}
 
-void ChannelPlugin::feed(
-    std::map<std::string, std::shared_ptr<Content>> &content, long sample_index,
-    long graph_sample_index, nfgrapher::LoadingPolicy loading_policy) {
-  _child_plugin->feed(content, sample_index, graph_sample_index,
-                      loading_policy);
-  Content &audio_content = *content[AudioContentTypeKey];
+void ChannelPlugin::feedPorts(PortContent &content, long sample_index,
+                              long graph_sample_index,
+                              nfgrapher::LoadingPolicy loading_policy) {
+  _child_plugin->feedPorts(content, sample_index, graph_sample_index,
+                           loading_policy);
+  Content &audio_content = *content[AudioPortId];
+  if (audio_content.silent()) {
+    return;
+  }
   float *samples = (float *)audio_content.payload();
   size_t channels = audio_content.channels();
   size_t sample_count = audio_content.items();
@@ -69,6 +72,8 @@ Plugin::PluginType ChannelPlugin::type() const {
   return Plugin::PluginTypeConsumer;
 }
 
+bool ChannelPlugin::timeAligned() const { return true; }
+
 void ChannelPlugin::load(LOAD_CALLBACK callback) {
   _child_plugin->load(callback);
 }
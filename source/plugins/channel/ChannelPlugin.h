@@ -33,7 +33,7 @@ extern const std::string ChannelPluginIdentifier;
 /**
  * A plugin that can isolate different channels
  */
-class ChannelPlugin : public Plugin {
+class ChannelPlugin : public PortPlugin {
  public:
   ChannelPlugin(const nfgrapher::Node &grapher_node, int channels,
                 double samplerate,
@@ -41,14 +41,15 @@ class ChannelPlugin : public Plugin {
   virtual ~ChannelPlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
 
   std::string name() override;
   bool finished(long sample_index, long sample_index_end) override;
   void notifyFinished(long sample_index, long graph_sample_index) override;
   PluginType type() const override;
+  bool timeAligned() const override;
   void load(LOAD_CALLBACK callback) override;
   bool loaded() const override;
   void run(long sample_index, const NodeTimes &node_times,
@@ -39,6 +39,10 @@ std::shared_ptr<Plugin> PluginFactory::createPlugin(
                                          child_plugin);
 }
 
+bool PluginFactory::timeAligned(const nfgrapher::Node &grapher_node) const {
+  return true;
+}
+
 std::vector<std::string> PluginFactory::identifiers() const {
   return {ChannelPluginIdentifier};
 }
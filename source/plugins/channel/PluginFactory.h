@@ -39,6 +39,7 @@ class PluginFactory : public Factory {
       const NF_PLUGIN_RESOLVE_CALLBACK &resolve_callback, int channels,
       double samplerate, const std::shared_ptr<plugin::Plugin> &child_plugin,
       const std::string &session_id) override;
+  bool timeAligned(const nfgrapher::Node &grapher_node) const override;
   std::vector<std::string> identifiers() const override;
 };
 
@@ -118,19 +118,17 @@ CompanderPlugin::CompanderPlugin(
 
 CompanderPlugin::~CompanderPlugin() {}
 
-void CompanderPlugin::feed(
-    std::map<std::string, std::shared_ptr<Content>> &content, long sample_index,
-    long graph_sample_index, nfgrapher::LoadingPolicy loading_policy) {
-  _child_plugin->feed(content, sample_index, graph_sample_index,
-                      loading_policy);
-  Content &audio_content = *content[AudioContentTypeKey];
+void CompanderPlugin::feedPorts(PortContent &content, long sample_index,
+                                long graph_sample_index,
+                                nfgrapher::LoadingPolicy loading_policy) {
+  _child_plugin->feedPorts(content, sample_index, graph_sample_index,
+                           loading_policy);
+  Content &audio_content = *content[AudioPortId];
   size_t sample_count = audio_content.items();
-  std::string sidechain_key =
-      content.find(SidechainContentTypeKey) == content.end()
-          ? AudioContentTypeKey
-          : SidechainContentTypeKey;
+  PortId sidechain_port =
+      content.has(SidechainPortId) ? SidechainPortId : AudioPortId;
 
-  Content &sidechain_content = *content[sidechain_key];
+  Content &sidechain_content = *content[sidechain_port];
   size_t sidechain_sample_count = sidechain_content.items();
 
   // Output zeros if sidechain signal starts before audio
@@ -149,7 +147,7 @@ void CompanderPlugin::feed(
     bands = _splitter->bands();
 
     split_bands(sample_count, audio_content, _content);
-    if (AudioContentTypeKey != sidechain_key)
+    if (sidechain_port != AudioPortId)
       split_bands(sidechain_sample_count, sidechain_content,
                   _sidechain_content);
   }
@@ -163,7 +161,7 @@ void CompanderPlugin::feed(
     } else {
       samples = static_cast<sample_t *>(_content.at(band_index)->payload());
       sidechain_samples = static_cast<sample_t *>(
-          (AudioContentTypeKey == sidechain_key ? _content : _sidechain_content)
+          (sidechain_port == AudioPortId ? _content : _sidechain_content)
               .at(band_index)
               ->payload());
     }
@@ -203,6 +201,8 @@ Plugin::PluginType CompanderPlugin::type() const {
   return Plugin::PluginTypeConsumer;
 }
 
+bool CompanderPlugin::timeAligned() const { return true; }
+
 void CompanderPlugin::load(LOAD_CALLBACK callback) {
   _child_plugin->load(callback);
 }
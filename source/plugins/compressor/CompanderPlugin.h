@@ -35,7 +35,7 @@ extern const std::string CompanderPluginIdentifier;
 /**
  * A plugin that can perform dynamic range compression
  */
-class CompanderPlugin : public Plugin {
+class CompanderPlugin : public PortPlugin {
   using NodeInfo = nfgrapher::contract::CompanderNodeInfo;
   using DetectionMode = typename NodeInfo::DetectionMode;
   using Compander = Drc<NodeInfo>;
@@ -46,14 +46,15 @@ class CompanderPlugin : public Plugin {
   virtual ~CompanderPlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
 
   std::string name() override;
   bool finished(long sample_index, long sample_index_end) override;
   void notifyFinished(long sample_index, long graph_sample_index) override;
   PluginType type() const override;
+  bool timeAligned() const override;
   void load(LOAD_CALLBACK callback) override;
   bool loaded() const override;
   void run(long sample_index, const NodeTimes &node_times,
@@ -28,6 +28,8 @@ namespace compressor {
 
 const std::string CompressorPluginIdentifier(
     "com.nativeformat.plugin.compressor.compressor");
+// How many release times of silence it takes for the level detector to settle
+static const double CompressorPluginSilentReleaseTimes = 10.0;
 
 constexpr char CompressorPlugin::SidechainContentTypeKey[];
 
@@ -50,7 +52,8 @@ CompressorPlugin::CompressorPlugin(
                              "_ratio_db"),
       }),
       _splitter(nullptr),
-      _payload_size(0) {
+      _payload_size(0),
+      _silent_frames(0) {
   nfgrapher::param::addCommands(_attack, grapher_node._attack);
   nfgrapher::param::addCommands(_release, grapher_node._release);
   nfgrapher::param::addCommands(_compressor_params._threshold_db,
@@ -94,19 +97,17 @@ CompressorPlugin::CompressorPlugin(
 
 CompressorPlugin::~CompressorPlugin() {}
 
-void CompressorPlugin::feed(
-    std::map<std::string, std::shared_ptr<Content>> &content, long sample_index,
-    long graph_sample_index, nfgrapher::LoadingPolicy loading_policy) {
-  _child_plugin->feed(content, sample_index, graph_sample_index,
-                      loading_policy);
-  Content &audio_content = *content[AudioContentTypeKey];
+void CompressorPlugin::feedPorts(PortContent &content, long sample_index,
+                                 long graph_sample_index,
+                                 nfgrapher::LoadingPolicy loading_policy) {
+  _child_plugin->feedPorts(content, sample_index, graph_sample_index,
+                           loading_policy);
+  Content &audio_content = *content[AudioPortId];
   size_t sample_count = audio_content.items();
-  std::string sidechain_key =
-      content.find(SidechainContentTypeKey) == content.end()
-          ? AudioContentTypeKey
-          : SidechainContentTypeKey;
+  PortId sidechain_port =
+      content.has(SidechainPortId) ? SidechainPortId : AudioPortId;
 
-  Content &sidechain_content = *content[sidechain_key];
+  Content &sidechain_content = *content[sidechain_port];
   size_t sidechain_sample_count = sidechain_content.items();
 
   // Output zeros if sidechain signal starts before audio
@@ -120,12 +121,25 @@ void CompressorPlugin::feed(
     return;
   }
 
+  // Silence needs no compressing once the band filters have rung out and the
+  // level detector has had long enough to release
+  const bool silent = audio_content.silent() && sidechain_content.silent();
+  if (!silent) {
+    _silent_frames = 0;
+  } else if (_tail.decayed() &&
+             _silent_frames / _samplerate >
+                 CompressorPluginSilentReleaseTimes *
+                     _release->valueForTime(sample_index /
+                                            (_samplerate * _channels))) {
+    return;
+  }
+
   size_t bands = 1;
   if (_splitter) {
     bands = _splitter->bands();
 
     split_bands(sample_count, audio_content, _content);
-    if (AudioContentTypeKey != sidechain_key)
+    if (sidechain_port != AudioPortId)
       split_bands(sidechain_sample_count, sidechain_content,
                   _sidechain_content);
   }
@@ -139,7 +153,7 @@ void CompressorPlugin::feed(
     } else {
       samples = static_cast<sample_t *>(_content.at(band_index)->payload());
       sidechain_samples = static_cast<sample_t *>(
-          (AudioContentTypeKey == sidechain_key ? _content : _sidechain_content)
+          (sidechain_port == AudioPortId ? _content : _sidechain_content)
               .at(band_index)
               ->payload());
     }
@@ -162,6 +176,10 @@ void CompressorPlugin::feed(
     std::copy_n(_content[bands - 1]->payload(), _payload_size,
                 audio_content.payload());
   }
+  if (silent) {
+    _silent_frames += sample_count / _channels;
+  }
+  _tail.update(silent, audio_content.constPayload(), sample_count);
 }
 
 std::string CompressorPlugin::name() { return CompressorPluginIdentifier; }
@@ -179,6 +197,8 @@ Plugin::PluginType CompressorPlugin::type() const {
   return Plugin::PluginTypeConsumer;
 }
 
+bool CompressorPlugin::timeAligned() const { return true; }
+
 void CompressorPlugin::load(LOAD_CALLBACK callback) {
   _child_plugin->load(callback);
 }
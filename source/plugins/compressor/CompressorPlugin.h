@@ -22,6 +22,7 @@
 
 #include <BandSplitter.h>
 #include <NFSmartPlayer/Plugin.h>
+#include <TailDecay.h>
 
 #include "Drc.h"
 #include "types.h"
@@ -35,7 +36,7 @@ extern const std::string CompressorPluginIdentifier;
 /**
  * A plugin that can perform dynamic range compression
  */
-class CompressorPlugin : public Plugin {
+class CompressorPlugin : public PortPlugin {
   using NodeInfo = nfgrapher::contract::CompressorNodeInfo;
   using DetectionMode = typename NodeInfo::DetectionMode;
   using Compressor = Drc<NodeInfo>;
@@ -47,14 +48,15 @@ class CompressorPlugin : public Plugin {
   virtual ~CompressorPlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
 
   std::string name() override;
   bool finished(long sample_index, long sample_index_end) override;
   void notifyFinished(long sample_index, long graph_sample_index) override;
   PluginType type() const override;
+  bool timeAligned() const override;
   void load(LOAD_CALLBACK callback) override;
   bool loaded() const override;
   void run(long sample_index, const NodeTimes &node_times,
@@ -77,6 +79,9 @@ class CompressorPlugin : public Plugin {
   std::vector<Compressor> _compressors;
   size_t _payload_size;
 
+  util::TailDecay _tail;
+  long _silent_frames;
+
   // helper functions to perform filtering and compression
   void split_bands(
       size_t sample_count, Content &content,
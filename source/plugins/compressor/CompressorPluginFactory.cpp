@@ -65,6 +65,18 @@ std::shared_ptr<Plugin> CompressorPluginFactory::createPlugin(
   return std::shared_ptr<Plugin>(nullptr);
 }
 
+int CompressorPluginFactory::channels(const nfgrapher::Node &grapher_node,
+                                      int input_channels, int channels) const {
+  // The detectors and band splitters run as many channels as they are created
+  // with, a sidechain wider than the audio widens the node
+  return input_channels;
+}
+
+bool CompressorPluginFactory::timeAligned(
+    const nfgrapher::Node &grapher_node) const {
+  return true;
+}
+
 std::vector<std::string> CompressorPluginFactory::identifiers() const {
   return {nfgrapher::contract::CompressorNodeInfo::kind(),
           nfgrapher::contract::ExpanderNodeInfo::kind(),
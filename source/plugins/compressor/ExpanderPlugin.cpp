@@ -94,19 +94,17 @@ ExpanderPlugin::ExpanderPlugin(
 
 ExpanderPlugin::~ExpanderPlugin() {}
 
-void ExpanderPlugin::feed(
-    std::map<std::string, std::shared_ptr<Content>> &content, long sample_index,
-    long graph_sample_index, nfgrapher::LoadingPolicy loading_policy) {
-  _child_plugin->feed(content, sample_index, graph_sample_index,
-                      loading_policy);
-  Content &audio_content = *content[AudioContentTypeKey];
+void ExpanderPlugin::feedPorts(PortContent &content, long sample_index,
+                               long graph_sample_index,
+                               nfgrapher::LoadingPolicy loading_policy) {
+  _child_plugin->feedPorts(content, sample_index, graph_sample_index,
+                           loading_policy);
+  Content &audio_content = *content[AudioPortId];
   size_t sample_count = audio_content.items();
-  std::string sidechain_key =
-      content.find(SidechainContentTypeKey) == content.end()
-          ? AudioContentTypeKey
-          : SidechainContentTypeKey;
+  PortId sidechain_port =
+      content.has(SidechainPortId) ? SidechainPortId : AudioPortId;
 
-  Content &sidechain_content = *content[sidechain_key];
+  Content &sidechain_content = *content[sidechain_port];
   size_t sidechain_sample_count = sidechain_content.items();
 
   // Output zeros if sidechain signal starts before audio
@@ -125,7 +123,7 @@ void ExpanderPlugin::feed(
     bands = _splitter->bands();
 
     split_bands(sample_count, audio_content, _content);
-    if (AudioContentTypeKey != sidechain_key)
+    if (sidechain_port != AudioPortId)
       split_bands(sidechain_sample_count, sidechain_content,
                   _sidechain_content);
   }
@@ -139,7 +137,7 @@ void ExpanderPlugin::feed(
     } else {
       samples = static_cast<sample_t *>(_content.at(band_index)->payload());
       sidechain_samples = static_cast<sample_t *>(
-          (AudioContentTypeKey == sidechain_key ? _content : _sidechain_content)
+          (sidechain_port == AudioPortId ? _content : _sidechain_content)
               .at(band_index)
               ->payload());
     }
@@ -179,6 +177,8 @@ Plugin::PluginType ExpanderPlugin::type() const {
   return Plugin::PluginTypeConsumer;
 }
 
+bool ExpanderPlugin::timeAligned() const { return true; }
+
 void ExpanderPlugin::load(LOAD_CALLBACK callback) {
   _child_plugin->load(callback);
 }
@@ -47,10 +47,10 @@ EQPlugin::EQPlugin(const nfgrapher::contract::Eq3bandNodeInfo &eq_node,
   nfgrapher::param::addCommands(_mid_gain, eq_node._mid_gain);
   nfgrapher::param::addCommands(_high_gain, eq_node._high_gain);
 
-  _old_freqs = {_low_cutoff->valueForTime(0), _mid_freq->valueForTime(0),
-                _high_cutoff->valueForTime(0)};
-  _old_gains = {_low_gain->valueForTime(0), _mid_gain->valueForTime(0),
-                _low_gain->valueForTime(0)};
+  _old_freqs = {{_low_cutoff->valueForTime(0), _mid_freq->valueForTime(0),
+                 _high_cutoff->valueForTime(0)}};
+  _old_gains = {{_low_gain->valueForTime(0), _mid_gain->valueForTime(0),
+                 _low_gain->valueForTime(0)}};
 
   x_ = peqbank_new(samplerate, channels, 512);
 
@@ -72,12 +72,17 @@ EQPlugin::EQPlugin(const nfgrapher::contract::Eq3bandNodeInfo &eq_node,
 
 EQPlugin::~EQPlugin() { peqbank_freemem(x_); }
 
-void EQPlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
-                    long sample_index, long graph_sample_index,
-                    nfgrapher::LoadingPolicy loading_policy) {
-  _child_plugin->feed(content, sample_index, graph_sample_index,
-                      loading_policy);
-  Content &audio_content = *content[AudioContentTypeKey];
+void EQPlugin::feedPorts(PortContent &content, long sample_index,
+                         long graph_sample_index,
+                         nfgrapher::LoadingPolicy loading_policy) {
+  _child_plugin->feedPorts(content, sample_index, graph_sample_index,
+                           loading_policy);
+  Content &audio_content = *content[AudioPortId];
+  // Once the filters have rung out there is nothing to do with silence
+  const bool silent = audio_content.silent();
+  if (silent && _tail.decayed()) {
+    return;
+  }
   size_t sample_count = audio_content.items();
   size_t channels = audio_content.channels();
   size_t frame_count = sample_count / channels;
@@ -97,8 +102,8 @@ void EQPlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
   float high_cutoff = _high_cutoff->smoothedValueForTimeRange(time, end_time);
 
   // if the frequencies or gains have changed, recompute filter coefficients
-  std::vector<float> new_freqs{low_cutoff, mid_freq, high_cutoff};
-  std::vector<float> new_gains{low_gain, mid_gain, high_gain};
+  const std::array<float, 3> new_freqs = {{low_cutoff, mid_freq, high_cutoff}};
+  const std::array<float, 3> new_gains = {{low_gain, mid_gain, high_gain}};
 
   // for now, assume filters[0] is a shelf and filters[1] is a peq
   if (_old_freqs != new_freqs || _old_gains != new_gains) {
@@ -147,6 +152,7 @@ void EQPlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
   }
 
   peqbank_callback_float(x_, samples, samples);
+  _tail.update(silent, samples, sample_count);
 }
 
 std::string EQPlugin::name() {
@@ -196,6 +202,8 @@ std::vector<float> EQPlugin::get_freqs(double time) {
                             _high_cutoff->valueForTime(time)};
 }
 
+bool EQPlugin::timeAligned() const { return true; }
+
 std::vector<float> EQPlugin::get_gains(double time) {
   return std::vector<float>{_low_gain->valueForTime(time),
                             _mid_gain->valueForTime(time),
@@ -21,7 +21,9 @@
 #pragma once
 
 #include <NFSmartPlayer/Plugin.h>
+#include <TailDecay.h>
 
+#include <array>
 #include <mutex>
 
 extern "C" {
@@ -35,7 +37,7 @@ namespace eq {
 /**
  * A plugin that can control the amount of gain on an audio signal
  */
-class EQPlugin : public Plugin {
+class EQPlugin : public PortPlugin {
  public:
   EQPlugin(const nfgrapher::contract::Eq3bandNodeInfo &eq_node, int channels,
            double samplerate,
@@ -43,9 +45,9 @@ class EQPlugin : public Plugin {
   virtual ~EQPlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
 
   std::string name() override;
   std::vector<std::string> paramNames() override;
@@ -53,6 +55,7 @@ class EQPlugin : public Plugin {
   bool finished(long sample_index, long sample_index_end) override;
   void notifyFinished(long sample_index, long graph_sample_index) override;
   PluginType type() const override;
+  bool timeAligned() const override;
   void load(LOAD_CALLBACK callback) override;
   bool loaded() const override;
   void run(long sample_index, const NodeTimes &node_times,
@@ -77,8 +80,10 @@ class EQPlugin : public Plugin {
   std::shared_ptr<param::Param> _mid_gain;
   std::shared_ptr<param::Param> _high_gain;
 
-  std::vector<float> _old_freqs;
-  std::vector<float> _old_gains;
+  std::array<float, 3> _old_freqs;
+  std::array<float, 3> _old_gains;
+
+  util::TailDecay _tail;
 };
 
 }  // namespace eq
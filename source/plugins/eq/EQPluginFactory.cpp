@@ -48,6 +48,16 @@ std::shared_ptr<Plugin> EQPluginFactory::createPlugin(
   return nullptr;
 }
 
+int EQPluginFactory::channels(const nfgrapher::Node &grapher_node,
+                              int input_channels, int channels) const {
+  // The filters run as many channels as they are created with
+  return input_channels;
+}
+
+bool EQPluginFactory::timeAligned(const nfgrapher::Node &grapher_node) const {
+  return true;
+}
+
 std::vector<std::string> EQPluginFactory::identifiers() const {
   return {nfgrapher::contract::Eq3bandNodeInfo::kind(),
           nfgrapher::contract::FilterNodeInfo::kind()};
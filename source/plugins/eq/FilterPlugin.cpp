@@ -44,12 +44,17 @@ FilterPlugin::FilterPlugin(const nfgrapher::contract::FilterNodeInfo &node,
 
 FilterPlugin::~FilterPlugin() {}
 
-void FilterPlugin::feed(
-    std::map<std::string, std::shared_ptr<Content>> &content, long sample_index,
-    long graph_sample_index, nfgrapher::LoadingPolicy loading_policy) {
-  _child_plugin->feed(content, sample_index, graph_sample_index,
-                      loading_policy);
-  Content &audio_content = *content[AudioContentTypeKey];
+void FilterPlugin::feedPorts(PortContent &content, long sample_index,
+                             long graph_sample_index,
+                             nfgrapher::LoadingPolicy loading_policy) {
+  _child_plugin->feedPorts(content, sample_index, graph_sample_index,
+                           loading_policy);
+  Content &audio_content = *content[AudioPortId];
+  // Once the filter has rung out there is nothing to do with silence
+  const bool silent = audio_content.silent();
+  if (silent && _tail.decayed()) {
+    return;
+  }
   size_t sample_count = audio_content.items();
   size_t channels = audio_content.channels();
   size_t frame_count = sample_count / channels;
@@ -72,6 +77,7 @@ void FilterPlugin::feed(
 
   // perform filtering
   _filter.filter(samples, frame_count);
+  _tail.update(silent, samples, sample_count);
 }
 
 std::string FilterPlugin::name() {
@@ -107,6 +113,8 @@ void FilterPlugin::load(LOAD_CALLBACK callback) {
   _child_plugin->load(callback);
 }
 
+bool FilterPlugin::timeAligned() const { return true; }
+
 bool FilterPlugin::loaded() const { return _child_plugin->loaded(); }
 
 void FilterPlugin::run(long sample_index, const NodeTimes &node_times,
@@ -22,6 +22,7 @@
 
 #include <ButterFilter.h>
 #include <NFSmartPlayer/Plugin.h>
+#include <TailDecay.h>
 
 #include <mutex>
 
@@ -29,7 +30,7 @@ namespace nativeformat {
 namespace plugin {
 namespace eq {
 
-class FilterPlugin : public Plugin {
+class FilterPlugin : public PortPlugin {
  public:
   FilterPlugin(const nfgrapher::contract::FilterNodeInfo &node, int channels,
                double samplerate,
@@ -37,9 +38,9 @@ class FilterPlugin : public Plugin {
   virtual ~FilterPlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
 
   std::string name() override;
   std::vector<std::string> paramNames() override;
@@ -47,6 +48,7 @@ class FilterPlugin : public Plugin {
   bool finished(long sample_index, long sample_index_end) override;
   void notifyFinished(long sample_index, long graph_sample_index) override;
   PluginType type() const override;
+  bool timeAligned() const override;
   void load(LOAD_CALLBACK callback) override;
   bool loaded() const override;
   void run(long sample_index, const NodeTimes &node_times,
@@ -64,6 +66,7 @@ class FilterPlugin : public Plugin {
   float _last_low_cutoff;
   float _last_high_cutoff;
   util::ButterFilter _filter;
+  util::TailDecay _tail;
 };
 
 }  // namespace eq
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "ChannelProbe.h"
+
+#include <algorithm>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+static bool ChunkChannelsIdentical(const PCMCache::Chunk &chunk) {
+  const size_t channels = std::max(chunk._channels, 1);
+  for (size_t i = 0; i + channels <= chunk._samples.size(); i += channels) {
+    if (!std::all_of(chunk._samples.begin() + i + 1,
+                     chunk._samples.begin() + i + channels,
+                     [&chunk, i](float sample) {
+                       return sample == chunk._samples[i];
+                     })) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<ChannelProbe> ChannelProbe::sharedProbe() {
+  static std::shared_ptr<ChannelProbe> shared_probe =
+      std::make_shared<ChannelProbe>();
+  return shared_probe;
+}
+
+ChannelProbe::ChannelProbe() {}
+
+ChannelProbe::~ChannelProbe() {}
+
+void ChannelProbe::record(const std::string &path, double samplerate,
+                          long chunks, long chunk_index,
+                          const PCMCache::Chunk &chunk) {
+  // Decoded chunks are never written to again, so they're scanned unlocked
+  const bool identical = ChunkChannelsIdentical(chunk);
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto probe_it = _probes.find(path);
+  if (probe_it == _probes.end()) {
+    probe_it = _probes.insert({path, {samplerate, chunks, {}, false}}).first;
+  }
+  Probe &probe = probe_it->second;
+  if (probe._differs) {
+    return;
+  }
+  if (!identical) {
+    probe._differs = true;
+    probe._identical_chunks.clear();
+    return;
+  }
+  // Chunks only line up with chunks decoded at the same rate
+  if (probe._samplerate != samplerate) {
+    probe._samplerate = samplerate;
+    probe._chunks = chunks;
+    probe._identical_chunks.clear();
+  }
+  if (chunk_index < probe._chunks) {
+    probe._identical_chunks.insert(chunk_index);
+  }
+}
+
+int ChannelProbe::channels(const std::string &path, int channels) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto probe_it = _probes.find(path);
+  if (probe_it == _probes.end()) {
+    return channels;
+  }
+  const Probe &probe = probe_it->second;
+  if (probe._differs || probe._chunks <= 0 ||
+      static_cast<long>(probe._identical_chunks.size()) < probe._chunks) {
+    return channels;
+  }
+  return 1;
+}
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "PCMCache.h"
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+/**
+ * Learns which files carry the same audio in every channel from the chunks
+ * decoded of them. Decoders convert files to the channels they are asked
+ * for, so this is the only way to tell a mono file opened at the graph's
+ * width. Once every chunk of a file has been seen, later scores can render
+ * the file narrower and leave widening it to the graph.
+ */
+class ChannelProbe {
+ public:
+  // The probe every file in the process shares
+  static std::shared_ptr<ChannelProbe> sharedProbe();
+
+  ChannelProbe();
+  virtual ~ChannelProbe();
+
+  /**
+   * Records a chunk decoded of a file
+   * @param path The path of the file
+   * @param samplerate The sample rate the chunk was decoded at
+   * @param chunks The number of chunks in the whole file at that rate, or 0
+   * if the length of the file isn't known
+   * @param chunk_index The index of the chunk
+   * @param chunk The decoded chunk
+   */
+  void record(const std::string &path, double samplerate, long chunks,
+              long chunk_index, const PCMCache::Chunk &chunk);
+  /**
+   * The number of channels a file has to be decoded at
+   * @param path The path of the file
+   * @param channels The number of channels it would otherwise decode at
+   * @return One if every chunk of the file has been seen and none of them
+   * differed between channels, otherwise channels
+   */
+  int channels(const std::string &path, int channels) const;
+
+ private:
+  struct Probe {
+    double _samplerate;
+    long _chunks;
+    std::set<long> _identical_chunks;
+    // Once a chunk differs the file is never narrowed
+    bool _differs;
+  };
+
+  mutable std::mutex _mutex;
+  std::map<std::string, Probe> _probes;
+};
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "ChunkRing.h"
+
+#include <climits>
+#include <thread>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+static const long ChunkRingSlotEmpty = -1;
+static const long ChunkRingSlotWriting = -2;
+
+static size_t roundUpToPowerOfTwo(size_t value) {
+  size_t power = 1;
+  while (power < value) {
+    power <<= 1;
+  }
+  return power;
+}
+
+ChunkRing::ChunkRing(size_t capacity)
+    : _capacity(roundUpToPowerOfTwo(capacity)),
+      _slots(new Slot[_capacity]),
+      _reads(0) {
+  for (size_t i = 0; i < _capacity; ++i) {
+    _slots[i]._chunk_index = ChunkRingSlotEmpty;
+    _slots[i]._requested_chunk_index = ChunkRingSlotEmpty;
+  }
+}
+
+ChunkRing::~ChunkRing() {}
+
+size_t ChunkRing::capacity() const { return _capacity; }
+
+bool ChunkRing::publish(long chunk_index, const PCMCache::CHUNK &chunk) {
+  Slot &chunk_slot = slot(chunk_index);
+  long expected = ChunkRingSlotEmpty;
+  if (!chunk_slot._chunk_index.compare_exchange_strong(
+          expected, ChunkRingSlotWriting, std::memory_order_acq_rel)) {
+    return expected == chunk_index;
+  }
+  chunk_slot._chunk = chunk;
+  chunk_slot._chunk_index.store(chunk_index, std::memory_order_release);
+  return true;
+}
+
+bool ChunkRing::contains(long chunk_index) const {
+  return slot(chunk_index)._chunk_index.load(std::memory_order_acquire) ==
+         chunk_index;
+}
+
+bool ChunkRing::markRequested(long chunk_index) {
+  return slot(chunk_index)._requested_chunk_index.exchange(
+             chunk_index, std::memory_order_acq_rel) != chunk_index;
+}
+
+void ChunkRing::clearRequested(long chunk_index) {
+  slot(chunk_index)._requested_chunk_index.compare_exchange_strong(
+      chunk_index, ChunkRingSlotEmpty, std::memory_order_acq_rel);
+}
+
+void ChunkRing::beginRead() { _reads.fetch_add(1); }
+
+void ChunkRing::endRead() { _reads.fetch_add(1); }
+
+const PCMCache::Chunk *ChunkRing::peek(long chunk_index) const {
+  const Slot &chunk_slot = slot(chunk_index);
+  if (chunk_slot._chunk_index.load() != chunk_index) {
+    return nullptr;
+  }
+  return chunk_slot._chunk.get();
+}
+
+void ChunkRing::releaseOutside(long first_chunk_index) {
+  const long end_chunk_index =
+      first_chunk_index > LONG_MAX - static_cast<long>(_capacity)
+          ? LONG_MAX
+          : first_chunk_index + static_cast<long>(_capacity);
+  // Takes the slots away from new reads first
+  std::vector<std::pair<Slot *, long>> released_slots;
+  for (size_t i = 0; i < _capacity; ++i) {
+    Slot &chunk_slot = _slots[i];
+    long chunk_index = chunk_slot._chunk_index.load();
+    if (chunk_index < 0 ||
+        (chunk_index >= first_chunk_index && chunk_index < end_chunk_index)) {
+      continue;
+    }
+    if (chunk_slot._chunk_index.compare_exchange_strong(
+            chunk_index, ChunkRingSlotWriting)) {
+      released_slots.push_back(std::make_pair(&chunk_slot, chunk_index));
+    }
+  }
+  if (released_slots.empty()) {
+    return;
+  }
+
+  // Then waits out a read that may have peeked one of them before
+  const unsigned long reads = _reads.load();
+  if (reads % 2 == 1) {
+    while (_reads.load() == reads) {
+      std::this_thread::yield();
+    }
+  }
+  for (const auto &released_slot : released_slots) {
+    // Whoever asks for the chunk again has to fetch it again
+    clearRequested(released_slot.second);
+    PCMCache::CHUNK released_chunk = std::move(released_slot.first->_chunk);
+    released_slot.first->_chunk_index.store(ChunkRingSlotEmpty);
+  }
+}
+
+ChunkRing::Slot &ChunkRing::slot(long chunk_index) const {
+  return _slots[static_cast<size_t>(chunk_index) & (_capacity - 1)];
+}
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "PCMCache.h"
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+/**
+ * The chunks of a file a plugin is holding on to, in a fixed number of slots
+ * picked by chunk index. The render thread reads chunks without waiting on
+ * anyone, any thread can hand it chunks, and the thread running the plugin
+ * lets go of them. A chunk whose slot still holds one that hasn't been let go
+ * of is turned away and has to be handed over again later. Letting go waits
+ * for the render thread to finish any read it is in the middle of, so a chunk
+ * is never freed while it is being copied from.
+ */
+class ChunkRing {
+ public:
+  // The capacity is rounded up to a power of two
+  explicit ChunkRing(size_t capacity);
+  virtual ~ChunkRing();
+
+  size_t capacity() const;
+
+  // Any thread
+  // Returns false if the chunk's slot is taken
+  bool publish(long chunk_index, const PCMCache::CHUNK &chunk);
+  bool contains(long chunk_index) const;
+  // Marks a chunk as on its way, returns false if it already was
+  bool markRequested(long chunk_index);
+  void clearRequested(long chunk_index);
+
+  // Render thread only
+  // Brackets every peek, a chunk peeked stays valid until the read ends
+  void beginRead();
+  void endRead();
+  const PCMCache::Chunk *peek(long chunk_index) const;
+
+  // Lets go of the chunks outside those from first_chunk_index onwards that
+  // fit in the ring, only one thread may at a time
+  void releaseOutside(long first_chunk_index);
+
+ private:
+  struct Slot {
+    // The chunk index held, or one of the slot states
+    std::atomic<long> _chunk_index;
+    std::atomic<long> _requested_chunk_index;
+    PCMCache::CHUNK _chunk;
+  };
+
+  Slot &slot(long chunk_index) const;
+
+  const size_t _capacity;
+  std::unique_ptr<Slot[]> _slots;
+  // Odd while the render thread is reading
+  std::atomic<unsigned long> _reads;
+};
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "DecodeScheduler.h"
+
+#include <algorithm>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+const size_t DecodeSchedulerDefaultThreads =
+    std::max(std::thread::hardware_concurrency() / 2, 1u);
+
+std::shared_ptr<DecodeScheduler> DecodeScheduler::sharedScheduler() {
+  static std::shared_ptr<DecodeScheduler> shared_scheduler =
+      std::make_shared<DecodeScheduler>();
+  return shared_scheduler;
+}
+
+DecodeScheduler::DecodeScheduler(size_t threads)
+    : _scheduled_decodes(0),
+      _active_decodes(0),
+      _completed_decodes(0),
+      _cancelled_decodes(0),
+      _missed_decodes(0),
+      _stopping(false) {
+  for (size_t i = 0; i < std::max(threads, static_cast<size_t>(1)); ++i) {
+    _threads.emplace_back(&DecodeScheduler::work, this);
+  }
+}
+
+DecodeScheduler::~DecodeScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _condition.notify_all();
+  for (auto &thread : _threads) {
+    thread.join();
+  }
+  for (const auto &queued : _queue) {
+    if (queued.second._cancelled) {
+      queued.second._cancelled();
+    }
+  }
+}
+
+void DecodeScheduler::schedule(const void *owner, DEADLINE deadline,
+                               const DECODE_TASK &task,
+                               const DECODE_TASK &cancelled) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queue[std::make_pair(deadline, _scheduled_decodes++)] = {
+        owner, deadline, task, cancelled};
+  }
+  _condition.notify_one();
+}
+
+size_t DecodeScheduler::cancel(const void *owner) {
+  std::vector<DECODE_TASK> cancelled_callbacks;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto queue_it = _queue.begin(); queue_it != _queue.end();) {
+      if (queue_it->second._owner == owner) {
+        cancelled_callbacks.push_back(queue_it->second._cancelled);
+        queue_it = _queue.erase(queue_it);
+      } else {
+        ++queue_it;
+      }
+    }
+    _cancelled_decodes += cancelled_callbacks.size();
+  }
+  for (const auto &cancelled_callback : cancelled_callbacks) {
+    if (cancelled_callback) {
+      cancelled_callback();
+    }
+  }
+  return cancelled_callbacks.size();
+}
+
+size_t DecodeScheduler::threads() const { return _threads.size(); }
+
+smartplayer::DecodeStats DecodeScheduler::stats() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return {_queue.size(), _active_decodes, _completed_decodes,
+          _cancelled_decodes, _missed_decodes};
+}
+
+void DecodeScheduler::work() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (!_stopping) {
+    // The soonest decode whose owner isn't already decoding
+    auto queue_it = _queue.begin();
+    while (queue_it != _queue.end() &&
+           _busy_owners.count(queue_it->second._owner) > 0) {
+      ++queue_it;
+    }
+    if (queue_it == _queue.end()) {
+      _condition.wait(lock);
+      continue;
+    }
+    const void *owner = queue_it->second._owner;
+    const DEADLINE deadline = queue_it->second._deadline;
+    DECODE_TASK task = std::move(queue_it->second._task);
+    _queue.erase(queue_it);
+    _busy_owners.insert(owner);
+    ++_active_decodes;
+    lock.unlock();
+
+    task();
+    const bool missed = std::chrono::steady_clock::now() > deadline;
+    task = nullptr;
+
+    lock.lock();
+    _busy_owners.erase(owner);
+    --_active_decodes;
+    ++_completed_decodes;
+    if (missed) {
+      ++_missed_decodes;
+    }
+    // The owner's next decode may be waiting on this one
+    _condition.notify_all();
+  }
+}
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
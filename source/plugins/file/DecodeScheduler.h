@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/DecodeStats.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+extern const size_t DecodeSchedulerDefaultThreads;
+
+/**
+ * Decodes files on a fixed number of threads, starting whichever decode is
+ * needed soonest by playback. Decodes belonging to the same owner never run
+ * at the same time, so an owner can share one decoder between them.
+ */
+class DecodeScheduler {
+ public:
+  typedef std::chrono::steady_clock::time_point DEADLINE;
+  typedef std::function<void()> DECODE_TASK;
+
+  // The scheduler every file in the process shares
+  static std::shared_ptr<DecodeScheduler> sharedScheduler();
+
+  explicit DecodeScheduler(size_t threads = DecodeSchedulerDefaultThreads);
+  virtual ~DecodeScheduler();
+
+  /**
+   * Queues a decode
+   * @param owner Whoever the decode belongs to
+   * @param deadline When playback needs the decoded audio
+   * @param task The decode, run on one of the scheduler's threads
+   * @param cancelled Called instead of the task if the decode is cancelled
+   */
+  void schedule(const void *owner, DEADLINE deadline, const DECODE_TASK &task,
+                const DECODE_TASK &cancelled);
+  // Drops the decodes an owner has waiting, returning how many there were
+  size_t cancel(const void *owner);
+  size_t threads() const;
+  smartplayer::DecodeStats stats() const;
+
+ private:
+  struct Decode {
+    const void *_owner;
+    DEADLINE _deadline;
+    DECODE_TASK _task;
+    DECODE_TASK _cancelled;
+  };
+
+  void work();
+
+  mutable std::mutex _mutex;
+  std::condition_variable _condition;
+  // Keyed by deadline, then by the order the decodes were scheduled
+  std::map<std::pair<DEADLINE, unsigned long>, Decode> _queue;
+  std::set<const void *> _busy_owners;
+  unsigned long _scheduled_decodes;
+  size_t _active_decodes;
+  long _completed_decodes;
+  long _cancelled_decodes;
+  long _missed_decodes;
+  bool _stopping;
+  std::vector<std::thread> _threads;
+};
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
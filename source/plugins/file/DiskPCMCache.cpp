@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "DiskPCMCache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <utility>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+const size_t DiskPCMCacheDefaultBudgetBytes = 1024 * 1024 * 1024;
+
+static const uint32_t DISK_CHUNK_MAGIC = 0x4d43504e;  // "NPCM"
+static const uint32_t DISK_CHUNK_VERSION = 1;
+static const std::string DISK_CHUNK_EXTENSION = ".nfpcm";
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+// Written at the start of every chunk, followed by the path of the file it
+// belongs to padded to a whole sample, then the samples
+struct DiskChunkHeader {
+  uint32_t _magic;
+  uint32_t _version;
+  // Of everything after the header
+  uint64_t _checksum;
+  int64_t _chunk_index;
+  int64_t _chunk_frames;
+  int64_t _file_frames;
+  int64_t _frames;
+  double _samplerate;
+  int32_t _channels;
+  uint32_t _eof;
+  uint32_t _path_bytes;
+  uint32_t _reserved;
+};
+
+static size_t paddedPathBytes(size_t path_bytes) {
+  return (path_bytes + sizeof(float) - 1) / sizeof(float) * sizeof(float);
+}
+
+// FNV-1a over whole words, the data is always padded to a whole sample
+static uint64_t checksum(uint64_t hash, const void *data, size_t bytes) {
+  const unsigned char *words = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i + sizeof(uint32_t) <= bytes; i += sizeof(uint32_t)) {
+    uint32_t word;
+    std::memcpy(&word, words + i, sizeof(word));
+    hash = (hash ^ word) * FNV_PRIME;
+  }
+  return hash;
+}
+
+static bool writeAll(int fd, const void *data, size_t bytes) {
+  const char *remaining = static_cast<const char *>(data);
+  while (bytes > 0) {
+    const ssize_t written = ::write(fd, remaining, bytes);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    remaining += written;
+    bytes -= written;
+  }
+  return true;
+}
+
+std::shared_ptr<DiskPCMCache> DiskPCMCache::sharedCache() {
+  static std::shared_ptr<DiskPCMCache> shared_cache =
+      std::make_shared<DiskPCMCache>();
+  return shared_cache;
+}
+
+DiskPCMCache::DiskPCMCache()
+    : _budget_bytes(DiskPCMCacheDefaultBudgetBytes),
+      _resident_bytes(0),
+      _hits(0),
+      _misses(0),
+      _writes(0),
+      _evictions(0),
+      _corrupt(0) {}
+
+DiskPCMCache::~DiskPCMCache() {}
+
+bool DiskPCMCache::setDirectory(const std::string &directory,
+                                size_t budget_bytes) {
+  // The chunks another run left behind, most recently used first
+  std::vector<std::pair<time_t, std::pair<std::string, size_t>>> chunks;
+  if (!directory.empty()) {
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+      return false;
+    }
+    while (struct dirent *dir_entry = readdir(dir)) {
+      const std::string name = dir_entry->d_name;
+      if (name.size() <= DISK_CHUNK_EXTENSION.size() ||
+          name.compare(name.size() - DISK_CHUNK_EXTENSION.size(),
+                       DISK_CHUNK_EXTENSION.size(),
+                       DISK_CHUNK_EXTENSION) != 0) {
+        continue;
+      }
+      struct stat chunk_stat;
+      if (stat((directory + "/" + name).c_str(), &chunk_stat) == 0) {
+        chunks.push_back(std::make_pair(
+            chunk_stat.st_mtime,
+            std::make_pair(name, static_cast<size_t>(chunk_stat.st_size))));
+      }
+    }
+    closedir(dir);
+    std::sort(chunks.begin(), chunks.end(),
+              [](const std::pair<time_t, std::pair<std::string, size_t>> &lhs,
+                 const std::pair<time_t, std::pair<std::string, size_t>>
+                     &rhs) { return lhs.first > rhs.first; });
+  }
+
+  std::vector<std::string> evicted_paths;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _directory = directory;
+    _budget_bytes = budget_bytes;
+    _entries.clear();
+    _lru.clear();
+    _resident_bytes = 0;
+    for (const auto &chunk : chunks) {
+      _lru.push_back(chunk.second.first);
+      _entries[chunk.second.first] = {chunk.second.second,
+                                      std::prev(_lru.end())};
+      _resident_bytes += chunk.second.second;
+    }
+    evicted_paths = evict();
+  }
+  for (const auto &evicted_path : evicted_paths) {
+    unlink(evicted_path.c_str());
+  }
+  return true;
+}
+
+bool DiskPCMCache::enabled() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return !_directory.empty();
+}
+
+PCMCache::CHUNK DiskPCMCache::read(const std::string &path, long chunk_index,
+                                   double samplerate, int channels,
+                                   long file_frames) {
+  const std::string name = chunkName(path, chunk_index, samplerate, channels);
+  std::string chunk_path;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_directory.empty()) {
+      return nullptr;
+    }
+    chunk_path = _directory + "/" + name;
+  }
+
+  // Another process sharing the directory may have written the chunk, so it
+  // is looked for even if it wasn't there when the directory was read
+  const int fd = open(chunk_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    drop(name, false);
+    return nullptr;
+  }
+  struct stat chunk_stat;
+  size_t chunk_bytes = 0;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &chunk_stat) == 0 &&
+      static_cast<size_t>(chunk_stat.st_size) >= sizeof(DiskChunkHeader)) {
+    chunk_bytes = chunk_stat.st_size;
+    mapping = mmap(nullptr, chunk_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    drop(name, true);
+    return nullptr;
+  }
+
+  const char *bytes = static_cast<const char *>(mapping);
+  DiskChunkHeader header;
+  std::memcpy(&header, bytes, sizeof(header));
+  const size_t padded_path_bytes = paddedPathBytes(header._path_bytes);
+  const bool valid =
+      header._magic == DISK_CHUNK_MAGIC &&
+      header._version == DISK_CHUNK_VERSION && header._channels > 0 &&
+      header._frames >= 0 && header._frames <= header._chunk_frames &&
+      chunk_bytes == sizeof(header) + padded_path_bytes +
+                         header._frames * header._channels * sizeof(float) &&
+      header._checksum == checksum(FNV_OFFSET_BASIS, bytes + sizeof(header),
+                                   chunk_bytes - sizeof(header));
+  // A chunk from another file, or from this file before it changed
+  const bool current =
+      valid && header._chunk_index == chunk_index &&
+      header._chunk_frames == PCMCacheChunkFrames &&
+      header._samplerate == samplerate && header._channels == channels &&
+      header._file_frames == file_frames &&
+      path.compare(0, std::string::npos, bytes + sizeof(header),
+                   header._path_bytes) == 0;
+  // Copied out rather than handed out as a view of the mapping: the render
+  // callback reads chunks, and a view could fault on pages the kernel has
+  // since dropped, blocking it on the disk. The checksum has just read every
+  // page, so the copy doesn't go to the disk again.
+  std::shared_ptr<PCMCache::Chunk> chunk;
+  if (current) {
+    const float *samples = reinterpret_cast<const float *>(
+        bytes + sizeof(header) + padded_path_bytes);
+    chunk = std::make_shared<PCMCache::Chunk>();
+    chunk->_channels = header._channels;
+    chunk->_eof = header._eof != 0;
+    chunk->_samples.assign(samples,
+                           samples + header._frames * header._channels);
+  }
+  munmap(mapping, chunk_bytes);
+  if (!chunk) {
+    drop(name, !valid);
+    return nullptr;
+  }
+
+  // Marked as used for whoever reads the directory next
+  utimes(chunk_path.c_str(), nullptr);
+  std::lock_guard<std::mutex> lock(_mutex);
+  ++_hits;
+  auto entry_it = _entries.find(name);
+  if (entry_it == _entries.end()) {
+    _lru.push_front(name);
+    _entries[name] = {chunk_bytes, _lru.begin()};
+    _resident_bytes += chunk_bytes;
+  } else {
+    _lru.splice(_lru.begin(), _lru, entry_it->second._lru_it);
+  }
+  return chunk;
+}
+
+void DiskPCMCache::write(const std::string &path, long chunk_index,
+                         double samplerate, long file_frames,
+                         const PCMCache::Chunk &chunk) {
+  const std::string name =
+      chunkName(path, chunk_index, samplerate, chunk._channels);
+  std::string chunk_path;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_directory.empty()) {
+      return;
+    }
+    chunk_path = _directory + "/" + name;
+  }
+
+  const size_t padded_path_bytes = paddedPathBytes(path.size());
+  std::vector<char> padded_path(padded_path_bytes, 0);
+  std::copy(path.begin(), path.end(), padded_path.begin());
+  const size_t sample_bytes = chunk._samples.size() * sizeof(float);
+  DiskChunkHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header._magic = DISK_CHUNK_MAGIC;
+  header._version = DISK_CHUNK_VERSION;
+  const uint64_t path_checksum =
+      checksum(FNV_OFFSET_BASIS, padded_path.data(), padded_path_bytes);
+  header._checksum =
+      checksum(path_checksum, chunk._samples.data(), sample_bytes);
+  header._chunk_index = chunk_index;
+  header._chunk_frames = PCMCacheChunkFrames;
+  header._file_frames = file_frames;
+  header._frames = chunk.frames();
+  header._samplerate = samplerate;
+  header._channels = chunk._channels;
+  header._eof = chunk._eof ? 1 : 0;
+  header._path_bytes = path.size();
+
+  // Written aside and moved into place, so nobody reads half a chunk
+  const std::string temporary_path =
+      chunk_path + ".tmp" + std::to_string(getpid());
+  const int fd =
+      open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return;
+  }
+  const bool written = writeAll(fd, &header, sizeof(header)) &&
+                       writeAll(fd, padded_path.data(), padded_path_bytes) &&
+                       writeAll(fd, chunk._samples.data(), sample_bytes);
+  if (close(fd) != 0 || !written ||
+      rename(temporary_path.c_str(), chunk_path.c_str()) != 0) {
+    unlink(temporary_path.c_str());
+    return;
+  }
+
+  const size_t chunk_bytes = sizeof(header) + padded_path_bytes + sample_bytes;
+  std::vector<std::string> evicted_paths;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_writes;
+    auto entry_it = _entries.find(name);
+    if (entry_it != _entries.end()) {
+      _resident_bytes -= entry_it->second._bytes;
+      _lru.erase(entry_it->second._lru_it);
+      _entries.erase(entry_it);
+    }
+    _lru.push_front(name);
+    _entries[name] = {chunk_bytes, _lru.begin()};
+    _resident_bytes += chunk_bytes;
+    evicted_paths = evict();
+  }
+  for (const auto &evicted_path : evicted_paths) {
+    unlink(evicted_path.c_str());
+  }
+}
+
+smartplayer::DiskCacheStats DiskPCMCache::stats() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return {_hits,    _misses,         _writes,      _evictions,
+          _corrupt, _resident_bytes, _budget_bytes};
+}
+
+std::string DiskPCMCache::chunkName(const std::string &path, long chunk_index,
+                                    double samplerate, int channels) const {
+  uint64_t path_hash = FNV_OFFSET_BASIS;
+  for (const unsigned char c : path) {
+    path_hash = (path_hash ^ c) * FNV_PRIME;
+  }
+  char path_hash_string[17];
+  std::snprintf(path_hash_string, sizeof(path_hash_string), "%016llx",
+                static_cast<unsigned long long>(path_hash));
+  return std::string(path_hash_string) + "-" +
+         std::to_string(static_cast<long>(samplerate)) + "-" +
+         std::to_string(channels) + "-" + std::to_string(chunk_index) +
+         DISK_CHUNK_EXTENSION;
+}
+
+void DiskPCMCache::drop(const std::string &name, bool corrupt) {
+  std::string chunk_path;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_misses;
+    if (corrupt) {
+      ++_corrupt;
+    }
+    auto entry_it = _entries.find(name);
+    if (entry_it != _entries.end()) {
+      _resident_bytes -= entry_it->second._bytes;
+      _lru.erase(entry_it->second._lru_it);
+      _entries.erase(entry_it);
+    }
+    if (_directory.empty()) {
+      return;
+    }
+    chunk_path = _directory + "/" + name;
+  }
+  unlink(chunk_path.c_str());
+}
+
+std::vector<std::string> DiskPCMCache::evict() {
+  std::vector<std::string> evicted_paths;
+  while (_resident_bytes > _budget_bytes && !_lru.empty()) {
+    const std::string &name = _lru.back();
+    auto entry_it = _entries.find(name);
+    _resident_bytes -= entry_it->second._bytes;
+    _entries.erase(entry_it);
+    evicted_paths.push_back(_directory + "/" + name);
+    _lru.pop_back();
+    ++_evictions;
+  }
+  return evicted_paths;
+}
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
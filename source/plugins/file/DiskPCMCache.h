@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/DiskCacheStats.h>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PCMCache.h"
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+extern const size_t DiskPCMCacheDefaultBudgetBytes;
+
+/**
+ * Decoded audio kept on disk between runs, one file per chunk of a file at a
+ * sample rate and channel count. Chunks are read back by mapping them into
+ * memory and copying them out, so files played again come from the page
+ * cache rather than their decoder. Each chunk starts with a header checked
+ * before it is used, and the chunks used least recently are deleted once the
+ * directory holds more than its budget.
+ */
+class DiskPCMCache {
+ public:
+  // The cache every file in the process shares, off until given a directory
+  static std::shared_ptr<DiskPCMCache> sharedCache();
+
+  DiskPCMCache();
+  virtual ~DiskPCMCache();
+
+  /**
+   * Keeps chunks in a directory, creating it if it doesn't exist, and picks
+   * up the chunks already in it
+   * @param directory Where to keep the chunks, empty to stop using the disk
+   * @param budget_bytes Bytes of chunks to keep at most
+   * @return Whether the directory can be used
+   */
+  bool setDirectory(const std::string &directory,
+                    size_t budget_bytes = DiskPCMCacheDefaultBudgetBytes);
+  bool enabled() const;
+
+  /**
+   * Reads a chunk back from disk
+   * @param path The file the chunk belongs to
+   * @param chunk_index Which chunk, counting in PCMCacheChunkFrames
+   * @param samplerate The sample rate the file was decoded at
+   * @param channels The number of channels the file was decoded to
+   * @param file_frames How long the file is, so chunks of a file that has
+   * since changed aren't used
+   * @return The chunk, or null if it isn't on disk
+   */
+  PCMCache::CHUNK read(const std::string &path, long chunk_index,
+                       double samplerate, int channels, long file_frames);
+  void write(const std::string &path, long chunk_index, double samplerate,
+             long file_frames, const PCMCache::Chunk &chunk);
+  smartplayer::DiskCacheStats stats() const;
+
+ private:
+  struct Entry {
+    size_t _bytes;
+    std::list<std::string>::iterator _lru_it;
+  };
+
+  std::string chunkName(const std::string &path, long chunk_index,
+                        double samplerate, int channels) const;
+  // Forgets a chunk that couldn't be used, deleting it if it is still there
+  void drop(const std::string &name, bool corrupt);
+  // Returns the chunk files to delete, so it can happen outside the lock
+  std::vector<std::string> evict();
+
+  mutable std::mutex _mutex;
+  std::string _directory;
+  std::map<std::string, Entry> _entries;
+  // Most recently used first
+  std::list<std::string> _lru;
+  size_t _budget_bytes;
+  size_t _resident_bytes;
+  long _hits;
+  long _misses;
+  long _writes;
+  long _evictions;
+  long _corrupt;
+};
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
@@ -20,6 +20,8 @@
  */
 #include "FilePlugin.h"
 
+#include <climits>
+#include <cmath>
 #include <stdexcept>
 
 namespace nativeformat {
@@ -28,25 +30,54 @@ namespace file {
 
 static const double FILE_PLUGIN_CACHE_TIME = 10.0;
 static const long INVALID_DURATION_FRAMES = -1;
+// Playback jumping further ahead than this is a seek rather than a render
+static const double FILE_PLUGIN_SEEK_TIME = 1.0;
+// How far the measured rate of a file's time may stray from the graph's
+static const double FILE_PLUGIN_MIN_RATE = 0.25;
+static const double FILE_PLUGIN_MAX_RATE = 16.0;
+
+const double FilePluginDefaultReadyTime = 0.25;
 
 FilePlugin::FilePlugin(const std::shared_ptr<decoder::Factory> &factory,
+                       const std::shared_ptr<LoadScheduler> &load_scheduler,
+                       const std::shared_ptr<PCMCache> &pcm_cache,
+                       const std::shared_ptr<DiskPCMCache> &disk_pcm_cache,
+                       const std::shared_ptr<DecodeScheduler> &decode_scheduler,
+                       const std::shared_ptr<PrefetchPlanner> &prefetch_planner,
+                       const std::shared_ptr<ChannelProbe> &channel_probe,
                        const nfgrapher::contract::FileNodeInfo &grapher_node,
-                       const std::string &name, int channels, double samplerate)
+                       const std::string &name, int channels, double samplerate,
+                       double ready_time)
     : _factory(factory),
+      _load_scheduler(load_scheduler),
+      _pcm_cache(pcm_cache),
+      _disk_pcm_cache(disk_pcm_cache),
+      _decode_scheduler(decode_scheduler),
+      _prefetch_planner(prefetch_planner),
+      _channel_probe(channel_probe),
       _name(name),
       _channels(channels),
       _samplerate(samplerate),
+      _ready_time(ready_time),
       _path(grapher_node._file),
       _start_time_frame_index(nanosToFrames(samplerate, grapher_node._when)),
       _duration_frames(nanosToFrames(samplerate, grapher_node._duration)),
       _track_start_frame_index(nanosToFrames(samplerate, grapher_node._offset)),
       _loaded(false),
       _initialised(false),
-      _cached_samples_start_frame_index(0),
+      _chunks(std::ceil(FILE_PLUGIN_CACHE_TIME * samplerate /
+                        PCMCacheChunkFrames) +
+              2),
       _initialising(false),
-      _decoding(false) {}
+      _render_frame_index(0),
+      _last_run_frame_index(-1),
+      _residency(PrefetchPlanner::ResidencyEvicted),
+      _rate(1.0),
+      _wrap_from_frame_index(-1),
+      _wrap_to_frame_index(-1),
+      _initialise_generation(0) {}
 
-FilePlugin::~FilePlugin() {}
+FilePlugin::~FilePlugin() { _prefetch_planner->remove(this); }
 
 void FilePlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
                       long sample_index, long graph_sample_index,
@@ -71,45 +102,49 @@ void FilePlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
   frame_end += start_time_frame_index;
   long output_samples = (frame_begin - frame_index) * channels;
   audio_content.setItems(output_samples);
-  {
-    std::lock_guard<std::mutex> cached_samples_lock(_cached_samples_mutex);
-    long cached_samples_start_frame_index = _cached_samples_start_frame_index;
-    long cached_samples_duration_frames = _cached_samples.size() / channels;
-    if (cached_samples_duration_frames == 0) {
-      return;
+  long relative_frame_index =
+      frame_begin - start_time_frame_index + _track_start_frame_index;
+  const long relative_frame_index_end =
+      frame_end - start_time_frame_index + _track_start_frame_index;
+  float *samples = audio_content.payload();
+  // Copy from the chunks this file holds until one it doesn't have yet
+  _chunks.beginRead();
+  while (relative_frame_index < relative_frame_index_end) {
+    const long chunk_index = relative_frame_index / PCMCacheChunkFrames;
+    const PCMCache::Chunk *chunk = _chunks.peek(chunk_index);
+    if (!chunk) {
+      break;
     }
-    long cached_samples_end_frame_index =
-        cached_samples_start_frame_index + cached_samples_duration_frames;
-    long track_start_frame_index = _track_start_frame_index;
-    long current_relative_frame_index_begin =
-        frame_begin - start_time_frame_index + track_start_frame_index;
-    long current_relative_frame_index_end =
-        frame_end - start_time_frame_index + track_start_frame_index;
-    long current_relative_frame_begin = 0;
-    long current_relative_frame_end = 0;
-    if (!findBeginAndEndOfRange(
-            current_relative_frame_index_begin,
-            current_relative_frame_index_end, cached_samples_start_frame_index,
-            cached_samples_end_frame_index, current_relative_frame_begin,
-            current_relative_frame_end)) {
-      return;
-    }
-    float *samples = (float *)audio_content.payload();
-    long copy_samples =
-        (current_relative_frame_end - current_relative_frame_begin) * channels;
-    if (copy_samples <= 0) {
-      return;
+    const long chunk_frame_index =
+        relative_frame_index - chunk_index * PCMCacheChunkFrames;
+    const long chunk_frames =
+        std::min(relative_frame_index_end - relative_frame_index,
+                 PCMCacheChunkFrames - chunk_frame_index);
+    const long copy_frames = std::max(
+        std::min(chunk_frames, chunk->frames() - chunk_frame_index), 0l);
+    std::copy_n(chunk->_samples.data() + chunk_frame_index * channels,
+                copy_frames * channels, samples + output_samples);
+    if (copy_frames < chunk_frames) {
+      if (!chunk->_eof) {
+        output_samples += copy_frames * channels;
+        break;
+      }
+      // Clips that run on past the end of their file play silence
+      std::fill_n(samples + output_samples + copy_frames * channels,
+                  (chunk_frames - copy_frames) * channels, 0.0f);
     }
-    std::copy_n(&_cached_samples[current_relative_frame_begin * channels],
-                copy_samples, &samples[output_samples]);
-
-    output_samples += copy_samples;
+    output_samples += chunk_frames * channels;
+    relative_frame_index += chunk_frames;
   }
+  _chunks.endRead();
   audio_content.setItems(output_samples);
 }
 
 void FilePlugin::load(LOAD_CALLBACK callback) {
-  if (_start_time_frame_index / _samplerate < FILE_PLUGIN_CACHE_TIME) {
+  const PrefetchPlanner::Residency residency =
+      _prefetch_planner->plan(this, prefetchDemand(_render_frame_index));
+  if (residency != PrefetchPlanner::ResidencyEvicted) {
+    _residency = residency;
     initialise(callback);
   } else {
     _loaded = true;
@@ -129,19 +164,57 @@ void FilePlugin::run(long sample_index, const NodeTimes &node_times,
   long start_time_frame_index = _start_time_frame_index;
   long duration_frames = _duration_frames;
   long end_time_frame_index = start_time_frame_index + duration_frames;
-  if (frame_index < start_time_frame_index) {
-    if ((start_time_frame_index - frame_index) / _samplerate <
-        FILE_PLUGIN_CACHE_TIME) {
-      initialise(nullptr);
+  // Decodes queued before a seek are for audio that won't be heard soon, the
+  // ones still needed are asked for again below
+  const long last_run_frame_index = _last_run_frame_index;
+  const auto last_run_time = _last_run_time;
+  _last_run_frame_index = frame_index;
+  _last_run_time = std::chrono::steady_clock::now();
+  _render_frame_index = frame_index;
+  if (last_run_frame_index >= 0) {
+    const long run_frames = frame_index - last_run_frame_index;
+    if (run_frames < 0 || run_frames > FILE_PLUGIN_SEEK_TIME * _samplerate) {
+      _decode_scheduler->cancel(this);
+      if (run_frames < 0) {
+        _wrap_from_frame_index = last_run_frame_index;
+        _wrap_to_frame_index = frame_index;
+      }
+    } else if (run_frames > 0) {
+      const double run_seconds =
+          std::chrono::duration<double>(_last_run_time - last_run_time)
+              .count();
+      if (run_seconds > 0.0) {
+        const double rate =
+            std::min(std::max(run_frames / (_samplerate * run_seconds),
+                              FILE_PLUGIN_MIN_RATE),
+                     FILE_PLUGIN_MAX_RATE);
+        _rate = (_rate + rate) / 2.0;
+      }
     }
-  } else if (frame_index > end_time_frame_index) {
-    if ((frame_index - end_time_frame_index) / _samplerate >
-        FILE_PLUGIN_CACHE_TIME) {
-      // De-initialise our plugin
-      std::lock_guard<std::mutex> lock(_decoder_mutex);
-      _initialised = false;
-      _initialising = false;
-      _decoder = nullptr;
+  }
+
+  // The planner decides what the file holds, from how soon every file is
+  // needed and how much memory they take
+  const PrefetchPlanner::Residency residency =
+      _prefetch_planner->plan(this, prefetchDemand(frame_index));
+  const PrefetchPlanner::Residency last_residency =
+      _residency.exchange(residency);
+  if (residency == PrefetchPlanner::ResidencyEvicted) {
+    if (_initialised || _initialising) {
+      evict();
+    }
+  } else if (frame_index < start_time_frame_index ||
+             frame_index > end_time_frame_index) {
+    // Waiting to play, for the first time or the next time round a loop
+    if (!_initialised) {
+      initialise(nullptr);
+    } else if (residency == PrefetchPlanner::ResidencyDecoded &&
+               last_residency != PrefetchPlanner::ResidencyDecoded) {
+      requestChunks(_track_start_frame_index, cacheFrames(), nullptr);
+    } else if (residency == PrefetchPlanner::ResidencyOpen &&
+               last_residency == PrefetchPlanner::ResidencyDecoded) {
+      releaseChunks(LONG_MAX);
+      _decode_scheduler->cancel(this);
     }
   } else {
     // If we aren't initialised yet we definitely need to initialise now
@@ -150,61 +223,18 @@ void FilePlugin::run(long sample_index, const NodeTimes &node_times,
     if (!_initialised) {
       initialise(nullptr);
     } else {
-      long cached_samples_frames = 0;
-      {
-        std::lock_guard<std::mutex> cached_samples_lock(_cached_samples_mutex);
-        cached_samples_frames = _cached_samples.size() / _channels;
-      }
-      long cached_samples_start_frame_index = _cached_samples_start_frame_index;
-      long cached_samples_end_frame_index =
-          cached_samples_start_frame_index + cached_samples_frames;
-      long cached_frames_required = (FILE_PLUGIN_CACHE_TIME * _samplerate) / 2;
-      if (!cached_samples_frames ||
-          !rangesOverlap(cached_samples_start_frame_index,
-                         cached_samples_end_frame_index - 1,
-                         relative_frame_index, relative_frame_index)) {
-        long frames_required =
-            relative_frame_index < cached_samples_start_frame_index
-                ? std::min(
-                      cached_frames_required,
-                      cached_samples_start_frame_index - relative_frame_index)
-                : std::min(
-                      cached_frames_required,
-                      duration_frames - (frame_index - start_time_frame_index));
-        decode(relative_frame_index, frames_required, nullptr);
-      } else {
-        long frames_required =
-            std::min(cached_frames_required,
+      // Keep the next half of the cache time ready, and let go of what has
+      // played
+      long frames_required = (FILE_PLUGIN_CACHE_TIME * _samplerate) / 2;
+      if (duration_frames != INVALID_DURATION_FRAMES) {
+        frames_required =
+            std::min(frames_required,
                      duration_frames - (frame_index - start_time_frame_index));
-        if (frames_required < 0) {
-          return;
-        }
-        long frame_begin = 0, frame_end = 0;
-        findBeginAndEndOfRange(relative_frame_index, relative_frame_index,
-                               cached_samples_start_frame_index,
-                               cached_samples_end_frame_index, frame_begin,
-                               frame_end);
-        long cached_samples_frames_left = cached_samples_frames - frame_end;
-        if (cached_samples_frames_left < frames_required) {
-          // Let's get some more samples
-          decode(cached_samples_end_frame_index, frames_required, nullptr);
-        } else {
-          // Let's see if we can trim some samples
-          long trimmable_frames =
-              frame_begin - cached_samples_start_frame_index;
-          if (trimmable_frames > cached_frames_required) {
-            // Erase more than we are required to (to prevent reallocations
-            // every time run is called)
-            std::lock_guard<std::mutex> cached_samples_lock(
-                _cached_samples_mutex);
-            _cached_samples.erase(
-                _cached_samples.begin(),
-                _cached_samples.begin() + (cached_frames_required * 2));
-            _cached_samples_start_frame_index =
-                cached_samples_start_frame_index + cached_frames_required;
-          }
-        }
       }
+      if (frames_required > 0) {
+        requestChunks(relative_frame_index, frames_required, nullptr);
+      }
+      releaseChunks(relative_frame_index);
     }
   }
 }
@@ -258,143 +288,364 @@ bool FilePlugin::shouldProcess(long sample_index_start, long sample_index_end) {
 }
 
 void FilePlugin::initialise(LOAD_CALLBACK callback) {
-  if (_initialising || _initialised) {
+  // A plugin kept between loads of a score is asked to load again, answer
+  // straight away if it already has, or once the load in flight finishes
+  bool initialised = false;
+  unsigned long generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(_initialise_mutex);
+    initialised = _initialised;
+    if (!initialised) {
+      if (callback) {
+        _load_callbacks.push_back(callback);
+      }
+      if (_initialising) {
+        return;
+      }
+      _initialising = true;
+      generation = _initialise_generation;
+    }
+  }
+  if (initialised) {
+    if (callback) {
+      callback(Load{true});
+    }
     return;
   }
-  _initialising = true;
 
+  // Opening decoders is queued with the rest of the score's, so the clips
+  // heard first are ready first
+  auto strong_this = shared_from_this();
+  _load_scheduler->schedule(
+      startSampleIndex(),
+      [strong_this, generation](const LoadScheduler::DONE_CALLBACK &done) {
+        strong_this->createDecoder(done, generation);
+      });
+}
+
+void FilePlugin::createDecoder(const LoadScheduler::DONE_CALLBACK &done,
+                               unsigned long generation) {
   auto strong_this = shared_from_this();
   _factory->createDecoder(
       _path, "",
-      [callback,
-       strong_this](const std::shared_ptr<decoder::Decoder> &decoder) {
+      [strong_this, done,
+       generation](const std::shared_ptr<decoder::Decoder> &decoder) {
         if (!decoder) {
+          done();
           return;
         }
         {
-          std::lock_guard<std::mutex> lock(strong_this->_decoder_mutex);
+          std::lock_guard<std::mutex> lock(strong_this->_initialise_mutex);
+          // Evicted while it was being created, a later load has its own
+          if (generation != strong_this->_initialise_generation) {
+            done();
+            return;
+          }
+          std::lock_guard<std::mutex> decoder_lock(
+              strong_this->_decoder_mutex);
           strong_this->_decoder = decoder;
         }
+        // Files the planner only wants open decode once it says so
+        if (strong_this->_residency != PrefetchPlanner::ResidencyDecoded) {
+          strong_this->_loaded = true;
+          done();
+          strong_this->finishInitialising(Load{true}, generation);
+          return;
+        }
         long duration_frames = strong_this->_duration_frames;
         if (duration_frames == INVALID_DURATION_FRAMES) {
           duration_frames = decoder->frames();
         }
-        long frames = std::min(
+        // Only the start of the file has to be ready for it to play, the
+        // rest of the cache time follows once it has
+        const long cache_frames = std::min(
             static_cast<long>(FILE_PLUGIN_CACHE_TIME * decoder->sampleRate()),
             duration_frames);
-        strong_this->decode(strong_this->_track_start_frame_index, frames,
-                            [callback, strong_this](const Load &load) {
-                              strong_this->_loaded = true;
-                              strong_this->_initialised = true;
-                              strong_this->_initialising = false;
-                              if (callback) {
-                                callback(Load{true});
-                              }
-                            });
+        const long ready_frames = std::min(
+            std::max(static_cast<long>(strong_this->_ready_time *
+                                       decoder->sampleRate()),
+                     1l),
+            cache_frames);
+        const long track_start_frame_index =
+            strong_this->_track_start_frame_index;
+        strong_this->requestChunks(
+            track_start_frame_index, ready_frames,
+            [strong_this, done, generation, track_start_frame_index,
+             ready_frames, cache_frames]() {
+              strong_this->_loaded = true;
+              done();
+              if (strong_this->finishInitialising(Load{true}, generation) >=
+                  0) {
+                strong_this->fillCache(track_start_frame_index + ready_frames,
+                                       cache_frames - ready_frames);
+              }
+            });
       },
-      [callback, strong_this](const std::string &domain, int error_code) {
-        strong_this->_loaded = false;
-        strong_this->_initialising = false;
+      [strong_this, done, generation](const std::string &domain,
+                                      int error_code) {
+        done();
         std::string error_message =
             "Failed to create decoder for " + strong_this->_path;
-        if (callback) {
-          callback(Load{false, domain, error_message});
-        } else {
+        const int told = strong_this->finishInitialising(
+            Load{false, domain, error_message}, generation);
+        if (told >= 0) {
+          strong_this->_loaded = false;
+        }
+        if (told == 0) {
           throw std::runtime_error(error_message);
         }
-      });
+      },
+      _samplerate, _channels);
 }
 
-void FilePlugin::decode(long frame_index, long frames, LOAD_CALLBACK callback) {
-  if (_decoding) {
-    return;
+int FilePlugin::finishInitialising(const Load &load,
+                                   unsigned long generation) {
+  std::vector<LOAD_CALLBACK> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(_initialise_mutex);
+    if (generation != _initialise_generation) {
+      return -1;
+    }
+    _initialised = load._loaded;
+    _initialising = false;
+    callbacks.swap(_load_callbacks);
+  }
+  for (const auto &callback : callbacks) {
+    callback(load);
   }
+  return callbacks.size();
+}
 
-  _decoding = true;
-  std::lock_guard<std::mutex> lock(_decoder_mutex);
-  long decoder_frame_index = _decoder->currentFrameIndex();
-  if (decoder_frame_index != frame_index) {
-    _decoder->seek(frame_index);
+void FilePlugin::requestChunks(long frame_index, long frames,
+                               const std::function<void()> &ready) {
+  const long first_chunk_index = frame_index / PCMCacheChunkFrames;
+  const long last_chunk_index =
+      (frame_index + std::max(frames, 1l) - 1) / PCMCacheChunkFrames;
+  // One more than the chunks, so ready waits until they've all been asked for
+  std::function<void()> arrived;
+  if (ready) {
+    auto remaining = std::make_shared<std::atomic<long>>(
+        last_chunk_index - first_chunk_index + 2);
+    arrived = [remaining, ready]() {
+      if (--(*remaining) == 0) {
+        ready();
+      }
+    };
+  }
+  for (long chunk_index = first_chunk_index; chunk_index <= last_chunk_index;
+       ++chunk_index) {
+    requestChunk(chunk_index, arrived);
+  }
+  if (arrived) {
+    arrived();
   }
+}
+
+void FilePlugin::requestChunk(long chunk_index,
+                              const std::function<void()> &arrived) {
+  if (_chunks.contains(chunk_index)) {
+    if (arrived) {
+      arrived();
+    }
+    return;
+  }
+  // Chunks already on their way are only asked for again by someone waiting
+  // to hear they've arrived, the cache doesn't decode them twice
+  if (!_chunks.markRequested(chunk_index) && !arrived) {
+    return;
+  }
+
   auto strong_this = shared_from_this();
-  auto decoder = _decoder;
-  decoder->decode(frames, [callback, strong_this, decoder](
-                              long frame_index, long frames, float *samples) {
-    // Load samples here
-    {
-      std::lock_guard<std::mutex> cached_samples_lock(
-          strong_this->_cached_samples_mutex);
-      long cached_samples_start_frame_index =
-          strong_this->_cached_samples_start_frame_index;
-      long cached_samples_end_frame_index =
-          cached_samples_start_frame_index +
-          (strong_this->_cached_samples.size() / strong_this->_channels);
-      long end_frame_index = frame_index + frames;
-      long frame_begin = 0;
-      long frame_end = 0;
-      if (!findBeginAndEndOfRange(
-              frame_index, end_frame_index, cached_samples_start_frame_index,
-              cached_samples_end_frame_index, frame_begin, frame_end)) {
-        if (cached_samples_end_frame_index == frame_index) {
-          // If we are at the current end of the sample cache then just add what
-          // we have onto it
-          strong_this->_cached_samples.insert(
-              strong_this->_cached_samples.end(), samples,
-              samples + (frames * strong_this->_channels));
-        } else {
-          // We are at a completely different part of the track, and we just
-          // need to wipe the cached samples
-          strong_this->_cached_samples.clear();
-          strong_this->_cached_samples.insert(
-              strong_this->_cached_samples.begin(), samples,
-              samples + (frames * strong_this->_channels));
-          strong_this->_cached_samples_start_frame_index = frame_index;
-        }
-      } else {
-        // We are in a range, so we may have to overwrite some data
-        long frame_copy_begin_index = frame_begin;
-        long frames_to_copy = frame_end - frame_begin;
-        if (frames_to_copy > 0) {
-          auto n_channels = strong_this->_channels;
-          std::copy_n(&samples[frame_copy_begin_index * n_channels],
-                      frames_to_copy * n_channels,
-                      &strong_this->_cached_samples[frame_begin * n_channels]);
+  bool decode = false;
+  PCMCache::CHUNK chunk = _pcm_cache->find(
+      _path, _samplerate, _channels, chunk_index,
+      [strong_this, chunk_index, arrived](const PCMCache::CHUNK &chunk) {
+        strong_this->chunkArrived(chunk_index, chunk);
+        if (arrived) {
+          arrived();
         }
-        if (frames_to_copy != frames) {
-          long frames_to_insert = frames - frames_to_copy;
-          if (frame_end == cached_samples_end_frame_index) {
-            // Append the rest to the end
-            long frames_insertion_index = frames - frames_to_insert;
-            strong_this->_cached_samples.insert(
-                strong_this->_cached_samples.end(),
-                &samples[frames_insertion_index * strong_this->_channels],
-                &samples[frames_insertion_index * strong_this->_channels] +
-                    (frames_to_insert * strong_this->_channels));
-          } else {
-            // Append the rest to the beginning
-            strong_this->_cached_samples.insert(
-                strong_this->_cached_samples.begin(), samples,
-                samples + (frames_to_insert * strong_this->_channels));
-            strong_this->_cached_samples_start_frame_index = frame_index;
-          }
-        }
-      }
-      if (decoder->eof()) {
-        long silence_frames =
-            strong_this->_duration_frames -
-            (decoder->frames() - strong_this->_track_start_frame_index);
-        if (silence_frames > 0) {
-          strong_this->_cached_samples.insert(
-              strong_this->_cached_samples.end(),
-              silence_frames * decoder->channels(), 0.0f);
-        }
-      }
+      },
+      decode);
+  if (chunk) {
+    chunkArrived(chunk_index, chunk);
+    if (arrived) {
+      arrived();
     }
-    if (callback) {
+  } else if (decode) {
+    queueDecode(chunk_index);
+  }
+}
+
+void FilePlugin::fillCache(long frame_index, long frames) {
+  if (frames <= 0) {
+    return;
+  }
+  auto strong_this = shared_from_this();
+  _load_scheduler->schedule(
+      startSampleIndex(),
+      [strong_this, frame_index,
+       frames](const LoadScheduler::DONE_CALLBACK &done) {
+        strong_this->requestChunks(frame_index, frames, done);
+      },
+      true);
+}
+
+void FilePlugin::chunkArrived(long chunk_index, const PCMCache::CHUNK &chunk) {
+  // A chunk that failed, or whose slot is still taken, is asked for again
+  // the next time it is needed
+  if (!chunk || !_chunks.publish(chunk_index, chunk)) {
+    _chunks.clearRequested(chunk_index);
+  }
+}
+
+void FilePlugin::releaseChunks(long frame_index) {
+  // Keeps the chunk before the one playing, in case a block straddles them
+  _chunks.releaseOutside(frame_index / PCMCacheChunkFrames - 1);
+}
+
+void FilePlugin::queueDecode(long chunk_index) {
+  auto strong_this = shared_from_this();
+  _decode_scheduler->schedule(
+      this, chunkDeadline(chunk_index),
+      [strong_this, chunk_index]() { strong_this->decodeChunk(chunk_index); },
+      [strong_this, chunk_index]() {
+        // Whoever still needs the chunk asks for it again
+        strong_this->_pcm_cache->insert(
+            strong_this->_path, strong_this->_samplerate,
+            strong_this->_channels, chunk_index, nullptr);
+      });
+}
+
+void FilePlugin::decodeChunk(long chunk_index) {
+  std::shared_ptr<decoder::Decoder> decoder;
+  {
+    std::lock_guard<std::mutex> lock(_decoder_mutex);
+    decoder = _decoder;
+  }
+  if (!decoder) {
+    _pcm_cache->insert(_path, _samplerate, _channels, chunk_index, nullptr);
+    return;
+  }
+
+  const long frame_index = chunk_index * PCMCacheChunkFrames;
+  const long decoder_frames = decoder->frames();
+  const long decoder_chunks =
+      std::max(decoder_frames + PCMCacheChunkFrames - 1, 0l) /
+      PCMCacheChunkFrames;
+  std::shared_ptr<PCMCache::Chunk> chunk;
+  if (decoder_frames > 0 && frame_index >= decoder_frames) {
+    chunk = std::make_shared<PCMCache::Chunk>();
+    chunk->_channels = decoder->channels();
+    chunk->_eof = true;
+  } else if (PCMCache::CHUNK disk_chunk = _disk_pcm_cache->read(
+                 _path, chunk_index, decoder->sampleRate(),
+                 decoder->channels(), decoder_frames)) {
+    // Decoded by an earlier run
+    _channel_probe->record(_path, decoder->sampleRate(), decoder_chunks,
+                           chunk_index, *disk_chunk);
+    _pcm_cache->insert(_path, _samplerate, _channels, chunk_index, disk_chunk);
+    return;
+  } else {
+    if (decoder->currentFrameIndex() != frame_index) {
+      decoder->seek(frame_index);
+    }
+    // The scheduler's thread does the decoding, so it doesn't hand it off
+    decoder->decode(
+        PCMCacheChunkFrames,
+        [&chunk, &decoder](long decoded_frame_index, long frames,
+                           float *samples) {
+          chunk = std::make_shared<PCMCache::Chunk>();
+          chunk->_channels = decoder->channels();
+          chunk->_samples.assign(samples,
+                                 samples + (frames * chunk->_channels));
+          chunk->_eof = decoder->eof() || frames < PCMCacheChunkFrames;
+        },
+        true);
+    // Only whole chunks are kept for the next run
+    if (chunk && (chunk->frames() == PCMCacheChunkFrames || chunk->_eof)) {
+      _disk_pcm_cache->write(_path, chunk_index, decoder->sampleRate(),
+                             decoder_frames, *chunk);
+    }
+  }
+  if (chunk) {
+    _channel_probe->record(_path, decoder->sampleRate(), decoder_chunks,
+                           chunk_index, *chunk);
+  }
+  _pcm_cache->insert(_path, _samplerate, _channels, chunk_index, chunk);
+}
+
+DecodeScheduler::DEADLINE FilePlugin::chunkDeadline(long chunk_index) const {
+  const long chunk_frame_index = std::max(
+      chunk_index * PCMCacheChunkFrames - _track_start_frame_index, 0l);
+  const double seconds =
+      (_start_time_frame_index + chunk_frame_index - _render_frame_index) /
+      _samplerate;
+  return std::chrono::steady_clock::now() +
+         std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+             std::chrono::duration<double>(seconds));
+}
+
+PrefetchPlanner::Demand FilePlugin::prefetchDemand(long frame_index) const {
+  const long start_time_frame_index = _start_time_frame_index;
+  const long end_time_frame_index =
+      _duration_frames == INVALID_DURATION_FRAMES
+          ? LONG_MAX
+          : start_time_frame_index + _duration_frames;
+  long frames = -1;
+  if (frame_index < start_time_frame_index) {
+    frames = start_time_frame_index - frame_index;
+  } else if (frame_index <= end_time_frame_index) {
+    frames = 0;
+  } else {
+    // Having jumped back from a point once, playback is expected to again
+    const long wrap_from_frame_index = _wrap_from_frame_index;
+    const long wrap_to_frame_index = _wrap_to_frame_index;
+    if (wrap_to_frame_index >= 0 &&
+        wrap_to_frame_index <= end_time_frame_index &&
+        frame_index <= wrap_from_frame_index) {
+      frames = (wrap_from_frame_index - frame_index) +
+               std::max(start_time_frame_index - wrap_to_frame_index, 0l);
+    }
+  }
+  const long chunks =
+      (cacheFrames() + PCMCacheChunkFrames - 1) / PCMCacheChunkFrames + 1;
+  return {frames < 0 ? -1.0 : frames / (_samplerate * _rate),
+          static_cast<size_t>(chunks * PCMCacheChunkFrames * _channels) *
+              sizeof(float)};
+}
+
+long FilePlugin::cacheFrames() const {
+  long cache_frames = FILE_PLUGIN_CACHE_TIME * _samplerate;
+  if (_duration_frames != INVALID_DURATION_FRAMES) {
+    cache_frames = std::min(cache_frames, _duration_frames);
+  }
+  return cache_frames;
+}
+
+void FilePlugin::evict() {
+  // A load still in flight is dropped when it finishes, so everyone waiting
+  // on it hears the file has loaded, as it would have had it been evicted
+  // before they asked
+  std::vector<LOAD_CALLBACK> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(_initialise_mutex);
+    ++_initialise_generation;
+    _initialised = false;
+    _initialising = false;
+    callbacks.swap(_load_callbacks);
+  }
+  releaseChunks(LONG_MAX);
+  _decode_scheduler->cancel(this);
+  {
+    std::lock_guard<std::mutex> lock(_decoder_mutex);
+    _decoder = nullptr;
+  }
+  if (!callbacks.empty()) {
+    _loaded = true;
+    for (const auto &callback : callbacks) {
       callback(Load{true});
     }
-    strong_this->_decoding = false;
-  });
+  }
 }
 
 }  // namespace file
@@ -24,18 +24,40 @@
 #include <NFSmartPlayer/Plugin.h>
 
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ChannelProbe.h"
+#include "ChunkRing.h"
+#include "DecodeScheduler.h"
+#include "DiskPCMCache.h"
+#include "LoadScheduler.h"
+#include "PCMCache.h"
+#include "PrefetchPlanner.h"
 
 namespace nativeformat {
 namespace plugin {
 namespace file {
 
+// Seconds of audio a file has decoded before it reports it has loaded
+extern const double FilePluginDefaultReadyTime;
+
 class FilePlugin : public Plugin,
                    public std::enable_shared_from_this<FilePlugin> {
  public:
   FilePlugin(const std::shared_ptr<decoder::Factory> &factory,
+             const std::shared_ptr<LoadScheduler> &load_scheduler,
+             const std::shared_ptr<PCMCache> &pcm_cache,
+             const std::shared_ptr<DiskPCMCache> &disk_pcm_cache,
+             const std::shared_ptr<DecodeScheduler> &decode_scheduler,
+             const std::shared_ptr<PrefetchPlanner> &prefetch_planner,
+             const std::shared_ptr<ChannelProbe> &channel_probe,
              const nfgrapher::contract::FileNodeInfo &grapher_node,
-             const std::string &name, int channels, double samplerate);
+             const std::string &name, int channels, double samplerate,
+             double ready_time = FilePluginDefaultReadyTime);
   virtual ~FilePlugin();
 
   // Plugin
@@ -57,12 +79,47 @@ class FilePlugin : public Plugin,
 
  private:
   void initialise(LOAD_CALLBACK callback);
-  void decode(long frame_index, long frames, LOAD_CALLBACK callback);
+  void createDecoder(const LoadScheduler::DONE_CALLBACK &done,
+                     unsigned long generation);
+  // Tells everyone waiting how the load started in a generation went.
+  // Returns how many were told, or -1 when an eviction has answered them
+  // since and the load is of no use.
+  int finishInitialising(const Load &load, unsigned long generation);
+  // Asks for the chunks covering some frames of the file, calling ready once
+  // they have all arrived or failed to
+  void requestChunks(long frame_index, long frames,
+                     const std::function<void()> &ready);
+  void requestChunk(long chunk_index, const std::function<void()> &arrived);
+  // Decodes the rest of the cache time once the file has loaded, after the
+  // loads of every other file
+  void fillCache(long frame_index, long frames);
+  void chunkArrived(long chunk_index, const PCMCache::CHUNK &chunk);
+  // Lets go of the chunks that have played before a frame of the file, and
+  // any too far ahead of it to fit
+  void releaseChunks(long frame_index);
+  // Chunks nobody else is decoding are decoded one after another, by when
+  // playback reaches them
+  void queueDecode(long chunk_index);
+  void decodeChunk(long chunk_index);
+  DecodeScheduler::DEADLINE chunkDeadline(long chunk_index) const;
+  // When playback at a frame of the graph next needs the file, and how much
+  // memory it takes to be ready for it
+  PrefetchPlanner::Demand prefetchDemand(long frame_index) const;
+  long cacheFrames() const;
+  // Lets go of the decoder and the chunks, leaving its audio to the cache
+  void evict();
 
   const std::shared_ptr<decoder::Factory> _factory;
+  const std::shared_ptr<LoadScheduler> _load_scheduler;
+  const std::shared_ptr<PCMCache> _pcm_cache;
+  const std::shared_ptr<DiskPCMCache> _disk_pcm_cache;
+  const std::shared_ptr<DecodeScheduler> _decode_scheduler;
+  const std::shared_ptr<PrefetchPlanner> _prefetch_planner;
+  const std::shared_ptr<ChannelProbe> _channel_probe;
   const std::string _name;
   const int _channels;
   const double _samplerate;
+  const double _ready_time;
 
   // grapher config
   const std::string _path;
@@ -73,13 +130,35 @@ class FilePlugin : public Plugin,
   std::atomic<bool> _loaded;
   std::shared_ptr<decoder::Decoder> _decoder;
   std::mutex _decoder_mutex;
+  // Only changed with the initialise mutex held, along with the generation
+  // and the load callbacks, but read without it
   std::atomic<bool> _initialised;
 
-  std::atomic<long> _cached_samples_start_frame_index;
-  std::vector<float> _cached_samples;
-  std::mutex _cached_samples_mutex;
+  // The chunks of the file this plugin holds on to, enough for the cache
+  // time and the chunk before the one playing
+  ChunkRing _chunks;
   std::atomic<bool> _initialising;
-  std::atomic<bool> _decoding;
+  // Where the graph last rendered, which decodes are scheduled relative to
+  std::atomic<long> _render_frame_index;
+  // Only touched by run(), so by the thread pumping the graph (the player's
+  // run loop, or an offline segment's own thread), never the render callback
+  long _last_run_frame_index;
+  std::chrono::steady_clock::time_point _last_run_time;
+  // What the planner last told the file to hold
+  std::atomic<PrefetchPlanner::Residency> _residency;
+  // How fast the file's time runs against the clock, which loops and
+  // stretches above it change
+  std::atomic<double> _rate;
+  // Where playback last jumped back from and to, as it will again each time
+  // round a loop
+  std::atomic<long> _wrap_from_frame_index;
+  std::atomic<long> _wrap_to_frame_index;
+  // Everyone who asked to load while the decoder was being created
+  std::vector<LOAD_CALLBACK> _load_callbacks;
+  // Bumped by every eviction, so a decoder created for the load before it is
+  // dropped when it arrives
+  unsigned long _initialise_generation;
+  std::mutex _initialise_mutex;
 };
 
 }  // namespace file
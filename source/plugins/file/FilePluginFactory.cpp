@@ -22,13 +22,12 @@
 
 #include <NFGrapher/NFGrapher.h>
 
-#include "FilePlugin.h"
-
 namespace nativeformat {
 namespace plugin {
 namespace file {
 
-FilePluginFactory::FilePluginFactory(std::shared_ptr<http::Client> client)
+FilePluginFactory::FilePluginFactory(std::shared_ptr<http::Client> client,
+                                     double ready_time)
     : _client(client),
       _manifest_factory(decoder::createManifestFactory(client)),
       _decrypter_factory(
@@ -36,7 +35,14 @@ FilePluginFactory::FilePluginFactory(std::shared_ptr<http::Client> client)
       _data_provider_factory(
           decoder::createDataProviderFactory(client, _manifest_factory)),
       _decoder_factory(decoder::createFactory(
-          _data_provider_factory, _decrypter_factory, _manifest_factory)) {}
+          _data_provider_factory, _decrypter_factory, _manifest_factory)),
+      _load_scheduler(std::make_shared<LoadScheduler>()),
+      _pcm_cache(PCMCache::sharedCache()),
+      _disk_pcm_cache(DiskPCMCache::sharedCache()),
+      _decode_scheduler(DecodeScheduler::sharedScheduler()),
+      _prefetch_planner(PrefetchPlanner::sharedPlanner()),
+      _channel_probe(ChannelProbe::sharedProbe()),
+      _ready_time(ready_time) {}
 
 FilePluginFactory::~FilePluginFactory() {}
 
@@ -51,6 +57,14 @@ std::shared_ptr<Plugin> FilePluginFactory::createPlugin(
   return plugin;
 }
 
+int FilePluginFactory::channels(const nfgrapher::Node &grapher_node,
+                                int input_channels, int channels) const {
+  // Decoders open files at whatever width they're asked for, so a file only
+  // narrows once its decoded audio has shown it carries one channel
+  nfgrapher::contract::FileNodeInfo file_node(grapher_node);
+  return _channel_probe->channels(file_node._file, channels);
+}
+
 std::vector<std::string> FilePluginFactory::identifiers() const {
   return {nfgrapher::contract::FileNodeInfo::kind()};
 }
@@ -60,8 +74,11 @@ std::shared_ptr<Plugin> FilePluginFactory::filePluginForIdentifier(
     const std::string &graph_id, int channels, double samplerate,
     const std::string &session_id) {
   nfgrapher::contract::FileNodeInfo grapher_file_node(grapher_node);
-  return std::make_shared<FilePlugin>(_decoder_factory, grapher_node,
-                                      identifier, channels, samplerate);
+  return std::make_shared<FilePlugin>(_decoder_factory, _load_scheduler,
+                                      _pcm_cache, _disk_pcm_cache,
+                                      _decode_scheduler, _prefetch_planner,
+                                      _channel_probe, grapher_node, identifier,
+                                      channels, samplerate, _ready_time);
 }
 
 }  // namespace file
@@ -24,13 +24,22 @@
 #include <NFHTTP/Client.h>
 #include <NFSmartPlayer/Factory.h>
 
+#include "ChannelProbe.h"
+#include "DecodeScheduler.h"
+#include "DiskPCMCache.h"
+#include "FilePlugin.h"
+#include "LoadScheduler.h"
+#include "PCMCache.h"
+#include "PrefetchPlanner.h"
+
 namespace nativeformat {
 namespace plugin {
 namespace file {
 
 class FilePluginFactory : public Factory {
  public:
-  FilePluginFactory(std::shared_ptr<http::Client> client);
+  FilePluginFactory(std::shared_ptr<http::Client> client,
+                    double ready_time = FilePluginDefaultReadyTime);
   virtual ~FilePluginFactory();
 
   // Factory
@@ -39,6 +48,8 @@ class FilePluginFactory : public Factory {
       const NF_PLUGIN_RESOLVE_CALLBACK &resolve_callback, int channels,
       double samplerate, const std::shared_ptr<plugin::Plugin> &child_plugin,
       const std::string &session_id) override;
+  int channels(const nfgrapher::Node &grapher_node, int input_channels,
+               int channels) const override;
   std::vector<std::string> identifiers() const override;
 
  private:
@@ -52,6 +63,15 @@ class FilePluginFactory : public Factory {
   const std::shared_ptr<decoder::DecrypterFactory> _decrypter_factory;
   const std::shared_ptr<decoder::DataProviderFactory> _data_provider_factory;
   const std::shared_ptr<decoder::Factory> _decoder_factory;
+  // Shared by every file the factory creates, across all of its graphs
+  const std::shared_ptr<LoadScheduler> _load_scheduler;
+  const std::shared_ptr<PCMCache> _pcm_cache;
+  const std::shared_ptr<DiskPCMCache> _disk_pcm_cache;
+  const std::shared_ptr<DecodeScheduler> _decode_scheduler;
+  const std::shared_ptr<PrefetchPlanner> _prefetch_planner;
+  const std::shared_ptr<ChannelProbe> _channel_probe;
+  // Seconds of audio each file decodes before it reports it has loaded
+  const double _ready_time;
 };
 
 }  // namespace file
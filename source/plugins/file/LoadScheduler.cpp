@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "LoadScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+const size_t LoadSchedulerDefaultMaximumLoads = 4;
+
+LoadScheduler::LoadScheduler(size_t maximum_loads)
+    : _maximum_loads(std::max(maximum_loads, static_cast<size_t>(1))),
+      _scheduled_loads(0),
+      _active_loads(0) {}
+
+LoadScheduler::~LoadScheduler() {}
+
+void LoadScheduler::schedule(long start_sample_index, const LOAD_TASK &task,
+                             bool background) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queue[std::make_tuple(background, start_sample_index,
+                           _scheduled_loads++)] = task;
+  }
+  dispatch();
+}
+
+size_t LoadScheduler::maximumLoads() const { return _maximum_loads; }
+
+size_t LoadScheduler::activeLoads() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _active_loads;
+}
+
+size_t LoadScheduler::queuedLoads() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _queue.size();
+}
+
+void LoadScheduler::dispatch() {
+  while (true) {
+    LOAD_TASK task;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_queue.empty()) {
+        return;
+      }
+      auto queue_it = _queue.begin();
+      const bool background = std::get<0>(queue_it->first);
+      const size_t maximum_loads =
+          background ? std::max(_maximum_loads - 1, static_cast<size_t>(1))
+                     : _maximum_loads;
+      if (_active_loads >= maximum_loads) {
+        return;
+      }
+      task = std::move(queue_it->second);
+      _queue.erase(queue_it);
+      ++_active_loads;
+    }
+    // Only the first call to done counts, so a load can't free up two slots
+    auto strong_this = shared_from_this();
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    task([strong_this, done]() {
+      if (!done->exchange(true)) {
+        strong_this->finish();
+      }
+    });
+  }
+}
+
+void LoadScheduler::finish() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    --_active_loads;
+  }
+  dispatch();
+}
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
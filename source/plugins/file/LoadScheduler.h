@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+extern const size_t LoadSchedulerDefaultMaximumLoads;
+
+/**
+ * Runs loads a few at a time rather than all at once, starting the ones whose
+ * content is heard soonest first, so a large score gets its first seconds
+ * ready before it opens decoders for clips that start minutes later.
+ */
+class LoadScheduler : public std::enable_shared_from_this<LoadScheduler> {
+ public:
+  typedef std::function<void()> DONE_CALLBACK;
+  // Starts a load, which has to call done once it has finished either way
+  typedef std::function<void(const DONE_CALLBACK &done)> LOAD_TASK;
+
+  explicit LoadScheduler(
+      size_t maximum_loads = LoadSchedulerDefaultMaximumLoads);
+  virtual ~LoadScheduler();
+
+  /**
+   * Queues a load to start once fewer than the maximum are running
+   * @param start_sample_index Where in the graph the content being loaded is
+   * first heard, loads that are needed sooner start first
+   * @param task The load to run
+   * @param background Whether the load only gets ahead of time, background
+   * loads start after every other load and leave a slot free for them
+   */
+  void schedule(long start_sample_index, const LOAD_TASK &task,
+                bool background = false);
+  size_t maximumLoads() const;
+  // The loads that have started and not yet finished
+  size_t activeLoads() const;
+  // The loads waiting to start
+  size_t queuedLoads() const;
+
+ private:
+  void dispatch();
+  void finish();
+
+  const size_t _maximum_loads;
+  mutable std::mutex _mutex;
+  // Keyed by whether the load is in the background, start sample index, then
+  // by the order the loads were scheduled
+  std::map<std::tuple<bool, long, unsigned long>, LOAD_TASK> _queue;
+  unsigned long _scheduled_loads;
+  size_t _active_loads;
+};
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
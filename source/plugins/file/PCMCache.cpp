@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "PCMCache.h"
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+const long PCMCacheChunkFrames = 32768;
+const size_t PCMCacheDefaultBudgetBytes = 256 * 1024 * 1024;
+
+static size_t ChunkBytes(const PCMCache::Chunk &chunk) {
+  return chunk._samples.size() * sizeof(float);
+}
+
+std::shared_ptr<PCMCache> PCMCache::sharedCache() {
+  static std::shared_ptr<PCMCache> shared_cache = std::make_shared<PCMCache>();
+  return shared_cache;
+}
+
+PCMCache::PCMCache(size_t budget_bytes)
+    : _budget_bytes(budget_bytes),
+      _resident_bytes(0),
+      _hits(0),
+      _shared(0),
+      _misses(0) {}
+
+PCMCache::~PCMCache() {}
+
+PCMCache::CHUNK PCMCache::find(const std::string &path, double samplerate,
+                               int channels, long chunk_index,
+                               const CHUNK_CALLBACK &callback, bool &decode) {
+  decode = false;
+  std::lock_guard<std::mutex> lock(_mutex);
+  const KEY key(path, samplerate, channels, chunk_index);
+  auto entry_it = _entries.find(key);
+  if (entry_it != _entries.end()) {
+    _lru.splice(_lru.begin(), _lru, entry_it->second._lru_it);
+    ++_hits;
+    return entry_it->second._chunk;
+  }
+  auto pending_it = _pending.find(key);
+  if (pending_it != _pending.end()) {
+    ++_shared;
+  } else {
+    ++_misses;
+    pending_it =
+        _pending.insert(std::make_pair(key, std::vector<CHUNK_CALLBACK>()))
+            .first;
+    decode = true;
+  }
+  if (callback) {
+    pending_it->second.push_back(callback);
+  }
+  return nullptr;
+}
+
+void PCMCache::insert(const std::string &path, double samplerate,
+                      int channels, long chunk_index, const CHUNK &chunk) {
+  std::vector<CHUNK_CALLBACK> callbacks;
+  std::vector<CHUNK> evicted_chunks;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const KEY key(path, samplerate, channels, chunk_index);
+    auto pending_it = _pending.find(key);
+    if (pending_it != _pending.end()) {
+      callbacks.swap(pending_it->second);
+      _pending.erase(pending_it);
+    }
+    if (chunk && _entries.find(key) == _entries.end()) {
+      _lru.push_front(key);
+      _entries[key] = {chunk, _lru.begin()};
+      _resident_bytes += ChunkBytes(*chunk);
+      evicted_chunks = evict();
+    }
+  }
+  for (const auto &callback : callbacks) {
+    callback(chunk);
+  }
+}
+
+void PCMCache::setBudgetBytes(size_t budget_bytes) {
+  std::vector<CHUNK> evicted_chunks;
+  std::lock_guard<std::mutex> lock(_mutex);
+  _budget_bytes = budget_bytes;
+  evicted_chunks = evict();
+}
+
+smartplayer::CacheStats PCMCache::stats() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  const long lookups = _hits + _shared + _misses;
+  return {_hits,
+          _shared,
+          _misses,
+          lookups > 0 ? static_cast<double>(_hits + _shared) / lookups : 0.0,
+          _resident_bytes,
+          _budget_bytes};
+}
+
+std::vector<PCMCache::CHUNK> PCMCache::evict() {
+  std::vector<CHUNK> evicted_chunks;
+  while (_resident_bytes > _budget_bytes && !_lru.empty()) {
+    auto entry_it = _entries.find(_lru.back());
+    _resident_bytes -= ChunkBytes(*entry_it->second._chunk);
+    evicted_chunks.push_back(entry_it->second._chunk);
+    _entries.erase(entry_it);
+    _lru.pop_back();
+  }
+  return evicted_chunks;
+}
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
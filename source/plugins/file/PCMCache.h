@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/CacheStats.h>
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+extern const long PCMCacheChunkFrames;
+extern const size_t PCMCacheDefaultBudgetBytes;
+
+/**
+ * Decoded audio shared between every file playing the same path at the same
+ * sample rate and channel count, in chunks of a fixed number of frames.
+ * Chunks nobody has used for the longest are dropped once the cache holds
+ * more than its budget, although they stay in memory for as long as a file
+ * is still holding on to them.
+ */
+class PCMCache {
+ public:
+  struct Chunk {
+    std::vector<float> _samples;
+    int _channels;
+    // Whether the file ends within this chunk, anything after it is silence
+    bool _eof;
+
+    long frames() const {
+      return _channels > 0 ? _samples.size() / _channels : 0;
+    }
+  };
+  typedef std::shared_ptr<const Chunk> CHUNK;
+  typedef std::function<void(const CHUNK &chunk)> CHUNK_CALLBACK;
+
+  // The cache every file in the process shares
+  static std::shared_ptr<PCMCache> sharedCache();
+
+  explicit PCMCache(size_t budget_bytes = PCMCacheDefaultBudgetBytes);
+  virtual ~PCMCache();
+
+  /**
+   * Looks up a chunk of a file's audio
+   * @param path The file the chunk belongs to
+   * @param samplerate The sample rate the file is decoded at
+   * @param channels The number of channels the file is decoded to
+   * @param chunk_index Which chunk, counting in PCMCacheChunkFrames
+   * @param callback Called with the chunk once it has been decoded when it
+   * isn't cached yet, or with null if decoding it failed
+   * @param decode Set when nobody is decoding the chunk yet, in which case
+   * the caller decodes it and inserts it
+   * @return The chunk if it is cached, in which case callback isn't called
+   */
+  CHUNK find(const std::string &path, double samplerate, int channels,
+             long chunk_index, const CHUNK_CALLBACK &callback, bool &decode);
+  /**
+   * Caches a decoded chunk and hands it to everyone waiting on it
+   * @param chunk The chunk, or null to tell them decoding it failed
+   */
+  void insert(const std::string &path, double samplerate, int channels,
+              long chunk_index, const CHUNK &chunk);
+  void setBudgetBytes(size_t budget_bytes);
+  smartplayer::CacheStats stats() const;
+
+ private:
+  typedef std::tuple<std::string, double, int, long> KEY;
+  struct Entry {
+    CHUNK _chunk;
+    std::list<KEY>::iterator _lru_it;
+  };
+
+  // Returns the chunks it dropped, so they can be freed outside the lock
+  std::vector<CHUNK> evict();
+
+  mutable std::mutex _mutex;
+  std::map<KEY, Entry> _entries;
+  // Most recently used first
+  std::list<KEY> _lru;
+  std::map<KEY, std::vector<CHUNK_CALLBACK>> _pending;
+  size_t _budget_bytes;
+  size_t _resident_bytes;
+  long _hits;
+  long _shared;
+  long _misses;
+};
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
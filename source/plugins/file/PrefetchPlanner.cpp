@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "PrefetchPlanner.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+const size_t PrefetchPlannerDefaultBudgetBytes = 128 * 1024 * 1024;
+const double PrefetchPlannerDefaultDecodeTime = 10.0;
+const double PrefetchPlannerDefaultOpenTime = 30.0;
+const std::chrono::milliseconds PrefetchPlannerDefaultInterval(100);
+
+std::shared_ptr<PrefetchPlanner> PrefetchPlanner::sharedPlanner() {
+  static std::shared_ptr<PrefetchPlanner> shared_planner =
+      std::make_shared<PrefetchPlanner>();
+  return shared_planner;
+}
+
+PrefetchPlanner::PrefetchPlanner(size_t budget_bytes, double decode_time,
+                                 double open_time,
+                                 std::chrono::milliseconds interval)
+    : _decode_time(decode_time),
+      _open_time(std::max(open_time, decode_time)),
+      _interval(interval),
+      _budget_bytes(budget_bytes),
+      _planned_bytes(0),
+      _evictions(0),
+      _deferrals(0) {}
+
+PrefetchPlanner::~PrefetchPlanner() {}
+
+PrefetchPlanner::Residency PrefetchPlanner::plan(const void *file,
+                                                 const Demand &demand) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto entry_it = _entries.find(file);
+  const bool new_file = entry_it == _entries.end();
+  if (new_file) {
+    const Entry entry = {demand, ResidencyEvicted, false};
+    entry_it = _entries.insert(std::make_pair(file, entry)).first;
+  } else {
+    entry_it->second._demand = demand;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (new_file || now - _planned_time >= _interval) {
+    replan();
+    _planned_time = now;
+  }
+  return entry_it->second._residency;
+}
+
+void PrefetchPlanner::remove(const void *file) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _entries.erase(file);
+}
+
+void PrefetchPlanner::setBudgetBytes(size_t budget_bytes) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _budget_bytes = budget_bytes;
+  replan();
+}
+
+smartplayer::PrefetchStats PrefetchPlanner::stats() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  size_t decoded_files = 0;
+  size_t open_files = 0;
+  for (const auto &entry : _entries) {
+    if (entry.second._residency == ResidencyDecoded) {
+      ++decoded_files;
+    } else if (entry.second._residency == ResidencyOpen) {
+      ++open_files;
+    }
+  }
+  return {_budget_bytes, _planned_bytes, decoded_files,
+          open_files,    _evictions,     _deferrals};
+}
+
+void PrefetchPlanner::replan() {
+  // Soonest first, files that aren't needed again are left out
+  std::vector<std::pair<double, Entry *>> needed_entries;
+  for (auto &entry : _entries) {
+    if (entry.second._demand._seconds >= 0.0) {
+      needed_entries.push_back(
+          std::make_pair(entry.second._demand._seconds, &entry.second));
+    } else {
+      if (entry.second._residency != ResidencyEvicted) {
+        ++_evictions;
+      }
+      entry.second._residency = ResidencyEvicted;
+      entry.second._deferred = false;
+    }
+  }
+  std::stable_sort(needed_entries.begin(), needed_entries.end(),
+                   [](const std::pair<double, Entry *> &lhs,
+                      const std::pair<double, Entry *> &rhs) {
+                     return lhs.first < rhs.first;
+                   });
+
+  size_t planned_bytes = 0;
+  for (const auto &needed_entry : needed_entries) {
+    Entry &entry = *needed_entry.second;
+    const double seconds = needed_entry.first;
+    const size_t bytes = entry._demand._bytes;
+    Residency residency = ResidencyEvicted;
+    bool deferred = false;
+    if (seconds <= 0.0 ||
+        (seconds <= _decode_time && planned_bytes + bytes <= _budget_bytes)) {
+      residency = ResidencyDecoded;
+      planned_bytes += bytes;
+    } else if (seconds <= _open_time) {
+      // Opening the decoder now still saves time when it comes to play
+      residency = ResidencyOpen;
+      deferred = seconds <= _decode_time;
+    }
+    if (deferred && !entry._deferred) {
+      ++_deferrals;
+    }
+    if (residency < entry._residency) {
+      ++_evictions;
+    }
+    entry._residency = residency;
+    entry._deferred = deferred;
+  }
+  _planned_bytes = planned_bytes;
+}
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
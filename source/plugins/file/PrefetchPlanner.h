@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <NFSmartPlayer/PrefetchStats.h>
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace nativeformat {
+namespace plugin {
+namespace file {
+
+extern const size_t PrefetchPlannerDefaultBudgetBytes;
+extern const double PrefetchPlannerDefaultDecodeTime;
+extern const double PrefetchPlannerDefaultOpenTime;
+extern const std::chrono::milliseconds PrefetchPlannerDefaultInterval;
+
+/**
+ * Decides which files keep their audio decoded ahead of playback, which only
+ * keep their decoder open, and which let go of both. Files needed soonest are
+ * decoded first until the decoded audio would take more than the budget, the
+ * files playing always keep theirs.
+ */
+class PrefetchPlanner {
+ public:
+  typedef enum : int {
+    ResidencyEvicted,  // Holds neither a decoder nor any audio
+    ResidencyOpen,     // Keeps its decoder open
+    ResidencyDecoded   // Keeps its decoder and the audio it plays next
+  } Residency;
+
+  struct Demand {
+    // Seconds until playback needs the file, 0 while it plays, or negative if
+    // it isn't going to be needed again
+    double _seconds;
+    // Bytes of decoded audio the file holds when it is decoded
+    size_t _bytes;
+  };
+
+  // The planner every file in the process shares
+  static std::shared_ptr<PrefetchPlanner> sharedPlanner();
+
+  explicit PrefetchPlanner(
+      size_t budget_bytes = PrefetchPlannerDefaultBudgetBytes,
+      double decode_time = PrefetchPlannerDefaultDecodeTime,
+      double open_time = PrefetchPlannerDefaultOpenTime,
+      std::chrono::milliseconds interval = PrefetchPlannerDefaultInterval);
+  virtual ~PrefetchPlanner();
+
+  /**
+   * Tells the planner what a file needs, planning again if the last plan is
+   * older than the interval or the file is new to it
+   * @param file The file the demand belongs to
+   * @return What the file should hold, as of the latest plan
+   */
+  Residency plan(const void *file, const Demand &demand);
+  // Forgets a file, freeing its share of the budget at the next plan
+  void remove(const void *file);
+  void setBudgetBytes(size_t budget_bytes);
+  smartplayer::PrefetchStats stats() const;
+
+ private:
+  struct Entry {
+    Demand _demand;
+    Residency _residency;
+    // Whether the budget is keeping it from decoding ahead
+    bool _deferred;
+  };
+
+  void replan();
+
+  const double _decode_time;
+  const double _open_time;
+  const std::chrono::milliseconds _interval;
+
+  mutable std::mutex _mutex;
+  std::map<const void *, Entry> _entries;
+  std::chrono::steady_clock::time_point _planned_time;
+  size_t _budget_bytes;
+  size_t _planned_bytes;
+  long _evictions;
+  long _deferrals;
+};
+
+}  // namespace file
+}  // namespace plugin
+}  // namespace nativeformat
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "ChannelProbe.h"
+
+BOOST_AUTO_TEST_SUITE(ChannelProbeTests)
+using namespace nativeformat::plugin::file;
+
+static const double SAMPLERATE = 44100.0;
+static const int CHANNELS = 2;
+
+static PCMCache::Chunk createChunk(float left, float right) {
+  PCMCache::Chunk chunk;
+  chunk._channels = CHANNELS;
+  chunk._eof = false;
+  for (long i = 0; i < PCMCacheChunkFrames; ++i) {
+    chunk._samples.push_back(left + i);
+    chunk._samples.push_back(right + i);
+  }
+  return chunk;
+}
+
+BOOST_AUTO_TEST_CASE(testChannelProbeNarrowsOnceEveryChunkIsIdentical) {
+  ChannelProbe channel_probe;
+  BOOST_CHECK_EQUAL(channel_probe.channels("mono.wav", CHANNELS), CHANNELS);
+  channel_probe.record("mono.wav", SAMPLERATE, 3, 0, createChunk(1.0f, 1.0f));
+  channel_probe.record("mono.wav", SAMPLERATE, 3, 2, createChunk(1.0f, 1.0f));
+  // Any chunk not seen yet could still differ
+  BOOST_CHECK_EQUAL(channel_probe.channels("mono.wav", CHANNELS), CHANNELS);
+  channel_probe.record("mono.wav", SAMPLERATE, 3, 1, createChunk(1.0f, 1.0f));
+  BOOST_CHECK_EQUAL(channel_probe.channels("mono.wav", CHANNELS), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testChannelProbeKeepsFilesThatDifferWide) {
+  ChannelProbe channel_probe;
+  channel_probe.record("stereo.wav", SAMPLERATE, 2, 0,
+                       createChunk(1.0f, 1.0f));
+  channel_probe.record("stereo.wav", SAMPLERATE, 2, 1,
+                       createChunk(1.0f, 2.0f));
+  channel_probe.record("stereo.wav", SAMPLERATE, 2, 1,
+                       createChunk(1.0f, 1.0f));
+  BOOST_CHECK_EQUAL(channel_probe.channels("stereo.wav", CHANNELS), CHANNELS);
+}
+
+BOOST_AUTO_TEST_CASE(testChannelProbeKeepsFilesOfUnknownLengthWide) {
+  ChannelProbe channel_probe;
+  channel_probe.record("stream.wav", SAMPLERATE, 0, 0,
+                       createChunk(1.0f, 1.0f));
+  BOOST_CHECK_EQUAL(channel_probe.channels("stream.wav", CHANNELS), CHANNELS);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <thread>
+
+#include "ChunkRing.h"
+
+BOOST_AUTO_TEST_SUITE(ChunkRingTests)
+using namespace nativeformat::plugin::file;
+
+static PCMCache::CHUNK makeChunk(float value) {
+  auto chunk = std::make_shared<PCMCache::Chunk>();
+  chunk->_channels = 1;
+  chunk->_samples.assign(4, value);
+  chunk->_eof = false;
+  return chunk;
+}
+
+BOOST_AUTO_TEST_CASE(testChunkRingRoundsCapacityUp) {
+  ChunkRing chunk_ring(17);
+  BOOST_CHECK_EQUAL(chunk_ring.capacity(), 32);
+}
+
+BOOST_AUTO_TEST_CASE(testChunkRingTurnsAwayChunksWhoseSlotIsTaken) {
+  ChunkRing chunk_ring(4);
+  BOOST_CHECK(chunk_ring.publish(1, makeChunk(1.0f)));
+  BOOST_CHECK(chunk_ring.contains(1));
+  BOOST_CHECK_EQUAL(chunk_ring.peek(1)->_samples[0], 1.0f);
+  // Chunk 5 shares chunk 1's slot
+  BOOST_CHECK(!chunk_ring.publish(5, makeChunk(5.0f)));
+  BOOST_CHECK(!chunk_ring.peek(5));
+  chunk_ring.releaseOutside(2);
+  BOOST_CHECK(!chunk_ring.contains(1));
+  BOOST_CHECK(chunk_ring.publish(5, makeChunk(5.0f)));
+  BOOST_CHECK_EQUAL(chunk_ring.peek(5)->_samples[0], 5.0f);
+}
+
+BOOST_AUTO_TEST_CASE(testChunkRingReleasesChunksOutsideTheWindow) {
+  ChunkRing chunk_ring(4);
+  for (long chunk_index = 0; chunk_index < 4; ++chunk_index) {
+    chunk_ring.publish(chunk_index, makeChunk(chunk_index));
+  }
+  chunk_ring.releaseOutside(2);
+  BOOST_CHECK(!chunk_ring.contains(0));
+  BOOST_CHECK(!chunk_ring.contains(1));
+  BOOST_CHECK(chunk_ring.contains(2));
+  BOOST_CHECK(chunk_ring.contains(3));
+  // Seeking back lets go of the chunks ahead that no longer fit
+  chunk_ring.publish(4, makeChunk(4.0f));
+  chunk_ring.releaseOutside(0);
+  BOOST_CHECK(chunk_ring.contains(2));
+  BOOST_CHECK(chunk_ring.contains(3));
+  BOOST_CHECK(!chunk_ring.contains(4));
+}
+
+BOOST_AUTO_TEST_CASE(testChunkRingMarksRequestsUntilReleased) {
+  ChunkRing chunk_ring(4);
+  BOOST_CHECK(chunk_ring.markRequested(3));
+  BOOST_CHECK(!chunk_ring.markRequested(3));
+  chunk_ring.clearRequested(3);
+  BOOST_CHECK(chunk_ring.markRequested(3));
+  chunk_ring.publish(3, makeChunk(3.0f));
+  chunk_ring.releaseOutside(4);
+  BOOST_CHECK(chunk_ring.markRequested(3));
+}
+
+BOOST_AUTO_TEST_CASE(testChunkRingHandsChunksBetweenThreads) {
+  ChunkRing chunk_ring(8);
+  const long chunks = 10000;
+  std::thread producer([&chunk_ring, chunks]() {
+    for (long chunk_index = 0; chunk_index < chunks; ++chunk_index) {
+      while (!chunk_ring.publish(chunk_index,
+                                 makeChunk(static_cast<float>(chunk_index)))) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  long mismatches = 0;
+  for (long chunk_index = 0; chunk_index < chunks; ++chunk_index) {
+    const PCMCache::Chunk *chunk = nullptr;
+    while (!(chunk = chunk_ring.peek(chunk_index))) {
+      std::this_thread::yield();
+    }
+    if (chunk->_samples[3] != static_cast<float>(chunk_index)) {
+      ++mismatches;
+    }
+    chunk_ring.releaseOutside(chunk_index + 1);
+  }
+  producer.join();
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testChunkRingReleasesWhileTheRenderThreadReads) {
+  ChunkRing chunk_ring(4);
+  std::atomic<bool> reading(true);
+  long mismatches = 0;
+  std::thread render_thread([&chunk_ring, &reading, &mismatches]() {
+    while (reading) {
+      for (long chunk_index = 0; chunk_index < 4; ++chunk_index) {
+        chunk_ring.beginRead();
+        if (const PCMCache::Chunk *chunk = chunk_ring.peek(chunk_index)) {
+          for (float sample : chunk->_samples) {
+            if (sample != static_cast<float>(chunk_index)) {
+              ++mismatches;
+            }
+          }
+        }
+        chunk_ring.endRead();
+      }
+    }
+  });
+  for (int i = 0; i < 10000; ++i) {
+    for (long chunk_index = 0; chunk_index < 4; ++chunk_index) {
+      chunk_ring.publish(chunk_index, makeChunk(chunk_index));
+    }
+    chunk_ring.releaseOutside(i % 2 == 0 ? 4 : 2);
+  }
+  reading = false;
+  render_thread.join();
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
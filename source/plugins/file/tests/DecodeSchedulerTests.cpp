@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DecodeScheduler.h"
+
+BOOST_AUTO_TEST_SUITE(DecodeSchedulerTests)
+using namespace nativeformat::plugin::file;
+
+// Holds the scheduler's only thread until the test lets it go
+class Gate {
+ public:
+  Gate() : _open(false) {}
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this]() { return _open; });
+  }
+  void open() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _open = true;
+    }
+    _condition.notify_all();
+  }
+
+ private:
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  bool _open;
+};
+
+static void waitUntilIdle(const DecodeScheduler &decode_scheduler) {
+  while (true) {
+    auto stats = decode_scheduler.stats();
+    if (stats._queued == 0 && stats._active == 0) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+static DecodeScheduler::DEADLINE inSeconds(double seconds) {
+  return std::chrono::steady_clock::now() +
+         std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+             std::chrono::duration<double>(seconds));
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeSchedulerStartsSoonestDeadlineFirst) {
+  DecodeScheduler decode_scheduler(1);
+  Gate gate;
+  std::mutex order_mutex;
+  std::vector<int> order;
+  auto record = [&order_mutex, &order](int decode) {
+    return [&order_mutex, &order, decode]() {
+      std::lock_guard<std::mutex> lock(order_mutex);
+      order.push_back(decode);
+    };
+  };
+  int owners[5];
+  decode_scheduler.schedule(&owners[0], inSeconds(0.0),
+                            [&gate]() { gate.wait(); }, nullptr);
+  decode_scheduler.schedule(&owners[1], inSeconds(30.0), record(1), nullptr);
+  decode_scheduler.schedule(&owners[2], inSeconds(10.0), record(2), nullptr);
+  decode_scheduler.schedule(&owners[3], inSeconds(20.0), record(3), nullptr);
+  decode_scheduler.schedule(&owners[4], inSeconds(10.0), record(4), nullptr);
+  gate.open();
+  waitUntilIdle(decode_scheduler);
+  BOOST_CHECK(order == std::vector<int>({2, 4, 3, 1}));
+  BOOST_CHECK_EQUAL(decode_scheduler.stats()._completed, 5);
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeSchedulerRunsAnOwnersDecodesOneAtATime) {
+  DecodeScheduler decode_scheduler(4);
+  std::mutex running_mutex;
+  int running = 0;
+  int most_running = 0;
+  int owner = 0;
+  for (int i = 0; i < 20; ++i) {
+    decode_scheduler.schedule(
+        &owner, inSeconds(1.0),
+        [&running_mutex, &running, &most_running]() {
+          {
+            std::lock_guard<std::mutex> lock(running_mutex);
+            most_running = std::max(most_running, ++running);
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          std::lock_guard<std::mutex> lock(running_mutex);
+          --running;
+        },
+        nullptr);
+  }
+  waitUntilIdle(decode_scheduler);
+  BOOST_CHECK_EQUAL(most_running, 1);
+  BOOST_CHECK_EQUAL(decode_scheduler.stats()._completed, 20);
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeSchedulerCancelsAnOwnersQueuedDecodes) {
+  DecodeScheduler decode_scheduler(1);
+  Gate gate;
+  int owners[2];
+  int ran = 0;
+  int cancelled = 0;
+  decode_scheduler.schedule(&owners[0], inSeconds(0.0),
+                            [&gate]() { gate.wait(); }, nullptr);
+  for (int i = 0; i < 3; ++i) {
+    decode_scheduler.schedule(&owners[1], inSeconds(1.0), [&ran]() { ++ran; },
+                              [&cancelled]() { ++cancelled; });
+  }
+  decode_scheduler.schedule(&owners[0], inSeconds(1.0), [&ran]() { ++ran; },
+                            [&cancelled]() { ++cancelled; });
+  BOOST_CHECK_EQUAL(decode_scheduler.cancel(&owners[1]), 3);
+  BOOST_CHECK_EQUAL(cancelled, 3);
+  gate.open();
+  waitUntilIdle(decode_scheduler);
+  BOOST_CHECK_EQUAL(ran, 1);
+  BOOST_CHECK_EQUAL(decode_scheduler.stats()._cancelled, 3);
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeSchedulerCountsMissedDeadlines) {
+  DecodeScheduler decode_scheduler(1);
+  int owner = 0;
+  decode_scheduler.schedule(&owner, inSeconds(-1.0), []() {}, nullptr);
+  decode_scheduler.schedule(&owner, inSeconds(60.0), []() {}, nullptr);
+  waitUntilIdle(decode_scheduler);
+  auto stats = decode_scheduler.stats();
+  BOOST_CHECK_EQUAL(stats._completed, 2);
+  BOOST_CHECK_EQUAL(stats._missed, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "DiskPCMCache.h"
+
+BOOST_AUTO_TEST_SUITE(DiskPCMCacheTests)
+using namespace nativeformat::plugin::file;
+
+static const double SAMPLERATE = 44100.0;
+static const int CHANNELS = 2;
+static const long FILE_FRAMES = 1000000;
+
+// A directory of its own for each test, deleted along with its chunks
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    char directory[] = "/tmp/DiskPCMCacheTestsXXXXXX";
+    _directory = mkdtemp(directory);
+  }
+  ~TemporaryDirectory() {
+    for (const auto &name : names()) {
+      std::remove((_directory + "/" + name).c_str());
+    }
+    rmdir(_directory.c_str());
+  }
+
+  std::vector<std::string> names() const {
+    std::vector<std::string> names;
+    if (DIR *dir = opendir(_directory.c_str())) {
+      while (struct dirent *dir_entry = readdir(dir)) {
+        const std::string name = dir_entry->d_name;
+        if (name != "." && name != "..") {
+          names.push_back(name);
+        }
+      }
+      closedir(dir);
+    }
+    return names;
+  }
+  const std::string &path() const { return _directory; }
+
+ private:
+  std::string _directory;
+};
+
+static PCMCache::Chunk makeChunk(long frames, float value, bool eof = false) {
+  PCMCache::Chunk chunk;
+  chunk._channels = CHANNELS;
+  for (long i = 0; i < frames * chunk._channels; ++i) {
+    chunk._samples.push_back(value + i);
+  }
+  chunk._eof = eof;
+  return chunk;
+}
+
+BOOST_AUTO_TEST_CASE(testDiskPCMCacheReadsBackWhatItWrote) {
+  TemporaryDirectory directory;
+  DiskPCMCache disk_cache;
+  BOOST_CHECK(!disk_cache.enabled());
+  BOOST_CHECK(!disk_cache.read("a.ogg", 0, SAMPLERATE, CHANNELS, FILE_FRAMES));
+  BOOST_CHECK(disk_cache.setDirectory(directory.path()));
+  BOOST_CHECK(disk_cache.enabled());
+  BOOST_CHECK(!disk_cache.read("a.ogg", 0, SAMPLERATE, CHANNELS, FILE_FRAMES));
+  const PCMCache::Chunk written = makeChunk(100, 1.0f, true);
+  disk_cache.write("a.ogg", 3, SAMPLERATE, FILE_FRAMES, written);
+  auto chunk = disk_cache.read("a.ogg", 3, SAMPLERATE, CHANNELS, FILE_FRAMES);
+  BOOST_REQUIRE(chunk);
+  BOOST_CHECK(chunk->_samples == written._samples);
+  BOOST_CHECK_EQUAL(chunk->_channels, 2);
+  BOOST_CHECK(chunk->_eof);
+  // Keyed by chunk, sample rate and channels as well as path
+  BOOST_CHECK(!disk_cache.read("a.ogg", 4, SAMPLERATE, CHANNELS, FILE_FRAMES));
+  BOOST_CHECK(!disk_cache.read("a.ogg", 3, 48000.0, CHANNELS, FILE_FRAMES));
+  BOOST_CHECK(!disk_cache.read("a.ogg", 3, SAMPLERATE, 1, FILE_FRAMES));
+  auto stats = disk_cache.stats();
+  BOOST_CHECK_EQUAL(stats._hits, 1);
+  BOOST_CHECK_EQUAL(stats._misses, 4);
+  BOOST_CHECK_EQUAL(stats._writes, 1);
+}
+
+BOOST_AUTO_TEST_CASE(testDiskPCMCacheKeepsChunksBetweenRuns) {
+  TemporaryDirectory directory;
+  const PCMCache::Chunk written = makeChunk(100, 2.0f);
+  {
+    DiskPCMCache disk_cache;
+    disk_cache.setDirectory(directory.path());
+    disk_cache.write("a.ogg", 0, SAMPLERATE, FILE_FRAMES, written);
+  }
+  DiskPCMCache disk_cache;
+  disk_cache.setDirectory(directory.path());
+  BOOST_CHECK_GT(disk_cache.stats()._resident_bytes,
+                 written._samples.size() * sizeof(float));
+  auto chunk = disk_cache.read("a.ogg", 0, SAMPLERATE, CHANNELS, FILE_FRAMES);
+  BOOST_REQUIRE(chunk);
+  BOOST_CHECK(chunk->_samples == written._samples);
+  // The file has changed since
+  BOOST_CHECK(
+      !disk_cache.read("a.ogg", 0, SAMPLERATE, CHANNELS, FILE_FRAMES + 1));
+  BOOST_CHECK(directory.names().empty());
+}
+
+BOOST_AUTO_TEST_CASE(testDiskPCMCacheDeletesCorruptChunks) {
+  TemporaryDirectory directory;
+  DiskPCMCache disk_cache;
+  disk_cache.setDirectory(directory.path());
+  disk_cache.write("a.ogg", 0, SAMPLERATE, FILE_FRAMES, makeChunk(100, 3.0f));
+  const auto names = directory.names();
+  BOOST_REQUIRE_EQUAL(names.size(), 1);
+  {
+    std::fstream chunk_file(directory.path() + "/" + names.front(),
+                            std::ios::in | std::ios::out | std::ios::binary);
+    chunk_file.seekp(-1, std::ios::end);
+    chunk_file.put(0x7f);
+  }
+  BOOST_CHECK(!disk_cache.read("a.ogg", 0, SAMPLERATE, CHANNELS, FILE_FRAMES));
+  BOOST_CHECK_EQUAL(disk_cache.stats()._corrupt, 1);
+  BOOST_CHECK(directory.names().empty());
+}
+
+BOOST_AUTO_TEST_CASE(testDiskPCMCacheDeletesLeastRecentlyUsedOverBudget) {
+  TemporaryDirectory directory;
+  DiskPCMCache disk_cache;
+  disk_cache.setDirectory(directory.path());
+  disk_cache.write("a.ogg", 0, SAMPLERATE, FILE_FRAMES, makeChunk(100, 1.0f));
+  const size_t chunk_bytes = disk_cache.stats()._resident_bytes;
+  disk_cache.setDirectory(directory.path(), chunk_bytes * 2);
+  disk_cache.write("a.ogg", 1, SAMPLERATE, FILE_FRAMES, makeChunk(100, 2.0f));
+  BOOST_CHECK(disk_cache.read("a.ogg", 0, SAMPLERATE, CHANNELS, FILE_FRAMES));
+  disk_cache.write("a.ogg", 2, SAMPLERATE, FILE_FRAMES, makeChunk(100, 3.0f));
+  auto stats = disk_cache.stats();
+  BOOST_CHECK_EQUAL(stats._evictions, 1);
+  BOOST_CHECK_EQUAL(stats._resident_bytes, chunk_bytes * 2);
+  BOOST_CHECK_EQUAL(directory.names().size(), 2);
+  BOOST_CHECK(disk_cache.read("a.ogg", 0, SAMPLERATE, CHANNELS, FILE_FRAMES));
+  BOOST_CHECK(!disk_cache.read("a.ogg", 1, SAMPLERATE, CHANNELS, FILE_FRAMES));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
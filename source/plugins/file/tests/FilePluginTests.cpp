@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <NFGrapher/NFGrapher.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "FilePlugin.h"
+
+BOOST_AUTO_TEST_SUITE(FilePluginTests)
+using namespace nativeformat;
+using namespace nativeformat::plugin::file;
+
+static const double SAMPLERATE = 44100.0;
+static const int CHANNELS = 2;
+
+// Decodes a file whose every sample is the index of its frame
+class RampDecoder : public decoder::Decoder {
+ public:
+  RampDecoder(const std::string &path, long frames, double samplerate,
+              int channels)
+      : _path(path),
+        _frames(frames),
+        _samplerate(samplerate),
+        _channels(channels),
+        _frame_index(0) {}
+
+  double sampleRate() override { return _samplerate; }
+  int channels() override { return _channels; }
+  long currentFrameIndex() override { return _frame_index; }
+  void seek(long frame_index) override { _frame_index = frame_index; }
+  long frames() override { return _frames; }
+  void decode(long frames, const decoder::DECODE_CALLBACK &decode_callback,
+              bool synchronous) override {
+    const long decoded_frames =
+        std::max(std::min(frames, _frames - _frame_index), 0l);
+    std::vector<float> samples(decoded_frames * _channels);
+    for (long i = 0; i < decoded_frames; ++i) {
+      std::fill_n(samples.begin() + i * _channels, _channels,
+                  static_cast<float>(_frame_index + i));
+    }
+    const long frame_index = _frame_index;
+    _frame_index += decoded_frames;
+    decode_callback(frame_index, decoded_frames, samples.data());
+  }
+  bool eof() override { return _frame_index >= _frames; }
+  const std::string &path() override { return _path; }
+  void flush() override {}
+
+ private:
+  const std::string _path;
+  const long _frames;
+  const double _samplerate;
+  const int _channels;
+  long _frame_index;
+};
+
+// Opens files of a fixed length, decoded at whatever rate they're asked for
+class RampDecoderFactory : public decoder::Factory {
+ public:
+  explicit RampDecoderFactory(double seconds) : _seconds(seconds) {}
+
+  void createDecoder(const std::string &path, const std::string &mime_type,
+                     const decoder::CREATE_DECODER_CALLBACK &decoder_callback,
+                     const decoder::ERROR_DECODER_CALLBACK &error_callback,
+                     double samplerate, int channels) override {
+    decoder_callback(std::make_shared<RampDecoder>(
+        path, _seconds * samplerate, samplerate, channels));
+  }
+
+ private:
+  const double _seconds;
+};
+
+// Opens ramp files only once the test lets each of them open, in the order
+// they were asked for
+class HeldRampDecoderFactory : public decoder::Factory {
+ public:
+  explicit HeldRampDecoderFactory(double seconds) : _seconds(seconds) {}
+
+  void createDecoder(const std::string &path, const std::string &mime_type,
+                     const decoder::CREATE_DECODER_CALLBACK &decoder_callback,
+                     const decoder::ERROR_DECODER_CALLBACK &error_callback,
+                     double samplerate, int channels) override {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _held.push_back([=]() {
+      decoder_callback(std::make_shared<RampDecoder>(
+          path, _seconds * samplerate, samplerate, channels));
+    });
+  }
+
+  size_t held() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _held.size();
+  }
+
+  void open() {
+    std::function<void()> create;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      create = _held.front();
+      _held.pop_front();
+    }
+    create();
+  }
+
+ private:
+  const double _seconds;
+  std::mutex _mutex;
+  std::deque<std::function<void()>> _held;
+};
+
+static std::shared_ptr<FilePlugin> createRampFilePlugin(
+    const std::string &path, double when, double duration,
+    const std::shared_ptr<PrefetchPlanner> &prefetch_planner,
+    double samplerate = SAMPLERATE,
+    const std::shared_ptr<ChannelProbe> &channel_probe =
+        std::make_shared<ChannelProbe>(),
+    std::shared_ptr<decoder::Factory> decoder_factory = nullptr) {
+  const nlohmann::json file_json = {
+      {"id", "file-node-01"},
+      {"kind", nfgrapher::contract::FileNodeInfo::kind()},
+      {"config",
+       {{"file", path},
+        {"when", when * 1.0e9},
+        {"duration", duration * 1.0e9},
+        {"offset", 0.0}}}};
+  nfgrapher::contract::FileNodeInfo file_node((nfgrapher::Node)file_json);
+  // Decodes still running hold on to the plugin, so the scheduler outlives
+  // it rather than being freed from one of its own threads
+  static std::shared_ptr<DecodeScheduler> decode_scheduler =
+      std::make_shared<DecodeScheduler>(2);
+  if (!decoder_factory) {
+    decoder_factory = std::make_shared<RampDecoderFactory>(duration);
+  }
+  return std::make_shared<FilePlugin>(
+      decoder_factory, std::make_shared<LoadScheduler>(),
+      std::make_shared<PCMCache>(),
+      std::make_shared<DiskPCMCache>(), decode_scheduler, prefetch_planner,
+      channel_probe, file_node, path, CHANNELS, samplerate);
+}
+
+BOOST_AUTO_TEST_CASE(testFilePluginFeedsWhileRunLetsGoOfChunks) {
+  auto prefetch_planner = std::make_shared<PrefetchPlanner>(
+      PrefetchPlannerDefaultBudgetBytes, 10.0, 30.0,
+      std::chrono::milliseconds(0));
+  auto file_plugin =
+      createRampFilePlugin("ramp.wav", 0.0, 20.0, prefetch_planner);
+  std::atomic<bool> loaded(false);
+  file_plugin->load([&loaded](const Load &load) { loaded = true; });
+  while (!loaded) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // The render thread plays the first seconds over and over while the
+  // plugin is run to and fro, letting go of its chunks each time it leaves
+  const long block_frames = 1024;
+  const long render_frames = 5 * SAMPLERATE;
+  std::atomic<bool> rendering(true);
+  long mismatches = 0;
+  std::thread render_thread([&]() {
+    std::map<std::string, std::shared_ptr<plugin::Content>> content = {
+        {AudioContentTypeKey,
+         std::make_shared<plugin::Content>(
+             block_frames * CHANNELS, 0, SAMPLERATE, CHANNELS,
+             block_frames * CHANNELS, plugin::ContentPayloadTypeBuffer)}};
+    auto &audio_content = *content[AudioContentTypeKey];
+    while (rendering) {
+      for (long frame_index = 0; frame_index < render_frames;
+           frame_index += block_frames) {
+        audio_content.erase();
+        file_plugin->feed(content, frame_index * CHANNELS,
+                          frame_index * CHANNELS,
+                          nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+        const float *samples = audio_content.constPayload();
+        for (size_t i = 0; i < audio_content.items(); ++i) {
+          if (samples[i] != static_cast<float>(frame_index + i / CHANNELS)) {
+            ++mismatches;
+          }
+        }
+      }
+    }
+  });
+  for (int i = 0; i < 50; ++i) {
+    for (long frame_index = 0; frame_index < render_frames;
+         frame_index += render_frames / 4) {
+      file_plugin->run(frame_index * CHANNELS, plugin::NodeTimes(), 0);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Long past the end of the file, which lets go of everything
+    file_plugin->run((100 + i) * SAMPLERATE * CHANNELS, plugin::NodeTimes(),
+                     0);
+  }
+  rendering = false;
+  render_thread.join();
+  BOOST_CHECK_EQUAL(mismatches, 0);
+  BOOST_CHECK_GT(prefetch_planner->stats()._evictions, 0);
+}
+
+// Loads a ramp file and renders it offline from start to end, waiting on each
+// block until the file has decoded it. Returns the frames rendered.
+static long renderRampOffline(const std::shared_ptr<FilePlugin> &file_plugin,
+                              double samplerate, double duration,
+                              long &mismatches) {
+  std::atomic<bool> loaded(false);
+  file_plugin->load([&loaded](const Load &load) { loaded = true; });
+  while (!loaded) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  const long block_frames = 1024;
+  std::map<std::string, std::shared_ptr<plugin::Content>> content = {
+      {AudioContentTypeKey,
+       std::make_shared<plugin::Content>(
+           block_frames * CHANNELS, 0, samplerate, CHANNELS,
+           block_frames * CHANNELS, plugin::ContentPayloadTypeBuffer)}};
+  auto &audio_content = *content[AudioContentTypeKey];
+  long rendered_frames = 0;
+  mismatches = 0;
+  for (long frame_index = 0;; frame_index += block_frames) {
+    file_plugin->run(frame_index * CHANNELS, plugin::NodeTimes(), 0);
+    const long end_frames =
+        std::min(block_frames, static_cast<long>(duration * samplerate) -
+                                   frame_index);
+    for (;;) {
+      audio_content.erase();
+      file_plugin->feed(content, frame_index * CHANNELS,
+                        frame_index * CHANNELS,
+                        nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+      if (static_cast<long>(audio_content.items()) >= end_frames * CHANNELS) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const long frames = audio_content.items() / CHANNELS;
+    if (frames == 0) {
+      break;
+    }
+    const float *samples = audio_content.constPayload();
+    for (size_t i = 0; i < audio_content.items(); ++i) {
+      if (samples[i] != static_cast<float>(frame_index + i / CHANNELS)) {
+        ++mismatches;
+      }
+    }
+    rendered_frames += frames;
+  }
+  return rendered_frames;
+}
+
+BOOST_AUTO_TEST_CASE(testFilePluginDecodesAtTheGraphSamplerate) {
+  const double samplerate = 48000.0;
+  const double duration = 2.0;
+  auto file_plugin = createRampFilePlugin(
+      "ramp.wav", 0.0, duration, PrefetchPlanner::sharedPlanner(), samplerate);
+  long mismatches = 0;
+  BOOST_CHECK_EQUAL(
+      renderRampOffline(file_plugin, samplerate, duration, mismatches),
+      duration * samplerate);
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testFilePluginProbesTheChannelsItDecodes) {
+  const double duration = 2.0;
+  auto channel_probe = std::make_shared<ChannelProbe>();
+  auto file_plugin =
+      createRampFilePlugin("ramp.wav", 0.0, duration,
+                           PrefetchPlanner::sharedPlanner(), SAMPLERATE,
+                           channel_probe);
+  // The ramp is the same in both channels, which only shows once all of it
+  // has been decoded
+  BOOST_CHECK_EQUAL(channel_probe->channels("ramp.wav", CHANNELS), CHANNELS);
+  long mismatches = 0;
+  renderRampOffline(file_plugin, SAMPLERATE, duration, mismatches);
+  BOOST_CHECK_EQUAL(mismatches, 0);
+  BOOST_CHECK_EQUAL(channel_probe->channels("ramp.wav", CHANNELS), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testFilePluginEvictedWhileLoadingStartsOver) {
+  const double duration = 2.0;
+  auto decoder_factory = std::make_shared<HeldRampDecoderFactory>(duration);
+  auto prefetch_planner = std::make_shared<PrefetchPlanner>(
+      PrefetchPlannerDefaultBudgetBytes, 10.0, 30.0,
+      std::chrono::milliseconds(0));
+  auto file_plugin = createRampFilePlugin(
+      "ramp.wav", 0.0, duration, prefetch_planner, SAMPLERATE,
+      std::make_shared<ChannelProbe>(), decoder_factory);
+  // Loads are answered on whichever thread finishes them
+  std::atomic<int> failed_loads(0);
+  std::atomic<int> first_loads(0);
+  file_plugin->load([&failed_loads, &first_loads](const Load &load) {
+    ++(load._loaded ? first_loads : failed_loads);
+  });
+  BOOST_REQUIRE_EQUAL(decoder_factory->held(), 1);
+
+  // Evicted long past the end of the file, which answers the load in flight,
+  // then needed again, which starts another
+  file_plugin->run(100 * SAMPLERATE * CHANNELS, plugin::NodeTimes(), 0);
+  BOOST_CHECK_EQUAL(first_loads, 1);
+  file_plugin->run(0, plugin::NodeTimes(), 0);
+  std::atomic<int> second_loads(0);
+  file_plugin->load([&failed_loads, &second_loads](const Load &load) {
+    ++(load._loaded ? second_loads : failed_loads);
+  });
+
+  // The decoder asked for before the eviction is of no use to anyone
+  decoder_factory->open();
+  BOOST_CHECK_EQUAL(second_loads, 0);
+  BOOST_REQUIRE_EQUAL(decoder_factory->held(), 1);
+  decoder_factory->open();
+  while (second_loads == 0 && failed_loads == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  BOOST_CHECK_EQUAL(failed_loads, 0);
+  BOOST_CHECK_EQUAL(first_loads, 1);
+  BOOST_CHECK_EQUAL(second_loads, 1);
+  BOOST_CHECK_EQUAL(decoder_factory->held(), 0);
+
+  long mismatches = 0;
+  BOOST_CHECK_EQUAL(
+      renderRampOffline(file_plugin, SAMPLERATE, duration, mismatches),
+      duration * SAMPLERATE);
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
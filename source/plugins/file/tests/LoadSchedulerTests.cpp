@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "LoadScheduler.h"
+
+BOOST_AUTO_TEST_SUITE(LoadSchedulerTests)
+using namespace nativeformat::plugin::file;
+
+// Schedules a load that records when it starts and holds on to its done
+// callback, so the test decides when it finishes
+static void scheduleHeldLoad(
+    const std::shared_ptr<LoadScheduler> &load_scheduler,
+    long start_sample_index, std::vector<long> &started,
+    std::vector<LoadScheduler::DONE_CALLBACK> &held, bool background = false) {
+  load_scheduler->schedule(
+      start_sample_index,
+      [start_sample_index, &started,
+       &held](const LoadScheduler::DONE_CALLBACK &done) {
+        started.push_back(start_sample_index);
+        held.push_back(done);
+      },
+      background);
+}
+
+BOOST_AUTO_TEST_CASE(testLoadSchedulerCapsActiveLoads) {
+  auto load_scheduler = std::make_shared<LoadScheduler>(2);
+  std::vector<long> started;
+  std::vector<LoadScheduler::DONE_CALLBACK> held;
+  for (long i = 0; i < 5; ++i) {
+    scheduleHeldLoad(load_scheduler, i, started, held);
+  }
+  BOOST_CHECK_EQUAL(started.size(), 2);
+  BOOST_CHECK_EQUAL(load_scheduler->activeLoads(), 2);
+  BOOST_CHECK_EQUAL(load_scheduler->queuedLoads(), 3);
+  held[0]();
+  BOOST_CHECK_EQUAL(started.size(), 3);
+  BOOST_CHECK_EQUAL(load_scheduler->activeLoads(), 2);
+  BOOST_CHECK_EQUAL(load_scheduler->queuedLoads(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(testLoadSchedulerStartsSoonestFirst) {
+  auto load_scheduler = std::make_shared<LoadScheduler>(1);
+  std::vector<long> started;
+  std::vector<LoadScheduler::DONE_CALLBACK> held;
+  scheduleHeldLoad(load_scheduler, 500, started, held);
+  scheduleHeldLoad(load_scheduler, 300, started, held);
+  scheduleHeldLoad(load_scheduler, 100, started, held);
+  scheduleHeldLoad(load_scheduler, 200, started, held);
+  scheduleHeldLoad(load_scheduler, 100, started, held);
+  for (size_t i = 0; i < held.size(); ++i) {
+    held[i]();
+  }
+  BOOST_CHECK(started == std::vector<long>({500, 100, 100, 200, 300}));
+  BOOST_CHECK_EQUAL(load_scheduler->activeLoads(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testLoadSchedulerRunsLoadsThatFinishStraightAway) {
+  auto load_scheduler = std::make_shared<LoadScheduler>(1);
+  int finished = 0;
+  for (long i = 0; i < 100; ++i) {
+    load_scheduler->schedule(
+        i, [&finished](const LoadScheduler::DONE_CALLBACK &done) {
+          ++finished;
+          done();
+        });
+  }
+  BOOST_CHECK_EQUAL(finished, 100);
+  BOOST_CHECK_EQUAL(load_scheduler->activeLoads(), 0);
+  BOOST_CHECK_EQUAL(load_scheduler->queuedLoads(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testLoadSchedulerIgnoresRepeatedDone) {
+  auto load_scheduler = std::make_shared<LoadScheduler>(2);
+  std::vector<long> started;
+  std::vector<LoadScheduler::DONE_CALLBACK> held;
+  for (long i = 0; i < 4; ++i) {
+    scheduleHeldLoad(load_scheduler, i, started, held);
+  }
+  held[0]();
+  held[0]();
+  BOOST_CHECK_EQUAL(started.size(), 3);
+  BOOST_CHECK_EQUAL(load_scheduler->activeLoads(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(testLoadSchedulerStartsBackgroundLoadsLast) {
+  auto load_scheduler = std::make_shared<LoadScheduler>(3);
+  std::vector<long> started;
+  std::vector<LoadScheduler::DONE_CALLBACK> held;
+  scheduleHeldLoad(load_scheduler, 0, started, held);
+  scheduleHeldLoad(load_scheduler, 100, started, held, true);
+  scheduleHeldLoad(load_scheduler, 200, started, held, true);
+  scheduleHeldLoad(load_scheduler, 300, started, held, true);
+  // Background loads leave the last slot for loads that are needed to play
+  BOOST_CHECK(started == std::vector<long>({0, 100}));
+  scheduleHeldLoad(load_scheduler, 400, started, held);
+  BOOST_CHECK(started == std::vector<long>({0, 100, 400}));
+  held[0]();
+  BOOST_CHECK(started == std::vector<long>({0, 100, 400}));
+  held[2]();
+  BOOST_CHECK(started == std::vector<long>({0, 100, 400, 200}));
+  BOOST_CHECK_EQUAL(load_scheduler->queuedLoads(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
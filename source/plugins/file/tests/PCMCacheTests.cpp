@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+#include "PCMCache.h"
+
+BOOST_AUTO_TEST_SUITE(PCMCacheTests)
+using namespace nativeformat::plugin::file;
+
+static const double SAMPLERATE = 44100.0;
+static const int CHANNELS = 2;
+
+static PCMCache::CHUNK makeChunk(long frames, float value) {
+  auto chunk = std::make_shared<PCMCache::Chunk>();
+  chunk->_channels = CHANNELS;
+  chunk->_samples.assign(frames * chunk->_channels, value);
+  chunk->_eof = false;
+  return chunk;
+}
+
+BOOST_AUTO_TEST_CASE(testPCMCacheCountsHitsSharedAndMisses) {
+  PCMCache pcm_cache;
+  bool decode = false;
+  BOOST_CHECK(
+      !pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode));
+  BOOST_CHECK(decode);
+  BOOST_CHECK(
+      !pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode));
+  BOOST_CHECK(!decode);
+  pcm_cache.insert("a.ogg", SAMPLERATE, CHANNELS, 0, makeChunk(16, 1.0f));
+  BOOST_CHECK(
+      pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode));
+  BOOST_CHECK(!decode);
+  auto stats = pcm_cache.stats();
+  BOOST_CHECK_EQUAL(stats._hits, 1);
+  BOOST_CHECK_EQUAL(stats._shared, 1);
+  BOOST_CHECK_EQUAL(stats._misses, 1);
+  BOOST_CHECK_CLOSE(stats._hit_rate, 2.0 / 3.0, 0.001);
+  BOOST_CHECK_EQUAL(stats._resident_bytes, 16 * 2 * sizeof(float));
+}
+
+BOOST_AUTO_TEST_CASE(testPCMCacheHandsChunksToWaiters) {
+  PCMCache pcm_cache;
+  std::vector<PCMCache::CHUNK> received;
+  auto callback = [&received](const PCMCache::CHUNK &chunk) {
+    received.push_back(chunk);
+  };
+  bool decode = false;
+  pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 3, callback, decode);
+  BOOST_CHECK(decode);
+  pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 3, callback, decode);
+  BOOST_CHECK(!decode);
+  BOOST_CHECK(received.empty());
+  auto chunk = makeChunk(8, 0.5f);
+  pcm_cache.insert("a.ogg", SAMPLERATE, CHANNELS, 3, chunk);
+  BOOST_CHECK_EQUAL(received.size(), 2);
+  BOOST_CHECK(received[0] == chunk);
+  BOOST_CHECK(received[1] == chunk);
+}
+
+BOOST_AUTO_TEST_CASE(testPCMCacheTellsWaitersWhenDecodingFails) {
+  PCMCache pcm_cache;
+  int failures = 0;
+  bool decode = false;
+  pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0,
+                 [&failures](const PCMCache::CHUNK &chunk) {
+                   if (!chunk) {
+                     ++failures;
+                   }
+                 },
+                 decode);
+  pcm_cache.insert("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr);
+  BOOST_CHECK_EQUAL(failures, 1);
+  BOOST_CHECK_EQUAL(pcm_cache.stats()._resident_bytes, 0);
+  // The next file to ask decodes it again
+  pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode);
+  BOOST_CHECK(decode);
+}
+
+BOOST_AUTO_TEST_CASE(testPCMCacheKeysChunksByHowTheyWereDecoded) {
+  PCMCache pcm_cache;
+  bool decode = false;
+  pcm_cache.insert("a.ogg", SAMPLERATE, CHANNELS, 0, makeChunk(16, 1.0f));
+  BOOST_CHECK(
+      pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode));
+  // The same file decoded for another graph is another chunk
+  BOOST_CHECK(!pcm_cache.find("a.ogg", 48000.0, CHANNELS, 0, nullptr, decode));
+  BOOST_CHECK(decode);
+  BOOST_CHECK(!pcm_cache.find("a.ogg", SAMPLERATE, 1, 0, nullptr, decode));
+  BOOST_CHECK(decode);
+}
+
+BOOST_AUTO_TEST_CASE(testPCMCacheEvictsLeastRecentlyUsed) {
+  const size_t chunk_bytes = 16 * 2 * sizeof(float);
+  PCMCache pcm_cache(chunk_bytes * 2);
+  bool decode = false;
+  pcm_cache.insert("a.ogg", SAMPLERATE, CHANNELS, 0, makeChunk(16, 0.0f));
+  pcm_cache.insert("a.ogg", SAMPLERATE, CHANNELS, 1, makeChunk(16, 1.0f));
+  // Touching the first chunk leaves the second as the least recently used
+  pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode);
+  auto held_chunk =
+      pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 1, nullptr, decode);
+  pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode);
+  pcm_cache.insert("b.ogg", SAMPLERATE, CHANNELS, 0, makeChunk(16, 2.0f));
+  BOOST_CHECK_EQUAL(pcm_cache.stats()._resident_bytes, chunk_bytes * 2);
+  BOOST_CHECK(
+      pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode));
+  BOOST_CHECK(
+      pcm_cache.find("b.ogg", SAMPLERATE, CHANNELS, 0, nullptr, decode));
+  BOOST_CHECK(
+      !pcm_cache.find("a.ogg", SAMPLERATE, CHANNELS, 1, nullptr, decode));
+  BOOST_CHECK(decode);
+  // Whoever still holds an evicted chunk keeps its audio
+  BOOST_CHECK_EQUAL(held_chunk->_samples[0], 1.0f);
+  pcm_cache.setBudgetBytes(0);
+  BOOST_CHECK_EQUAL(pcm_cache.stats()._resident_bytes, 0);
+  BOOST_CHECK_EQUAL(pcm_cache.stats()._budget_bytes, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+
+#include "PrefetchPlanner.h"
+
+BOOST_AUTO_TEST_SUITE(PrefetchPlannerTests)
+using namespace nativeformat::plugin::file;
+
+static const size_t MEGABYTE = 1024 * 1024;
+
+BOOST_AUTO_TEST_CASE(testPrefetchPlannerDecodesSoonestWithinBudget) {
+  PrefetchPlanner prefetch_planner(3 * MEGABYTE, 10.0, 30.0,
+                                   std::chrono::milliseconds(0));
+  int files[4];
+  prefetch_planner.plan(&files[0], {8.0, MEGABYTE});
+  prefetch_planner.plan(&files[1], {2.0, MEGABYTE});
+  prefetch_planner.plan(&files[2], {4.0, MEGABYTE});
+  prefetch_planner.plan(&files[3], {6.0, MEGABYTE});
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[1], {2.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyDecoded);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[2], {4.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyDecoded);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[3], {6.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyDecoded);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[0], {8.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyOpen);
+  auto stats = prefetch_planner.stats();
+  BOOST_CHECK_EQUAL(stats._budget_bytes, 3 * MEGABYTE);
+  BOOST_CHECK_EQUAL(stats._planned_bytes, 3 * MEGABYTE);
+  BOOST_CHECK_EQUAL(stats._decoded_files, 3);
+  BOOST_CHECK_EQUAL(stats._open_files, 1);
+  BOOST_CHECK_EQUAL(stats._deferrals, 1);
+}
+
+BOOST_AUTO_TEST_CASE(testPrefetchPlannerAlwaysDecodesPlayingFiles) {
+  PrefetchPlanner prefetch_planner(0, 10.0, 30.0,
+                                   std::chrono::milliseconds(0));
+  int files[2];
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[0], {0.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyDecoded);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[1], {1.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyOpen);
+  BOOST_CHECK_EQUAL(prefetch_planner.stats()._planned_bytes, MEGABYTE);
+}
+
+BOOST_AUTO_TEST_CASE(testPrefetchPlannerEvictsFilesNotNeededSoon) {
+  PrefetchPlanner prefetch_planner(10 * MEGABYTE, 10.0, 30.0,
+                                   std::chrono::milliseconds(0));
+  int files[3];
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[0], {0.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyDecoded);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[1], {20.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyOpen);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[2], {60.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyEvicted);
+  // Played out and not coming back
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[0], {-1.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyEvicted);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[1], {40.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyEvicted);
+  auto stats = prefetch_planner.stats();
+  BOOST_CHECK_EQUAL(stats._evictions, 2);
+  BOOST_CHECK_EQUAL(stats._planned_bytes, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testPrefetchPlannerFreesBudgetOfRemovedFiles) {
+  PrefetchPlanner prefetch_planner(MEGABYTE, 10.0, 30.0,
+                                   std::chrono::milliseconds(0));
+  int files[2];
+  prefetch_planner.plan(&files[0], {1.0, MEGABYTE});
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[1], {2.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyOpen);
+  prefetch_planner.remove(&files[0]);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[1], {2.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyDecoded);
+  prefetch_planner.setBudgetBytes(0);
+  BOOST_CHECK_EQUAL(prefetch_planner.plan(&files[1], {2.0, MEGABYTE}),
+                    PrefetchPlanner::ResidencyOpen);
+  BOOST_CHECK_EQUAL(prefetch_planner.stats()._evictions, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -34,12 +34,11 @@ NoisePlugin::NoisePlugin(const nfgrapher::contract::NoiseNodeInfo &noise_node,
 
 NoisePlugin::~NoisePlugin() {}
 
-void NoisePlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
-                       long sample_index, long graph_sample_index,
-                       nfgrapher::LoadingPolicy loading_policy) {
-  Content &audio_content = *content[AudioContentTypeKey];
+void NoisePlugin::feedPorts(PortContent &content, long sample_index,
+                            long graph_sample_index,
+                            nfgrapher::LoadingPolicy loading_policy) {
+  Content &audio_content = *content[AudioPortId];
   size_t sample_count = audio_content.requiredItems();
-  float *samples = (float *)audio_content.payload();
   long start_sample_index = _start_sample_index;
   long duration_samples = _duration_samples;
   long end_sample_index = start_sample_index + duration_samples;
@@ -49,8 +48,10 @@ void NoisePlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
   if (!findBeginAndEndOfRange(
           start_sample_index, end_sample_index, sample_index, sample_index_end,
           sample_count_index_begin, sample_count_index_end)) {
+    // Leave the content silent
     return;
   }
+  float *samples = (float *)audio_content.payload();
   sample_count_index_begin -= sample_index;
   for (long i = sample_count_index_begin; i < sample_count_index_end; ++i) {
     float sample = _distribution(_generator);
@@ -32,16 +32,16 @@ namespace noise {
 /**
  * A plugin that can control the amount of gain on an audio signal
  */
-class NoisePlugin : public Plugin {
+class NoisePlugin : public PortPlugin {
  public:
   NoisePlugin(const nfgrapher::contract::NoiseNodeInfo &noise_node,
               int channels, double samplerate);
   virtual ~NoisePlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
 
   std::string name() override;
   bool finished(long sample_index, long sample_index_end) override;
@@ -44,6 +44,16 @@ std::shared_ptr<Plugin> NoisePluginFactory::createPlugin(
   return std::make_shared<SilencePlugin>(silence_node, channels, samplerate);
 }
 
+int NoisePluginFactory::channels(const nfgrapher::Node &grapher_node,
+                                 int input_channels, int channels) const {
+  // Silence is the same in every channel, whereas each channel of noise is
+  // its own
+  if (grapher_node.kind == nfgrapher::contract::SilenceNodeInfo::kind()) {
+    return 1;
+  }
+  return channels;
+}
+
 std::vector<std::string> NoisePluginFactory::identifiers() const {
   return {nfgrapher::contract::NoiseNodeInfo::kind(),
           nfgrapher::contract::SilenceNodeInfo::kind()};
@@ -34,12 +34,11 @@ SilencePlugin::SilencePlugin(
 
 SilencePlugin::~SilencePlugin() {}
 
-void SilencePlugin::feed(
-    std::map<std::string, std::shared_ptr<Content>> &content, long sample_index,
-    long graph_sample_index, nfgrapher::LoadingPolicy loading_policy) {
-  Content &audio_content = *content[AudioContentTypeKey];
+void SilencePlugin::feedPorts(PortContent &content, long sample_index,
+                              long graph_sample_index,
+                              nfgrapher::LoadingPolicy loading_policy) {
+  Content &audio_content = *content[AudioPortId];
   size_t sample_count = audio_content.requiredItems();
-  float *samples = (float *)audio_content.payload();
   long start_sample_index = _start_sample_index;
   long duration_samples = _duration_samples;
   long end_sample_index = start_sample_index + duration_samples;
@@ -51,9 +50,10 @@ void SilencePlugin::feed(
   size_t sample_begin = std::max(start_sample_index, sample_index);
   size_t sample_end = std::min(end_sample_index, sample_index_end);
   size_t write_samples = sample_end - sample_begin;
-  std::fill_n(&samples[sample_begin - sample_index], write_samples, 0);
 
+  // Only zeros the samples if the content isn't silent already
   audio_content.setItems(write_samples);
+  audio_content.setSilent();
 }
 
 std::string SilencePlugin::name() {
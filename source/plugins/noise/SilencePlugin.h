@@ -31,16 +31,16 @@ namespace noise {
 /**
  * A plugin that outputs silence
  */
-class SilencePlugin : public Plugin {
+class SilencePlugin : public PortPlugin {
  public:
   SilencePlugin(const nfgrapher::contract::SilenceNodeInfo &silence_node,
                 int channels, double samplerate);
   virtual ~SilencePlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
 
   std::string name() override;
   bool finished(long sample_index, long sample_index_end) override;
@@ -21,6 +21,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include "NoisePlugin.h"
+#include "NoisePluginFactory.h"
 
 BOOST_AUTO_TEST_SUITE(NoisePluginTests)
 
@@ -48,4 +49,16 @@ BOOST_AUTO_TEST_CASE(testLocalRenderTimeBetweenStartTimeAndDuration) {
                     10 * 2 * 44100);
 }
 
+BOOST_AUTO_TEST_CASE(testFactoryRendersOnlySilenceNarrower) {
+  nativeformat::plugin::noise::NoisePluginFactory factory;
+  const nlohmann::json silence_json = {
+      {"id", "silence-node-01"},
+      {"kind", nfgrapher::contract::SilenceNodeInfo::kind()},
+      {"config", {{"when", 50E9}, {"duration", 50E9}}}};
+  // Every channel of noise is drawn on its own, so it can't be repeated from
+  // a single one
+  BOOST_CHECK_EQUAL(factory.channels((nfgrapher::Node)noise_json, 2, 2), 2);
+  BOOST_CHECK_EQUAL(factory.channels((nfgrapher::Node)silence_json, 2, 2), 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -52,7 +52,8 @@ StretchPlugin::StretchPlugin(
       _frames_to_discard(0),
       _frames_to_preproc(0),
       _child_sample_offset(0),
-      _child_sample_index(0) {
+      _child_sample_index(0),
+      _block_samples(NF_DRIVER_SAMPLE_BLOCK_SIZE) {
   nfgrapher::param::addCommands(_stretch, stretch_node._stretch);
   nfgrapher::param::addCommands(_pitch, stretch_node._pitch_ratio);
   nfgrapher::param::addCommands(_formants, stretch_node._formant_ratio);
@@ -85,6 +86,8 @@ void StretchPlugin::feed(
   auto &audio_content = content[AudioContentTypeKey];
   auto required_items = audio_content->requiredItems();
   size_t filled_items = 0;
+  // The host picks the block size, time changes are measured in its blocks
+  _block_samples = required_items;
 
   // Check if this feed sample_index overlaps with the previous call
   if (sample_index < _expected_feed_sample) {
@@ -296,7 +299,7 @@ void StretchPlugin::majorTimeChange(long sample_index,
     auto start_time = ((child_start_sample_index / _channels) / _samplerate);
     auto end_time = ((sample_index / _channels) / _samplerate);
     auto render_time_diff = end_time - start_time;
-    auto precision = (NF_DRIVER_SAMPLE_BLOCK_SIZE / _channels) / _samplerate;
+    auto precision = (_block_samples / _channels) / _samplerate;
     auto stretch_factor =
         render_time_diff /
         _stretch->cumulativeValueForTimeRange(start_time, end_time, precision);
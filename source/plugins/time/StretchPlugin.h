@@ -97,6 +97,7 @@ class StretchPlugin : public Plugin {
   std::mutex _elastique_mutex;
   std::map<std::string, std::shared_ptr<Content>> _content;
   std::atomic<long> _child_sample_index;
+  std::atomic<size_t> _block_samples;
 };
 
 }  // namespace time
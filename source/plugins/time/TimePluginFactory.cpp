@@ -52,6 +52,16 @@ std::shared_ptr<Plugin> TimePluginFactory::createPlugin(
 #endif
 }
 
+int TimePluginFactory::channels(const nfgrapher::Node &grapher_node,
+                                int input_channels, int channels) const {
+  // Loops only need the width to count frames, stretching stays at the graph
+  // width
+  if (grapher_node.kind == nfgrapher::contract::LoopNodeInfo::kind()) {
+    return input_channels;
+  }
+  return channels;
+}
+
 std::vector<std::string> TimePluginFactory::identifiers() const {
   return {nfgrapher::contract::LoopNodeInfo::kind(),
 #ifdef WITH_ELASTIQUE
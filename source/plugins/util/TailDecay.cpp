@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "TailDecay.h"
+
+#include <cmath>
+
+namespace nativeformat {
+namespace plugin {
+namespace util {
+
+constexpr float TailDecay::DEFAULT_THRESHOLD;
+
+TailDecay::TailDecay(float threshold)
+    : _threshold(threshold), _decayed(true) {}
+
+void TailDecay::update(bool input_silent, const float *samples,
+                       size_t sample_count) {
+  // Only the tail is worth measuring, anything else keeps ringing
+  if (!input_silent) {
+    _decayed = false;
+    return;
+  }
+  _decayed = true;
+  for (size_t i = 0; i < sample_count; ++i) {
+    if (std::fabs(samples[i]) >= _threshold) {
+      _decayed = false;
+      return;
+    }
+  }
+}
+
+}  // namespace util
+}  // namespace plugin
+}  // namespace nativeformat
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace nativeformat {
+namespace plugin {
+namespace util {
+
+/**
+ * Tells a stateful effect when it can stop processing silent input, which is
+ * once the tail it rings out after the input fell silent has decayed.
+ */
+class TailDecay {
+ public:
+  static constexpr float DEFAULT_THRESHOLD = 1.0e-6f;
+
+  explicit TailDecay(float threshold = DEFAULT_THRESHOLD);
+
+  // Whether a block of silent input can be skipped
+  bool decayed() const { return _decayed; }
+
+  // Record a block of output, input_silent being whether its input was silent
+  void update(bool input_silent, const float *samples, size_t sample_count);
+
+ private:
+  const float _threshold;
+  bool _decayed;
+};
+
+}  // namespace util
+}  // namespace plugin
+}  // namespace nativeformat
@@ -26,6 +26,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include "BandSplitter.h"
+#include "TailDecay.h"
 
 BOOST_AUTO_TEST_SUITE(PluginUtilTests)
 using namespace nativeformat::plugin::util;
@@ -114,4 +115,22 @@ BOOST_AUTO_TEST_CASE(testButterFilterBandpassCoefficients) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(testTailDecayWaitsForTheTail) {
+  TailDecay tail;
+  BOOST_CHECK(tail.decayed());
+
+  std::vector<float> samples(64, 0.5f);
+  tail.update(false, samples.data(), samples.size());
+  BOOST_CHECK(!tail.decayed());
+
+  // The first silent block still rings
+  std::fill(samples.begin(), samples.end(), 1.0e-3f);
+  tail.update(true, samples.data(), samples.size());
+  BOOST_CHECK(!tail.decayed());
+
+  std::fill(samples.begin(), samples.end(), 1.0e-8f);
+  tail.update(true, samples.data(), samples.size());
+  BOOST_CHECK(tail.decayed());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
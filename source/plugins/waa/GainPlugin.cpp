@@ -38,12 +38,16 @@ GainPlugin::GainPlugin(const nfgrapher::contract::GainNodeInfo &gain_node,
 
 GainPlugin::~GainPlugin() {}
 
-void GainPlugin::feed(std::map<std::string, std::shared_ptr<Content>> &content,
-                      long sample_index, long graph_sample_index,
-                      nfgrapher::LoadingPolicy loading_policy) {
-  _child_plugin->feed(content, sample_index, graph_sample_index,
-                      loading_policy);
-  Content &audio_content = *content[AudioContentTypeKey];
+void GainPlugin::feedPorts(PortContent &content, long sample_index,
+                           long graph_sample_index,
+                           nfgrapher::LoadingPolicy loading_policy) {
+  _child_plugin->feedPorts(content, sample_index, graph_sample_index,
+                           loading_policy);
+  Content &audio_content = *content[AudioPortId];
+  // Silence stays silent whatever the gain
+  if (audio_content.silent()) {
+    return;
+  }
   float *samples = (float *)audio_content.payload();
   size_t sample_count = audio_content.items();
   double samplerate = audio_content.sampleRate();
@@ -92,6 +96,8 @@ Plugin::PluginType GainPlugin::type() const {
   return PluginType::PluginTypeConsumer;
 }
 
+bool GainPlugin::timeAligned() const { return true; }
+
 void GainPlugin::load(LOAD_CALLBACK callback) { _child_plugin->load(callback); }
 
 bool GainPlugin::loaded() const { return _child_plugin->loaded(); }
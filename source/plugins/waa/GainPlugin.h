@@ -29,7 +29,7 @@ namespace waa {
 /**
  * A plugin that can control the amount of gain on an audio signal
  */
-class GainPlugin : public Plugin {
+class GainPlugin : public PortPlugin {
  public:
   GainPlugin(const nfgrapher::contract::GainNodeInfo &gain_node, int channels,
              double samplerate,
@@ -37,15 +37,16 @@ class GainPlugin : public Plugin {
   virtual ~GainPlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
   std::string name() override;
   std::vector<std::string> paramNames() override;
   std::shared_ptr<param::Param> paramForName(const std::string &name) override;
   bool finished(long sample_index, long sample_index_end) override;
   void notifyFinished(long sample_index, long graph_sample_index) override;
   PluginType type() const override;
+  bool timeAligned() const override;
   void load(LOAD_CALLBACK callback) override;
   bool loaded() const override;
   void run(long sample_index, const NodeTimes &node_times,
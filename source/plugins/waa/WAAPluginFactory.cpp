@@ -59,6 +59,21 @@ std::shared_ptr<Plugin> WAAPluginFactory::createPlugin(
                                               samplerate, child_plugin);
 }
 
+int WAAPluginFactory::channels(const nfgrapher::Node &grapher_node,
+                               int input_channels, int channels) const {
+  // A gain works at whatever width it is fed, delay lines stay at the graph
+  // width
+  if (grapher_node.kind == nfgrapher::contract::GainNodeInfo::kind()) {
+    return input_channels;
+  }
+  return channels;
+}
+
+bool WAAPluginFactory::timeAligned(const nfgrapher::Node &grapher_node) const {
+  // Delays feed their inputs ahead of where they are
+  return grapher_node.kind == nfgrapher::contract::GainNodeInfo::kind();
+}
+
 std::vector<std::string> WAAPluginFactory::identifiers() const {
   std::vector<std::string> identifiers;
   for (const auto &plugin_factory : _plugin_factories) {
@@ -44,6 +44,9 @@ class WAAPluginFactory : public Factory {
       const NF_PLUGIN_RESOLVE_CALLBACK &resolve_callback, int channels,
       double samplerate, const std::shared_ptr<plugin::Plugin> &child_plugin,
       const std::string &session_id) override;
+  int channels(const nfgrapher::Node &grapher_node, int input_channels,
+               int channels) const override;
+  bool timeAligned(const nfgrapher::Node &grapher_node) const override;
   std::vector<std::string> identifiers() const override;
 
  private:
@@ -37,23 +37,24 @@ SineWavePlugin::SineWavePlugin(
 
 SineWavePlugin::~SineWavePlugin() {}
 
-void SineWavePlugin::feed(
-    std::map<std::string, std::shared_ptr<Content>> &content, long sample_index,
-    long graph_sample_index, nfgrapher::LoadingPolicy loading_policy) {
-  Content &audio_content = *content[AudioContentTypeKey];
+void SineWavePlugin::feedPorts(PortContent &content, long sample_index,
+                               long graph_sample_index,
+                               nfgrapher::LoadingPolicy loading_policy) {
+  Content &audio_content = *content[AudioPortId];
   size_t sample_count = audio_content.requiredItems();
   size_t channels = audio_content.channels();
   double sample_rate = audio_content.sampleRate();
-  float *samples = (float *)audio_content.payload();
   long start_sample_index = _start_sample_index;
   long duration_samples = _duration_samples;
   long end_sample_index = start_sample_index + duration_samples;
   long sample_index_end = sample_index + sample_count;
   if (!rangesOverlap(start_sample_index, end_sample_index, sample_index,
                      sample_index_end)) {
+    // Leave the content silent
     return;
   }
 
+  float *samples = (float *)audio_content.payload();
   size_t start_sample =
       std::max(start_sample_index, sample_index) - sample_index;
   size_t end_sample =
@@ -31,16 +31,16 @@ namespace wave {
 /**
  * A plugin that can produce a sine wave signal
  */
-class SineWavePlugin : public Plugin {
+class SineWavePlugin : public PortPlugin {
  public:
   SineWavePlugin(const nfgrapher::contract::SineNodeInfo &sine_node,
                  int channels, double samplerate);
   virtual ~SineWavePlugin();
 
   // Plugin
-  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
-            long sample_index, long graph_sample_index,
-            nfgrapher::LoadingPolicy loading_policy) override;
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override;
 
   std::string name() override;
   bool finished(long sample_index, long sample_index_end) override;
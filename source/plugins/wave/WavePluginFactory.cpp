@@ -38,6 +38,12 @@ std::shared_ptr<Plugin> WavePluginFactory::createPlugin(
   return std::make_shared<SineWavePlugin>(grapher_node, channels, samplerate);
 }
 
+int WavePluginFactory::channels(const nfgrapher::Node &grapher_node,
+                                int input_channels, int channels) const {
+  // A sine wave is the same in every channel
+  return 1;
+}
+
 std::vector<std::string> WavePluginFactory::identifiers() const {
   return {nfgrapher::contract::SineNodeInfo::kind()};
 }
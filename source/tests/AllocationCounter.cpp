@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static thread_local bool CountingAllocations = false;
+static std::atomic<size_t> Allocations(0);
+
+static void *CountedAllocation(std::size_t size) {
+  if (CountingAllocations) {
+    ++Allocations;
+  }
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new(std::size_t size) {
+  void *pointer = CountedAllocation(size);
+  if (!pointer) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return CountedAllocation(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return CountedAllocation(size);
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  std::free(pointer);
+}
+
+namespace nativeformat {
+namespace test {
+
+void startCountingAllocations() {
+  Allocations = 0;
+  CountingAllocations = true;
+}
+
+size_t stopCountingAllocations() {
+  CountingAllocations = false;
+  return Allocations;
+}
+
+}  // namespace test
+}  // namespace nativeformat
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "AllocationCounter.h"
+#include "ExecutionPlan.h"
+#include "RenderThreadPool.h"
+#include "SharedNodePlugin.h"
+
+BOOST_AUTO_TEST_SUITE(ExecutionPlanTests)
+
+using namespace nativeformat::plugin;
+
+class LevelPlugin : public Plugin {
+ public:
+  LevelPlugin(float level, bool active, long cost_micros)
+      : _level(level), _active(active), _cost_micros(cost_micros) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    auto &audio = content[AudioContentTypeKey];
+    audio->setItems(audio->requiredItems());
+    for (size_t i = 0; i < audio->items(); ++i) {
+      audio->payload()[i] = _level * ((sample_index + i) % 7);
+    }
+    if (_cost_micros > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(_cost_micros));
+    }
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {
+    callback(nativeformat::Load{true});
+  }
+  bool loaded() const override { return true; }
+  std::string name() override { return "com.nativeformat.plugin.level"; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {}
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeProducer; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return _active;
+  }
+
+ private:
+  const float _level;
+  const bool _active;
+  const long _cost_micros;
+};
+
+class ScalePlugin : public Plugin {
+ public:
+  ScalePlugin(float scale, bool time_aligned,
+              std::shared_ptr<Plugin> child_plugin)
+      : _scale(scale),
+        _time_aligned(time_aligned),
+        _child_plugin(child_plugin) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    _child_plugin->feed(content, sample_index, graph_sample_index,
+                        loading_policy);
+    auto &audio = content[AudioContentTypeKey];
+    for (size_t i = 0; i < audio->items(); ++i) {
+      audio->payload()[i] *= _scale;
+    }
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {
+    _child_plugin->load(callback);
+  }
+  bool loaded() const override { return _child_plugin->loaded(); }
+  std::string name() override { return "com.nativeformat.plugin.scale"; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {}
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeConsumer; }
+  bool timeAligned() const override { return _time_aligned; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return _child_plugin->shouldProcess(sample_index_start, sample_index_end);
+  }
+
+ private:
+  const float _scale;
+  const bool _time_aligned;
+  const std::shared_ptr<Plugin> _child_plugin;
+};
+
+class PortScalePlugin : public PortPlugin {
+ public:
+  PortScalePlugin(float scale, std::shared_ptr<Plugin> child_plugin)
+      : _scale(scale), _child_plugin(child_plugin), _map_feeds(0) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    _map_feeds++;
+    PortPlugin::feed(content, sample_index, graph_sample_index,
+                     loading_policy);
+  }
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override {
+    _child_plugin->feedPorts(content, sample_index, graph_sample_index,
+                             loading_policy);
+    Content &audio = *content[AudioPortId];
+    for (size_t i = 0; i < audio.items(); ++i) {
+      audio.payload()[i] *= _scale;
+    }
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {
+    _child_plugin->load(callback);
+  }
+  bool loaded() const override { return _child_plugin->loaded(); }
+  std::string name() override { return "com.nativeformat.plugin.portscale"; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {}
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeConsumer; }
+  bool timeAligned() const override { return true; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return _child_plugin->shouldProcess(sample_index_start, sample_index_end);
+  }
+
+  int mapFeeds() const { return _map_feeds; }
+
+ private:
+  const float _scale;
+  const std::shared_ptr<Plugin> _child_plugin;
+  int _map_feeds;
+};
+
+typedef std::function<std::shared_ptr<Plugin>(std::shared_ptr<Plugin>)>
+    PluginCreator;
+
+static std::shared_ptr<ExecutionPlan::Node> createNode(
+    PluginCreator creator,
+    const std::vector<std::shared_ptr<ExecutionPlan::Node>> &inputs,
+    const std::string &destination = AudioContentTypeKey) {
+  auto node = std::make_shared<ExecutionPlan::Node>();
+  std::vector<MixerPlugin::Metadata> metadata;
+  for (const auto &input : inputs) {
+    MixerPlugin::Metadata input_metadata;
+    input_metadata._plugin = input->_plugin;
+    input_metadata._edges = {{AudioContentTypeKey, destination}};
+    metadata.push_back(input_metadata);
+    node->_inputs.emplace_back(input, input_metadata._edges);
+  }
+  node->_input = std::make_shared<PlanInputPlugin>(metadata, 2, 44100.0);
+  if (creator) {
+    node->_plugin = creator(node->_input);
+  }
+  return node;
+}
+
+static std::shared_ptr<ExecutionPlan::Node> createLevel(float level,
+                                                        bool active = true,
+                                                        long cost_micros = 0) {
+  return createNode(
+      [level, active, cost_micros](std::shared_ptr<Plugin> child) {
+        return std::make_shared<LevelPlugin>(level, active, cost_micros);
+      },
+      {});
+}
+
+static std::shared_ptr<ExecutionPlan::Node> createScale(
+    float scale, bool time_aligned,
+    const std::vector<std::shared_ptr<ExecutionPlan::Node>> &inputs) {
+  return createNode(
+      [scale, time_aligned](std::shared_ptr<Plugin> child) {
+        return std::make_shared<ScalePlugin>(scale, time_aligned, child);
+      },
+      inputs);
+}
+
+// output <- scale(0.5) <- [level(0.1), level(0.2, inactive),
+//                          scale(2.0) <- level(0.3)]
+// output <- unaligned scale(3.0) <- level(0.4)
+static std::shared_ptr<ExecutionPlan::Node> createTestGraph() {
+  return createNode(
+      nullptr,
+      {createScale(0.5f, true,
+                   {createLevel(0.1f), createLevel(0.2f, false),
+                    createScale(2.0f, true, {createLevel(0.3f)})}),
+       createScale(3.0f, false, {createLevel(0.4f)})});
+}
+
+// output <- scale(0.5) <- shared level(0.3)
+// output <- unaligned scale(2.0) <- shared level(0.3)
+static std::shared_ptr<ExecutionPlan::Node> createSharedGraph(
+    const std::shared_ptr<RenderPass> &render_pass) {
+  auto shared_node = createLevel(0.3f);
+  shared_node->_plugin =
+      std::make_shared<SharedNodePlugin>(shared_node->_plugin, render_pass);
+  return createNode(nullptr, {createScale(0.5f, true, {shared_node}),
+                              createScale(2.0f, false, {shared_node})});
+}
+
+static std::map<std::string, std::shared_ptr<Content>> createContent(
+    size_t items) {
+  return {{AudioContentTypeKey,
+           std::make_shared<Content>(items, 0, 44100.0, 2, items,
+                                     ContentPayloadTypeBuffer)}};
+}
+
+static void checkContentEqual(const std::shared_ptr<Content> &lhs,
+                              const std::shared_ptr<Content> &rhs) {
+  BOOST_REQUIRE_EQUAL(lhs->items(), rhs->items());
+  BOOST_REQUIRE(std::equal(lhs->payload(), lhs->payload() + lhs->items(),
+                           rhs->payload()));
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanFlattensAlignedPlugins) {
+  ExecutionPlan plan(createTestGraph());
+  // Both scales, the three levels under the aligned scale and the unaligned
+  // scale, whose level is still fed recursively
+  BOOST_CHECK_EQUAL(plan.steps(), 6);
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanMatchesRecursiveFeed) {
+  auto recursive_output = createTestGraph();
+  ExecutionPlan plan(createTestGraph());
+  auto recursive_content = createContent(2048);
+  auto plan_content = createContent(2048);
+  for (long sample_index = 0; sample_index < 2048 * 20;
+       sample_index += 2048) {
+    recursive_content[AudioContentTypeKey]->erase();
+    plan_content[AudioContentTypeKey]->erase();
+    recursive_output->_input->feed(
+        recursive_content, sample_index, sample_index,
+        nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    plan.feed(plan_content, sample_index, sample_index,
+              nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    checkContentEqual(recursive_content[AudioContentTypeKey],
+                      plan_content[AudioContentTypeKey]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanFollowsBlockSize) {
+  ExecutionPlan plan(createTestGraph());
+  for (size_t items : {2048, 512, 2048}) {
+    auto content = createContent(items);
+    plan.feed(content, 0, 0, nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    BOOST_CHECK_EQUAL(content[AudioContentTypeKey]->items(), items);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanParallelMatchesSerial) {
+  auto create_graph = []() {
+    std::vector<std::shared_ptr<ExecutionPlan::Node>> levels;
+    for (int i = 0; i < 6; ++i) {
+      levels.push_back(createLevel(0.1f * (i + 1), true, 200));
+    }
+    return createNode(nullptr, {createScale(0.5f, true, levels)});
+  };
+  ExecutionPlan serial_plan(create_graph());
+  ExecutionPlan parallel_plan(
+      create_graph(),
+      std::make_shared<nativeformat::smartplayer::RenderThreadPool>(4));
+  auto serial_content = createContent(2048);
+  auto parallel_content = createContent(2048);
+  for (long sample_index = 0; sample_index < 2048 * 20;
+       sample_index += 2048) {
+    serial_content[AudioContentTypeKey]->erase();
+    parallel_content[AudioContentTypeKey]->erase();
+    serial_plan.feed(serial_content, sample_index, sample_index,
+                     nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    parallel_plan.feed(parallel_content, sample_index, sample_index,
+                       nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    checkContentEqual(serial_content[AudioContentTypeKey],
+                      parallel_content[AudioContentTypeKey]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanFeedsPorts) {
+  auto create_graph = []() {
+    return createNode(
+        nullptr,
+        {createNode(
+             [](std::shared_ptr<Plugin> child) {
+               return std::make_shared<PortScalePlugin>(0.5f, child);
+             },
+             {createLevel(0.1f), createScale(2.0f, true, {createLevel(0.3f)})}),
+         createLevel(0.2f)});
+  };
+  auto recursive_output = create_graph();
+  auto plan_output = create_graph();
+  ExecutionPlan plan(plan_output);
+  auto recursive_content = createContent(2048);
+  auto plan_content = createContent(2048);
+  for (long sample_index = 0; sample_index < 2048 * 10;
+       sample_index += 2048) {
+    recursive_content[AudioContentTypeKey]->erase();
+    plan_content[AudioContentTypeKey]->erase();
+    recursive_output->_input->feed(
+        recursive_content, sample_index, sample_index,
+        nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    plan.feed(plan_content, sample_index, sample_index,
+              nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    checkContentEqual(recursive_content[AudioContentTypeKey],
+                      plan_content[AudioContentTypeKey]);
+  }
+  auto recursive_scale = std::static_pointer_cast<PortScalePlugin>(
+      recursive_output->_inputs.front().first->_plugin);
+  auto plan_scale = std::static_pointer_cast<PortScalePlugin>(
+      plan_output->_inputs.front().first->_plugin);
+  BOOST_CHECK_EQUAL(recursive_scale->mapFeeds(), 10);
+  BOOST_CHECK_EQUAL(plan_scale->mapFeeds(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanSharesNodes) {
+  auto recursive_render_pass = std::make_shared<RenderPass>(0);
+  auto plan_render_pass = std::make_shared<RenderPass>(0);
+  auto recursive_output = createSharedGraph(recursive_render_pass);
+  ExecutionPlan plan(createSharedGraph(plan_render_pass));
+  // Both scales and the level they share
+  BOOST_CHECK_EQUAL(plan.steps(), 3);
+  auto recursive_content = createContent(2048);
+  auto plan_content = createContent(2048);
+  for (long sample_index = 0; sample_index < 2048 * 10;
+       sample_index += 2048) {
+    ++(*recursive_render_pass);
+    ++(*plan_render_pass);
+    recursive_content[AudioContentTypeKey]->erase();
+    plan_content[AudioContentTypeKey]->erase();
+    recursive_output->_input->feed(
+        recursive_content, sample_index, sample_index,
+        nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    plan.feed(plan_content, sample_index, sample_index,
+              nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    checkContentEqual(recursive_content[AudioContentTypeKey],
+                      plan_content[AudioContentTypeKey]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanBindsWhenItTakesOver) {
+  auto recursive_output = createTestGraph();
+  auto plan_output = createTestGraph();
+  ExecutionPlan old_plan(plan_output);
+  // Compiled over the same plugins while the old plan still renders them
+  ExecutionPlan new_plan(plan_output, nullptr, true, false);
+  auto recursive_content = createContent(2048);
+  auto plan_content = createContent(2048);
+  for (long sample_index = 0; sample_index < 2048 * 20;
+       sample_index += 2048) {
+    if (sample_index == 2048 * 10) {
+      new_plan.bind();
+    }
+    ExecutionPlan &plan = sample_index < 2048 * 10 ? old_plan : new_plan;
+    recursive_content[AudioContentTypeKey]->erase();
+    plan_content[AudioContentTypeKey]->erase();
+    recursive_output->_input->feed(
+        recursive_content, sample_index, sample_index,
+        nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    plan.feed(plan_content, sample_index, sample_index,
+              nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    checkContentEqual(recursive_content[AudioContentTypeKey],
+                      plan_content[AudioContentTypeKey]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanRendersWithoutAllocating) {
+  auto render_pass = std::make_shared<RenderPass>(0);
+  auto shared_node = createLevel(0.3f);
+  shared_node->_plugin =
+      std::make_shared<SharedNodePlugin>(shared_node->_plugin, render_pass);
+  // Mixed, shared, recursive and port fed steps
+  ExecutionPlan plan(
+      createNode(nullptr,
+                 {createScale(0.5f, true,
+                              {createLevel(0.1f), createLevel(0.2f, false),
+                               shared_node}),
+                  createScale(2.0f, false, {shared_node, createLevel(0.4f)}),
+                  createNode(
+                      [](std::shared_ptr<Plugin> child) {
+                        return std::make_shared<PortScalePlugin>(0.5f, child);
+                      },
+                      {createLevel(0.5f)})}),
+      std::make_shared<nativeformat::smartplayer::RenderThreadPool>(4));
+  auto content = createContent(2048);
+  // Blocks cut short before the start of a graph are smaller
+  auto cut_content = createContent(512);
+  plan.reserve(*content[AudioContentTypeKey]);
+  const auto render = [&](long sample_index) {
+    for (auto *block_content : {&content, &cut_content}) {
+      ++(*render_pass);
+      (*block_content)[AudioContentTypeKey]->erase();
+      plan.feed(*block_content, sample_index, sample_index,
+                nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    }
+  };
+  // The mixers create the buffers for their children on the first block
+  render(0);
+  nativeformat::test::startCountingAllocations();
+  for (long sample_index = 2048; sample_index < 2048 * 20;
+       sample_index += 2048) {
+    render(sample_index);
+  }
+  BOOST_CHECK_EQUAL(nativeformat::test::stopCountingAllocations(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testExecutionPlanCreatesPortsBeforeRendering) {
+  // Inputs mixed into a port the consumers haven't got yet, fed by map and by
+  // port
+  ExecutionPlan plan(createNode(
+      nullptr,
+      {createNode(
+           [](std::shared_ptr<Plugin> child) {
+             return std::make_shared<ScalePlugin>(0.5f, true, child);
+           },
+           {createLevel(0.1f)}, "sidechain"),
+       createNode(
+           [](std::shared_ptr<Plugin> child) {
+             return std::make_shared<PortScalePlugin>(0.5f, child);
+           },
+           {createLevel(0.2f)}, "sidechain")}));
+  auto content = createContent(2048);
+  plan.reserve(*content[AudioContentTypeKey]);
+  nativeformat::test::startCountingAllocations();
+  for (long sample_index = 0; sample_index < 2048 * 4;
+       sample_index += 2048) {
+    content[AudioContentTypeKey]->erase();
+    plan.feed(content, sample_index, sample_index,
+              nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  }
+  BOOST_CHECK_EQUAL(nativeformat::test::stopCountingAllocations(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
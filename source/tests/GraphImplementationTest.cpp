@@ -20,10 +20,16 @@
  */
 #include <boost/test/unit_test.hpp>
 
+#include <cmath>
+#include <future>
+
 #include "GraphImplementation.h"
+#include "plugins/wave/WavePluginFactory.h"
 
 BOOST_AUTO_TEST_SUITE(GraphImplementationTests)
 
+using namespace nativeformat::plugin;
+
 static void fillTestScore(nfgrapher::Score &s) {
   s.version = nfgrapher::version();
   s.graph.id = "com.nativeformat.graph:123";
@@ -32,6 +38,64 @@ static void fillTestScore(nfgrapher::Score &s) {
           nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH));
 }
 
+static nlohmann::json sineNode(const std::string &id, double frequency) {
+  return {{"id", id},
+          {"kind", "com.nativeformat.plugin.wave.sine"},
+          {"config",
+           {{"frequency", frequency},
+            {"when", 0.0},
+            {"duration", 2000000000.0}}},
+          {"params", nlohmann::json::object()}};
+}
+
+static std::string sinesScoreString(double frequency_a, double frequency_b) {
+  nlohmann::json score = {
+      {"version", nfgrapher::version()},
+      {"graph",
+       {{"id", "com.nativeformat.graph:sines"},
+        {"nodes", nlohmann::json::array({sineNode("sine-a", frequency_a),
+                                         sineNode("sine-b", frequency_b)})},
+        {"edges", nlohmann::json::array()},
+        {"scripts", nlohmann::json::array()}}}};
+  return score.dump();
+}
+
+static std::shared_ptr<nativeformat::smartplayer::GraphImplementation>
+createSinesGraph() {
+  auto graph = std::make_shared<nativeformat::smartplayer::GraphImplementation>(
+      2, 44100.0, nativeformat::smartplayer::createGraphSessionId());
+  graph->setPluginRegistry(std::make_shared<nativeformat::plugin::Registry>(
+      std::vector<std::shared_ptr<nativeformat::plugin::Factory>>(
+          {std::make_shared<nativeformat::plugin::wave::WavePluginFactory>()}),
+      [](const std::string &plugin_namespace,
+         const std::string &variable_name) { return ""; }));
+  return graph;
+}
+
+static bool loadScoreString(
+    const std::shared_ptr<nativeformat::smartplayer::GraphImplementation>
+        &graph,
+    const std::string &score) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  graph->setJson(score, [promise](const nativeformat::Load &load) {
+    promise->set_value(load._loaded);
+  });
+  return promise->get_future().get();
+}
+
+static std::map<std::string, std::shared_ptr<nativeformat::smartplayer::Node>>
+graphNodes(const std::shared_ptr<nativeformat::smartplayer::GraphImplementation>
+               &graph) {
+  std::map<std::string, std::shared_ptr<nativeformat::smartplayer::Node>>
+      nodes;
+  graph->forEachNode(
+      [&nodes](const std::shared_ptr<nativeformat::smartplayer::Node> &node) {
+        nodes[node->identifier()] = node;
+        return true;
+      });
+  return nodes;
+}
+
 BOOST_AUTO_TEST_CASE(testGraphImplementationConstructor) {
   std::shared_ptr<nativeformat::smartplayer::GraphImplementation> graph =
       std::make_shared<nativeformat::smartplayer::GraphImplementation>(
@@ -86,4 +150,269 @@ BOOST_AUTO_TEST_CASE(testGraphImplementationIdentifier) {
   BOOST_CHECK_EQUAL(s.graph.id, graph->identifier());
 }
 
+BOOST_AUTO_TEST_CASE(testGraphImplementationReloadKeepsUnchangedNodes) {
+  auto graph = createSinesGraph();
+  BOOST_REQUIRE(loadScoreString(graph, sinesScoreString(440.0, 220.0)));
+  auto nodes = graphNodes(graph);
+  BOOST_REQUIRE(loadScoreString(graph, sinesScoreString(440.0, 220.0)));
+  auto reloaded_nodes = graphNodes(graph);
+  BOOST_CHECK(nodes["sine-a"] == reloaded_nodes["sine-a"]);
+  BOOST_CHECK(nodes["sine-b"] == reloaded_nodes["sine-b"]);
+}
+
+BOOST_AUTO_TEST_CASE(testGraphImplementationReloadRebuildsChangedNodes) {
+  auto graph = createSinesGraph();
+  BOOST_REQUIRE(loadScoreString(graph, sinesScoreString(440.0, 220.0)));
+  auto nodes = graphNodes(graph);
+  BOOST_REQUIRE(loadScoreString(graph, sinesScoreString(440.0, 330.0)));
+  auto reloaded_nodes = graphNodes(graph);
+  BOOST_CHECK(nodes["sine-a"] == reloaded_nodes["sine-a"]);
+  BOOST_CHECK(nodes["sine-b"] != reloaded_nodes["sine-b"]);
+}
+
+BOOST_AUTO_TEST_CASE(testGraphImplementationCrossfadeRebuildsChangedScore) {
+  auto graph = createSinesGraph();
+  graph->setCrossfadeBlocks(4);
+  BOOST_REQUIRE(loadScoreString(graph, sinesScoreString(440.0, 220.0)));
+  auto nodes = graphNodes(graph);
+  BOOST_REQUIRE(loadScoreString(graph, sinesScoreString(440.0, 220.0)));
+  auto unchanged_nodes = graphNodes(graph);
+  BOOST_CHECK(nodes["sine-a"] == unchanged_nodes["sine-a"]);
+  BOOST_CHECK(nodes["sine-b"] == unchanged_nodes["sine-b"]);
+  // Fading scores render side by side, so they share nothing
+  BOOST_REQUIRE(loadScoreString(graph, sinesScoreString(440.0, 330.0)));
+  auto changed_nodes = graphNodes(graph);
+  BOOST_CHECK(nodes["sine-a"] != changed_nodes["sine-a"]);
+  BOOST_CHECK(nodes["sine-b"] != changed_nodes["sine-b"]);
+}
+
+// Renders a constant level, but only once it has been run a number of times,
+// like a file that asks for its chunks to be decoded as it runs
+class LevelPlugin : public Plugin {
+ public:
+  LevelPlugin(float level, int loading_runs,
+              const std::shared_ptr<int> &live_plugins)
+      : _level(level),
+        _loading_runs(loading_runs),
+        _live_plugins(live_plugins),
+        _runs(0),
+        _rendered_samples(0) {
+    ++(*_live_plugins);
+  }
+  virtual ~LevelPlugin() { --(*_live_plugins); }
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    auto &audio = content[AudioContentTypeKey];
+    if (_runs < _loading_runs) {
+      audio->setItems(0);
+      return;
+    }
+    audio->setItems(audio->requiredItems());
+    std::fill(audio->payload(), audio->payload() + audio->items(), _level);
+    _rendered_samples += audio->items();
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {
+    callback(nativeformat::Load(true));
+  }
+  bool loaded() const override { return true; }
+  std::string name() override { return LevelPluginKind; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {
+    ++_runs;
+  }
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeProducer; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return true;
+  }
+
+  long renderedSamples() const { return _rendered_samples; }
+
+  static const char *LevelPluginKind;
+
+ private:
+  const float _level;
+  const int _loading_runs;
+  const std::shared_ptr<int> _live_plugins;
+  int _runs;
+  long _rendered_samples;
+};
+
+const char *LevelPlugin::LevelPluginKind = "com.nativeformat.plugin.test.level";
+
+class LevelPluginFactory : public Factory {
+ public:
+  LevelPluginFactory() : _live_plugins(std::make_shared<int>(0)) {}
+
+  std::shared_ptr<Plugin> createPlugin(
+      const nfgrapher::Node &grapher_node, const std::string &graph_id,
+      const NF_PLUGIN_RESOLVE_CALLBACK &resolve_callback, int channels,
+      double samplerate, const std::shared_ptr<Plugin> &child_plugin,
+      const std::string &session_id) override {
+    auto plugin = std::make_shared<LevelPlugin>(
+        grapher_node.config["level"].get<float>(),
+        grapher_node.config["loading_runs"].get<int>(), _live_plugins);
+    _plugin = plugin;
+    return plugin;
+  }
+  std::vector<std::string> identifiers() const override {
+    return {LevelPlugin::LevelPluginKind};
+  }
+
+  const std::shared_ptr<int> _live_plugins;
+  std::weak_ptr<LevelPlugin> _plugin;
+};
+
+class RenderingGraph : public nativeformat::smartplayer::GraphImplementation {
+ public:
+  using GraphImplementation::GraphImplementation;
+  using GraphImplementation::run;
+  using GraphImplementation::traverse;
+};
+
+static std::string levelScoreString(float level, int loading_runs = 1) {
+  nlohmann::json score = {
+      {"version", nfgrapher::version()},
+      {"graph",
+       {{"id", "com.nativeformat.graph:level"},
+        {"nodes", nlohmann::json::array(
+                      {{{"id", "level"},
+                        {"kind", LevelPlugin::LevelPluginKind},
+                        {"config",
+                         {{"level", level}, {"loading_runs", loading_runs}}},
+                        {"params", nlohmann::json::object()}}})},
+        {"edges", nlohmann::json::array()},
+        {"scripts", nlohmann::json::array()}}}};
+  return score.dump();
+}
+
+static std::vector<float> renderBlock(
+    const std::shared_ptr<RenderingGraph> &graph, size_t block_samples) {
+  std::map<std::string, std::shared_ptr<Content>> content = {
+      {AudioContentTypeKey,
+       std::make_shared<Content>(block_samples, 0, 44100.0, 2, block_samples,
+                                 ContentPayloadTypeBuffer)}};
+  graph->traverse(content, nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  const Content &audio = *content[AudioContentTypeKey];
+  return std::vector<float>(audio.constPayload(),
+                            audio.constPayload() + audio.items());
+}
+
+// Creates a graph fading between scores over the given number of blocks, that
+// has played a couple of blocks of a score at level one
+static std::shared_ptr<RenderingGraph> createLevelGraph(
+    const std::shared_ptr<LevelPluginFactory> &factory, size_t block_samples,
+    size_t crossfade_blocks) {
+  auto graph = std::make_shared<RenderingGraph>(
+      2, 44100.0, nativeformat::smartplayer::createGraphSessionId());
+  graph->setPluginRegistry(std::make_shared<Registry>(
+      std::vector<std::shared_ptr<Factory>>({factory}),
+      [](const std::string &plugin_namespace,
+         const std::string &variable_name) { return ""; }));
+  graph->setBlockSize(block_samples);
+  graph->setCrossfadeBlocks(crossfade_blocks);
+  BOOST_REQUIRE(loadScoreString(graph, levelScoreString(1.0f)));
+  graph->run();
+  for (int block = 0; block < 2; ++block) {
+    for (float sample : renderBlock(graph, block_samples)) {
+      BOOST_REQUIRE_EQUAL(sample, 1.0f);
+    }
+  }
+  return graph;
+}
+
+// Checks a block of a fade between two constant levels, starting from the
+// given frame of the fade
+static void checkCrossfade(const std::vector<float> &rendered,
+                           long first_frame, long crossfade_frames,
+                           float outgoing_level, float incoming_level) {
+  BOOST_REQUIRE(!rendered.empty());
+  for (size_t i = 0; i < rendered.size(); ++i) {
+    const long frame = first_frame + i / 2;
+    const double position = static_cast<double>(frame) / crossfade_frames;
+    const float expected = incoming_level * std::sin(position * M_PI_2) +
+                           outgoing_level * std::cos(position * M_PI_2);
+    BOOST_CHECK_CLOSE(rendered[i], expected, 0.001);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testGraphImplementationCrossfadeRendersEqualPower) {
+  const size_t block_samples = 64;
+  const size_t crossfade_blocks = 2;
+  const long crossfade_frames = crossfade_blocks * block_samples / 2;
+  auto factory = std::make_shared<LevelPluginFactory>();
+  auto graph = createLevelGraph(factory, block_samples, crossfade_blocks);
+
+  // The new score is run and rendered up to where the graph has got to before
+  // it is heard, without the graph having to run first
+  BOOST_REQUIRE(loadScoreString(graph, levelScoreString(3.0f)));
+  BOOST_REQUIRE(!factory->_plugin.expired());
+  BOOST_CHECK_EQUAL(factory->_plugin.lock()->renderedSamples(),
+                    static_cast<long>(2 * block_samples));
+  BOOST_CHECK_EQUAL(*factory->_live_plugins, 2);
+
+  // Each frame mixes the two scores at gains whose powers add up to one, over
+  // as many blocks as the graph was asked to fade for
+  for (size_t block = 0; block < crossfade_blocks; ++block) {
+    checkCrossfade(renderBlock(graph, block_samples),
+                   block * block_samples / 2, crossfade_frames, 1.0f, 3.0f);
+  }
+  for (float sample : renderBlock(graph, block_samples)) {
+    BOOST_REQUIRE_EQUAL(sample, 3.0f);
+  }
+  // The score that faded out is only freed once the graph runs
+  BOOST_CHECK_EQUAL(*factory->_live_plugins, 2);
+  graph->run();
+  BOOST_CHECK_EQUAL(*factory->_live_plugins, 1);
+
+  // Seeking mid fade cuts straight over to the new score
+  BOOST_REQUIRE(loadScoreString(graph, levelScoreString(5.0f)));
+  checkCrossfade(renderBlock(graph, block_samples), 0, crossfade_frames, 3.0f,
+                 5.0f);
+  graph->setRenderTime(0.0);
+  for (float sample : renderBlock(graph, block_samples)) {
+    BOOST_REQUIRE_EQUAL(sample, 5.0f);
+  }
+  BOOST_CHECK_EQUAL(*factory->_live_plugins, 2);
+  graph->run();
+  BOOST_CHECK_EQUAL(*factory->_live_plugins, 1);
+}
+
+BOOST_AUTO_TEST_CASE(testGraphImplementationCrossfadeWaitsForContentOverRuns) {
+  const size_t block_samples = 64;
+  const size_t crossfade_blocks = 2;
+  const long crossfade_frames = crossfade_blocks * block_samples / 2;
+  auto factory = std::make_shared<LevelPluginFactory>();
+  auto graph = createLevelGraph(factory, block_samples, crossfade_blocks);
+
+  // A score whose content isn't ready yet keeps catching up as the graph
+  // runs, and the one playing carries on until it has
+  std::promise<bool> loaded;
+  auto loaded_future = loaded.get_future();
+  graph->setJson(levelScoreString(3.0f, 3),
+                 [&loaded](const nativeformat::Load &load) {
+                   loaded.set_value(load._loaded);
+                 });
+  BOOST_CHECK(loaded_future.wait_for(std::chrono::seconds(0)) !=
+              std::future_status::ready);
+  for (float sample : renderBlock(graph, block_samples)) {
+    BOOST_REQUIRE_EQUAL(sample, 1.0f);
+  }
+  graph->run();
+  BOOST_CHECK(loaded_future.wait_for(std::chrono::seconds(0)) !=
+              std::future_status::ready);
+  graph->run();
+  BOOST_REQUIRE(loaded_future.wait_for(std::chrono::seconds(0)) ==
+                std::future_status::ready);
+  BOOST_REQUIRE(loaded_future.get());
+  BOOST_CHECK_EQUAL(factory->_plugin.lock()->renderedSamples(),
+                    static_cast<long>(3 * block_samples));
+  checkCrossfade(renderBlock(graph, block_samples), 0, crossfade_frames, 1.0f,
+                 3.0f);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+#include "HealthMonitor.h"
+
+BOOST_AUTO_TEST_SUITE(HealthMonitorTests)
+
+using namespace nativeformat::smartplayer;
+
+static void renderCallback(HealthMonitor &health_monitor, long frames,
+                           double render_time) {
+  health_monitor.willRender();
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+  health_monitor.didRender(frames, 44100.0, render_time);
+}
+
+BOOST_AUTO_TEST_CASE(testHealthMonitorCountsMissedDeadlines) {
+  HealthMonitor health_monitor(HealthMonitorNearMissRatio, 0.0);
+  HealthMonitor::Report report;
+  BOOST_CHECK(!health_monitor.report(report));
+
+  // A second of audio is plenty of time, a single frame is not
+  renderCallback(health_monitor, 44100, 1.0);
+  BOOST_CHECK(!health_monitor.report(report));
+  renderCallback(health_monitor, 1, 2.0);
+  health_monitor.didStutter(3.0);
+  BOOST_REQUIRE(health_monitor.report(report));
+  BOOST_CHECK_EQUAL(report._xruns, 1);
+  BOOST_CHECK_EQUAL(report._near_misses, 0);
+  BOOST_CHECK_EQUAL(report._stutters, 1);
+  BOOST_CHECK_EQUAL(report._render_time, 3.0);
+  BOOST_CHECK_EQUAL(report._callbacks._blocks, 2);
+  BOOST_CHECK_GE(report._callbacks._max_time, 100.0e-6);
+}
+
+BOOST_AUTO_TEST_CASE(testHealthMonitorCountsNearMisses) {
+  HealthMonitor health_monitor(0.0, 0.0);
+  renderCallback(health_monitor, 44100, 1.0);
+  HealthMonitor::Report report;
+  BOOST_REQUIRE(health_monitor.report(report));
+  BOOST_CHECK_EQUAL(report._xruns, 0);
+  BOOST_CHECK_EQUAL(report._near_misses, 1);
+  BOOST_CHECK_EQUAL(report._render_time, 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(testHealthMonitorLimitsReports) {
+  HealthMonitor health_monitor(HealthMonitorNearMissRatio, 3600.0);
+  HealthMonitor::Report report;
+  health_monitor.didStutter(1.0);
+  BOOST_CHECK(health_monitor.report(report));
+  health_monitor.didStutter(2.0);
+  BOOST_CHECK(!health_monitor.report(report));
+}
+
+BOOST_AUTO_TEST_CASE(testHealthMonitorReportsEveryEvent) {
+  HealthMonitor health_monitor(HealthMonitorNearMissRatio, 0.0);
+  renderCallback(health_monitor, 1, 1.0);
+  health_monitor.didStutter(2.0);
+  health_monitor.didStutter(3.0);
+  HealthMonitor::Report report;
+  BOOST_REQUIRE(health_monitor.report(report));
+  BOOST_REQUIRE_EQUAL(report._events.size(), 3);
+  BOOST_CHECK_EQUAL(report._events[0]._type, HealthMonitor::EventTypeXrun);
+  BOOST_CHECK_EQUAL(report._events[0]._render_time, 1.0);
+  BOOST_CHECK_EQUAL(report._events[1]._type, HealthMonitor::EventTypeStutter);
+  BOOST_CHECK_EQUAL(report._events[1]._render_time, 2.0);
+  BOOST_CHECK_EQUAL(report._events[2]._render_time, 3.0);
+
+  // Only the events since the last report, and only the most recent ones
+  for (size_t i = 0; i < HealthMonitor::ReportEvents + 8; ++i) {
+    health_monitor.didStutter(10.0 + i);
+  }
+  BOOST_REQUIRE(health_monitor.report(report));
+  BOOST_CHECK_EQUAL(report._stutters, HealthMonitor::ReportEvents + 10);
+  BOOST_REQUIRE_EQUAL(report._events.size(), HealthMonitor::ReportEvents);
+  BOOST_CHECK_EQUAL(report._events.front()._render_time, 18.0);
+  BOOST_CHECK_EQUAL(report._events.back()._render_time,
+                    10.0 + HealthMonitor::ReportEvents + 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
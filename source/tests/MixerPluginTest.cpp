@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "AllocationCounter.h"
+
+// Just for testing
+#define private public
+
+#include "MixerPlugin.h"
+#include "RenderThreadPool.h"
+
+BOOST_AUTO_TEST_SUITE(MixerPluginTests)
+
+using namespace nativeformat::plugin;
+
+class BranchPlugin : public Plugin {
+ public:
+  BranchPlugin(float level, long cost_micros)
+      : _level(level), _cost_micros(cost_micros) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    auto &audio = content[AudioContentTypeKey];
+    audio->setItems(audio->requiredItems());
+    if (_level == 0.0f) {
+      audio->setSilent();
+    } else {
+      std::fill_n(audio->payload(), audio->items(), _level);
+    }
+    if (_cost_micros > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(_cost_micros));
+    }
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {
+    callback(nativeformat::Load{true});
+  }
+  bool loaded() const override { return true; }
+  std::string name() override { return "com.nativeformat.plugin.branch"; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {}
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeProducer; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return true;
+  }
+
+ private:
+  const float _level;
+  const long _cost_micros;
+};
+
+static std::shared_ptr<MixerPlugin> createLevelMixer(
+    const std::vector<float> &levels, long cost_micros,
+    std::shared_ptr<nativeformat::smartplayer::RenderThreadPool> pool) {
+  std::vector<MixerPlugin::Metadata> metadata;
+  for (const auto level : levels) {
+    MixerPlugin::Metadata branch;
+    branch._plugin = std::make_shared<BranchPlugin>(level, cost_micros);
+    branch._edges = {{AudioContentTypeKey, AudioContentTypeKey}};
+    metadata.push_back(branch);
+  }
+  return std::make_shared<MixerPlugin>(metadata, 2, 44100.0, pool);
+}
+
+static std::shared_ptr<MixerPlugin> createBranchMixer(
+    long cost_micros,
+    std::shared_ptr<nativeformat::smartplayer::RenderThreadPool> pool) {
+  return createLevelMixer({0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f}, cost_micros,
+                          pool);
+}
+
+static std::map<std::string, std::shared_ptr<Content>> createContent() {
+  return {{AudioContentTypeKey,
+           std::make_shared<Content>(2048, 0, 44100.0, 2, 2048,
+                                     ContentPayloadTypeBuffer)}};
+}
+
+BOOST_AUTO_TEST_CASE(testParallelFeedMatchesSerial) {
+  auto serial_mixer = createBranchMixer(200, nullptr);
+  auto parallel_mixer = createBranchMixer(
+      200, std::make_shared<nativeformat::smartplayer::RenderThreadPool>(4));
+  auto serial_content = createContent();
+  auto parallel_content = createContent();
+  for (long sample_index = 0; sample_index < 2048 * 50;
+       sample_index += 2048) {
+    serial_content[AudioContentTypeKey]->erase();
+    parallel_content[AudioContentTypeKey]->erase();
+    serial_mixer->feed(serial_content, sample_index, sample_index,
+                       nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    parallel_mixer->feed(parallel_content, sample_index, sample_index,
+                         nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    BOOST_REQUIRE_EQUAL(serial_content[AudioContentTypeKey]->items(),
+                        parallel_content[AudioContentTypeKey]->items());
+    const auto &serial_audio = serial_content[AudioContentTypeKey];
+    const auto &parallel_audio = parallel_content[AudioContentTypeKey];
+    BOOST_REQUIRE(std::equal(serial_audio->payload(),
+                             serial_audio->payload() + serial_audio->items(),
+                             parallel_audio->payload()));
+  }
+  BOOST_CHECK(!serial_mixer->shouldFeedInParallel());
+  BOOST_CHECK(parallel_mixer->shouldFeedInParallel());
+}
+
+BOOST_AUTO_TEST_CASE(testSingleRenderThreadStaysSerial) {
+  auto mixer = createBranchMixer(
+      200, std::make_shared<nativeformat::smartplayer::RenderThreadPool>(1));
+  auto content = createContent();
+  for (long sample_index = 0; sample_index < 2048 * 10;
+       sample_index += 2048) {
+    content[AudioContentTypeKey]->erase();
+    mixer->feed(content, sample_index, sample_index,
+                nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  }
+  BOOST_CHECK(!mixer->shouldFeedInParallel());
+}
+
+BOOST_AUTO_TEST_CASE(testMixerPluginFeedsWithoutAllocating) {
+  auto mixer = createBranchMixer(0, nullptr);
+  auto content = createContent();
+  mixer->feed(content, 0, 0, nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  nativeformat::test::startCountingAllocations();
+  for (long sample_index = 2048; sample_index < 2048 * 10;
+       sample_index += 2048) {
+    content[AudioContentTypeKey]->erase();
+    mixer->feed(content, sample_index, sample_index,
+                nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  }
+  BOOST_CHECK_EQUAL(nativeformat::test::stopCountingAllocations(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testMixerPluginSkipsSilentChildren) {
+  auto content = createContent();
+  auto &audio = content[AudioContentTypeKey];
+
+  auto silent_mixer = createLevelMixer({0.0f, 0.0f, 0.0f}, 0, nullptr);
+  for (long sample_index = 0; sample_index < 2048 * 3;
+       sample_index += 2048) {
+    audio->erase();
+    silent_mixer->feed(content, sample_index, sample_index,
+                       nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    BOOST_CHECK_EQUAL(audio->items(), 2048);
+    BOOST_CHECK(audio->silent());
+    BOOST_CHECK(std::all_of(audio->constPayload(),
+                            audio->constPayload() + audio->items(),
+                            [](float sample) { return sample == 0.0f; }));
+  }
+
+  auto sparse_mixer = createLevelMixer({0.0f, 0.25f, 0.0f, 0.5f}, 0, nullptr);
+  audio->erase();
+  sparse_mixer->feed(content, 0, 0,
+                     nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  BOOST_CHECK_EQUAL(audio->items(), 2048);
+  BOOST_CHECK(!audio->silent());
+  BOOST_CHECK(std::all_of(audio->constPayload(),
+                          audio->constPayload() + audio->items(),
+                          [](float sample) { return sample == 0.75f; }));
+
+  // Erasing written content zeroes it so the silent mixer is silent again
+  audio->erase();
+  silent_mixer->feed(content, 0, 0,
+                     nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  BOOST_CHECK(audio->silent());
+  BOOST_CHECK(std::all_of(audio->constPayload(),
+                          audio->constPayload() + audio->items(),
+                          [](float sample) { return sample == 0.0f; }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "OfflineSegments.h"
+
+BOOST_AUTO_TEST_SUITE(OfflineSegmentsTests)
+
+using namespace nativeformat::smartplayer;
+
+BOOST_AUTO_TEST_CASE(testPlanOfflineSegments) {
+  const long frames = 44100 * 10;
+  auto segments = planOfflineSegments(frames, 4, 4410, 441, 512);
+  BOOST_REQUIRE_EQUAL(segments.size(), 4);
+  BOOST_CHECK_EQUAL(segments.front()._render_frame, 0);
+  BOOST_CHECK_EQUAL(segments.front()._start_frame, 0);
+  BOOST_CHECK_EQUAL(segments.front()._fade_frames, 0);
+  BOOST_CHECK_EQUAL(segments.back()._end_frame, frames);
+  for (size_t i = 1; i < segments.size(); ++i) {
+    const OfflineSegment &segment = segments[i];
+    // Each segment picks up where the last one ended, fading in over its end
+    BOOST_CHECK_EQUAL(segment._start_frame + segment._fade_frames,
+                      segments[i - 1]._end_frame);
+    BOOST_CHECK_EQUAL(segment._fade_frames, 441);
+    BOOST_CHECK_EQUAL(segments[i - 1]._end_frame % 512, 0);
+    BOOST_CHECK_EQUAL(segment._render_frame % 512, 0);
+    BOOST_CHECK_LE(segment._render_frame, segment._start_frame - 4410);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testPlanOfflineSegmentsShortRender) {
+  // Too short to hold more than one crossfade
+  auto segments = planOfflineSegments(1000, 8, 4410, 441, 512);
+  BOOST_REQUIRE_EQUAL(segments.size(), 1);
+  BOOST_CHECK_EQUAL(segments.front()._end_frame, 1000);
+  BOOST_CHECK(planOfflineSegments(0, 8, 4410, 441, 512).empty());
+}
+
+BOOST_AUTO_TEST_CASE(testCrossfadeOfflineSegment) {
+  std::vector<float> output(8, 1.0f);
+  std::vector<float> fade_in(8, 0.0f);
+  crossfadeOfflineSegment(output.data(), fade_in.data(), 4, 2);
+  for (size_t frame = 1; frame < 4; ++frame) {
+    BOOST_CHECK_LT(output[frame * 2], output[(frame - 1) * 2]);
+    BOOST_CHECK_EQUAL(output[frame * 2], output[frame * 2 + 1]);
+  }
+  BOOST_CHECK_GT(output.front(), 0.5f);
+  BOOST_CHECK_LT(output.back(), 0.5f);
+
+  // Identical signals come through a crossfade untouched
+  std::vector<float> signal = {0.25f, -0.5f, 0.75f, -1.0f};
+  std::vector<float> stitched = signal;
+  crossfadeOfflineSegment(stitched.data(), signal.data(), 2, 2);
+  BOOST_CHECK_EQUAL(maximumSampleDeviation(stitched.data(), signal.data(),
+                                           signal.size()),
+                    0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(testMaximumSampleDeviation) {
+  std::vector<float> samples = {0.0f, 0.5f, -0.25f};
+  std::vector<float> reference = {0.0f, 0.25f, 0.25f};
+  BOOST_CHECK_EQUAL(
+      maximumSampleDeviation(samples.data(), reference.data(), samples.size()),
+      0.5f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
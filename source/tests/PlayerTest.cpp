@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <vector>
+
+// Just for testing
+#define private public
+
+#include "AllocationCounter.h"
+#include "GraphImplementation.h"
+#include "Player.h"
+#include "plugins/wave/WavePluginFactory.h"
+
+BOOST_AUTO_TEST_SUITE(PlayerTests)
+
+static std::string testScoreString(const std::string &graph_id) {
+  nfgrapher::Score s;
+  s.version = nfgrapher::version();
+  s.graph.id = graph_id;
+  s.graph.loading_policy =
+      std::unique_ptr<nfgrapher::LoadingPolicy>(new nfgrapher::LoadingPolicy(
+          nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH));
+  return ((nlohmann::json)s).dump();
+}
+
+static std::string sineScoreString(const std::string &graph_id,
+                                   double frequency) {
+  nlohmann::json node = {{"id", "sine"},
+                         {"kind", "com.nativeformat.plugin.wave.sine"},
+                         {"config",
+                          {{"frequency", frequency},
+                           {"when", 0.0},
+                           {"duration", 2000000000.0}}},
+                         {"params", nlohmann::json::object()}};
+  nlohmann::json score = {{"version", nfgrapher::version()},
+                          {"graph",
+                           {{"id", graph_id},
+                            {"nodes", nlohmann::json::array({node})},
+                            {"edges", nlohmann::json::array()},
+                            {"scripts", nlohmann::json::array()}}}};
+  return score.dump();
+}
+
+static std::shared_ptr<nativeformat::smartplayer::Player> createTestPlayer(
+    boost::asio::io_service &io_service, int render_threads = 1,
+    double samplerate = nativeformat::smartplayer::NFSmartPlayerSampleRate,
+    int block_frames = nativeformat::smartplayer::NFSmartPlayerBlockSize,
+    nativeformat::smartplayer::NF_SMART_PLAYER_ERROR_CALLBACK error_callback =
+        [](nativeformat::Load::ERROR_INFO &info) {}) {
+  return std::make_shared<nativeformat::smartplayer::Player>(
+      std::make_shared<nativeformat::plugin::Registry>(
+          std::vector<std::shared_ptr<nativeformat::plugin::Factory>>(
+              {std::make_shared<
+                  nativeformat::plugin::wave::WavePluginFactory>()}),
+          [](const std::string &plugin_namespace,
+             const std::string &variable_name) { return ""; }),
+      error_callback, 0, nativeformat::smartplayer::DriverTypeSoundCard, "",
+      io_service, render_threads, samplerate, block_frames);
+}
+
+BOOST_AUTO_TEST_CASE(testRenderWithoutGraphs) {
+  boost::asio::io_service io_service;
+  auto player = createTestPlayer(io_service);
+  std::vector<float> samples(NF_DRIVER_SAMPLE_BLOCK_SIZE * NF_DRIVER_CHANNELS,
+                             1.0f);
+  int frames = nativeformat::smartplayer::Player::driverRender(
+      player.get(), samples.data(), NF_DRIVER_SAMPLE_BLOCK_SIZE);
+  BOOST_CHECK_EQUAL(frames, 0);
+  for (const auto sample : samples) {
+    BOOST_CHECK_EQUAL(sample, 0.0f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testRenderSnapshotStress) {
+  boost::asio::io_service io_service;
+  auto player = createTestPlayer(io_service);
+  std::atomic<bool> done(false);
+  std::atomic<long> renders(0);
+  std::atomic<long> worst_render_nanos(0);
+
+  std::thread render_thread([&]() {
+    std::vector<float> samples(NF_DRIVER_SAMPLE_BLOCK_SIZE *
+                               NF_DRIVER_CHANNELS);
+    while (!done) {
+      auto start = std::chrono::steady_clock::now();
+      nativeformat::smartplayer::Player::driverRender(
+          player.get(), samples.data(), NF_DRIVER_SAMPLE_BLOCK_SIZE);
+      long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+      if (nanos > worst_render_nanos) {
+        worst_render_nanos = nanos;
+      }
+      renders++;
+    }
+  });
+
+  std::thread control_thread([&]() {
+    for (int i = 0; i < 200; ++i) {
+      const std::string graph_id =
+          "com.nativeformat.graph:" + std::to_string(i % 8);
+      auto graph =
+          std::make_shared<nativeformat::smartplayer::GraphImplementation>(
+              2, 44100.0, nativeformat::smartplayer::createGraphSessionId());
+      graph->setPluginRegistry(player->pluginRegistry());
+      graph->setJson(testScoreString(graph_id),
+                     [](const nativeformat::Load &load) {});
+      player->addGraph(graph);
+      player->setJson(testScoreString("com.nativeformat.graph:json"));
+      if (i % 3 == 0) {
+        player->removeGraph(graph_id);
+      }
+      player->run();
+    }
+  });
+
+  std::thread walk_thread([&]() {
+    while (!done) {
+      player->forEachGraph(
+          [](const std::shared_ptr<nativeformat::smartplayer::Graph> &graph) {
+            // Simulate a script taking its time walking the graphs
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            return true;
+          });
+      player->isLoaded();
+    }
+  });
+
+  control_thread.join();
+  done = true;
+  walk_thread.join();
+  render_thread.join();
+
+  BOOST_CHECK(renders > 0);
+  // How long callbacks take depends on the machine, so it's only reported
+  BOOST_TEST_MESSAGE("Rendered " << renders << " blocks, worst callback took "
+                                 << worst_render_nanos / 1000 << "us");
+}
+
+BOOST_AUTO_TEST_CASE(testRenderWithoutTheGraphsLock) {
+  boost::asio::io_service io_service;
+  auto player = createTestPlayer(io_service);
+  BOOST_REQUIRE(
+      player->setJson(sineScoreString("com.nativeformat.graph:locked", 440.0))
+          .get()
+          ._loaded);
+
+  // A render that waited on the graphs would never finish while they're
+  // locked, the timeout only keeps a broken build from hanging
+  std::unique_lock<std::mutex> graphs_lock(player->_graphs_mutex);
+  auto render = std::async(std::launch::async, [&player]() {
+    std::vector<float> samples(NF_DRIVER_SAMPLE_BLOCK_SIZE *
+                               NF_DRIVER_CHANNELS);
+    return nativeformat::smartplayer::Player::driverRender(
+        player.get(), samples.data(), NF_DRIVER_SAMPLE_BLOCK_SIZE);
+  });
+  const bool rendered = render.wait_for(std::chrono::seconds(10)) ==
+                        std::future_status::ready;
+  graphs_lock.unlock();
+  BOOST_CHECK(rendered);
+  BOOST_CHECK_EQUAL(render.get(), NF_DRIVER_SAMPLE_BLOCK_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(testRenderWithoutAllocating) {
+  boost::asio::io_service io_service;
+  auto player = createTestPlayer(io_service);
+  const std::string graph_id = "com.nativeformat.graph:allocating";
+  BOOST_REQUIRE(
+      player->setJson(sineScoreString(graph_id, 440.0)).get()._loaded);
+  const int block_frames = player->blockFrames();
+  std::vector<float> samples(block_frames * NF_DRIVER_CHANNELS);
+  // The plan creates the buffers plugins keep for themselves on the first
+  // block
+  nativeformat::smartplayer::Player::driverRender(player.get(), samples.data(),
+                                                  block_frames);
+
+  // Start the graph a block and a half early, so it renders silence, then a
+  // block cut short where the graph starts, then whole blocks
+  player->graphForIdentifier(graph_id)->setRenderTime(
+      -1.5 * block_frames / player->sampleRate());
+  nativeformat::test::startCountingAllocations();
+  for (int block = 0; block < 20; ++block) {
+    nativeformat::smartplayer::Player::driverRender(
+        player.get(), samples.data(), block_frames);
+  }
+  BOOST_CHECK_EQUAL(nativeformat::test::stopCountingAllocations(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testParallelRenderMatchesSerial) {
+  boost::asio::io_service io_service;
+  auto serial_player = createTestPlayer(io_service, 1);
+  auto parallel_player = createTestPlayer(io_service, 4);
+  const std::vector<double> frequencies = {110.0, 220.0, 330.0, 440.0,
+                                           550.0, 660.0};
+  for (size_t i = 0; i < frequencies.size(); ++i) {
+    const std::string graph_id =
+        "com.nativeformat.graph:" + std::to_string(i);
+    const std::string score = sineScoreString(graph_id, frequencies[i]);
+    BOOST_REQUIRE(serial_player->setJson(score).get()._loaded);
+    BOOST_REQUIRE(parallel_player->setJson(score).get()._loaded);
+  }
+
+  const size_t sample_count = NF_DRIVER_SAMPLE_BLOCK_SIZE * NF_DRIVER_CHANNELS;
+  std::vector<float> serial_samples(sample_count);
+  std::vector<float> parallel_samples(sample_count);
+  for (int block = 0; block < 100; ++block) {
+    int serial_frames = nativeformat::smartplayer::Player::driverRender(
+        serial_player.get(), serial_samples.data(),
+        NF_DRIVER_SAMPLE_BLOCK_SIZE);
+    int parallel_frames = nativeformat::smartplayer::Player::driverRender(
+        parallel_player.get(), parallel_samples.data(),
+        NF_DRIVER_SAMPLE_BLOCK_SIZE);
+    BOOST_REQUIRE_EQUAL(serial_frames, parallel_frames);
+    BOOST_REQUIRE(serial_samples == parallel_samples);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testRenderOffline) {
+  boost::asio::io_service io_service;
+  auto player = createTestPlayer(io_service);
+  BOOST_REQUIRE(
+      player->setJson(sineScoreString("com.nativeformat.graph:offline", 440.0))
+          .get()
+          ._loaded);
+  const std::string output_path = "nfsmartplayer_offline_test.wav";
+  auto offline_render = player->renderOffline(output_path, 0.0);
+  BOOST_REQUIRE_MESSAGE(offline_render._rendered, offline_render._error);
+  // The sine lasts two seconds, the last block it renders runs a little over
+  BOOST_CHECK_CLOSE(offline_render._render_time, 2.0, 5.0);
+  BOOST_CHECK_GT(offline_render._realtime_factor, 1.0);
+  const size_t frames = offline_render._render_time * 44100.0 + 0.5;
+  std::ifstream output_file(output_path,
+                            std::ifstream::ate | std::ifstream::binary);
+  BOOST_CHECK_EQUAL(static_cast<size_t>(output_file.tellg()),
+                    44 + frames * NF_DRIVER_CHANNELS * sizeof(int16_t));
+  std::remove(output_path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testRenderOfflineParallel) {
+  boost::asio::io_service io_service;
+  auto player = createTestPlayer(io_service);
+  BOOST_REQUIRE(
+      player
+          ->setJson(sineScoreString("com.nativeformat.graph:parallel", 440.0))
+          .get()
+          ._loaded);
+  const std::string output_path = "nfsmartplayer_parallel_test.wav";
+  nativeformat::smartplayer::OfflineRenderOptions options{4, 0.1, 0.01, true};
+  auto offline_render =
+      player->renderOfflineParallel(output_path, 2.5, options);
+  BOOST_REQUIRE_MESSAGE(offline_render._rendered, offline_render._error);
+  BOOST_CHECK_CLOSE(offline_render._render_time, 2.5, 0.1);
+  // Segments render the same sine as a serial render once pre-rolled
+  BOOST_CHECK_LT(offline_render._maximum_deviation, 1e-3f);
+  std::ifstream output_file(output_path,
+                            std::ifstream::ate | std::ifstream::binary);
+  BOOST_CHECK_EQUAL(static_cast<size_t>(output_file.tellg()),
+                    44 + 110250 * NF_DRIVER_CHANNELS * sizeof(int16_t));
+  std::remove(output_path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testRenderBlockSizeDoesNotChangeOutput) {
+  boost::asio::io_service io_service;
+  auto small_player = createTestPlayer(io_service, 1, 48000.0, 64);
+  auto large_player = createTestPlayer(io_service, 1, 48000.0, 4096);
+  BOOST_CHECK_EQUAL(small_player->sampleRate(), 48000.0);
+  BOOST_CHECK_EQUAL(small_player->blockFrames(), 64);
+  const std::string score =
+      sineScoreString("com.nativeformat.graph:blocks", 440.0);
+  BOOST_REQUIRE(small_player->setJson(score).get()._loaded);
+  BOOST_REQUIRE(large_player->setJson(score).get()._loaded);
+
+  // Ask for frames that don't line up with either block size
+  const int frame_count = 1000;
+  std::vector<float> small_samples(frame_count * NF_DRIVER_CHANNELS);
+  std::vector<float> large_samples(frame_count * NF_DRIVER_CHANNELS);
+  for (int callback = 0; callback < 20; ++callback) {
+    BOOST_REQUIRE_EQUAL(
+        nativeformat::smartplayer::Player::driverRender(
+            small_player.get(), small_samples.data(), frame_count),
+        frame_count);
+    BOOST_REQUIRE_EQUAL(
+        nativeformat::smartplayer::Player::driverRender(
+            large_player.get(), large_samples.data(), frame_count),
+        frame_count);
+    for (size_t i = 0; i < small_samples.size(); ++i) {
+      BOOST_REQUIRE_CLOSE_FRACTION(small_samples[i], large_samples[i], 1e-4);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testRenderOfflineAtSampleRate) {
+  boost::asio::io_service io_service;
+  auto player = createTestPlayer(io_service, 1, 48000.0, 256);
+  BOOST_REQUIRE(
+      player->setJson(sineScoreString("com.nativeformat.graph:rate", 440.0))
+          .get()
+          ._loaded);
+  const std::string output_path = "nfsmartplayer_rate_test.wav";
+  auto offline_render = player->renderOffline(output_path, 0.5);
+  BOOST_REQUIRE_MESSAGE(offline_render._rendered, offline_render._error);
+  BOOST_CHECK_CLOSE(offline_render._render_time, 0.5, 0.1);
+  std::ifstream output_file(output_path, std::ifstream::binary);
+  uint32_t sample_rate = 0;
+  output_file.seekg(24);
+  output_file.read(reinterpret_cast<char *>(&sample_rate),
+                   sizeof(sample_rate));
+  BOOST_CHECK_EQUAL(sample_rate, 48000);
+  output_file.seekg(0, std::ifstream::end);
+  BOOST_CHECK_EQUAL(static_cast<size_t>(output_file.tellg()),
+                    44 + 24000 * NF_DRIVER_CHANNELS * sizeof(int16_t));
+  std::remove(output_path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(testPlayAtSampleRateIsRejected) {
+  boost::asio::io_service io_service;
+  int errors = 0;
+  auto player = createTestPlayer(
+      io_service, 1, 48000.0, 256,
+      [&errors](nativeformat::Load::ERROR_INFO &info) {
+        errors += info.size();
+      });
+  // The sound card runs at the driver's rate, so this player can only render
+  // offline
+  player->setPlaying(true);
+  BOOST_CHECK(!player->isPlaying());
+  BOOST_CHECK_EQUAL(errors, 1);
+  BOOST_CHECK_EQUAL(player->sampleRate(), 48000.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
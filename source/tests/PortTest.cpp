@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <NFSmartPlayer/Plugin.h>
+#include <NFSmartPlayer/Port.h>
+
+BOOST_AUTO_TEST_SUITE(PortTests)
+
+using namespace nativeformat::plugin;
+
+BOOST_AUTO_TEST_CASE(testInternPort) {
+  BOOST_CHECK_EQUAL(internPort(AudioContentTypeKey), AudioPortId);
+  BOOST_CHECK_EQUAL(internPort("sidechain"), SidechainPortId);
+  const PortId port = internPort("com.nativeformat.port.test");
+  BOOST_CHECK_EQUAL(internPort("com.nativeformat.port.test"), port);
+  BOOST_CHECK(port != AudioPortId && port != SidechainPortId);
+  BOOST_CHECK_EQUAL(portName(port), "com.nativeformat.port.test");
+  BOOST_CHECK_EQUAL(portName(AudioPortId), AudioContentTypeKey);
+}
+
+BOOST_AUTO_TEST_CASE(testPortContent) {
+  PortContent content;
+  BOOST_CHECK(!content.has(AudioPortId));
+  BOOST_CHECK(content.find(AudioPortId) == nullptr);
+  auto audio = std::make_shared<Content>(16, 0, 44100.0, 2, 16,
+                                         ContentPayloadTypeBuffer);
+  content[AudioPortId] = audio;
+  BOOST_CHECK_EQUAL(content.find(AudioPortId), audio.get());
+  BOOST_CHECK_EQUAL(content.size(), 1);
+  for (PortId port = 1; port < PortContent::Capacity; ++port) {
+    content[port] = audio;
+  }
+  BOOST_CHECK_THROW(content[PortContent::Capacity], std::length_error);
+  content.clear();
+  BOOST_CHECK_EQUAL(content.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testPortContentMapRoundTrip) {
+  std::map<std::string, std::shared_ptr<Content>> content_map = {
+      {AudioContentTypeKey,
+       std::make_shared<Content>(16, 0, 44100.0, 2, 16,
+                                 ContentPayloadTypeBuffer)},
+      {"sidechain", std::make_shared<Content>(16, 0, 44100.0, 2, 16,
+                                              ContentPayloadTypeBuffer)}};
+  PortContent content(content_map);
+  BOOST_CHECK_EQUAL(content.find(AudioPortId),
+                    content_map[AudioContentTypeKey].get());
+  BOOST_CHECK_EQUAL(content.find(SidechainPortId),
+                    content_map["sidechain"].get());
+  std::map<std::string, std::shared_ptr<Content>> copied_map;
+  content.copyTo(copied_map);
+  BOOST_CHECK(copied_map == content_map);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
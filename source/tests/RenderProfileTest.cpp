@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <thread>
+
+#include "ExecutionPlan.h"
+#include "ProfiledPlugin.h"
+#include "RenderProfile.h"
+
+BOOST_AUTO_TEST_SUITE(RenderProfileTests)
+
+using namespace nativeformat::plugin;
+using namespace nativeformat::smartplayer;
+
+class IdlePlugin : public Plugin {
+ public:
+  IdlePlugin() : _feeds(0) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    _feeds++;
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {}
+  bool loaded() const override { return true; }
+  std::string name() override { return "com.nativeformat.plugin.idle"; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {}
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeProducer; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return true;
+  }
+
+  int _feeds;
+};
+
+// Takes a while to feed, before feeding from its input if it has one
+class BusyPlugin : public IdlePlugin {
+ public:
+  BusyPlugin(std::chrono::milliseconds busy_time,
+             const std::shared_ptr<Plugin> &input)
+      : _busy_time(busy_time), _input(input) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    IdlePlugin::feed(content, sample_index, graph_sample_index,
+                     loading_policy);
+    std::this_thread::sleep_for(_busy_time);
+    if (_input) {
+      _input->feed(content, sample_index, graph_sample_index, loading_policy);
+    }
+  }
+
+ private:
+  const std::chrono::milliseconds _busy_time;
+  const std::shared_ptr<Plugin> _input;
+};
+
+BOOST_AUTO_TEST_CASE(testRenderProfileStats) {
+  RenderProfile render_profile;
+  for (int i = 0; i < 99; ++i) {
+    render_profile.record(1000, 10000);
+  }
+  render_profile.record(1000000, 10000);
+  RenderStats stats = render_profile.stats();
+  BOOST_CHECK_EQUAL(stats._blocks, 100);
+  BOOST_CHECK_CLOSE(stats._mean_time, 10990.0e-9, 0.001);
+  BOOST_CHECK_CLOSE(stats._max_time, 1.0e-3, 0.001);
+  // The percentile is the top of its bucket, within a quarter octave
+  BOOST_CHECK_GE(stats._p99_time, 1000.0e-9);
+  BOOST_CHECK_LT(stats._p99_time, 1250.0e-9);
+  BOOST_CHECK_CLOSE(stats._load, 109.9, 0.001);
+
+  render_profile.reset();
+  stats = render_profile.stats();
+  BOOST_CHECK_EQUAL(stats._blocks, 0);
+  BOOST_CHECK_EQUAL(stats._max_time, 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(testRenderProfileDeadline) {
+  Content content(1024, 0, 44100.0, 2, 1024, ContentPayloadTypeBuffer);
+  BOOST_CHECK_EQUAL(RenderProfile::deadlineNanos(content),
+                    static_cast<long>(512 * 1.0e9 / 44100.0));
+}
+
+BOOST_AUTO_TEST_CASE(testProfiledPluginOnlyRecordsWhileProfiling) {
+  auto idle_plugin = std::make_shared<IdlePlugin>();
+  auto render_profile = std::make_shared<RenderProfile>();
+  auto profiling = std::make_shared<RenderProfiling>(false);
+  ProfiledPlugin profiled_plugin(idle_plugin, render_profile, profiling);
+  std::map<std::string, std::shared_ptr<Content>> content = {
+      {AudioContentTypeKey,
+       std::make_shared<Content>(64, 0, 44100.0, 2, 64,
+                                 ContentPayloadTypeBuffer)}};
+  profiled_plugin.feed(content, 0, 0,
+                       nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  BOOST_CHECK_EQUAL(render_profile->stats()._blocks, 0);
+
+  *profiling = true;
+  profiled_plugin.feed(content, 64, 64,
+                       nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  BOOST_CHECK_EQUAL(idle_plugin->_feeds, 2);
+  BOOST_CHECK_EQUAL(render_profile->stats()._blocks, 1);
+}
+
+BOOST_AUTO_TEST_CASE(testProfiledPluginLeavesOutItsInputs) {
+  auto profiling = std::make_shared<RenderProfiling>(true);
+  auto input_profile = std::make_shared<RenderProfile>();
+  MixerPlugin::Metadata metadata;
+  metadata._plugin = std::make_shared<ProfiledPlugin>(
+      std::make_shared<BusyPlugin>(std::chrono::milliseconds(20), nullptr),
+      input_profile, profiling);
+  metadata._edges = {{AudioContentTypeKey, AudioContentTypeKey}};
+  auto input = std::make_shared<PlanInputPlugin>(
+      std::vector<MixerPlugin::Metadata>{metadata}, 2, 44100.0);
+  auto render_profile = std::make_shared<RenderProfile>();
+  ProfiledPlugin profiled_plugin(
+      std::make_shared<BusyPlugin>(std::chrono::milliseconds(2), input),
+      render_profile, profiling, input);
+  std::map<std::string, std::shared_ptr<Content>> content = {
+      {AudioContentTypeKey,
+       std::make_shared<Content>(64, 0, 44100.0, 2, 64,
+                                 ContentPayloadTypeBuffer)}};
+  profiled_plugin.feed(content, 0, 0,
+                       nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+
+  // The input rendered recursively counts towards its own node alone
+  BOOST_CHECK_GE(input_profile->stats()._max_time, 0.02);
+  BOOST_CHECK_GE(render_profile->stats()._max_time, 0.002);
+  BOOST_CHECK_LT(render_profile->stats()._max_time, 0.02);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include "RenderThreadPool.h"
+
+BOOST_AUTO_TEST_SUITE(RenderThreadPoolTests)
+
+struct CountingContext {
+  std::vector<std::atomic<int>> counts;
+  explicit CountingContext(size_t size) : counts(size) {
+    for (auto &count : counts) {
+      count = 0;
+    }
+  }
+};
+
+static void countIndex(void *context, size_t index) {
+  static_cast<CountingContext *>(context)->counts[index]++;
+}
+
+BOOST_AUTO_TEST_CASE(testRenderThreadPoolThreads) {
+  nativeformat::smartplayer::RenderThreadPool pool(4);
+  BOOST_CHECK_EQUAL(pool.threads(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(testRenderThreadPoolRunsEveryIndexOnce) {
+  nativeformat::smartplayer::RenderThreadPool pool(4);
+  for (int block = 0; block < 1000; ++block) {
+    CountingContext context(7);
+    pool.parallelFor(context.counts.size(), &countIndex, &context);
+    for (const auto &count : context.counts) {
+      BOOST_REQUIRE_EQUAL(count.load(), 1);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testRenderThreadPoolSerial) {
+  nativeformat::smartplayer::RenderThreadPool pool(1);
+  CountingContext context(5);
+  pool.parallelFor(context.counts.size(), &countIndex, &context);
+  for (const auto &count : context.counts) {
+    BOOST_CHECK_EQUAL(count.load(), 1);
+  }
+}
+
+struct NestedContext {
+  nativeformat::smartplayer::RenderThreadPool *pool;
+  CountingContext inner;
+  NestedContext() : pool(nullptr), inner(16) {}
+};
+
+static void nestedIndex(void *context, size_t index) {
+  NestedContext *nested = static_cast<NestedContext *>(context);
+  CountingContext inner(4);
+  nested->pool->parallelFor(inner.counts.size(), &countIndex, &inner);
+  for (const auto &count : inner.counts) {
+    nested->inner.counts[index] += count;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testRenderThreadPoolNested) {
+  nativeformat::smartplayer::RenderThreadPool pool(3);
+  NestedContext context;
+  context.pool = &pool;
+  pool.parallelFor(context.inner.counts.size(), &nestedIndex, &context);
+  for (const auto &count : context.inner.counts) {
+    BOOST_CHECK_EQUAL(count.load(), 4);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2016 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <NFSmartPlayer/Registry.h>
+
+#include <future>
+
+#include "GraphImplementation.h"
+#include "SharedNodePlugin.h"
+
+BOOST_AUTO_TEST_SUITE(SharedNodePluginTests)
+
+using namespace nativeformat::plugin;
+
+class CountingPlugin : public Plugin {
+ public:
+  CountingPlugin() : _feeds(0), _loads(0) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    _feeds++;
+    auto &audio = content[AudioContentTypeKey];
+    audio->setItems(audio->requiredItems());
+    for (size_t i = 0; i < audio->items(); ++i) {
+      audio->payload()[i] = static_cast<float>(sample_index + i);
+    }
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {
+    _loads++;
+    _load_callback = callback;
+  }
+  bool loaded() const override { return !_load_callback; }
+  std::string name() override { return "com.nativeformat.plugin.counting"; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {}
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeProducer; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return true;
+  }
+
+  int _feeds;
+  int _loads;
+  nativeformat::LOAD_CALLBACK _load_callback;
+};
+
+static std::map<std::string, std::shared_ptr<Content>> createContent() {
+  return {{AudioContentTypeKey,
+           std::make_shared<Content>(64, 0, 44100.0, 2, 64,
+                                     ContentPayloadTypeBuffer)}};
+}
+
+BOOST_AUTO_TEST_CASE(testSharedNodeRendersOncePerPass) {
+  auto render_pass = std::make_shared<RenderPass>(0);
+  auto counting_plugin = std::make_shared<CountingPlugin>();
+  auto shared_plugin =
+      std::make_shared<SharedNodePlugin>(counting_plugin, render_pass);
+  auto first_content = createContent();
+  auto second_content = createContent();
+  shared_plugin->feed(first_content, 128, 128,
+                      nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  shared_plugin->feed(second_content, 128, 128,
+                      nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  BOOST_CHECK_EQUAL(counting_plugin->_feeds, 1);
+  BOOST_REQUIRE_EQUAL(second_content[AudioContentTypeKey]->items(), 64);
+  BOOST_CHECK(std::equal(first_content[AudioContentTypeKey]->payload(),
+                         first_content[AudioContentTypeKey]->payload() + 64,
+                         second_content[AudioContentTypeKey]->payload()));
+
+  // The next pass renders again, even for the same sample index
+  ++(*render_pass);
+  shared_plugin->feed(second_content, 128, 128,
+                      nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  BOOST_CHECK_EQUAL(counting_plugin->_feeds, 2);
+}
+
+// Renders how many samples it has rendered so far, whatever it is asked for
+class StatefulPlugin : public Plugin {
+ public:
+  StatefulPlugin() : _rendered_samples(0) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    auto &audio = content[AudioContentTypeKey];
+    audio->setItems(audio->requiredItems());
+    for (size_t i = 0; i < audio->items(); ++i) {
+      audio->payload()[i] = static_cast<float>(_rendered_samples++);
+    }
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {
+    callback(nativeformat::Load(true));
+  }
+  bool loaded() const override { return true; }
+  std::string name() override { return StatefulPluginKind; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {}
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeProducer; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return true;
+  }
+
+  static const char *StatefulPluginKind;
+
+ private:
+  long _rendered_samples;
+};
+
+const char *StatefulPlugin::StatefulPluginKind =
+    "com.nativeformat.plugin.test.stateful";
+
+// Feeds its input ahead of where it is when dilated, like a delay line
+class OffsetPlugin : public Plugin {
+ public:
+  OffsetPlugin(const std::shared_ptr<Plugin> &child_plugin, long offset)
+      : _child_plugin(child_plugin), _offset(offset) {}
+
+  void feed(std::map<std::string, std::shared_ptr<Content>> &content,
+            long sample_index, long graph_sample_index,
+            nfgrapher::LoadingPolicy loading_policy) override {
+    _child_plugin->feed(content, sample_index + _offset, graph_sample_index,
+                        loading_policy);
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {
+    _child_plugin->load(callback);
+  }
+  bool loaded() const override { return _child_plugin->loaded(); }
+  std::string name() override { return "com.nativeformat.plugin.test.offset"; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {
+    _child_plugin->run(sample_index + _offset, node_times, node_sample_index);
+  }
+  bool timeAligned() const override { return _offset == 0; }
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeConsumer; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    return true;
+  }
+
+ private:
+  const std::shared_ptr<Plugin> _child_plugin;
+  const long _offset;
+};
+
+static const std::string AlignedPluginKind =
+    "com.nativeformat.plugin.test.aligned";
+static const std::string DilatedPluginKind =
+    "com.nativeformat.plugin.test.dilated";
+
+class TestPluginFactory : public Factory {
+ public:
+  TestPluginFactory() : _stateful_plugins(0) {}
+
+  std::shared_ptr<Plugin> createPlugin(
+      const nfgrapher::Node &grapher_node, const std::string &graph_id,
+      const NF_PLUGIN_RESOLVE_CALLBACK &resolve_callback, int channels,
+      double samplerate, const std::shared_ptr<Plugin> &child_plugin,
+      const std::string &session_id) override {
+    if (grapher_node.kind == StatefulPlugin::StatefulPluginKind) {
+      _stateful_plugins++;
+      return std::make_shared<StatefulPlugin>();
+    }
+    return std::make_shared<OffsetPlugin>(
+        child_plugin, grapher_node.kind == DilatedPluginKind ? 64 : 0);
+  }
+  bool timeAligned(const nfgrapher::Node &grapher_node) const override {
+    return grapher_node.kind == AlignedPluginKind;
+  }
+  std::vector<std::string> identifiers() const override {
+    return {StatefulPlugin::StatefulPluginKind, AlignedPluginKind,
+            DilatedPluginKind};
+  }
+
+  int _stateful_plugins;
+};
+
+class RenderingGraph : public nativeformat::smartplayer::GraphImplementation {
+ public:
+  using GraphImplementation::GraphImplementation;
+  using GraphImplementation::traverse;
+};
+
+// Loads a stateful node feeding two consumers of the given kinds, and
+// returns what the graph renders over a few blocks
+static std::vector<float> renderFanOut(
+    const std::shared_ptr<TestPluginFactory> &factory,
+    const std::string &first_kind, const std::string &second_kind) {
+  auto graph = std::make_shared<RenderingGraph>(
+      2, 44100.0, nativeformat::smartplayer::createGraphSessionId());
+  graph->setPluginRegistry(std::make_shared<Registry>(
+      std::vector<std::shared_ptr<Factory>>({factory}),
+      [](const std::string &plugin_namespace,
+         const std::string &variable_name) { return ""; }));
+  auto node = [](const std::string &id, const std::string &kind) {
+    return nlohmann::json{{"id", id},
+                          {"kind", kind},
+                          {"config", nlohmann::json::object()},
+                          {"params", nlohmann::json::object()}};
+  };
+  auto edge = [](const std::string &id, const std::string &source,
+                 const std::string &target) {
+    return nlohmann::json{{"id", id},
+                          {"source", source},
+                          {"target", target},
+                          {"sourcePort", nullptr},
+                          {"targetPort", nullptr}};
+  };
+  nlohmann::json score = {
+      {"version", nfgrapher::version()},
+      {"graph",
+       {{"id", "com.nativeformat.graph:fan-out"},
+        {"nodes",
+         nlohmann::json::array(
+             {node("source", StatefulPlugin::StatefulPluginKind),
+              node("first", first_kind), node("second", second_kind)})},
+        {"edges", nlohmann::json::array(
+                      {edge("source-first", "source", "first"),
+                       edge("source-second", "source", "second")})},
+        {"scripts", nlohmann::json::array()}}}};
+  std::promise<bool> loaded;
+  graph->setJson(score.dump(), [&loaded](const nativeformat::Load &load) {
+    loaded.set_value(load._loaded);
+  });
+  BOOST_REQUIRE(loaded.get_future().get());
+
+  std::vector<float> rendered;
+  std::map<std::string, std::shared_ptr<Content>> content = createContent();
+  for (int block = 0; block < 4; ++block) {
+    content[AudioContentTypeKey]->erase();
+    graph->traverse(content, nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+    const auto &audio = *content[AudioContentTypeKey];
+    rendered.insert(rendered.end(), audio.constPayload(),
+                    audio.constPayload() + audio.items());
+  }
+  return rendered;
+}
+
+BOOST_AUTO_TEST_CASE(testSharedNodeRendersDilatedTime) {
+  // Each consumer hears every sample the stateful node renders once
+  std::vector<float> expected;
+  for (int i = 0; i < 4 * 64; ++i) {
+    expected.push_back(2.0f * i);
+  }
+
+  // Consumers in step with the graph share a single stateful node, which
+  // renders once per block for both of them
+  auto aligned_factory = std::make_shared<TestPluginFactory>();
+  const auto aligned_rendered =
+      renderFanOut(aligned_factory, AlignedPluginKind, AlignedPluginKind);
+  BOOST_CHECK_EQUAL(aligned_factory->_stateful_plugins, 1);
+  BOOST_CHECK_EQUAL_COLLECTIONS(aligned_rendered.begin(),
+                                aligned_rendered.end(), expected.begin(),
+                                expected.end());
+
+  // One asking for another sample index gets a node of its own, rather than
+  // moving on the state of the node the other consumer hears
+  auto dilated_factory = std::make_shared<TestPluginFactory>();
+  const auto dilated_rendered =
+      renderFanOut(dilated_factory, AlignedPluginKind, DilatedPluginKind);
+  BOOST_CHECK_EQUAL(dilated_factory->_stateful_plugins, 2);
+  BOOST_CHECK_EQUAL_COLLECTIONS(dilated_rendered.begin(),
+                                dilated_rendered.end(), expected.begin(),
+                                expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(testSharedNodeLoadsOnce) {
+  auto render_pass = std::make_shared<RenderPass>(0);
+  auto counting_plugin = std::make_shared<CountingPlugin>();
+  auto shared_plugin =
+      std::make_shared<SharedNodePlugin>(counting_plugin, render_pass);
+  int callbacks = 0;
+  shared_plugin->load([&callbacks](nativeformat::Load load) { callbacks++; });
+  shared_plugin->load([&callbacks](nativeformat::Load load) { callbacks++; });
+  BOOST_CHECK_EQUAL(counting_plugin->_loads, 1);
+  BOOST_CHECK_EQUAL(callbacks, 0);
+  counting_plugin->_load_callback(nativeformat::Load(true));
+  BOOST_CHECK_EQUAL(callbacks, 2);
+  shared_plugin->load([&callbacks](nativeformat::Load load) { callbacks++; });
+  BOOST_CHECK_EQUAL(counting_plugin->_loads, 1);
+  BOOST_CHECK_EQUAL(callbacks, 3);
+}
+
+BOOST_AUTO_TEST_CASE(testSharedNodeLoadsAgainAfterFailing) {
+  auto render_pass = std::make_shared<RenderPass>(0);
+  auto counting_plugin = std::make_shared<CountingPlugin>();
+  auto shared_plugin =
+      std::make_shared<SharedNodePlugin>(counting_plugin, render_pass);
+  int failures = 0;
+  shared_plugin->load([&failures](nativeformat::Load load) {
+    failures += load._loaded ? 0 : 1;
+  });
+  counting_plugin->_load_callback(nativeformat::Load(false));
+  BOOST_CHECK_EQUAL(failures, 1);
+
+  // As when a reload keeps the node, the failure isn't handed out again
+  bool loaded = false;
+  shared_plugin->load(
+      [&loaded](nativeformat::Load load) { loaded = load._loaded; });
+  BOOST_CHECK_EQUAL(counting_plugin->_loads, 2);
+  counting_plugin->_load_callback(nativeformat::Load(true));
+  BOOST_CHECK(loaded);
+  BOOST_CHECK_EQUAL(failures, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
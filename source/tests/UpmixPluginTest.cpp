@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2018 Spotify AB.
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "UpmixPlugin.h"
+
+BOOST_AUTO_TEST_SUITE(UpmixPluginTests)
+
+using namespace nativeformat::plugin;
+
+class MonoPlugin : public PortPlugin {
+ public:
+  explicit MonoPlugin(bool silent)
+      : _silent(silent),
+        _sample_index(-1),
+        _channels(0),
+        _should_process_sample_index(-1) {}
+
+  void feedPorts(PortContent &content, long sample_index,
+                 long graph_sample_index,
+                 nfgrapher::LoadingPolicy loading_policy) override {
+    Content &audio = *content[AudioPortId];
+    _sample_index = sample_index;
+    _channels = audio.channels();
+    audio.setItems(audio.requiredItems());
+    if (_silent) {
+      return;
+    }
+    for (size_t i = 0; i < audio.items(); ++i) {
+      audio.payload()[i] = static_cast<float>(sample_index + i);
+    }
+  }
+  void load(nativeformat::LOAD_CALLBACK callback) override {}
+  bool loaded() const override { return true; }
+  std::string name() override { return "com.nativeformat.plugin.mono"; }
+  void run(long sample_index, const NodeTimes &node_times,
+           long node_sample_index) override {}
+  bool finished(long sample_index, long sample_index_end) override {
+    return false;
+  }
+  PluginType type() const override { return PluginTypeProducer; }
+  long startSampleIndex() override { return 100; }
+  bool shouldProcess(long sample_index_start, long sample_index_end) override {
+    _should_process_sample_index = sample_index_start;
+    return true;
+  }
+
+  const bool _silent;
+  long _sample_index;
+  size_t _channels;
+  long _should_process_sample_index;
+};
+
+static PortContent createContent() {
+  PortContent content;
+  content[AudioPortId] = std::make_shared<Content>(64, 0, 44100.0, 2, 64,
+                                                   ContentPayloadTypeBuffer);
+  return content;
+}
+
+BOOST_AUTO_TEST_CASE(testUpmixRepeatsMonoAcrossChannels) {
+  auto mono_plugin = std::make_shared<MonoPlugin>(false);
+  UpmixPlugin upmix_plugin(mono_plugin, 1, 2);
+  auto content = createContent();
+  upmix_plugin.feedPorts(content, 128, 128,
+                         nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  // The mono branch counts its own frames
+  BOOST_CHECK_EQUAL(mono_plugin->_sample_index, 64);
+  BOOST_CHECK_EQUAL(mono_plugin->_channels, 1);
+  const Content &audio = *content[AudioPortId];
+  BOOST_REQUIRE_EQUAL(audio.items(), 64);
+  BOOST_CHECK(!audio.silent());
+  for (size_t i = 0; i < audio.items(); ++i) {
+    BOOST_CHECK_EQUAL(audio.constPayload()[i], 64.0f + i / 2);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testUpmixKeepsSilence) {
+  auto mono_plugin = std::make_shared<MonoPlugin>(true);
+  UpmixPlugin upmix_plugin(mono_plugin, 1, 2);
+  auto content = createContent();
+  upmix_plugin.feedPorts(content, 0, 0,
+                         nfgrapher::LoadingPolicy::ALL_CONTENT_PLAYTHROUGH);
+  const Content &audio = *content[AudioPortId];
+  BOOST_CHECK_EQUAL(audio.items(), 64);
+  BOOST_CHECK(audio.silent());
+}
+
+BOOST_AUTO_TEST_CASE(testUpmixConvertsSampleIndices) {
+  auto mono_plugin = std::make_shared<MonoPlugin>(false);
+  UpmixPlugin upmix_plugin(mono_plugin, 1, 2);
+  BOOST_CHECK_EQUAL(upmix_plugin.startSampleIndex(), 200);
+  upmix_plugin.shouldProcess(512, 576);
+  BOOST_CHECK_EQUAL(mono_plugin->_should_process_sample_index, 256);
+}
+
+BOOST_AUTO_TEST_SUITE_END()